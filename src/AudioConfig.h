@@ -0,0 +1,22 @@
+#ifndef AudioConfig_h
+#define AudioConfig_h
+
+#include <Audio.h>
+
+// sample rate and block size of the audio engine
+// both are defined in the Teensy core (AUDIO_SAMPLE_RATE_EXACT and AUDIO_BLOCK_SAMPLES in AudioStream.h), see Code.md
+// audio code should derive sample counts, frequencies and times from these instead of using hard-coded values
+
+// sample rate in Hz
+constexpr float AUDIO_SAMPLE_RATE{AUDIO_SAMPLE_RATE_EXACT};
+
+// maximum frequency passed to arbitraryWaveform(), the oscillators can play up to the nyquist frequency
+constexpr float ARBITRARY_WAVEFORM_MAX_FREQ{AUDIO_SAMPLE_RATE / 2.0f};
+
+// duration of a single audio block in milliseconds
+constexpr float AUDIO_BLOCK_MS{AUDIO_BLOCK_SAMPLES * 1000.0f / AUDIO_SAMPLE_RATE};
+
+// audio output latency in milliseconds: one block being calculated and one block being transmitted by the I2S DMA
+constexpr float AUDIO_OUTPUT_LATENCY_MS{2.0f * AUDIO_BLOCK_MS};
+
+#endif
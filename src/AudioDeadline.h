@@ -0,0 +1,72 @@
+#ifndef AudioDeadline_h
+#define AudioDeadline_h
+
+#include <stdint.h>
+#include <algorithm>
+
+#include <Audio.h>
+#include "AudioConfig.h"
+
+/**
+ * Audio update deadline statistics, measured by the Teensy Audio library.
+ * The audio update interrupt stores the CPU cycles taken by the longest audio update in AudioStream::cpu_cycles_total_max.
+ * poll() takes and resets it from the main loop, an audio update taking the audio block period or longer missed its
+ * deadline: the block it calculated was late for the audio output. Audio updates postponed by an audio transaction are
+ * counted by AudioTransaction.
+ *
+ * poll() takes the maximum of all audio updates since the last poll, so a poll counts at most one miss: the number of
+ * misses is a lower bound when the main loop takes longer than an audio block.
+ * Takes over the maximum CPU usage from the Audio library, use getUsageMax() instead of AudioProcessorUsageMax().
+ * To be used from the main program only, not from interrupts.
+ */
+class AudioDeadline
+{
+private:
+    // AudioStream::cpu_cycles_total counts units of 64 CPU cycles
+    static const uint8_t CYCLES_PER_UNIT{64};
+
+    // statistics
+    static inline uint32_t maxCycles{0};
+    static inline uint32_t misses{0};
+
+public:
+    /**
+     * Take the longest audio update since the last poll and count a miss if it took an audio block or longer.
+     * Call every main loop.
+     */
+    static void poll()
+    {
+        __disable_irq();
+        uint32_t cycles = AudioStream::cpu_cycles_total_max * CYCLES_PER_UNIT;
+        AudioStream::cpu_cycles_total_max = 0;
+        __enable_irq();
+
+        maxCycles = std::max(maxCycles, cycles);
+        if (cycles / (F_CPU_ACTUAL / 1000000) >= AUDIO_BLOCK_MS * 1000.0f)
+        {
+            misses++;
+        }
+    }
+
+    /**
+     * Get the maximum audio CPU usage since the statistics were reset, like AudioProcessorUsageMax().
+     *
+     * @return float CPU usage in percent of the audio block period
+     */
+    static float getUsageMax()
+    {
+        return maxCycles * 100000.0f / F_CPU_ACTUAL / AUDIO_BLOCK_MS;
+    }
+
+    /**
+     * Log the statistics since the last call and reset them.
+     */
+    static void logStats()
+    {
+        Serial.printf("audio updates: %.1fus max, %d missed the audio block (%.3fms)\n", maxCycles * 1000000.0f / F_CPU_ACTUAL, misses, AUDIO_BLOCK_MS);
+        maxCycles = 0;
+        misses = 0;
+    }
+};
+
+#endif
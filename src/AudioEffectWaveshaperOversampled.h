@@ -0,0 +1,370 @@
+#ifndef AudioEffectWaveshaperOversampled_h
+#define AudioEffectWaveshaperOversampled_h
+
+#include <stdint.h>
+#include <array>
+#include <atomic>
+#include <algorithm>
+
+#include <Audio.h>
+
+#include "ControlSmoother.h"
+#include "HalfBandFilter.h"
+
+/**
+ * Q15 waveshape table of 2^BITS + 1 entries, shared by all AudioEffectWaveshaperOversampled objects of the synth.
+ * The contents are published by swapping a single pointer, so the audio update never sees a partially written table.
+ */
+class WaveshapeTable
+{
+public:
+    // table size as a power of 2, 513 entries
+    static constexpr uint8_t BITS{9};
+    static constexpr uint16_t SIZE{(1 << BITS) + 1};
+
+    /**
+     * Get the table that is currently published.
+     *
+     * @return table or nullptr if no table has been published yet
+     */
+    const int16_t *load() const
+    {
+        return published.load(std::memory_order_acquire);
+    }
+
+    /**
+     * Publish a table.
+     * The previous table is no longer in use as soon as this function returns: audio updates run in an interrupt and
+     * always complete before the main program continues, so the previous table can be overwritten.
+     *
+     * @param table table of SIZE entries
+     */
+    void publish(const int16_t *table)
+    {
+        published.store(table, std::memory_order_release);
+    }
+
+private:
+    std::atomic<const int16_t *> published{nullptr};
+};
+
+/**
+ * Stereo waveshaper with selectable 1x, 2x or 4x oversampling, replacing a pair of AudioEffectWaveshaper objects.
+ *
+ * Input 0 and 1 (left and right) are processed together in a single update, output 0 and 1 contain the mix of the clean
+ * and the shaped signal (see mix()). The clean signal is delayed by the same amount as the oversampling filters, so mixing
+ * doesn't cause comb filtering.
+ *
+ * The shape is a Q15 table with linear interpolation. The table is not copied, it's owned by the caller
+ * and shared by all voices (see WaveshapeTable), which saves 2 * 1026 bytes per voice compared to AudioEffectWaveshaper.
+ *
+ * Both channels are shaped and filtered in a single pass as packed 16 bit stereo samples, the filters multiply and
+ * accumulate the left and right sample pairs with the DSP extension (see HalfBandFilter.h). The samples are saturated to
+ * 16 bits between the filter stages, at 1x and 2x the output is the same as shaping each channel on its own.
+ *
+ * Up and down sampling uses polyphase half-band filters (see HalfBandFilter.h):
+ * 2x: 31 tap filter, latency 15 samples (0.34ms)
+ * 4x: 31 tap filter for 1x <-> 2x, 11 tap filter for 2x <-> 4x, latency 18 samples (0.41ms), also suppresses aliasing
+ *     of the higher harmonics that fold back from above 2x the sample rate
+ *
+ * Aliasing of a full scale 7khz sine relative to the output, measured by test/test_waveshaper_oversampled:
+ * waveshape level   1x      2x      4x
+ * 0.02              -26dB   -59dB   -77dB
+ * 0.1               -14dB   -26dB   -48dB
+ *
+ * Estimated CPU cost per voice (stereo) at 912mhz (see platformio.ini), based on instruction counts of the inner loops,
+ * not measured on the synth yet:
+ * 1x: ~25 cycles per stereo sample, 0.12% CPU
+ * 2x: ~140 cycles per stereo sample, 0.7% CPU
+ * 4x: ~270 cycles per stereo sample, 1.3% CPU
+ * Multiply by NUM_VOICES for the total. Use DEBUG_CPU_USAGE in main.cpp to see the actual numbers (processorUsageMax()).
+ * When the shaped signal is muted (mix() with shapeGain 0), the shaper and filters are skipped and only the clean signal is passed.
+ * Changes of the mix are smoothed, see ControlSmoother.
+ */
+class AudioEffectWaveshaperOversampled : public AudioStream
+{
+public:
+    AudioEffectWaveshaperOversampled() : AudioStream(2, inputQueueArray) {}
+
+    /**
+     * Set the waveshape table.
+     * The table must stay valid as long as it's in use by this object, it's read once at the start of every update.
+     *
+     * @param table shared waveshape table
+     */
+    void shape(const WaveshapeTable &table)
+    {
+        waveshapeTable = &table;
+    }
+
+    /**
+     * Set the oversampling factor.
+     *
+     * @param factor 1, 2 or 4, other values are rounded down
+     */
+    void oversampling(const uint8_t factor)
+    {
+        oversamplingFactor = factor >= 4 ? 4 : factor >= 2 ? 2 : 1;
+    }
+
+    /**
+     * Set the gain of the clean and the shaped signal, changes are smoothed (see ControlSmoother).
+     *
+     * @param cleanGain gain of the clean signal (0.0f - 1.0f)
+     * @param shapeGain gain of the shaped signal (0.0f - 1.0f)
+     */
+    void mix(const float cleanGain, const float shapeGain)
+    {
+        cleanGainSmoother.set(constrain(cleanGain, 0.0f, 1.0f));
+        shapeGainSmoother.set(constrain(shapeGain, 0.0f, 1.0f));
+    }
+
+    virtual void update(void)
+    {
+        audio_block_t *blockL = receiveWritable(0);
+        audio_block_t *blockR = receiveWritable(1);
+
+        if (blockL == nullptr && blockR == nullptr)
+        {
+            // silence, the shape is expected to map 0 to 0, so only the history needs to be cleared
+            if (!cleared)
+            {
+                reset();
+                cleanDelayL.fill(0);
+                cleanDelayR.fill(0);
+            }
+            return;
+        }
+
+        // all processing is done in place, a missing channel is processed as silence to keep both channels aligned
+        if (blockL == nullptr)
+        {
+            blockL = allocate();
+            if (blockL == nullptr)
+            {
+                release(blockR);
+                return;
+            }
+            std::fill(blockL->data, blockL->data + AUDIO_BLOCK_SAMPLES, 0);
+        }
+        if (blockR == nullptr)
+        {
+            blockR = allocate();
+            if (blockR == nullptr)
+            {
+                release(blockL);
+                return;
+            }
+            std::fill(blockR->data, blockR->data + AUDIO_BLOCK_SAMPLES, 0);
+        }
+
+        const uint8_t factor = oversamplingFactor;
+        if (factor != activeOversamplingFactor)
+        {
+            activeOversamplingFactor = factor;
+            reset();
+        }
+
+        // read the table once, a new table may be published at any time but only becomes active at the next update
+        const int16_t *table = waveshapeTable == nullptr ? nullptr : waveshapeTable->load();
+
+        float cleanGain;
+        float cleanGainIncrement;
+        cleanGainSmoother.next(cleanGain, cleanGainIncrement);
+        const bool shaped = table != nullptr && !shapeGainSmoother.isSteadyAt(0.0f);
+        float shapeGain;
+        float shapeGainIncrement;
+        shapeGainSmoother.next(shapeGain, shapeGainIncrement);
+
+        // packed stereo samples, both channels are shaped and filtered together
+        std::array<uint32_t, AUDIO_BLOCK_SAMPLES> shapedStereo;
+        if (shaped)
+        {
+            cleared = false;
+            for (uint16_t i = 0; i < AUDIO_BLOCK_SAMPLES; i++)
+            {
+                shapedStereo[i] = packStereo(blockL->data[i], blockR->data[i]);
+            }
+            switch (factor)
+            {
+            case 1:
+                shape1x(table, shapedStereo.data());
+                break;
+            case 2:
+                shape2x(table, shapedStereo.data());
+                break;
+            default:
+                shape4x(table, shapedStereo.data());
+                break;
+            }
+        }
+        else if (!cleared)
+        {
+            // restart the filters from silence when the shaped signal is unmuted again
+            reset();
+        }
+
+        const uint8_t latency = factor == 1 ? 0 : factor == 2 ? LATENCY_2X : LATENCY_4X;
+        delayClean(blockL->data, cleanDelayL, latency);
+        delayClean(blockR->data, cleanDelayR, latency);
+
+        for (uint16_t i = 0; i < AUDIO_BLOCK_SAMPLES; i++)
+        {
+            const float clean = cleanGain + cleanGainIncrement * (i + 1);
+            float l = blockL->data[i] * clean;
+            float r = blockR->data[i] * clean;
+            if (shaped)
+            {
+                const float shape = shapeGain + shapeGainIncrement * (i + 1);
+                l += stereoLeft(shapedStereo[i]) * shape;
+                r += stereoRight(shapedStereo[i]) * shape;
+            }
+            blockL->data[i] = saturate16((int32_t)l);
+            blockR->data[i] = saturate16((int32_t)r);
+        }
+
+        transmit(blockL, 0);
+        transmit(blockR, 1);
+        release(blockL);
+        release(blockR);
+    }
+
+private:
+    audio_block_t *inputQueueArray[2];
+
+    using Interpolator1 = StereoHalfBandInterpolator<8, HALF_BAND_COEFFICIENTS_31, AUDIO_BLOCK_SAMPLES>;
+    using Decimator1 = StereoHalfBandDecimator<8, HALF_BAND_COEFFICIENTS_31, AUDIO_BLOCK_SAMPLES>;
+    using Interpolator2 = StereoHalfBandInterpolator<3, HALF_BAND_COEFFICIENTS_11, AUDIO_BLOCK_SAMPLES * 2>;
+    using Decimator2 = StereoHalfBandDecimator<3, HALF_BAND_COEFFICIENTS_11, AUDIO_BLOCK_SAMPLES * 2>;
+
+    // total latency in samples, the 2x <-> 4x filters have a latency of 5 samples at 2x, 1 sample is added to get a whole number at 1x
+    static constexpr uint8_t LATENCY_2X{Interpolator1::LATENCY + Decimator1::LATENCY / 2};
+    static constexpr uint8_t LATENCY_4X{LATENCY_2X + (Interpolator2::LATENCY + Decimator2::LATENCY / 2 + 1) / 2};
+
+    // filter state of both channels
+    Interpolator1 interpolator1;
+    Decimator1 decimator1;
+    Interpolator2 interpolator2;
+    Decimator2 decimator2;
+    // 1 sample delay at 2x for 4x oversampling
+    uint32_t delay4x{0};
+
+    // delay lines for the clean signal, history followed by the current block
+    using CleanDelay = std::array<int16_t, LATENCY_4X + AUDIO_BLOCK_SAMPLES>;
+    CleanDelay cleanDelayL{};
+    CleanDelay cleanDelayR{};
+
+    const WaveshapeTable *waveshapeTable{nullptr};
+    volatile uint8_t oversamplingFactor{1};
+    uint8_t activeOversamplingFactor{1};
+    ControlSmoother cleanGainSmoother{1.0f};
+    ControlSmoother shapeGainSmoother{0.0f};
+    bool cleared{true};
+
+    static int16_t saturate16(const int32_t value)
+    {
+        return (int16_t)constrain(value, -32768, 32767);
+    }
+
+    /**
+     * Clear the filter state of both channels, the clean delay lines are kept intact.
+     */
+    void reset()
+    {
+        interpolator1.reset();
+        decimator1.reset();
+        interpolator2.reset();
+        decimator2.reset();
+        delay4x = 0;
+        cleared = true;
+    }
+
+    /**
+     * Look up a sample in the waveshape table using linear interpolation.
+     *
+     * @param table waveshape table
+     * @param sample input sample, clipped to the 16 bit range
+     * @return shaped sample
+     */
+    static inline int32_t shapeSample(const int16_t *table, int32_t sample)
+    {
+        constexpr uint8_t shift = 16 - WaveshapeTable::BITS;
+        const uint32_t position = (uint32_t)(constrain(sample, -32768, 32767) + 32768);
+        const uint32_t index = position >> shift;
+        const int32_t fraction = position & ((1 << shift) - 1);
+        const int32_t a = table[index];
+        const int32_t b = table[index + 1];
+        return a + (((b - a) * fraction) >> shift);
+    }
+
+    /**
+     * Shape both channels of a packed stereo sample.
+     */
+    static inline uint32_t shapeStereo(const int16_t *table, const uint32_t sample)
+    {
+        return packStereo(shapeSample(table, stereoLeft(sample)), shapeSample(table, stereoRight(sample)));
+    }
+
+    /**
+     * Shape both channels in place without oversampling.
+     */
+    void shape1x(const int16_t *table, uint32_t *samples) const
+    {
+        for (uint16_t i = 0; i < AUDIO_BLOCK_SAMPLES; i++)
+        {
+            samples[i] = shapeStereo(table, samples[i]);
+        }
+    }
+
+    /**
+     * Shape both channels in place with 2x oversampling.
+     */
+    void shape2x(const int16_t *table, uint32_t *samples)
+    {
+        std::array<uint32_t, AUDIO_BLOCK_SAMPLES * 2> samples2x;
+
+        interpolator1.process(samples, samples2x.data(), AUDIO_BLOCK_SAMPLES);
+        for (auto &sample : samples2x)
+        {
+            sample = shapeStereo(table, sample);
+        }
+        decimator1.process(samples2x.data(), samples, AUDIO_BLOCK_SAMPLES);
+    }
+
+    /**
+     * Shape both channels in place with 4x oversampling.
+     */
+    void shape4x(const int16_t *table, uint32_t *samples)
+    {
+        std::array<uint32_t, AUDIO_BLOCK_SAMPLES * 2> samples2x;
+        std::array<uint32_t, AUDIO_BLOCK_SAMPLES * 4> samples4x;
+
+        interpolator1.process(samples, samples2x.data(), AUDIO_BLOCK_SAMPLES);
+        interpolator2.process(samples2x.data(), samples4x.data(), AUDIO_BLOCK_SAMPLES * 2);
+        for (auto &sample : samples4x)
+        {
+            sample = shapeStereo(table, sample);
+        }
+        decimator2.process(samples4x.data(), samples2x.data(), AUDIO_BLOCK_SAMPLES * 2);
+
+        // delay by 1 sample to align the 2x signal to whole samples at 1x
+        for (auto &sample : samples2x)
+        {
+            std::swap(sample, delay4x);
+        }
+
+        decimator1.process(samples2x.data(), samples, AUDIO_BLOCK_SAMPLES);
+    }
+
+    /**
+     * Delay the clean signal in place to match the latency of the oversampling filters.
+     */
+    void delayClean(int16_t *data, CleanDelay &buffer, const uint8_t latency) const
+    {
+        std::copy(data, data + AUDIO_BLOCK_SAMPLES, buffer.begin() + LATENCY_4X);
+        std::copy(buffer.begin() + LATENCY_4X - latency, buffer.begin() + LATENCY_4X - latency + AUDIO_BLOCK_SAMPLES, data);
+        std::copy(buffer.begin() + AUDIO_BLOCK_SAMPLES, buffer.end(), buffer.begin());
+    }
+};
+
+#endif
@@ -0,0 +1,161 @@
+#ifndef AudioMixerSmoothed4_h
+#define AudioMixerSmoothed4_h
+
+#include <stdint.h>
+#include <array>
+
+#include <Audio.h>
+
+#include "ControlSmoother.h"
+
+/**
+ * 4 channel mixer with smoothed gains and a smoothed DC offset, a drop-in replacement for AudioMixer4.
+ *
+ * Gain changes ramp linearly over TRANSITION_SPEED_MS (see ControlSmoother) instead of jumping, which prevents zipper
+ * noise and clicks when parameters are changed. The offset replaces an AudioSynthWaveformDc connected to one of the
+ * inputs just for smoothing a static control value, saving an audio object and a patch cord.
+ *
+ * Inputs without a block and inputs with a gain of 0 are skipped. With a single active input at a steady gain of 1.0
+ * and no offset, the input block is passed through without processing.
+ */
+class AudioMixerSmoothed4 : public AudioStream
+{
+public:
+    AudioMixerSmoothed4() : AudioStream(4, inputQueueArray) {}
+
+    /**
+     * Set the gain of a channel.
+     *
+     * @param channel channel (0 - 3)
+     * @param level gain (-32767.0f - 32767.0f, like AudioMixer4)
+     */
+    void gain(unsigned int channel, float level)
+    {
+        if (channel >= gains.size())
+        {
+            return;
+        }
+        gains[channel].set(constrain(level, -32767.0f, 32767.0f));
+    }
+
+    /**
+     * Set the DC offset added to the output.
+     *
+     * @param level offset (-1.0f - 1.0f, like AudioSynthWaveformDc)
+     */
+    void offset(float level)
+    {
+        dcOffset.set(constrain(level, -1.0f, 1.0f));
+    }
+
+    virtual void update(void)
+    {
+        std::array<audio_block_t *, 4> blocks;
+        std::array<float, 4> starts;
+        std::array<float, 4> increments;
+
+        uint8_t activeChannels{0};
+        uint8_t passThroughChannel{0};
+        bool steady{true};
+        for (uint8_t channel = 0; channel < blocks.size(); channel++)
+        {
+            blocks[channel] = receiveReadOnly(channel);
+            bool changing = gains[channel].next(starts[channel], increments[channel]);
+            if (blocks[channel] != nullptr && (changing || starts[channel] != 0.0f))
+            {
+                activeChannels++;
+                passThroughChannel = channel;
+                steady = steady && !changing && starts[channel] == 1.0f;
+            }
+        }
+
+        float offsetStart;
+        float offsetIncrement;
+        bool offsetChanging = dcOffset.next(offsetStart, offsetIncrement);
+        bool hasOffset = offsetChanging || offsetStart != 0.0f;
+
+        if (activeChannels == 1 && steady && !hasOffset)
+        {
+            transmit(blocks[passThroughChannel]);
+            releaseAll(blocks);
+            return;
+        }
+
+        if (activeChannels == 0 && !hasOffset)
+        {
+            releaseAll(blocks);
+            return;
+        }
+
+        audio_block_t *output = allocate();
+        if (output == nullptr)
+        {
+            releaseAll(blocks);
+            return;
+        }
+
+        std::array<float, AUDIO_BLOCK_SAMPLES> mix;
+        for (uint16_t i = 0; i < AUDIO_BLOCK_SAMPLES; i++)
+        {
+            mix[i] = 32767.0f * (offsetStart + offsetIncrement * (i + 1));
+        }
+
+        for (uint8_t channel = 0; channel < blocks.size(); channel++)
+        {
+            const audio_block_t *block = blocks[channel];
+            if (block == nullptr)
+            {
+                continue;
+            }
+
+            const float start = starts[channel];
+            const float increment = increments[channel];
+            if (increment == 0.0f)
+            {
+                if (start == 0.0f)
+                {
+                    continue;
+                }
+                for (uint16_t i = 0; i < AUDIO_BLOCK_SAMPLES; i++)
+                {
+                    mix[i] += block->data[i] * start;
+                }
+            }
+            else
+            {
+                for (uint16_t i = 0; i < AUDIO_BLOCK_SAMPLES; i++)
+                {
+                    mix[i] += block->data[i] * (start + increment * (i + 1));
+                }
+            }
+        }
+
+        for (uint16_t i = 0; i < AUDIO_BLOCK_SAMPLES; i++)
+        {
+            output->data[i] = (int16_t)constrain((int32_t)mix[i], -32768, 32767);
+        }
+
+        transmit(output);
+        release(output);
+        releaseAll(blocks);
+    }
+
+private:
+    audio_block_t *inputQueueArray[4];
+
+    std::array<ControlSmoother, 4> gains{{ControlSmoother(1.0f), ControlSmoother(1.0f), ControlSmoother(1.0f), ControlSmoother(1.0f)}};
+    ControlSmoother dcOffset{0.0f};
+
+    void releaseAll(std::array<audio_block_t *, 4> &blocks)
+    {
+        for (auto block : blocks)
+        {
+            if (block != nullptr)
+            {
+                release(block);
+            }
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,455 @@
+#ifndef AudioSynthFmOperator_h
+#define AudioSynthFmOperator_h
+
+#include <stdint.h>
+#include <array>
+#include <math.h>
+
+#include <Audio.h>
+
+#include "HalfBandFilter.h"
+
+/**
+ * Wavetable FM (phase modulation) operator with optional 2x oversampling, replacing an AudioSynthWaveformModulated
+ * in phase modulation mode together with the AudioEffectMultiply that applied the modulation index.
+ *
+ * Input 0: modulator (audio)
+ * Input 1: modulation index (control signal, 1.0 = full phase modulation range, see phaseModulation())
+ * The phase offset is modulator * index * range, calculated per sample.
+ *
+ * Waveforms are tables with linear interpolation. Arbitrary waveforms and the sine are 256 sample tables (257 entries
+ * are accepted as well). The saw, reverse saw (the inverted saw), square, pulse and triangle are band-limited per octave:
+ * tables holding the first 1, 2, 4 ... 256 harmonics are generated at startup (20kB), the table with the most harmonics
+ * below the nyquist frequency is played, so the highest harmonic is above a quarter of the sample rate for notes down
+ * to 43hz. The pulse plays the square, the variable triangle the triangle. Sample & hold picks a new random value every
+ * cycle.
+ *
+ * With 2x oversampling the operator runs at twice the sample rate. The modulation is upsampled and the output is
+ * decimated using the 31 tap half-band filters (see HalfBandFilter.h), which adds a latency of 7 samples (0.16ms) to the
+ * output and delays the modulation by 8 samples relative to the carrier.
+ *
+ * Aliasing (level of all non-harmonic components relative to the total output) of a sine carrier modulated by a sine of
+ * the same frequency, measured by the host test in test/test_fm_operator:
+ *
+ *   index   carrier   1x        2x
+ *   100%    1khz      -76dB     -74dB
+ *   100%    3khz       -3dB     -20dB
+ *   50%     3khz      -15dB     -27dB
+ *   50%     6khz       -4dB     -19dB
+ *   25%     3khz      -50dB     -66dB
+ *   25%     6khz       -9dB     -21dB
+ *
+ * Aliasing of the unmodulated saw and pulse, measured by the same test (-22dB to -11dB at 1x and 1 - 4khz with the
+ * 64 harmonic tables used before):
+ *
+ *   waveform   carrier   1x        2x
+ *   saw        1khz      -62dB     -64dB
+ *   saw        2khz      -72dB     -75dB
+ *   saw        3khz      -79dB     -83dB
+ *   saw        4khz      -79dB     -85dB
+ *   pulse      1khz      -64dB     -66dB
+ *   pulse      2khz      -74dB     -78dB
+ *   pulse      3khz      -83dB     -87dB
+ *   pulse      4khz      -83dB     -92dB
+ *
+ * Estimated (not measured) CPU cost per voice at 912mhz (see platformio.ini): 1x ~20 cycles per sample (0.1%), 2x ~70 cycles per sample (0.35%).
+ * Low notes and low indexes don't need oversampling. Use DEBUG_CPU_USAGE in main.cpp to see the actual CPU usage (processorUsageMax()).
+ */
+class AudioSynthFmOperator : public AudioStream
+{
+public:
+    AudioSynthFmOperator() : AudioStream(2, inputQueueArray) {}
+
+    /**
+     * Set the frequency.
+     *
+     * @param freq frequency in hz (0 - half the sample rate)
+     */
+    void frequency(float freq)
+    {
+        freq = constrain(freq, 0.0f, AUDIO_SAMPLE_RATE_EXACT / 2.0f);
+        phaseIncrement = (uint32_t)(freq * (4294967296.0f / AUDIO_SAMPLE_RATE_EXACT));
+    }
+
+    /**
+     * Set the amplitude.
+     *
+     * @param level amplitude (0.0f - 1.0f)
+     */
+    void amplitude(float level)
+    {
+        amplitudeQ15 = (int32_t)(constrain(level, 0.0f, 1.0f) * 32768.0f);
+    }
+
+    /**
+     * Set the phase modulation range, the phase offset at full modulator level and full index.
+     *
+     * @param degrees range in degrees (0 - 9000), like AudioSynthWaveformModulated::phaseModulation()
+     */
+    void phaseModulation(float degrees)
+    {
+        // the modulation (product of modulator and index) is Q30, one cycle is 2^32, so 360 degrees equals a factor of 4 (Q8: 1024)
+        phaseModulationFactorQ8 = (int32_t)(constrain(degrees, 0.0f, 9000.0f) * (1024.0f / 360.0f));
+    }
+
+    /**
+     * Set the oversampling factor.
+     *
+     * @param factor 1 or 2
+     */
+    void oversampling(uint8_t factor)
+    {
+        oversamplingFactor = factor >= 2 ? 2 : 1;
+    }
+
+    /**
+     * Select the waveform.
+     *
+     * @param waveform Teensy Audio waveform (WAVEFORM_*)
+     * @param arbitraryWaveform table for WAVEFORM_ARBITRARY (256 or 257 samples)
+     */
+    void begin(short waveform, const int16_t *arbitraryWaveform = nullptr)
+    {
+        const BandLimitedTables &bandLimitedTables = getBandLimitedTables();
+        const int16_t *table{nullptr};
+        const BandLimitedTable *bandLimitedTable{nullptr};
+        bool inverted{false};
+        bool sampleHold{false};
+        switch (waveform)
+        {
+        case WAVEFORM_SAWTOOTH:
+        case WAVEFORM_BANDLIMIT_SAWTOOTH:
+            bandLimitedTable = &bandLimitedTables[TABLE_SAWTOOTH];
+            break;
+        case WAVEFORM_SAWTOOTH_REVERSE:
+        case WAVEFORM_BANDLIMIT_SAWTOOTH_REVERSE:
+            bandLimitedTable = &bandLimitedTables[TABLE_SAWTOOTH];
+            inverted = true;
+            break;
+        case WAVEFORM_SQUARE:
+        case WAVEFORM_PULSE:
+        case WAVEFORM_BANDLIMIT_SQUARE:
+        case WAVEFORM_BANDLIMIT_PULSE:
+            bandLimitedTable = &bandLimitedTables[TABLE_SQUARE];
+            break;
+        case WAVEFORM_TRIANGLE:
+        case WAVEFORM_TRIANGLE_VARIABLE:
+            bandLimitedTable = &bandLimitedTables[TABLE_TRIANGLE];
+            break;
+        case WAVEFORM_SAMPLE_HOLD:
+            sampleHold = true;
+            break;
+        case WAVEFORM_ARBITRARY:
+            table = arbitraryWaveform;
+            break;
+        default:
+            table = getSineTable().data();
+            break;
+        }
+
+        __disable_irq();
+        waveformTable = table;
+        waveformBandLimitedTable = bandLimitedTable;
+        waveformInverted = inverted;
+        waveformSampleHold = sampleHold;
+        __enable_irq();
+    }
+
+    /**
+     * Restart the phase at the start of the next update.
+     */
+    void restart()
+    {
+        restartPending = true;
+    }
+
+    virtual void update(void)
+    {
+        audio_block_t *modulator = receiveReadOnly(0);
+        audio_block_t *index = receiveReadOnly(1);
+
+        audio_block_t *output = allocate();
+        if (output == nullptr)
+        {
+            releaseInputs(modulator, index);
+            return;
+        }
+
+        if (restartPending)
+        {
+            restartPending = false;
+            phase = 0;
+        }
+
+        const uint8_t factor = oversamplingFactor;
+        if (factor != activeOversamplingFactor)
+        {
+            activeOversamplingFactor = factor;
+            interpolator.reset();
+            decimator.reset();
+        }
+
+        // modulation per sample (Q28, leaving headroom for the half-band filter), the phase offset is calculated from this
+        std::array<int32_t, AUDIO_BLOCK_SAMPLES> modulation;
+        if (modulator != nullptr && index != nullptr)
+        {
+            for (uint16_t i = 0; i < AUDIO_BLOCK_SAMPLES; i++)
+            {
+                modulation[i] = ((int32_t)modulator->data[i] * index->data[i]) >> 2;
+            }
+        }
+        else
+        {
+            modulation.fill(0);
+        }
+        releaseInputs(modulator, index);
+
+        const int32_t modulationFactor = phaseModulationFactorQ8;
+
+        const bool sampleHold = waveformSampleHold;
+        const uint32_t increment = phaseIncrement;
+
+        // the band-limited table with the most harmonics below the nyquist frequency of the output, also with oversampling:
+        // harmonics above it would only be removed by the decimator, and fold back from its transition band
+        const BandLimitedTable *bandLimitedTable = waveformBandLimitedTable;
+        const int16_t *table = waveformTable;
+        uint8_t tableBits{TABLE_BITS};
+        if (bandLimitedTable != nullptr)
+        {
+            const uint8_t level = getBandLimitedLevel(increment);
+            table = bandLimitedTable->data() + getBandLimitedOffset(level);
+            tableBits = getBandLimitedBits(level);
+        }
+        const int32_t gain = waveformInverted ? -amplitudeQ15 : amplitudeQ15;
+
+        if (factor == 1)
+        {
+            for (uint16_t i = 0; i < AUDIO_BLOCK_SAMPLES; i++)
+            {
+                output->data[i] = applyAmplitude(sample(table, tableBits, sampleHold, phase + phaseOffset(modulation[i], modulationFactor)), gain);
+                phase += increment;
+            }
+        }
+        else
+        {
+            // the modulation is upsampled using a half-band filter, linear interpolation would leave images close to the
+            // original sample rate, which are turned into a lot of aliasing by the phase modulation
+            std::array<int32_t, AUDIO_BLOCK_SAMPLES * 2> modulation2x;
+            interpolator.process(modulation.data(), modulation2x.data(), AUDIO_BLOCK_SAMPLES);
+
+            std::array<int32_t, AUDIO_BLOCK_SAMPLES * 2> samples2x;
+            const uint32_t halfIncrement = increment / 2;
+            for (uint16_t i = 0; i < AUDIO_BLOCK_SAMPLES * 2; i += 2)
+            {
+                samples2x[i] = sample(table, tableBits, sampleHold, phase + phaseOffset(modulation2x[i], modulationFactor));
+                phase += halfIncrement;
+                samples2x[i + 1] = sample(table, tableBits, sampleHold, phase + phaseOffset(modulation2x[i + 1], modulationFactor));
+                phase += increment - halfIncrement;
+            }
+
+            std::array<int32_t, AUDIO_BLOCK_SAMPLES> samples;
+            decimator.process(samples2x.data(), samples.data(), AUDIO_BLOCK_SAMPLES);
+            for (uint16_t i = 0; i < AUDIO_BLOCK_SAMPLES; i++)
+            {
+                output->data[i] = applyAmplitude(samples[i], gain);
+            }
+        }
+
+        transmit(output);
+        release(output);
+    }
+
+private:
+    audio_block_t *inputQueueArray[2];
+
+    static constexpr uint8_t TABLE_BITS{8};
+    static constexpr uint16_t TABLE_SIZE{1 << TABLE_BITS};
+
+    // band-limited tables per octave: level k holds the first 2^k harmonics and is played while they stay below the
+    // nyquist frequency, so the highest harmonic played is always above a quarter of the sample rate
+    static constexpr uint8_t BAND_LIMITED_LEVELS{9};
+    // tables of 64 harmonics and less have TABLE_SIZE samples, larger ones 4 samples per harmonic
+    static constexpr uint8_t getBandLimitedBits(const uint8_t level)
+    {
+        return level + 2 > TABLE_BITS ? level + 2 : TABLE_BITS;
+    }
+    static constexpr uint16_t getBandLimitedOffset(const uint8_t level)
+    {
+        return level == 0 ? 0 : getBandLimitedOffset(level - 1) + (1 << getBandLimitedBits(level - 1));
+    }
+    // 7 levels of TABLE_SIZE samples, 512 and 1024 samples
+    static constexpr uint16_t BAND_LIMITED_TABLE_SIZE{7 * TABLE_SIZE + 512 + 1024};
+
+    enum BandLimitedWaveform
+    {
+        TABLE_SAWTOOTH,
+        TABLE_SQUARE,
+        TABLE_TRIANGLE,
+        NUM_BAND_LIMITED_TABLES
+    };
+    // all levels of a waveform, starting with the fundamental only
+    using BandLimitedTable = std::array<int16_t, BAND_LIMITED_TABLE_SIZE>;
+    using BandLimitedTables = std::array<BandLimitedTable, NUM_BAND_LIMITED_TABLES>;
+
+    HalfBandInterpolator<8, HALF_BAND_COEFFICIENTS_31, AUDIO_BLOCK_SAMPLES> interpolator;
+    HalfBandDecimator<8, HALF_BAND_COEFFICIENTS_31, AUDIO_BLOCK_SAMPLES> decimator;
+
+    volatile uint32_t phaseIncrement{0};
+    volatile int32_t phaseModulationFactorQ8{2048};
+    volatile int32_t amplitudeQ15{32768};
+    volatile uint8_t oversamplingFactor{1};
+    volatile bool restartPending{false};
+    const int16_t *volatile waveformTable{nullptr};
+    const BandLimitedTable *volatile waveformBandLimitedTable{nullptr};
+    volatile bool waveformInverted{false};
+    volatile bool waveformSampleHold{false};
+
+    // audio update state
+    uint32_t phase{0};
+    uint32_t lastPhase{0};
+    uint8_t activeOversamplingFactor{1};
+    int16_t sampleHoldValue{0};
+    uint32_t randomSeed{1};
+
+    /**
+     * Get the sine table, generated on the first call.
+     */
+    static const std::array<int16_t, TABLE_SIZE> &getSineTable()
+    {
+        static std::array<int16_t, TABLE_SIZE> table;
+        static bool generated{false};
+        if (!generated)
+        {
+            for (uint16_t i = 0; i < TABLE_SIZE; i++)
+            {
+                table[i] = (int16_t)lroundf(32767.0f * sinf(2.0f * (float)M_PI * i / TABLE_SIZE));
+            }
+            generated = true;
+        }
+        return table;
+    }
+
+    /**
+     * Get the band-limited tables of the saw, square and triangle, generated on the first call.
+     * begin() is called from SynthVoice::initialize(), so this happens during startup.
+     * The levels have the same scale, so the waveforms keep their level when the table changes with the frequency.
+     */
+    static const BandLimitedTables &getBandLimitedTables()
+    {
+        static_assert(getBandLimitedOffset(BAND_LIMITED_LEVELS) == BAND_LIMITED_TABLE_SIZE, "band-limited table size");
+        static BandLimitedTables tables;
+        static bool generated{false};
+        if (!generated)
+        {
+            // sine of the largest table, the harmonics of the smaller tables are read with a stride
+            constexpr uint8_t maxBits = getBandLimitedBits(BAND_LIMITED_LEVELS - 1);
+            static std::array<float, 1 << maxBits> sine;
+            for (uint16_t i = 0; i < sine.size(); i++)
+            {
+                sine[i] = sinf(2.0f * (float)M_PI * i / sine.size());
+            }
+
+            for (uint8_t level = 0; level < BAND_LIMITED_LEVELS; level++)
+            {
+                const uint8_t bits = getBandLimitedBits(level);
+                const uint16_t offset = getBandLimitedOffset(level);
+                const uint32_t mask = (1 << maxBits) - 1;
+                for (uint32_t i = 0; i < (1u << bits); i++)
+                {
+                    const uint32_t position = i << (maxBits - bits);
+                    float saw{0.0f};
+                    float square{0.0f};
+                    float triangle{0.0f};
+                    for (uint32_t harmonic = 1; harmonic <= (1u << level); harmonic++)
+                    {
+                        const float partial = sine[(harmonic * position) & mask] / harmonic;
+                        saw += partial;
+                        if (harmonic % 2 == 1)
+                        {
+                            square += partial;
+                            triangle += ((harmonic / 2) % 2 == 0 ? 1.0f : -1.0f) * partial / harmonic;
+                        }
+                    }
+                    // scaled to stay below full scale including the Gibbs overshoot of every level
+                    tables[TABLE_SAWTOOTH][offset + i] = (int16_t)lroundf(32767.0f * -0.54f * saw);
+                    tables[TABLE_SQUARE][offset + i] = (int16_t)lroundf(32767.0f * 0.78f * (4.0f / (float)M_PI) * square);
+                    tables[TABLE_TRIANGLE][offset + i] = (int16_t)lroundf(32767.0f * (8.0f / ((float)M_PI * (float)M_PI)) * triangle);
+                }
+            }
+            generated = true;
+        }
+        return tables;
+    }
+
+    /**
+     * Get the band-limited level for a phase increment: the most harmonics that stay below the nyquist frequency.
+     *
+     * @param increment phase increment per output sample
+     * @return uint8_t level (0 - BAND_LIMITED_LEVELS - 1)
+     */
+    static inline uint8_t getBandLimitedLevel(const uint32_t increment)
+    {
+        // harmonic h is below the nyquist frequency while h * increment < 2^31
+        uint8_t level{0};
+        while (level < BAND_LIMITED_LEVELS - 1 && ((uint64_t)increment << (level + 1)) < (1ull << 31))
+        {
+            level++;
+        }
+        return level;
+    }
+
+    /**
+     * Convert modulation (Q28) to a phase offset, offsets beyond a full cycle wrap around.
+     */
+    static inline uint32_t phaseOffset(const int32_t modulation, const int32_t modulationFactor)
+    {
+        return (uint32_t)(((int64_t)modulation * modulationFactor) >> 6);
+    }
+
+    /**
+     * Calculate a sample at the given phase.
+     */
+    inline int32_t sample(const int16_t *table, const uint8_t tableBits, const bool sampleHold, const uint32_t samplePhase)
+    {
+        if (sampleHold)
+        {
+            // a new random value every time the phase wraps around
+            if (samplePhase < lastPhase)
+            {
+                randomSeed = randomSeed * 1664525u + 1013904223u;
+                sampleHoldValue = (int16_t)(randomSeed >> 16);
+            }
+            lastPhase = samplePhase;
+            return sampleHoldValue;
+        }
+        if (table == nullptr)
+        {
+            return 0;
+        }
+
+        const uint32_t tableIndex = samplePhase >> (32 - tableBits);
+        const int32_t fraction = ((samplePhase << tableBits) >> 16) & 0xFFFF;
+        const int32_t a = table[tableIndex];
+        const int32_t b = table[(tableIndex + 1) & ((1 << tableBits) - 1)];
+        return a + (((b - a) * fraction) >> 16);
+    }
+
+    static inline int16_t applyAmplitude(const int32_t value, const int32_t gain)
+    {
+        return (int16_t)constrain((value * gain) >> 15, -32768, 32767);
+    }
+
+    void releaseInputs(audio_block_t *modulator, audio_block_t *index)
+    {
+        if (modulator != nullptr)
+        {
+            release(modulator);
+        }
+        if (index != nullptr)
+        {
+            release(index);
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,92 @@
+#ifndef AudioTransaction_h
+#define AudioTransaction_h
+
+#include <stdint.h>
+
+#include <Audio.h>
+#include "AudioConfig.h"
+
+/**
+ * Nestable audio transaction.
+ * Audio object changes made within a transaction are applied together at the next audio block boundary: the outermost
+ * begin() calls AudioNoInterrupts(), the outermost end() calls AudioInterrupts().
+ *
+ * Unlike calling AudioNoInterrupts() / AudioInterrupts() directly, a nested transaction (e.g. a voice setter called while
+ * a whole patch is applied) doesn't re-enable the audio update halfway through the outer transaction.
+ * Keep transactions short, the audio update is postponed until the transaction ends. Transactions postponing it by a
+ * whole audio block or more risk missing the audio block deadline, they are counted, see logStats().
+ * To be used from the main program only, not from interrupts.
+ */
+class AudioTransaction
+{
+private:
+    static inline uint8_t depth{0};
+
+    // cycle counter at the start of the outermost transaction
+    static inline uint32_t beginCycles{0};
+
+    // statistics
+    static inline uint32_t maxCycles{0};
+    static inline uint32_t overruns{0};
+
+public:
+    /**
+     * Begin a transaction.
+     */
+    static void begin()
+    {
+        if (depth++ == 0)
+        {
+            AudioNoInterrupts();
+            beginCycles = ARM_DWT_CYCCNT;
+        }
+    }
+
+    /**
+     * End a transaction, the changes are applied when the outermost transaction ends.
+     */
+    static void end()
+    {
+        if (depth > 0 && --depth == 0)
+        {
+            uint32_t cycles = ARM_DWT_CYCCNT - beginCycles;
+            maxCycles = std::max(maxCycles, cycles);
+            if (cycles / (F_CPU_ACTUAL / 1000000) >= AUDIO_BLOCK_MS * 1000.0f)
+            {
+                overruns++;
+            }
+
+            AudioInterrupts();
+        }
+    }
+
+    /**
+     * Get the duration of the longest transaction since the statistics were reset.
+     *
+     * @return float duration in microseconds
+     */
+    static float getMaxMicros()
+    {
+        return maxCycles * 1000000.0f / F_CPU_ACTUAL;
+    }
+
+    /**
+     * Reset the statistics.
+     */
+    static void resetStats()
+    {
+        maxCycles = 0;
+        overruns = 0;
+    }
+
+    /**
+     * Log the statistics since the last call and reset them.
+     */
+    static void logStats()
+    {
+        Serial.printf("audio transactions: %.1fus max, %d over the audio block (%.3fms)\n", getMaxMicros(), overruns, AUDIO_BLOCK_MS);
+        resetStats();
+    }
+};
+
+#endif
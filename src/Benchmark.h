@@ -0,0 +1,47 @@
+#ifndef Benchmark_h
+#define Benchmark_h
+
+#include <Arduino.h>
+#include <stdint.h>
+
+/**
+ * Micro benchmark helper for debugging purposes (see DEBUG_BENCHMARK in main.cpp).
+ * Measures a function using the CPU cycle counter and prints the average number of cycles per call.
+ */
+class Benchmark
+{
+private:
+    // results are accumulated here, to prevent the compiler from optimizing away the benchmarked code
+    static inline volatile uint32_t sink{0};
+
+public:
+    /**
+     * Run a function a number of times and print the average number of cycles per call.
+     * The function is called once before measuring, to warm up the caches.
+     *
+     * @param name name printed with the result
+     * @param iterations number of calls
+     * @param func function taking the iteration number (uint32_t) and returning a uint32_t result
+     * @return float average number of cycles per call
+     */
+    template <typename Func>
+    static float run(const char *name, const uint32_t iterations, Func func)
+    {
+        uint32_t result = func(0);
+
+        uint32_t start = ARM_DWT_CYCCNT;
+        for (uint32_t i = 0; i < iterations; i++)
+        {
+            result += func(i);
+        }
+        uint32_t cycles = ARM_DWT_CYCCNT - start;
+
+        sink = sink + result;
+
+        float cyclesPerCall = (float)cycles / iterations;
+        Serial.printf("Benchmark %s: %.1f cycles, %.3fus per call (%lu calls)\n", name, cyclesPerCall, cyclesPerCall * 1000000.0f / F_CPU_ACTUAL, iterations);
+        return cyclesPerCall;
+    }
+};
+
+#endif
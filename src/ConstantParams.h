@@ -1,592 +1,799 @@
 #ifndef ConstantParams_h
 #define ConstantParams_h
 
-#include <vector>
+#include <array>
 
 #include "Param.h"
 #include "MiscUtil.h"
 
 // list of parameters available for the synthesizer
-const std::vector<Param> PARAMS{
+// constexpr and PROGMEM, the list is generated at compile time and stays in flash
+// the array size is deduced from the params
+PROGMEM constexpr std::array PARAMS{
     // envelope 1
     Param(
         PARAM_ID_ENV_1_ATTACK,
-        PARAM_GROUP_NAME_ENV_1,
+        ParamGroup::env1,
         "Attack",
         PARAM_MC_ENV_1_ATTACK,
         PARAM_CC_ENV_1_ATTACK,
         0,
         127,
-        []([[maybe_unused]] const Param *param, Synth &synth, const uint8_t value)
-        { synth.setEnv1Attack(PARAM_SCALE_ENV_TIME[value]); },
+        []([[maybe_unused]] const Param *param, Synth &synth, const ParamValue value)
+        { synth.setEnv1Attack(value.scale(PARAM_SCALE_ENV_TIME)); },
         []([[maybe_unused]] const Param *param, const uint8_t value)
         { return formatString("%.1fms", PARAM_SCALE_ENV_TIME[value]); }),
     Param(
         PARAM_ID_ENV_1_DECAY,
-        PARAM_GROUP_NAME_ENV_1,
+        ParamGroup::env1,
         "Decay",
         PARAM_MC_ENV_1_DECAY,
         PARAM_CC_ENV_1_DECAY,
         50,
         127,
-        []([[maybe_unused]] const Param *param, Synth &synth, const uint8_t value)
-        { synth.setEnv1Decay(PARAM_SCALE_ENV_TIME[value]); },
+        []([[maybe_unused]] const Param *param, Synth &synth, const ParamValue value)
+        { synth.setEnv1Decay(value.scale(PARAM_SCALE_ENV_TIME)); },
         []([[maybe_unused]] const Param *param, const uint8_t value)
         { return formatString("%.1fms", PARAM_SCALE_ENV_TIME[value]); }),
     Param(
         PARAM_ID_ENV_1_SUSTAIN,
-        PARAM_GROUP_NAME_ENV_1,
+        ParamGroup::env1,
         "Sustain",
         PARAM_MC_ENV_1_SUSTAIN,
         PARAM_CC_ENV_1_SUSTAIN,
         100,
         127,
-        []([[maybe_unused]] const Param *param, Synth &synth, const uint8_t value)
-        { synth.setEnv1Sustain(PARAM_SCALE_POWER[value]); }),
+        []([[maybe_unused]] const Param *param, Synth &synth, const ParamValue value)
+        { synth.setEnv1Sustain(value.scale(PARAM_SCALE_POWER)); }),
     Param(
         PARAM_ID_ENV_1_RELEASE,
-        PARAM_GROUP_NAME_ENV_1,
+        ParamGroup::env1,
         "Release",
         PARAM_MC_ENV_1_RELEASE,
         PARAM_CC_ENV_1_RELEASE,
         50,
         127,
-        []([[maybe_unused]] const Param *param, Synth &synth, const uint8_t value)
-        { synth.setEnv1Release(PARAM_SCALE_ENV_TIME[value]); },
+        []([[maybe_unused]] const Param *param, Synth &synth, const ParamValue value)
+        { synth.setEnv1Release(value.scale(PARAM_SCALE_ENV_TIME)); },
         []([[maybe_unused]] const Param *param, const uint8_t value)
         { return formatString("%.1fms", PARAM_SCALE_ENV_TIME[value]); }),
 
     // envelope 2
     Param(
         PARAM_ID_ENV_2_ATTACK,
-        PARAM_GROUP_NAME_ENV_2,
+        ParamGroup::env2,
         "Attack",
         PARAM_MC_ENV_2_ATTACK,
         PARAM_CC_ENV_2_ATTACK,
         0,
         127,
-        []([[maybe_unused]] const Param *param, Synth &synth, const uint8_t value)
-        { synth.setEnv2Attack(PARAM_SCALE_ENV_TIME[value]); },
+        []([[maybe_unused]] const Param *param, Synth &synth, const ParamValue value)
+        { synth.setEnv2Attack(value.scale(PARAM_SCALE_ENV_TIME)); },
         []([[maybe_unused]] const Param *param, const uint8_t value)
         { return formatString("%.1fms", PARAM_SCALE_ENV_TIME[value]); }),
     Param(
         PARAM_ID_ENV_2_DECAY,
-        PARAM_GROUP_NAME_ENV_2,
+        ParamGroup::env2,
         "Decay",
         PARAM_MC_ENV_2_DECAY,
         PARAM_CC_ENV_2_DECAY,
         50,
         127,
-        []([[maybe_unused]] const Param *param, Synth &synth, const uint8_t value)
-        { synth.setEnv2Decay(PARAM_SCALE_ENV_TIME[value]); },
+        []([[maybe_unused]] const Param *param, Synth &synth, const ParamValue value)
+        { synth.setEnv2Decay(value.scale(PARAM_SCALE_ENV_TIME)); },
         []([[maybe_unused]] const Param *param, const uint8_t value)
         { return formatString("%.1fms", PARAM_SCALE_ENV_TIME[value]); }),
     Param(
         PARAM_ID_ENV_2_SUSTAIN,
-        PARAM_GROUP_NAME_ENV_2,
+        ParamGroup::env2,
         "Sustain",
         PARAM_MC_ENV_2_SUSTAIN,
         PARAM_CC_ENV_2_SUSTAIN,
         100,
         127,
-        []([[maybe_unused]] const Param *param, Synth &synth, const uint8_t value)
-        { synth.setEnv2Sustain(PARAM_SCALE_POWER[value]); }),
+        []([[maybe_unused]] const Param *param, Synth &synth, const ParamValue value)
+        { synth.setEnv2Sustain(value.scale(PARAM_SCALE_POWER)); }),
     Param(
         PARAM_ID_ENV_2_RELEASE,
-        PARAM_GROUP_NAME_ENV_2,
+        ParamGroup::env2,
         "Release",
         PARAM_MC_ENV_2_RELEASE,
         PARAM_CC_ENV_2_RELEASE,
         50,
         127,
-        []([[maybe_unused]] const Param *param, Synth &synth, const uint8_t value)
-        { synth.setEnv2Release(PARAM_SCALE_ENV_TIME[value]); },
+        []([[maybe_unused]] const Param *param, Synth &synth, const ParamValue value)
+        { synth.setEnv2Release(value.scale(PARAM_SCALE_ENV_TIME)); },
         []([[maybe_unused]] const Param *param, const uint8_t value)
         { return formatString("%.1fms", PARAM_SCALE_ENV_TIME[value]); }),
 
     // filter1
     Param(
         PARAM_ID_FILTER_1_FREQ,
-        PARAM_GROUP_NAME_FILTER,
+        ParamGroup::filter,
         "Frequency",
         PARAM_MC_FILTER_1_FREQ,
         PARAM_CC_FILTER_1_FREQ,
         96,
         127,
-        []([[maybe_unused]] const Param *param, Synth &synth, const uint8_t value)
-        { synth.setFilter1Frequency(PARAM_SCALE_LINEAR[value] * 2.0f - 1.0f); },
+        []([[maybe_unused]] const Param *param, Synth &synth, const ParamValue value)
+        { synth.setFilter1Frequency(value.scale(PARAM_SCALE_LINEAR) * 2.0f - 1.0f); },
         []([[maybe_unused]] const Param *param, const uint8_t value)
         { return formatString("%+.1f semitones", 96.0f * PARAM_SCALE_LINEAR[value] - 24.0f); }),
     Param(
         PARAM_ID_FILTER_1_RES,
-        PARAM_GROUP_NAME_FILTER,
+        ParamGroup::filter,
         "Resonance",
         PARAM_MC_FILTER_1_RES,
         PARAM_CC_FILTER_1_RES,
         40,
         127,
-        []([[maybe_unused]] const Param *param, Synth &synth, const uint8_t value)
-        { synth.setFilter1Resonance(PARAM_SCALE_LINEAR[value]); },
+        []([[maybe_unused]] const Param *param, Synth &synth, const ParamValue value)
+        { synth.setFilter1Resonance(value.scale(PARAM_SCALE_LINEAR)); },
         []([[maybe_unused]] const Param *param, const uint8_t value)
         { return formatString("%.0f%%", round(100 * PARAM_SCALE_LINEAR[value])); }),
     Param(
         PARAM_ID_FILTER_1_KBD_TRACK,
         PARAM_MI_FILTER_1_KBD_TRACK,
-        PARAM_GROUP_NAME_FILTER,
+        ParamGroup::filter,
         "Keyboard tracking",
         PARAM_MC_FILTER_1_KBD_TRACK,
         127,
         127,
-        []([[maybe_unused]] const Param *param, Synth &synth, const uint8_t value)
-        { synth.setFilter1KbdTrack(PARAM_SCALE_LINEAR_CENTER_ZERO[value]); },
+        []([[maybe_unused]] const Param *param, Synth &synth, const ParamValue value)
+        { synth.setFilter1KbdTrack(value.scale(PARAM_SCALE_LINEAR_CENTER_ZERO)); },
         []([[maybe_unused]] const Param *param, const uint8_t value)
         { return formatString("%+.0f%%%s", round(100 * PARAM_SCALE_LINEAR_CENTER_ZERO[value]), zeroSuffix(PARAM_SCALE_LINEAR_CENTER_ZERO[value]).c_str()); }),
     Param(
         PARAM_ID_FILTER_1_KBD_VELOCITY,
-        PARAM_GROUP_NAME_FILTER_MOD,
+        ParamGroup::filterMod,
         "Keyboard velocity",
         PARAM_MC_FILTER_1_KBD_VELOCITY,
         PARAM_CC_FILTER_1_KBD_VELOCITY,
         63,
         127,
-        []([[maybe_unused]] const Param *param, Synth &synth, const uint8_t value)
-        { synth.setFilter1KbdVelocity(PARAM_SCALE_LINEAR_CENTER_ZERO[value]); },
+        []([[maybe_unused]] const Param *param, Synth &synth, const ParamValue value)
+        { synth.setFilter1KbdVelocity(value.scale(PARAM_SCALE_LINEAR_CENTER_ZERO)); },
         []([[maybe_unused]] const Param *param, const uint8_t value)
         { return formatString("%+.0f%%%s", round(100 * PARAM_SCALE_LINEAR_CENTER_ZERO[value]), zeroSuffix(PARAM_SCALE_LINEAR_CENTER_ZERO[value]).c_str()); }),
     Param(
         PARAM_ID_FILTER_1_ENV_2,
-        PARAM_GROUP_NAME_FILTER_MOD,
+        ParamGroup::filterMod,
         "Envelope 2",
         PARAM_MC_FILTER_1_ENV_2,
         PARAM_CC_FILTER_1_ENV_2,
         63,
         127,
-        []([[maybe_unused]] const Param *param, Synth &synth, const uint8_t value)
-        { synth.setFilter1Env2(PARAM_SCALE_LINEAR_CENTER_ZERO[value]); },
+        []([[maybe_unused]] const Param *param, Synth &synth, const ParamValue value)
+        { synth.setFilter1Env2(value.scale(PARAM_SCALE_LINEAR_CENTER_ZERO)); },
         []([[maybe_unused]] const Param *param, const uint8_t value)
         { return formatString("%+.0f%%%s", round(100 * PARAM_SCALE_LINEAR_CENTER_ZERO[value]), zeroSuffix(PARAM_SCALE_LINEAR_CENTER_ZERO[value]).c_str()); }),
     Param(
         PARAM_ID_FILTER_1_LFO,
-        PARAM_GROUP_NAME_FILTER_MOD,
+        ParamGroup::filterMod,
         "LFO",
         PARAM_MC_FILTER_1_LFO,
         PARAM_CC_FILTER_1_LFO,
         0,
         127,
-        []([[maybe_unused]] const Param *param, Synth &synth, const uint8_t value)
-        { synth.setFilter1Lfo(PARAM_SCALE_LINEAR[value]); },
+        []([[maybe_unused]] const Param *param, Synth &synth, const ParamValue value)
+        { synth.setFilter1Lfo(value.scale(PARAM_SCALE_LINEAR)); },
         []([[maybe_unused]] const Param *param, const uint8_t value)
         { return formatString("%.0f%%", round(100 * PARAM_SCALE_LINEAR[value])); }),
     Param(
         PARAM_ID_FILTER_MODE,
-        PARAM_GROUP_NAME_FILTER,
+        ParamGroup::filter,
         "Mode",
         PARAM_MC_FILTER_MODE,
         PARAM_NI_FILTER_MODE,
         PARAM_ND_FILTER_MODE,
         0,
         6,
-        []([[maybe_unused]] const Param *param, Synth &synth, const uint8_t value)
-        { synth.setFilterMode(value); },
+        []([[maybe_unused]] const Param *param, Synth &synth, const ParamValue value)
+        { synth.setFilterMode(value.coarse); },
         []([[maybe_unused]] const Param *param, const uint8_t value)
         { return formatString("%s", FILTER_MODE_LABELS[value].c_str()); }),
 
     // lfo
     Param(
         PARAM_ID_LFO_FREQ,
-        PARAM_GROUP_NAME_LFO,
+        ParamGroup::lfo,
         "Frequency",
         PARAM_MC_LFO_FREQ,
         PARAM_CC_LFO_FREQ,
         63,
         127,
-        []([[maybe_unused]] const Param *param, Synth &synth, const uint8_t value)
-        { synth.setLfoFreq(PARAM_SCALE_LFO_FREQ[value]); },
+        []([[maybe_unused]] const Param *param, Synth &synth, const ParamValue value)
+        { synth.setLfoFreq(value.scale(PARAM_SCALE_LFO_FREQ)); },
         []([[maybe_unused]] const Param *param, const uint8_t value)
         { return formatString("%.3fhz", PARAM_SCALE_LFO_FREQ[value]); }),
     Param(
         PARAM_ID_LFO_SHAPE,
-        PARAM_GROUP_NAME_LFO,
+        ParamGroup::lfo,
         "Shape",
         PARAM_MC_LFO_SHAPE,
         PARAM_CC_LFO_SHAPE,
         63,
         127,
-        []([[maybe_unused]] const Param *param, Synth &synth, const uint8_t value)
-        { synth.setLfoShape(PARAM_SCALE_LINEAR_CENTER_ZERO[value]); },
+        []([[maybe_unused]] const Param *param, Synth &synth, const ParamValue value)
+        { synth.setLfoShape(value.scale(PARAM_SCALE_LINEAR_CENTER_ZERO)); },
         []([[maybe_unused]] const Param *param, const uint8_t value)
         { return formatString("%.0f%%%s", round(100.0f * (PARAM_SCALE_LINEAR_CENTER_ZERO[value])), zeroSuffix(PARAM_SCALE_LINEAR_CENTER_ZERO[value]).c_str()); }),
     Param(
         PARAM_ID_LFO_WAVEFORM,
-        PARAM_GROUP_NAME_LFO,
+        ParamGroup::lfo,
         "Waveform",
         PARAM_MC_LFO_WAVEFORM,
         PARAM_NI_LFO_WAVEFORM,
         PARAM_ND_LFO_WAVEFORM,
         4,
         (uint8_t)SYNTH_WAVEFORMS.size() - 1,
-        []([[maybe_unused]] const Param *param, Synth &synth, const uint8_t value)
-        { synth.setLfoWaveform(value); },
+        []([[maybe_unused]] const Param *param, Synth &synth, const ParamValue value)
+        { synth.setLfoWaveform(value.coarse); },
         []([[maybe_unused]] const Param *param, const uint8_t value)
-        { return SynthVoice::getSynthWaveformByValue(value).name; }),
+        { return std::string(SynthVoice::getSynthWaveformByValue(value).name); }),
     Param(
         PARAM_ID_LFO_ATTACK,
-        PARAM_GROUP_NAME_LFO_MOD,
+        ParamGroup::lfoMod,
         "Attack",
         PARAM_MC_LFO_ATTACK,
         PARAM_CC_LFO_ATTACK,
         0,
         127,
-        []([[maybe_unused]] const Param *param, Synth &synth, const uint8_t value)
-        { synth.setEnvLfoAttack(PARAM_SCALE_ENV_TIME[value]); },
+        []([[maybe_unused]] const Param *param, Synth &synth, const ParamValue value)
+        { synth.setEnvLfoAttack(value.scale(PARAM_SCALE_ENV_TIME)); },
         []([[maybe_unused]] const Param *param, const uint8_t value)
         { return formatString("%.1fms", PARAM_SCALE_ENV_TIME[value]); }),
 
     // osc 1/fm
     Param(
         PARAM_ID_OSC_VOLUME_MIX,
-        PARAM_GROUP_NAME_MISC,
+        ParamGroup::misc,
         "Osc. volume mix",
         PARAM_MC_OSC_VOLUME_MIX,
         PARAM_CC_OSC_VOLUME_MIX,
         0,
         127,
-        []([[maybe_unused]] const Param *param, Synth &synth, const uint8_t value)
-        { synth.setOscVolumeMix(PARAM_SCALE_LINEAR[value]); },
+        []([[maybe_unused]] const Param *param, Synth &synth, const ParamValue value)
+        { synth.setOscVolumeMix(value.scale(PARAM_SCALE_LINEAR)); },
         []([[maybe_unused]] const Param *param, const uint8_t value)
         { return formatString("1: %.0f%% 2: %.0f%%", round(100 - 100 * PARAM_SCALE_LINEAR[value]), round(100 * PARAM_SCALE_LINEAR[value])); }),
 
     Param(
         PARAM_ID_OSC_1_WAVEFORM,
-        PARAM_GROUP_NAME_OSC_1,
+        ParamGroup::osc1,
         "Waveform",
         PARAM_MC_OSC_1_WAVEFORM,
         PARAM_NI_OSC_1_WAVEFORM,
         PARAM_ND_OSC_1_WAVEFORM,
         0,
         (uint8_t)SYNTH_WAVEFORMS.size() - 1,
-        []([[maybe_unused]] const Param *param, Synth &synth, const uint8_t value)
-        { synth.setOsc1SynthWaveform(value); },
+        []([[maybe_unused]] const Param *param, Synth &synth, const ParamValue value)
+        { synth.setOsc1SynthWaveform(value.coarse); },
         []([[maybe_unused]] const Param *param, const uint8_t value)
-        { return SynthVoice::getSynthWaveformByValue(value).name; }),
+        { return std::string(SynthVoice::getSynthWaveformByValue(value).name); }),
     Param(
         PARAM_ID_OSC_FM_WAVEFORM,
-        PARAM_GROUP_NAME_OSC_FM,
+        ParamGroup::oscFm,
         "Waveform",
         PARAM_MC_OSC_FM_WAVEFORM,
         PARAM_NI_OSC_FM_WAVEFORM,
         PARAM_ND_OSC_FM_WAVEFORM,
         3,
         (uint8_t)SYNTH_WAVEFORMS.size() - 1,
-        []([[maybe_unused]] const Param *param, Synth &synth, const uint8_t value)
-        { synth.setOscFmSynthWaveform(value); },
+        []([[maybe_unused]] const Param *param, Synth &synth, const ParamValue value)
+        { synth.setOscFmSynthWaveform(value.coarse); },
         []([[maybe_unused]] const Param *param, const uint8_t value)
-        { return SynthVoice::getSynthWaveformByValue(value).name; }),
+        { return std::string(SynthVoice::getSynthWaveformByValue(value).name); }),
 
     Param(
         PARAM_ID_OSC_1_WAVEFOLD,
-        PARAM_GROUP_NAME_OSC_1,
+        ParamGroup::osc1,
         "Wavefold",
         PARAM_MC_OSC_1_WAVEFOLD,
         PARAM_CC_OSC_1_WAVEFOLD,
         0,
         127,
-        []([[maybe_unused]] const Param *param, Synth &synth, const uint8_t value)
-        { synth.setOsc1WaveFold(PARAM_SCALE_LINEAR[value]); },
+        []([[maybe_unused]] const Param *param, Synth &synth, const ParamValue value)
+        { synth.setOsc1WaveFold(value.scale(PARAM_SCALE_LINEAR)); },
         []([[maybe_unused]] const Param *param, const uint8_t value)
         { return formatString("%.0f%%", round(100 * PARAM_SCALE_LINEAR[value])); }),
 
     Param(
         PARAM_ID_OSC_1_SHAPE,
-        PARAM_GROUP_NAME_OSC_1,
+        ParamGroup::osc1,
         "Shape",
         PARAM_MC_OSC_1_SHAPE,
         PARAM_CC_OSC_1_SHAPE,
         63,
         127,
-        []([[maybe_unused]] const Param *param, Synth &synth, const uint8_t value)
-        { synth.setOsc1Shape(PARAM_SCALE_LINEAR_CENTER_ZERO[value]); },
+        []([[maybe_unused]] const Param *param, Synth &synth, const ParamValue value)
+        { synth.setOsc1Shape(value.scale(PARAM_SCALE_LINEAR_CENTER_ZERO)); },
         []([[maybe_unused]] const Param *param, const uint8_t value)
         { return formatString("%+.0f%%%s", round(100 * PARAM_SCALE_LINEAR_CENTER_ZERO[value]), zeroSuffix(PARAM_SCALE_LINEAR_CENTER_ZERO[value]).c_str()); }),
 
     Param(
         PARAM_ID_OSC_FM_OCTAVE,
-        PARAM_GROUP_NAME_OSC_FM,
+        ParamGroup::oscFm,
         "Octave",
         PARAM_MC_OSC_FM_OCTAVE,
         PARAM_NI_OSC_FM_OCTAVE,
         PARAM_ND_OSC_FM_OCTAVE,
         4,
         8,
-        []([[maybe_unused]] const Param *param, Synth &synth, const uint8_t value)
-        { synth.setOscFmOctave((int8_t)map(value, 0, 8, -4, +4)); },
+        []([[maybe_unused]] const Param *param, Synth &synth, const ParamValue value)
+        { synth.setOscFmOctave((int8_t)map(value.coarse, 0, 8, -4, +4)); },
         []([[maybe_unused]] const Param *param, const uint8_t value)
         { return formatString("%+d octaves", map(value, 0, 8, -4, +4)); }),
 
     Param(
         PARAM_ID_OSC_1_TRANSPOSE,
-        PARAM_GROUP_NAME_OSC_1,
+        ParamGroup::osc1,
         "Transpose",
         PARAM_MC_OSC_1_TRANSPOSE,
         PARAM_NI_OSC_1_TRANSPOSE,
         PARAM_ND_OSC_1_TRANSPOSE,
         12,
         24,
-        []([[maybe_unused]] const Param *param, Synth &synth, const uint8_t value)
-        { synth.setOsc1Transpose((int8_t)map(value, 0, 24, -12, +12)); },
+        []([[maybe_unused]] const Param *param, Synth &synth, const ParamValue value)
+        { synth.setOsc1Transpose((int8_t)map(value.coarse, 0, 24, -12, +12)); },
         []([[maybe_unused]] const Param *param, const uint8_t value)
         { return formatString("%+d semitones", map(value, 0, 24, -12, +12)); }),
     Param(
         PARAM_ID_OSC_FM_TRANSPOSE,
-        PARAM_GROUP_NAME_OSC_FM,
+        ParamGroup::oscFm,
         "Transpose",
         PARAM_MC_OSC_FM_TRANSPOSE,
         PARAM_NI_OSC_FM_TRANSPOSE,
         PARAM_ND_OSC_FM_TRANSPOSE,
         12,
         24,
-        []([[maybe_unused]] const Param *param, Synth &synth, const uint8_t value)
-        { synth.setOscFmTranspose((int8_t)map(value, 0, 24, -12, +12)); },
+        []([[maybe_unused]] const Param *param, Synth &synth, const ParamValue value)
+        { synth.setOscFmTranspose((int8_t)map(value.coarse, 0, 24, -12, +12)); },
         []([[maybe_unused]] const Param *param, const uint8_t value)
         { return formatString("%+d semitones", map(value, 0, 24, -12, +12)); }),
 
+    // osc fm oversampling, the lower half of the master slider range selects 1x, the upper half 2x
+    Param(
+        PARAM_ID_OSC_FM_OVERSAMPLING,
+        PARAM_MI_OSC_FM_OVERSAMPLING,
+        ParamGroup::oscFm,
+        "Oversampling",
+        PARAM_MC_OSC_FM_OVERSAMPLING,
+        0,
+        127,
+        []([[maybe_unused]] const Param *param, Synth &synth, const ParamValue value)
+        { synth.setOscFmOversampling(value.coarse < 64 ? 1 : 2); },
+        []([[maybe_unused]] const Param *param, const uint8_t value)
+        { return formatString("%dx", value < 64 ? 1 : 2); },
+        true),
+
     Param(
         PARAM_ID_OSC_1_DETUNE,
-        PARAM_GROUP_NAME_OSC_1,
+        ParamGroup::osc1,
         "Detune",
         PARAM_MC_OSC_1_DETUNE,
         PARAM_CC_OSC_1_DETUNE,
         63,
         127,
-        []([[maybe_unused]] const Param *param, Synth &synth, const uint8_t value)
-        { synth.setOsc1Detune(50.0f * PARAM_SCALE_LINEAR_CENTER_ZERO[value]); },
+        []([[maybe_unused]] const Param *param, Synth &synth, const ParamValue value)
+        { synth.setOsc1Detune(50.0f * value.scale(PARAM_SCALE_LINEAR_CENTER_ZERO)); },
         []([[maybe_unused]] const Param *param, const uint8_t value)
         { return formatString("%+.0f cents%s", round(50.0f * PARAM_SCALE_LINEAR_CENTER_ZERO[value]), zeroSuffix(PARAM_SCALE_LINEAR_CENTER_ZERO[value]).c_str()); }),
 
     // osc 1/fm mod
     Param(
         PARAM_ID_OSC_1_MOD_FREQ_ENV_2,
-        PARAM_GROUP_NAME_OSC_1_MOD,
+        ParamGroup::osc1Mod,
         "Frequency env. 2",
         PARAM_MC_OSC_1_MOD_FREQ_ENV_2,
         PARAM_CC_OSC_1_MOD_FREQ_ENV_2,
         63,
         127,
-        []([[maybe_unused]] const Param *param, Synth &synth, const uint8_t value)
-        { synth.setOsc1ModFreqEnv2(PARAM_SCALE_LINEAR_CENTER_ZERO[value]); },
+        []([[maybe_unused]] const Param *param, Synth &synth, const ParamValue value)
+        { synth.setOsc1ModFreqEnv2(value.scale(PARAM_SCALE_LINEAR_CENTER_ZERO)); },
         []([[maybe_unused]] const Param *param, const uint8_t value)
         { return formatString("%+.0f%%%s", round(100 * PARAM_SCALE_LINEAR_CENTER_ZERO[value]), zeroSuffix(PARAM_SCALE_LINEAR_CENTER_ZERO[value]).c_str()); }),
 
     Param(
         PARAM_ID_OSC_1_MOD_FREQ_LFO,
-        PARAM_GROUP_NAME_OSC_1_MOD,
+        ParamGroup::osc1Mod,
         "Frequency LFO",
         PARAM_MC_OSC_1_MOD_FREQ_LFO,
         PARAM_CC_OSC_1_MOD_FREQ_LFO,
         0,
         127,
-        []([[maybe_unused]] const Param *param, Synth &synth, const uint8_t value)
-        { synth.setOsc1ModFreqLfo(PARAM_SCALE_LINEAR[value]); },
+        []([[maybe_unused]] const Param *param, Synth &synth, const ParamValue value)
+        { synth.setOsc1ModFreqLfo(value.scale(PARAM_SCALE_LINEAR)); },
         []([[maybe_unused]] const Param *param, const uint8_t value)
         { return formatString("%.0f%%", round(100 * PARAM_SCALE_LINEAR[value])); }),
 
     Param(
         PARAM_ID_OSC_1_MOD_SHAPE_ENV_2,
-        PARAM_GROUP_NAME_OSC_1_MOD,
+        ParamGroup::osc1Mod,
         "Shape env. 2",
         PARAM_MC_OSC_1_MOD_SHAPE_ENV_2,
         PARAM_CC_OSC_1_MOD_SHAPE_ENV_2,
         63,
         127,
-        []([[maybe_unused]] const Param *param, Synth &synth, const uint8_t value)
-        { synth.setOsc1ModShapeEnv2(PARAM_SCALE_LINEAR_CENTER_ZERO[value]); },
+        []([[maybe_unused]] const Param *param, Synth &synth, const ParamValue value)
+        { synth.setOsc1ModShapeEnv2(value.scale(PARAM_SCALE_LINEAR_CENTER_ZERO)); },
         []([[maybe_unused]] const Param *param, const uint8_t value)
         { return formatString("%+.0f%%%s", round(100 * PARAM_SCALE_LINEAR_CENTER_ZERO[value]), zeroSuffix(PARAM_SCALE_LINEAR_CENTER_ZERO[value]).c_str()); }),
 
     Param(
         PARAM_ID_OSC_1_MOD_SHAPE_LFO,
-        PARAM_GROUP_NAME_OSC_1_MOD,
+        ParamGroup::osc1Mod,
         "Shape LFO",
         PARAM_MC_OSC_1_MOD_SHAPE_LFO,
         PARAM_CC_OSC_1_MOD_SHAPE_LFO,
         0,
         127,
-        []([[maybe_unused]] const Param *param, Synth &synth, const uint8_t value)
-        { synth.setOsc1ModShapeLfo(PARAM_SCALE_LINEAR[value]); },
+        []([[maybe_unused]] const Param *param, Synth &synth, const ParamValue value)
+        { synth.setOsc1ModShapeLfo(value.scale(PARAM_SCALE_LINEAR)); },
         []([[maybe_unused]] const Param *param, const uint8_t value)
         { return formatString("%.0f%%", round(100 * PARAM_SCALE_LINEAR[value])); }),
 
     Param(
         PARAM_ID_OSC_1_MOD_WAVEFOLD_ENV_2,
-        PARAM_GROUP_NAME_OSC_1_MOD,
+        ParamGroup::osc1Mod,
         "Wavefold env. 2",
         PARAM_MC_OSC_1_MOD_WAVEFOLD_ENV_2,
         PARAM_CC_OSC_1_MOD_WAVEFOLD_ENV_2,
         63,
         127,
-        []([[maybe_unused]] const Param *param, Synth &synth, const uint8_t value)
-        { synth.setOsc1ModWaveFoldEnv2(PARAM_SCALE_LINEAR_CENTER_ZERO[value]); },
+        []([[maybe_unused]] const Param *param, Synth &synth, const ParamValue value)
+        { synth.setOsc1ModWaveFoldEnv2(value.scale(PARAM_SCALE_LINEAR_CENTER_ZERO)); },
         []([[maybe_unused]] const Param *param, const uint8_t value)
         { return formatString("%+.0f%%%s", round(100 * PARAM_SCALE_LINEAR_CENTER_ZERO[value]), zeroSuffix(PARAM_SCALE_LINEAR_CENTER_ZERO[value]).c_str()); }),
 
     Param(
         PARAM_ID_OSC_1_UNISON_DETUNE,
-        PARAM_GROUP_NAME_OSC_1,
+        ParamGroup::osc1,
         "Unison detune",
         PARAM_MC_OSC_1_UNISON_DETUNE,
         PARAM_CC_OSC_1_UNISON_DETUNE,
         51,
         127,
-        []([[maybe_unused]] const Param *param, Synth &synth, const uint8_t value)
-        { synth.setOsc1UnisonDetune(PARAM_SCALE_LINEAR[value]); },
+        []([[maybe_unused]] const Param *param, Synth &synth, const ParamValue value)
+        { synth.setOsc1UnisonDetune(value.scale(PARAM_SCALE_LINEAR)); },
         []([[maybe_unused]] const Param *param, const uint8_t value)
         { return formatString("%.0f%%", round(100 * PARAM_SCALE_LINEAR[value])); }),
 
     Param(
         PARAM_ID_OSC_1_UNISON_MIX,
-        PARAM_GROUP_NAME_OSC_1,
+        ParamGroup::osc1,
         "Unison mix",
         PARAM_MC_OSC_1_UNISON_MIX,
         PARAM_CC_OSC_1_UNISON_MIX,
         0,
         127,
-        []([[maybe_unused]] const Param *param, Synth &synth, const uint8_t value)
-        { synth.setOsc1UnisonMix(PARAM_SCALE_LINEAR[value]); },
+        []([[maybe_unused]] const Param *param, Synth &synth, const ParamValue value)
+        { synth.setOsc1UnisonMix(value.scale(PARAM_SCALE_LINEAR)); },
         []([[maybe_unused]] const Param *param, const uint8_t value)
         { return formatString("%.0f%%", round(100 * PARAM_SCALE_LINEAR[value])); }),
 
     Param(
         PARAM_ID_OSC_FM_MOD_PHASE_MOD_ENV_2,
-        PARAM_GROUP_NAME_OSC_FM_MOD,
+        ParamGroup::oscFmMod,
         "Phase env. 2",
         PARAM_MC_OSC_FM_MOD_PHASE_MOD_ENV_2,
         PARAM_CC_OSC_FM_MOD_PHASE_MOD_ENV_2,
         0,
         127,
-        []([[maybe_unused]] const Param *param, Synth &synth, const uint8_t value)
-        { synth.setOscFmModPhaseEnv2(PARAM_SCALE_LINEAR[value]); },
+        []([[maybe_unused]] const Param *param, Synth &synth, const ParamValue value)
+        { synth.setOscFmModPhaseEnv2(value.scale(PARAM_SCALE_LINEAR)); },
         []([[maybe_unused]] const Param *param, const uint8_t value)
         { return formatString("%.0f%%", round(100 * PARAM_SCALE_LINEAR[value])); }),
 
     Param(
         PARAM_ID_OSC_FM_PHASE_MOD,
-        PARAM_GROUP_NAME_OSC_FM,
+        ParamGroup::oscFm,
         "Phase modulation",
         PARAM_MC_OSC_FM_PHASE_MOD,
         PARAM_CC_OSC_FM_PHASE_MOD,
         0,
         127,
-        []([[maybe_unused]] const Param *param, Synth &synth, const uint8_t value)
-        { synth.setOscFmPhaseMod(PARAM_SCALE_LINEAR[value]); },
+        []([[maybe_unused]] const Param *param, Synth &synth, const ParamValue value)
+        { synth.setOscFmPhaseMod(value.scale(PARAM_SCALE_LINEAR)); },
         []([[maybe_unused]] const Param *param, const uint8_t value)
         { return formatString("%.0f%%", round(100 * PARAM_SCALE_LINEAR[value])); }),
 
     Param(
         PARAM_ID_FILTER_2_FREQ_OFFSET,
-        PARAM_GROUP_NAME_FILTER,
+        ParamGroup::filter,
         "Filter 2 freq. offset",
         PARAM_MC_FILTER_2_FREQ_OFFSET,
         PARAM_CC_FILTER_2_FREQ_OFFSET,
         63,
         127,
-        []([[maybe_unused]] const Param *param, Synth &synth, const uint8_t value)
-        { synth.setFilter2FrequencyOffset(PARAM_SCALE_LINEAR_CENTER_ZERO[value]); },
+        []([[maybe_unused]] const Param *param, Synth &synth, const ParamValue value)
+        { synth.setFilter2FrequencyOffset(value.scale(PARAM_SCALE_LINEAR_CENTER_ZERO)); },
         []([[maybe_unused]] const Param *param, const uint8_t value)
         { return formatString("%+.1f semitones%s", 48.0f * PARAM_SCALE_LINEAR_CENTER_ZERO[value], zeroSuffix(PARAM_SCALE_LINEAR_CENTER_ZERO[value]).c_str()); }),
 
     // waveshape
     Param(
         PARAM_ID_WAVESHAPE_LEVEL,
-        PARAM_GROUP_NAME_MISC,
+        ParamGroup::misc,
         "Waveshape level",
         PARAM_MC_WAVESHAPE_LEVEL,
         PARAM_CC_WAVESHAPE_LEVEL,
         0,
         127,
-        []([[maybe_unused]] const Param *param, Synth &synth, const uint8_t value)
-        { synth.setWaveshapeLevel(PARAM_SCALE_LINEAR[value]); },
+        []([[maybe_unused]] const Param *param, Synth &synth, const ParamValue value)
+        { synth.setWaveshapeLevel(value.scale(PARAM_SCALE_LINEAR)); },
         []([[maybe_unused]] const Param *param, const uint8_t value)
         { return formatString("%.0f%%", round(100 * PARAM_SCALE_LINEAR[value])); }),
 
+    // waveshape oversampling, the range is divided in 3 parts to select 1x, 2x or 4x using the master slider
+    Param(
+        PARAM_ID_WAVESHAPE_OVERSAMPLING,
+        PARAM_MI_WAVESHAPE_OVERSAMPLING,
+        ParamGroup::misc,
+        "Waveshape oversampling",
+        PARAM_MC_WAVESHAPE_OVERSAMPLING,
+        0,
+        127,
+        []([[maybe_unused]] const Param *param, Synth &synth, const ParamValue value)
+        { synth.setWaveshapeOversampling(1 << (value.coarse / 43)); },
+        []([[maybe_unused]] const Param *param, const uint8_t value)
+        { return formatString("%dx", 1 << (value / 43)); },
+        true),
+
     Param(
         PARAM_ID_PITCH_CHANGE_RANGE,
-        PARAM_GROUP_NAME_MISC,
+        ParamGroup::misc,
         "Pitch change range",
         PARAM_MC_PITCH_CHANGE_RANGE_LEVEL,
         PARAM_NI_PITCH_CHANGE_RANGE_LEVEL,
         PARAM_ND_PITCH_CHANGE_RANGE_LEVEL,
         2,
         12,
-        []([[maybe_unused]] const Param *param, Synth &synth, const uint8_t value)
-        { synth.setPitchChangeRange(value); },
+        []([[maybe_unused]] const Param *param, Synth &synth, const ParamValue value)
+        { synth.setPitchChangeRange(value.coarse); },
         []([[maybe_unused]] const Param *param, const uint8_t value)
         { return formatString("%d semitones", value); }),
 
     Param(
         PARAM_ID_AMP_MOD_LFO,
-        PARAM_GROUP_NAME_AMP_MOD,
+        ParamGroup::ampMod,
         "Volume LFO",
         PARAM_MC_AMP_MOD_LFO,
         PARAM_CC_AMP_MOD_LFO,
         0,
         127,
-        []([[maybe_unused]] const Param *param, Synth &synth, const uint8_t value)
-        { synth.setAmpModLfo(PARAM_SCALE_LINEAR[value]); },
+        []([[maybe_unused]] const Param *param, Synth &synth, const ParamValue value)
+        { synth.setAmpModLfo(value.scale(PARAM_SCALE_LINEAR)); },
         []([[maybe_unused]] const Param *param, const uint8_t value)
         { return formatString("%.0f%%", round(100 * PARAM_SCALE_LINEAR[value])); }),
 
     Param(
         PARAM_ID_AMP_KBD_VELOCITY,
         PARAM_MI_AMP_KBD_VELOCITY,
-        PARAM_GROUP_NAME_AMP_MOD,
+        ParamGroup::ampMod,
         "Keyboard velocity",
         PARAM_MC_AMP_KBD_VELOCITY,
         64,
         127,
-        []([[maybe_unused]] const Param *param, Synth &synth, const uint8_t value)
-        { synth.setAmpKbdVelocity(PARAM_SCALE_LINEAR[value]); },
+        []([[maybe_unused]] const Param *param, Synth &synth, const ParamValue value)
+        { synth.setAmpKbdVelocity(value.scale(PARAM_SCALE_LINEAR)); },
         []([[maybe_unused]] const Param *param, const uint8_t value)
         { return formatString("%.0f%%", round(100 * PARAM_SCALE_LINEAR[value])); }),
 
     Param(
         PARAM_ID_ENSEMBLE_MIX,
-        PARAM_GROUP_NAME_MISC,
+        ParamGroup::misc,
         "Ensemble mix",
         PARAM_MC_ENSEMBLE_MIX,
         PARAM_CC_ENSEMBLE_MIX,
         0,
         127,
-        []([[maybe_unused]] const Param *param, Synth &synth, const uint8_t value)
-        { synth.setEnsembleMix(PARAM_SCALE_LINEAR[value]); },
+        []([[maybe_unused]] const Param *param, Synth &synth, const ParamValue value)
+        { synth.setEnsembleMix(value.scale(PARAM_SCALE_LINEAR)); },
         []([[maybe_unused]] const Param *param, const uint8_t value)
         { return formatString("%.0f%%", round(100 * PARAM_SCALE_LINEAR[value])); }),
 
     Param(
         PARAM_ID_ENSEMBLE_LFO_RATE,
-        PARAM_GROUP_NAME_MISC,
+        ParamGroup::misc,
         "Ensemble LFO rate",
         PARAM_MC_ENSEMBLE_LFO_RATE,
         PARAM_CC_ENSEMBLE_LFO_RATE,
         63,
         127,
-        []([[maybe_unused]] const Param *param, Synth &synth, const uint8_t value)
-        { synth.setEnsembleLfoRate(PARAM_SCALE_LFO_FREQ[value]); },
+        []([[maybe_unused]] const Param *param, Synth &synth, const ParamValue value)
+        { synth.setEnsembleLfoRate(value.scale(PARAM_SCALE_LFO_FREQ)); },
         []([[maybe_unused]] const Param *param, const uint8_t value)
         { return formatString("%.3fhz", PARAM_SCALE_LFO_FREQ[value]); }),
 
     Param(
         PARAM_ID_MOD_WHL_ENV_REVERSE,
         PARAM_MI_MOD_WHL_ENV_REVERSE,
-        PARAM_GROUP_NAME_MOD_WHL,
+        ParamGroup::modWhl,
         "ENV reverse",
         PARAM_MC_MOD_WHL_ENV_REVERSE,
         0,
         127,
-        []([[maybe_unused]] const Param *param, Synth &synth, const uint8_t value)
-        { synth.setEnvReverse(PARAM_SCALE_LINEAR[value]); },
+        []([[maybe_unused]] const Param *param, Synth &synth, const ParamValue value)
+        { synth.setEnvReverse(value.scale(PARAM_SCALE_LINEAR)); },
         []([[maybe_unused]] const Param *param, const uint8_t value)
         { return formatString("%.0f%%", round(100 * PARAM_SCALE_LINEAR[value])); }),
 
+    // morph target patch, the master slider range is divided in 64 parts to select the patch, see getMorphTargetPatchNumber()
+    // the morph itself is handled by the SynthController, the synth is not updated
+    Param(
+        PARAM_ID_MORPH_TARGET,
+        PARAM_MI_MORPH_TARGET,
+        ParamGroup::morph,
+        "Morph target",
+        PARAM_MC_MORPH_TARGET,
+        0,
+        127,
+        []([[maybe_unused]] const Param *param, [[maybe_unused]] Synth &synth, [[maybe_unused]] const ParamValue value) {},
+        []([[maybe_unused]] const Param *param, const uint8_t value)
+        { return formatString("%d ~%d", convertPatchNumberToDigits(getMorphTargetPatchNumber(value)), getMorphTargetPatchNumber(value) + 1); },
+        true),
+
 };
 
+/**
+ * Check if all params have a unique parameter ID.
+ * 
+ * @return bool true if all parameter IDs are unique
+ */
+constexpr bool hasUniqueParamIds()
+{
+    for (size_t i = 0; i < PARAMS.size(); i++)
+    {
+        for (size_t j = i + 1; j < PARAMS.size(); j++)
+        {
+            if (PARAMS[i].getParamId() == PARAMS[j].getParamId())
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static_assert(hasUniqueParamIds(), "PARAMS contains a duplicate paramId");
+
+// number of params, params are identified by their index in PARAMS at runtime (e.g. for storing values in a Patch)
+constexpr uint8_t PARAM_COUNT{PARAMS.size()};
+// index used for parameter IDs not present in PARAMS
+constexpr uint8_t PARAM_INDEX_NONE{255};
+
+static_assert(PARAMS.size() < PARAM_INDEX_NONE, "PARAMS contains too many params for a uint8_t index");
+
+/**
+ * Get the highest parameter ID.
+ * 
+ * @return uint16_t highest parameter ID
+ */
+constexpr uint16_t getMaxParamId()
+{
+    uint16_t maxParamId{0};
+    for (const Param &param : PARAMS)
+    {
+        if (param.getParamId() > maxParamId)
+        {
+            maxParamId = param.getParamId();
+        }
+    }
+    return maxParamId;
+}
+
+/**
+ * Create the parameter ID to param index lookup table.
+ * Parameter IDs are sparse (grouped per hundred), the table has an entry for every ID up to the highest parameter ID.
+ * 
+ * @return std::array<uint8_t, getMaxParamId() + 1> param index for each parameter ID, PARAM_INDEX_NONE if not used
+ */
+constexpr std::array<uint8_t, getMaxParamId() + 1> createParamIndexTable()
+{
+    std::array<uint8_t, getMaxParamId() + 1> table{};
+    for (auto &index : table)
+    {
+        index = PARAM_INDEX_NONE;
+    }
+    for (uint8_t index = 0; index < PARAMS.size(); index++)
+    {
+        table[PARAMS[index].getParamId()] = index;
+    }
+    return table;
+}
+
+/**
+ * Create the list of initial param values.
+ * 
+ * @return std::array<uint8_t, PARAM_COUNT> initial value for each param index
+ */
+constexpr std::array<uint8_t, PARAM_COUNT> createParamInitialValues()
+{
+    std::array<uint8_t, PARAM_COUNT> values{};
+    for (uint8_t index = 0; index < PARAMS.size(); index++)
+    {
+        values[index] = PARAMS[index].getInitialValue();
+    }
+    return values;
+}
+
+// parameter ID to param index lookup table, used when loading stored patches
+PROGMEM constexpr std::array<uint8_t, getMaxParamId() + 1> PARAM_INDEX_BY_ID{createParamIndexTable()};
+// initial values of all params, indexed by param index
+PROGMEM constexpr std::array<uint8_t, PARAM_COUNT> PARAM_INITIAL_VALUES{createParamInitialValues()};
+
+/**
+ * Get the index of a param in PARAMS.
+ * 
+ * @param param param (from PARAMS)
+ * @return uint8_t param index
+ */
+inline uint8_t getParamIndex(const Param &param)
+{
+    return (uint8_t)(&param - PARAMS.data());
+}
+
+/**
+ * Get the index of the param with the given parameter ID.
+ * 
+ * @param paramId parameter ID
+ * @return uint8_t param index, PARAM_INDEX_NONE if there is no param with this parameter ID
+ */
+inline uint8_t getParamIndexById(uint16_t paramId)
+{
+    return paramId < PARAM_INDEX_BY_ID.size() ? PARAM_INDEX_BY_ID[paramId] : PARAM_INDEX_NONE;
+}
+
+/**
+ * Create a dispatch table mapping a MIDI control change, note or menu param ID to a param.
+ * 
+ * @param getKey param getter returning the control change, note or menu param ID (values above 127 are not mapped)
+ * @return ParamDispatchTable dispatch table
+ */
+constexpr ParamDispatchTable createParamDispatchTable(uint8_t (Param::*getKey)() const)
+{
+    ParamDispatchTable table{};
+    for (const Param &param : PARAMS)
+    {
+        uint8_t key = (param.*getKey)();
+        if (key < table.size())
+        {
+            table[key] = &param;
+        }
+    }
+    return table;
+}
+
+// MIDI to param dispatch tables, generated at compile time
+// external MIDI control change to param mappings
+PROGMEM constexpr ParamDispatchTable PARAMS_BY_MIDI_CC{createParamDispatchTable(&Param::getMidiCc)};
+// controller MIDI control change to param mappings
+PROGMEM constexpr ParamDispatchTable PARAMS_BY_CONTROLLER_CC{createParamDispatchTable(&Param::getControllerCc)};
+// controller MIDI increment button note to param mappings
+PROGMEM constexpr ParamDispatchTable PARAMS_BY_CONTROLLER_NI{createParamDispatchTable(&Param::getControllerNi)};
+// controller MIDI decrement button note to param mappings
+PROGMEM constexpr ParamDispatchTable PARAMS_BY_CONTROLLER_ND{createParamDispatchTable(&Param::getControllerNd)};
+// menu param ID to param mappings
+PROGMEM constexpr ParamDispatchTable PARAMS_BY_MENU_ID{createParamDispatchTable(&Param::getMenuId)};
+
+/**
+ * Check that no param is mapped to a range of external MIDI control changes.
+ * 
+ * @param first first control change
+ * @param last last control change
+ * @return bool true if no param uses a control change in the range
+ */
+constexpr bool isMidiCcRangeFree(uint8_t first, uint8_t last)
+{
+    for (uint8_t control = first; control <= last; control++)
+    {
+        if (PARAMS_BY_MIDI_CC[control] != nullptr)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
 #endif
\ No newline at end of file
@@ -1,7 +1,7 @@
 #ifndef ConstantSynthWaveforms_h
 #define ConstantSynthWaveforms_h
 
-#include <vector>
+#include <array>
 #include <Audio.h>
 #include "SynthWaveform.h"
 
@@ -22,7 +22,7 @@
 #include "AKWF_WaveForms/AKWF_snippet.h"
 
 // waveforms available to the oscillators:
-const std::vector<SynthWaveform> SYNTH_WAVEFORMS{
+PROGMEM constexpr std::array<SynthWaveform, 93> SYNTH_WAVEFORMS{{
     {"Sawtooth", WAVEFORM_BANDLIMIT_SAWTOOTH, nullptr},
     {"Sawtooth (reverse)", WAVEFORM_BANDLIMIT_SAWTOOTH_REVERSE, nullptr},
     {"Square (w/shape)", WAVEFORM_BANDLIMIT_PULSE, nullptr},
@@ -116,6 +116,9 @@ const std::vector<SynthWaveform> SYNTH_WAVEFORMS{
     {"Wave - Snippet 44", WAVEFORM_ARBITRARY, AKWF_snippet_0044},
     {"Wave - Snippet 45", WAVEFORM_ARBITRARY, AKWF_snippet_0045},
     {"Wave - Snippet 46", WAVEFORM_ARBITRARY, AKWF_snippet_0046},
-};
+}};
+
+// the array size must match the number of waveforms, missing entries would be left empty
+static_assert(SYNTH_WAVEFORMS.back().name != nullptr, "SYNTH_WAVEFORMS size doesn't match the number of waveforms");
 
 #endif
\ No newline at end of file
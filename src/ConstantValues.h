@@ -95,6 +95,9 @@ PROGMEM static const uint8_t MIDIMIX_MASTER_SLIDER_CC{62};
 const char FILE_SIGNATURE[]{"TMP0"};
 const uint8_t FILE_SIGNATURE_SIZE{4};
 
+// number of patches (patch numbers 0-63)
+const uint8_t PATCH_COUNT{64};
+
 // generic transition speed for some of the controls
 const float TRANSITION_SPEED_MS{2.0f};
 
@@ -124,69 +127,73 @@ const uint8_t CONTROL_ND_VALUE_7{MIDIMIX_CH_7_REC_ARM_NT};
 const uint8_t CONTROL_NI_VALUE_8{MIDIMIX_CH_8_MUTE_NT};
 const uint8_t CONTROL_ND_VALUE_8{MIDIMIX_CH_8_REC_ARM_NT};
 
-// increment button note to value map
-const std::map<uint8_t, uint8_t> CONTROL_NI_VALUE_MAP{
-    {CONTROL_NI_VALUE_1, 1},
-    {CONTROL_NI_VALUE_2, 2},
-    {CONTROL_NI_VALUE_3, 3},
-    {CONTROL_NI_VALUE_4, 4},
-    {CONTROL_NI_VALUE_5, 5},
-    {CONTROL_NI_VALUE_6, 6},
-    {CONTROL_NI_VALUE_7, 7},
-    {CONTROL_NI_VALUE_8, 8}
-};
-
-// decrement button note to value map
-const std::map<uint8_t, uint8_t> CONTROL_ND_VALUE_MAP{
-    {CONTROL_ND_VALUE_1, 1},
-    {CONTROL_ND_VALUE_2, 2},
-    {CONTROL_ND_VALUE_3, 3},
-    {CONTROL_ND_VALUE_4, 4},
-    {CONTROL_ND_VALUE_5, 5},
-    {CONTROL_ND_VALUE_6, 6},
-    {CONTROL_ND_VALUE_7, 7},
-    {CONTROL_ND_VALUE_8, 8}
-};
-
-// increment value to button note map
-const std::map<uint8_t, uint8_t> CONTROL_VALUE_NI_MAP{
-    {1, CONTROL_NI_VALUE_1},
-    {2, CONTROL_NI_VALUE_2},
-    {3, CONTROL_NI_VALUE_3},
-    {4, CONTROL_NI_VALUE_4},
-    {5, CONTROL_NI_VALUE_5},
-    {6, CONTROL_NI_VALUE_6},
-    {7, CONTROL_NI_VALUE_7},
-    {8, CONTROL_NI_VALUE_8}
-};
-
-// decrement value to button note map
-const std::map<uint8_t, uint8_t> CONTROL_VALUE_ND_MAP{
-    {1, CONTROL_ND_VALUE_1},
-    {2, CONTROL_ND_VALUE_2},
-    {3, CONTROL_ND_VALUE_3},
-    {4, CONTROL_ND_VALUE_4},
-    {5, CONTROL_ND_VALUE_5},
-    {6, CONTROL_ND_VALUE_6},
-    {7, CONTROL_ND_VALUE_7},
-    {8, CONTROL_ND_VALUE_8}
-};
-
+// increment / decrement button notes for the values 1 - 8 (index 0 is value 1)
+constexpr std::array<uint8_t, 8> CONTROL_NI_VALUE_NOTES{{CONTROL_NI_VALUE_1, CONTROL_NI_VALUE_2, CONTROL_NI_VALUE_3, CONTROL_NI_VALUE_4, CONTROL_NI_VALUE_5, CONTROL_NI_VALUE_6, CONTROL_NI_VALUE_7, CONTROL_NI_VALUE_8}};
+constexpr std::array<uint8_t, 8> CONTROL_ND_VALUE_NOTES{{CONTROL_ND_VALUE_1, CONTROL_ND_VALUE_2, CONTROL_ND_VALUE_3, CONTROL_ND_VALUE_4, CONTROL_ND_VALUE_5, CONTROL_ND_VALUE_6, CONTROL_ND_VALUE_7, CONTROL_ND_VALUE_8}};
+
+/**
+ * Create a note to value lookup table for the increment / decrement buttons.
+ *
+ * @param notes button notes for the values 1 - 8
+ * @return std::array<uint8_t, 128> value (1 - 8) for each note, 0 if the note is not one of the buttons
+ */
+constexpr std::array<uint8_t, 128> createControlNoteValueTable(const std::array<uint8_t, 8> &notes)
+{
+    std::array<uint8_t, 128> table{};
+    for (uint8_t i = 0; i < notes.size(); i++)
+    {
+        table[notes[i]] = i + 1;
+    }
+    return table;
+}
+
+// increment / decrement button note to value tables
+constexpr std::array<uint8_t, 128> CONTROL_NI_VALUE_TABLE{createControlNoteValueTable(CONTROL_NI_VALUE_NOTES)};
+constexpr std::array<uint8_t, 128> CONTROL_ND_VALUE_TABLE{createControlNoteValueTable(CONTROL_ND_VALUE_NOTES)};
+
+/**
+ * Get the value of an increment button.
+ *
+ * @param note note
+ * @return uint8_t value (1 - 8), 0 if the note is not an increment button
+ */
+inline uint8_t getControlNiValue(uint8_t note)
+{
+    return note < CONTROL_NI_VALUE_TABLE.size() ? CONTROL_NI_VALUE_TABLE[note] : 0;
+}
+
+/**
+ * Get the value of a decrement button.
+ *
+ * @param note note
+ * @return uint8_t value (1 - 8), 0 if the note is not a decrement button
+ */
+inline uint8_t getControlNdValue(uint8_t note)
+{
+    return note < CONTROL_ND_VALUE_TABLE.size() ? CONTROL_ND_VALUE_TABLE[note] : 0;
+}
+
+
+// param groups, used as index in PARAM_GROUP_NAMES
+enum class ParamGroup : uint8_t { env1, env2, filter, filterMod, lfo, lfoMod, osc1, osc1Mod, oscFm, oscFmMod, ampMod, misc, modWhl, morph };
 
 // param group names
-const std::string PARAM_GROUP_NAME_ENV_1{"Envelope 1"};
-const std::string PARAM_GROUP_NAME_ENV_2{"Envelope 2"};
-const std::string PARAM_GROUP_NAME_FILTER{"Filters"};
-const std::string PARAM_GROUP_NAME_FILTER_MOD{"Filter modulation"};
-const std::string PARAM_GROUP_NAME_LFO{"LFO"};
-const std::string PARAM_GROUP_NAME_LFO_MOD{"LFO modulation"};
-const std::string PARAM_GROUP_NAME_OSC_1{"Oscillator 1"};
-const std::string PARAM_GROUP_NAME_OSC_1_MOD{"Osc. 1 modulation"};
-const std::string PARAM_GROUP_NAME_OSC_FM{"Oscillator FM"};
-const std::string PARAM_GROUP_NAME_OSC_FM_MOD{"Osc. FM modulation"};
-const std::string PARAM_GROUP_NAME_AMP_MOD{"Amplifier modulation"};
-const std::string PARAM_GROUP_NAME_MISC{"Miscellaneous"};
-const std::string PARAM_GROUP_NAME_MOD_WHL{"Modulation wheel"};
+PROGMEM constexpr std::array<const char *, 14> PARAM_GROUP_NAMES{{
+    "Envelope 1",
+    "Envelope 2",
+    "Filters",
+    "Filter modulation",
+    "LFO",
+    "LFO modulation",
+    "Oscillator 1",
+    "Osc. 1 modulation",
+    "Oscillator FM",
+    "Osc. FM modulation",
+    "Amplifier modulation",
+    "Miscellaneous",
+    "Modulation wheel",
+    "Morph"
+}};
 
 
 // constant for params
@@ -322,6 +329,7 @@ const uint8_t PARAM_MC_OSC_1_UNISON_MIX{87};
 const uint16_t PARAM_ID_OSC_FM_WAVEFORM{901};
 const uint16_t PARAM_ID_OSC_FM_OCTAVE{904};
 const uint16_t PARAM_ID_OSC_FM_TRANSPOSE{905};
+const uint16_t PARAM_ID_OSC_FM_OVERSAMPLING{906};
 
 const uint8_t PARAM_NI_OSC_FM_WAVEFORM{MIDIMIX_CH_6_MUTE_NT};
 const uint8_t PARAM_ND_OSC_FM_WAVEFORM{MIDIMIX_CH_6_REC_ARM_NT};
@@ -329,10 +337,12 @@ const uint8_t PARAM_NI_OSC_FM_OCTAVE{MIDIMIX_CH_7_MUTE_NT};
 const uint8_t PARAM_ND_OSC_FM_OCTAVE{MIDIMIX_CH_7_REC_ARM_NT};
 const uint8_t PARAM_NI_OSC_FM_TRANSPOSE{MIDIMIX_CH_8_MUTE_NT};
 const uint8_t PARAM_ND_OSC_FM_TRANSPOSE{MIDIMIX_CH_8_REC_ARM_NT};
+const uint8_t PARAM_MI_OSC_FM_OVERSAMPLING{4};
 
 const uint8_t PARAM_MC_OSC_FM_WAVEFORM{88};
 const uint8_t PARAM_MC_OSC_FM_OCTAVE{89};
 const uint8_t PARAM_MC_OSC_FM_TRANSPOSE{90};
+const uint8_t PARAM_MC_OSC_FM_OVERSAMPLING{109};
 
 // osc fm mod
 const uint16_t PARAM_ID_OSC_FM_MOD_PHASE_MOD_ENV_2{1011};
@@ -357,6 +367,7 @@ const uint16_t PARAM_ID_PITCH_CHANGE_RANGE{1301};
 const uint16_t PARAM_ID_OSC_VOLUME_MIX{1302};
 const uint16_t PARAM_ID_ENSEMBLE_MIX{1303};
 const uint16_t PARAM_ID_ENSEMBLE_LFO_RATE{1304};
+const uint16_t PARAM_ID_WAVESHAPE_OVERSAMPLING{1305};
 
 const uint8_t PARAM_CC_WAVESHAPE_LEVEL{MIDIMIX_CH_3_DAIL_3_CC};
 const uint8_t PARAM_NI_PITCH_CHANGE_RANGE_LEVEL{MIDIMIX_CH_3_MUTE_NT};
@@ -364,12 +375,14 @@ const uint8_t PARAM_ND_PITCH_CHANGE_RANGE_LEVEL{MIDIMIX_CH_3_REC_ARM_NT};
 const uint8_t PARAM_CC_OSC_VOLUME_MIX{MIDIMIX_CH_1_DAIL_1_CC};
 const uint8_t PARAM_CC_ENSEMBLE_MIX{MIDIMIX_CH_7_DAIL_3_CC};
 const uint8_t PARAM_CC_ENSEMBLE_LFO_RATE{MIDIMIX_CH_7_DAIL_2_CC};
+const uint8_t PARAM_MI_WAVESHAPE_OVERSAMPLING{3};
 
 const uint8_t PARAM_MC_WAVESHAPE_LEVEL{104};
 const uint8_t PARAM_MC_PITCH_CHANGE_RANGE_LEVEL{105};
 const uint8_t PARAM_MC_OSC_VOLUME_MIX{106};
 const uint8_t PARAM_MC_ENSEMBLE_MIX{93};
 const uint8_t PARAM_MC_ENSEMBLE_LFO_RATE{94};
+const uint8_t PARAM_MC_WAVESHAPE_OVERSAMPLING{108};
 
 // amp
 const uint16_t PARAM_ID_AMP_MOD_LFO{1400};
@@ -383,9 +396,12 @@ const uint8_t PARAM_MC_AMP_KBD_VELOCITY{95};
 
 // menu
 const uint16_t PARAM_ID_MOD_WHL_ENV_REVERSE{1500};
+const uint16_t PARAM_ID_MORPH_TARGET{1501};
 
 const uint8_t PARAM_MI_MOD_WHL_ENV_REVERSE{0};
+const uint8_t PARAM_MI_MORPH_TARGET{5};
 
 const uint8_t PARAM_MC_MOD_WHL_ENV_REVERSE{107};
+const uint8_t PARAM_MC_MORPH_TARGET{110};
 
 #endif
\ No newline at end of file
@@ -0,0 +1,112 @@
+#ifndef ControlSmoother_h
+#define ControlSmoother_h
+
+#include <stdint.h>
+
+#include <Audio.h>
+
+#include "AudioConfig.h"
+
+// references to external global constants
+extern const float TRANSITION_SPEED_MS;
+
+/**
+ * Control rate parameter smoother.
+ * The target value is set from the main program, the audio object calls next() once per block to get a linear ramp
+ * for the samples of that block. A change of the target reaches the new value in TRANSITION_SPEED_MS.
+ *
+ * All ramp state is only touched by the audio update, the main program only writes the target, so no interrupts
+ * need to be disabled.
+ */
+class ControlSmoother
+{
+private:
+    volatile float target;
+
+    // audio update state
+    float current;
+    float rampTarget;
+    float rampStep{0.0f};
+    float rampSamples;
+
+public:
+    /**
+     * Create a smoother.
+     *
+     * @param value initial value
+     */
+    ControlSmoother(float value = 0.0f) : target(value), current(value), rampTarget(value)
+    {
+        rampSamples = max(1.0f, TRANSITION_SPEED_MS * AUDIO_SAMPLE_RATE_EXACT / 1000.0f);
+    }
+
+    /**
+     * Get the time from setting a target in the main program until the value has reached it: the ramp starts at the
+     * next audio block and takes TRANSITION_SPEED_MS, rounded up to audio blocks.
+     *
+     * @return uint32_t time in microseconds
+     */
+    static uint32_t getSettleMicros()
+    {
+        return (TRANSITION_SPEED_MS + 2 * AUDIO_BLOCK_MS) * 1000;
+    }
+
+    /**
+     * Set a new target value, the value will ramp to the target.
+     *
+     * @param value target value
+     */
+    void set(float value)
+    {
+        target = value;
+    }
+
+    /**
+     * Is the value at rest, at the given value? To be called from the audio update only.
+     *
+     * @param value value to compare to
+     * @return true if the value doesn't change and equals value
+     */
+    bool isSteadyAt(float value) const
+    {
+        return current == value && target == value;
+    }
+
+    /**
+     * Advance the smoother by one block. To be called from the audio update only.
+     * The value for sample i of the block is start + increment * (i + 1), the last sample of the block gets the new current value.
+     *
+     * @param start value at the end of the previous block
+     * @param increment increment per sample
+     * @return true if the value changes during this block
+     */
+    bool next(float &start, float &increment)
+    {
+        float newTarget = target;
+        start = current;
+        if (newTarget == current)
+        {
+            increment = 0.0f;
+            return false;
+        }
+
+        if (newTarget != rampTarget)
+        {
+            rampTarget = newTarget;
+            rampStep = (newTarget - current) / rampSamples;
+        }
+
+        float end = current + rampStep * AUDIO_BLOCK_SAMPLES;
+        if ((rampStep > 0.0f && end >= newTarget) || (rampStep < 0.0f && end <= newTarget) || rampStep == 0.0f)
+        {
+            // the target is reached in this block, stretch the last part of the ramp over the full block
+            end = newTarget;
+        }
+
+        increment = (end - current) / AUDIO_BLOCK_SAMPLES;
+        current = end;
+        return true;
+    }
+};
+
+#endif
@@ -0,0 +1,49 @@
+#ifndef Crc32_h
+#define Crc32_h
+
+#include <Arduino.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <array>
+
+/**
+ * Create the lookup table for the CRC-32 (IEEE 802.3, reflected polynomial 0xEDB88320).
+ * 
+ * @return constexpr std::array<uint32_t, 256> CRC-32 table
+ */
+constexpr std::array<uint32_t, 256> createCrc32Table()
+{
+    std::array<uint32_t, 256> table{};
+    for (uint32_t i = 0; i < 256; i++)
+    {
+        uint32_t crc = i;
+        for (uint8_t bit = 0; bit < 8; bit++)
+        {
+            crc = (crc & 1) ? (crc >> 1) ^ 0xEDB88320 : crc >> 1;
+        }
+        table[i] = crc;
+    }
+    return table;
+}
+
+PROGMEM constexpr std::array<uint32_t, 256> CRC32_TABLE{createCrc32Table()};
+
+/**
+ * Calculate the CRC-32 of a block of data, compatible with zlib.crc32() in Python.
+ * 
+ * @param data data
+ * @param length length in bytes
+ * @param crc CRC-32 of the preceding data, to calculate the CRC-32 of data in several parts
+ * @return uint32_t CRC-32
+ */
+inline uint32_t crc32(const uint8_t *data, size_t length, uint32_t crc = 0)
+{
+    crc = ~crc;
+    for (size_t i = 0; i < length; i++)
+    {
+        crc = CRC32_TABLE[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+#endif
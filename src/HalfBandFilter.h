@@ -0,0 +1,336 @@
+#ifndef HalfBandFilter_h
+#define HalfBandFilter_h
+
+#include <stdint.h>
+#include <stddef.h>
+#include <array>
+#include <algorithm>
+
+// Polyphase half-band FIR filters for 2x up and down sampling, used by the oversampled audio objects.
+// A half-band filter has every other coefficient equal to zero (except the center tap of 0.5), so only the odd phase
+// needs to be calculated. The odd phase is symmetric, only one side of the coefficients is stored.
+//
+// Coefficients are Q15 and sum up to 16384 (one side), giving unity gain.
+// Samples are int32_t, the symmetric sample pairs are added before multiplying, so samples must stay within +/- 2^30.
+// They are calculated using a Kaiser windowed sinc, see the comments with each set for the response.
+
+// 31 taps (8 unique coefficients), Kaiser beta 5
+// passband ripple 0.02dB up to 0.2 fs, stopband attenuation 53dB from 0.3 fs
+// used for 1x <-> 2x (44.1khz <-> 88.2khz: flat up to 17.6khz, images above 26.5khz attenuated)
+inline constexpr std::array<int32_t, 8> HALF_BAND_COEFFICIENTS_31{{20701, -6425, 3338, -1906, 1080, -574, 268, -98}};
+
+// 11 taps (3 unique coefficients), Kaiser beta 5
+// passband ripple 0.015dB up to 0.1 fs, stopband attenuation 55dB from 0.4 fs
+// used for 2x <-> 4x, the signal only occupies the lower half of the band at this stage, which allows a much wider transition band
+inline constexpr std::array<int32_t, 3> HALF_BAND_COEFFICIENTS_11{{19609, -3844, 619}};
+
+// Stereo samples are packed in a uint32_t, the left sample in the bottom and the right sample in the top 16 bits, so
+// both channels are filtered in a single pass (see StereoHalfBandInterpolator and StereoHalfBandDecimator). On the
+// Cortex-M7 the symmetric sample pairs of both channels are multiplied and accumulated with the DSP extension, the
+// host build uses the portable version.
+
+/**
+ * Pack a stereo sample, both channels are saturated to 16 bits.
+ *
+ * @param left left sample
+ * @param right right sample
+ * @return uint32_t packed stereo sample
+ */
+inline uint32_t packStereo(const int32_t left, const int32_t right)
+{
+    return (uint16_t)std::clamp(left, -32768, 32767) | (uint32_t)(uint16_t)std::clamp(right, -32768, 32767) << 16;
+}
+
+inline int16_t stereoLeft(const uint32_t sample)
+{
+    return (int16_t)sample;
+}
+
+inline int16_t stereoRight(const uint32_t sample)
+{
+    return (int16_t)(sample >> 16);
+}
+
+/**
+ * Multiply the sum of the symmetric samples a and b of both channels by a coefficient and add it to the accumulators.
+ *
+ * @param accLeft left accumulator
+ * @param accRight right accumulator
+ * @param a packed stereo sample
+ * @param b packed stereo sample
+ * @param coefficient Q15 coefficient in both halves, see packCoefficients()
+ */
+inline void stereoMultiplyAccumulate(int64_t &accLeft, int64_t &accRight, const uint32_t a, const uint32_t b, const uint32_t coefficient)
+{
+#if defined(__ARM_FEATURE_DSP)
+    uint32_t left;
+    uint32_t right;
+    // left of a and b, right of a and b
+    asm("pkhbt %0, %1, %2, lsl #16" : "=r"(left) : "r"(a), "r"(b));
+    asm("pkhtb %0, %1, %2, asr #16" : "=r"(right) : "r"(b), "r"(a));
+    asm("smlald %Q0, %R0, %1, %2" : "+r"(accLeft) : "r"(left), "r"(coefficient));
+    asm("smlald %Q0, %R0, %1, %2" : "+r"(accRight) : "r"(right), "r"(coefficient));
+#else
+    accLeft += (int64_t)stereoLeft(coefficient) * (stereoLeft(a) + stereoLeft(b));
+    accRight += (int64_t)stereoLeft(coefficient) * (stereoRight(a) + stereoRight(b));
+#endif
+}
+
+/**
+ * Put each coefficient in both halves of a uint32_t, for stereoMultiplyAccumulate().
+ */
+template <size_t K>
+constexpr std::array<uint32_t, K> packCoefficients(const std::array<int32_t, K> &coefficients)
+{
+    std::array<uint32_t, K> packed{};
+    for (size_t j = 0; j < K; j++)
+    {
+        packed[j] = (uint16_t)coefficients[j] | (uint32_t)(uint16_t)coefficients[j] << 16;
+    }
+    return packed;
+}
+
+/**
+ * Half-band 2x interpolator.
+ * Produces two output samples for every input sample.
+ * The even output is the input delayed by K samples, the odd output is the interpolated sample halfway to the next one.
+ * Latency is K input samples.
+ *
+ * @tparam K number of unique coefficients
+ * @tparam COEFFICIENTS odd phase coefficients (Q15, one side)
+ * @tparam MAX_INPUT_SAMPLES maximum number of input samples per process() call
+ */
+template <size_t K, const std::array<int32_t, K> &COEFFICIENTS, size_t MAX_INPUT_SAMPLES>
+class HalfBandInterpolator
+{
+private:
+    static constexpr size_t HISTORY_SIZE{2 * K - 1};
+
+    // history followed by the samples of the current process() call
+    std::array<int32_t, HISTORY_SIZE + MAX_INPUT_SAMPLES> buffer{};
+
+public:
+    /**
+     * Latency in input samples.
+     */
+    static constexpr size_t LATENCY{K};
+
+    /**
+     * Clear the filter history.
+     */
+    void reset()
+    {
+        buffer.fill(0);
+    }
+
+    /**
+     * Upsample numSamples input samples to 2 * numSamples output samples.
+     *
+     * @param input input samples
+     * @param output output samples (2 * numSamples)
+     * @param numSamples number of input samples (up to MAX_INPUT_SAMPLES)
+     */
+    void process(const int32_t *input, int32_t *output, const size_t numSamples)
+    {
+        std::copy(input, input + numSamples, buffer.begin() + HISTORY_SIZE);
+
+        for (size_t i = 0; i < numSamples; i++)
+        {
+            // base points to the sample just before the interpolated position
+            const int32_t *base = &buffer[K - 1 + i];
+
+            int64_t acc = 1 << 14;
+            for (size_t j = 0; j < K; j++)
+            {
+                acc += (int64_t)COEFFICIENTS[j] * (base[-(int32_t)j] + base[j + 1]);
+            }
+
+            *output++ = base[0];
+            *output++ = (int32_t)(acc >> 15);
+        }
+
+        std::copy(buffer.begin() + numSamples, buffer.begin() + numSamples + HISTORY_SIZE, buffer.begin());
+    }
+};
+
+/**
+ * Half-band 2x decimator.
+ * Filters and produces one output sample for every two input samples.
+ * Latency is 2K - 2 input samples (K - 1 output samples).
+ *
+ * @tparam K number of unique coefficients
+ * @tparam COEFFICIENTS odd phase coefficients (Q15, one side)
+ * @tparam MAX_OUTPUT_SAMPLES maximum number of output samples per process() call
+ */
+template <size_t K, const std::array<int32_t, K> &COEFFICIENTS, size_t MAX_OUTPUT_SAMPLES>
+class HalfBandDecimator
+{
+private:
+    static constexpr size_t HISTORY_SIZE{4 * K - 2};
+
+    // history followed by the samples of the current process() call
+    std::array<int32_t, HISTORY_SIZE + 2 * MAX_OUTPUT_SAMPLES> buffer{};
+
+public:
+    /**
+     * Latency in input samples.
+     */
+    static constexpr size_t LATENCY{2 * K - 2};
+
+    /**
+     * Clear the filter history.
+     */
+    void reset()
+    {
+        buffer.fill(0);
+    }
+
+    /**
+     * Downsample 2 * numSamples input samples to numSamples output samples.
+     *
+     * @param input input samples (2 * numSamples)
+     * @param output output samples
+     * @param numSamples number of output samples (up to MAX_OUTPUT_SAMPLES)
+     */
+    void process(const int32_t *input, int32_t *output, const size_t numSamples)
+    {
+        std::copy(input, input + 2 * numSamples, buffer.begin() + HISTORY_SIZE);
+
+        for (size_t i = 0; i < numSamples; i++)
+        {
+            // center tap of the filter
+            const int32_t *center = &buffer[2 * K + 2 * i];
+
+            // the center tap is 0.5, everything is scaled by 2^16 instead of 2^15 to apply the 0.5 factor of the odd phase
+            int64_t acc = ((int64_t)center[0] << 15) + (1 << 15);
+            for (size_t j = 0; j < K; j++)
+            {
+                acc += (int64_t)COEFFICIENTS[j] * (center[-(int32_t)(2 * j + 1)] + center[2 * j + 1]);
+            }
+
+            *output++ = (int32_t)(acc >> 16);
+        }
+
+        std::copy(buffer.begin() + 2 * numSamples, buffer.begin() + 2 * numSamples + HISTORY_SIZE, buffer.begin());
+    }
+};
+
+/**
+ * Half-band 2x interpolator for packed stereo samples, see HalfBandInterpolator.
+ * The interpolated samples are saturated to 16 bits.
+ */
+template <size_t K, const std::array<int32_t, K> &COEFFICIENTS, size_t MAX_INPUT_SAMPLES>
+class StereoHalfBandInterpolator
+{
+private:
+    static constexpr size_t HISTORY_SIZE{2 * K - 1};
+    static constexpr std::array<uint32_t, K> PACKED_COEFFICIENTS{packCoefficients(COEFFICIENTS)};
+
+    // history followed by the samples of the current process() call
+    std::array<uint32_t, HISTORY_SIZE + MAX_INPUT_SAMPLES> buffer{};
+
+public:
+    /**
+     * Latency in input samples.
+     */
+    static constexpr size_t LATENCY{K};
+
+    /**
+     * Clear the filter history.
+     */
+    void reset()
+    {
+        buffer.fill(0);
+    }
+
+    /**
+     * Upsample numSamples input samples to 2 * numSamples output samples.
+     *
+     * @param input packed stereo input samples
+     * @param output packed stereo output samples (2 * numSamples)
+     * @param numSamples number of input samples (up to MAX_INPUT_SAMPLES)
+     */
+    void process(const uint32_t *input, uint32_t *output, const size_t numSamples)
+    {
+        std::copy(input, input + numSamples, buffer.begin() + HISTORY_SIZE);
+
+        for (size_t i = 0; i < numSamples; i++)
+        {
+            // base points to the sample just before the interpolated position
+            const uint32_t *base = &buffer[K - 1 + i];
+
+            int64_t accLeft = 1 << 14;
+            int64_t accRight = 1 << 14;
+            for (size_t j = 0; j < K; j++)
+            {
+                stereoMultiplyAccumulate(accLeft, accRight, base[-(int32_t)j], base[j + 1], PACKED_COEFFICIENTS[j]);
+            }
+
+            *output++ = base[0];
+            *output++ = packStereo((int32_t)(accLeft >> 15), (int32_t)(accRight >> 15));
+        }
+
+        std::copy(buffer.begin() + numSamples, buffer.begin() + numSamples + HISTORY_SIZE, buffer.begin());
+    }
+};
+
+/**
+ * Half-band 2x decimator for packed stereo samples, see HalfBandDecimator.
+ * The output samples are saturated to 16 bits.
+ */
+template <size_t K, const std::array<int32_t, K> &COEFFICIENTS, size_t MAX_OUTPUT_SAMPLES>
+class StereoHalfBandDecimator
+{
+private:
+    static constexpr size_t HISTORY_SIZE{4 * K - 2};
+    static constexpr std::array<uint32_t, K> PACKED_COEFFICIENTS{packCoefficients(COEFFICIENTS)};
+
+    // history followed by the samples of the current process() call
+    std::array<uint32_t, HISTORY_SIZE + 2 * MAX_OUTPUT_SAMPLES> buffer{};
+
+public:
+    /**
+     * Latency in input samples.
+     */
+    static constexpr size_t LATENCY{2 * K - 2};
+
+    /**
+     * Clear the filter history.
+     */
+    void reset()
+    {
+        buffer.fill(0);
+    }
+
+    /**
+     * Downsample 2 * numSamples input samples to numSamples output samples.
+     *
+     * @param input packed stereo input samples (2 * numSamples)
+     * @param output packed stereo output samples
+     * @param numSamples number of output samples (up to MAX_OUTPUT_SAMPLES)
+     */
+    void process(const uint32_t *input, uint32_t *output, const size_t numSamples)
+    {
+        std::copy(input, input + 2 * numSamples, buffer.begin() + HISTORY_SIZE);
+
+        for (size_t i = 0; i < numSamples; i++)
+        {
+            // center tap of the filter
+            const uint32_t *center = &buffer[2 * K + 2 * i];
+
+            // the center tap is 0.5, everything is scaled by 2^16 instead of 2^15 to apply the 0.5 factor of the odd phase
+            int64_t accLeft = ((int64_t)stereoLeft(center[0]) << 15) + (1 << 15);
+            int64_t accRight = ((int64_t)stereoRight(center[0]) << 15) + (1 << 15);
+            for (size_t j = 0; j < K; j++)
+            {
+                stereoMultiplyAccumulate(accLeft, accRight, center[-(int32_t)(2 * j + 1)], center[2 * j + 1], PACKED_COEFFICIENTS[j]);
+            }
+
+            *output++ = packStereo((int32_t)(accLeft >> 16), (int32_t)(accRight >> 16));
+        }
+
+        std::copy(buffer.begin() + 2 * numSamples, buffer.begin() + 2 * numSamples + HISTORY_SIZE, buffer.begin());
+    }
+};
+
+#endif
@@ -0,0 +1,269 @@
+#ifndef MidiCapture_h
+#define MidiCapture_h
+
+#include <Arduino.h>
+#include <stdint.h>
+#include <string.h>
+#include <array>
+#include <vector>
+
+#include "MidiIngest.h"
+#include "PatchService.h"
+
+/**
+ * MIDI capture file format, a log of all incoming MIDI messages with their source and time of arrival.
+ * See src/tmixmidi.py for a host side decoder.
+ *
+ * All numbers are little endian:
+ * - header: signature "TMMC", version (uint16), source count (uint8), reserved (uint8), source names (source count
+ *   times SOURCE_NAME_SIZE bytes, padded with zeros)
+ * - records (8 bytes): timestamp in microseconds since the capture started (uint32, wraps after 71 minutes),
+ *   source << 4 | message type (uint8, see MidiEventType), channel | controller << 7 (uint8), data (uint16)
+ *
+ * The record data is note or control | velocity or value << 7 for notes and control changes, pitch + 8192 for pitch
+ * changes, the program for program changes and the pressure for channel pressure.
+ */
+class MidiCaptureFile
+{
+public:
+    static constexpr const char *FILE_NAME{"capture.tmixmidi"};
+    static constexpr const char *SIGNATURE{"TMMC"};
+    static const uint8_t SIGNATURE_SIZE{4};
+    static const uint16_t VERSION{1};
+    static const uint8_t HEADER_SIZE{8};
+    static const uint8_t SOURCE_NAME_SIZE{12};
+    static const uint8_t RECORD_SIZE{8};
+
+    /**
+     * Get the size of the header including the source names.
+     *
+     * @param sourceCount number of sources
+     * @return constexpr uint16_t header size
+     */
+    static constexpr uint16_t headerSize(uint8_t sourceCount)
+    {
+        return HEADER_SIZE + sourceCount * SOURCE_NAME_SIZE;
+    }
+
+    /**
+     * Append a header to a buffer.
+     *
+     * @param ingest MIDI ingest stage, provides the sources
+     * @param data buffer
+     */
+    static void writeHeader(const MidiIngest &ingest, std::vector<uint8_t> &data)
+    {
+        size_t offset = data.size();
+        data.resize(offset + headerSize(ingest.getSourceCount()), 0);
+
+        uint8_t *header = data.data() + offset;
+        memcpy(header, SIGNATURE, SIGNATURE_SIZE);
+        header[4] = VERSION & 0xFF;
+        header[5] = VERSION >> 8;
+        header[6] = ingest.getSourceCount();
+        for (uint8_t source = 0; source < ingest.getSourceCount(); source++)
+        {
+            strncpy(reinterpret_cast<char *>(header + HEADER_SIZE + source * SOURCE_NAME_SIZE), ingest.getSourceName(source), SOURCE_NAME_SIZE);
+        }
+    }
+
+    /**
+     * Check the header of a capture.
+     *
+     * @param data capture data
+     * @param size capture data size
+     * @return uint16_t header size, 0 if the header is invalid
+     */
+    static uint16_t readHeader(const uint8_t *data, size_t size)
+    {
+        if (size < HEADER_SIZE || memcmp(data, SIGNATURE, SIGNATURE_SIZE) || (data[4] | (data[5] << 8)) != VERSION || size < headerSize(data[6]))
+        {
+            return 0;
+        }
+        return headerSize(data[6]);
+    }
+
+    /**
+     * Append a record to a buffer.
+     *
+     * @param event MIDI message
+     * @param timestamp timestamp in microseconds since the capture started
+     * @param data buffer
+     */
+    static void writeRecord(const MidiEvent &event, uint32_t timestamp, std::vector<uint8_t> &data)
+    {
+        uint16_t value = event.type == MidiEventType::pitchChange ? event.data2 + 8192 : (event.data1 & 0x7F) | ((event.data2 & 0x7F) << 7);
+        uint8_t record[RECORD_SIZE]{
+            (uint8_t)(timestamp & 0xFF), (uint8_t)((timestamp >> 8) & 0xFF), (uint8_t)((timestamp >> 16) & 0xFF), (uint8_t)(timestamp >> 24),
+            (uint8_t)((event.source << 4) | (uint8_t)event.type),
+            (uint8_t)((event.channel & 0x7F) | (event.controller ? 0x80 : 0)),
+            (uint8_t)(value & 0xFF), (uint8_t)(value >> 8)};
+        data.insert(data.end(), record, record + RECORD_SIZE);
+    }
+
+    /**
+     * Read a record.
+     *
+     * @param record record
+     * @return MidiEvent MIDI message, the timestamp is relative to the start of the capture
+     */
+    static MidiEvent readRecord(const uint8_t *record)
+    {
+        uint32_t timestamp = record[0] | (record[1] << 8) | (record[2] << 16) | ((uint32_t)record[3] << 24);
+        MidiEventType type = (MidiEventType)(record[4] & 0x0F);
+        uint16_t value = record[6] | (record[7] << 8);
+        if (type == MidiEventType::pitchChange)
+        {
+            return MidiEvent{timestamp, (uint8_t)(record[4] >> 4), type, (uint8_t)(record[5] & 0x7F), 0, (int16_t)(value - 8192), (record[5] & 0x80) != 0};
+        }
+        return MidiEvent{timestamp, (uint8_t)(record[4] >> 4), type, (uint8_t)(record[5] & 0x7F), (uint8_t)(value & 0x7F), (int16_t)(value >> 7), (record[5] & 0x80) != 0};
+    }
+};
+
+/**
+ * Records all incoming MIDI messages to a capture file on SD (see MidiCaptureFile), to reproduce problems using
+ * MidiReplay.
+ *
+ * Records are collected in blocks of BLOCK_SIZE bytes, full blocks are appended to the file by the storage worker
+ * thread (see PatchService::saveFile()), so recording never waits for the SD card. Partially filled blocks are written
+ * every FLUSH_INTERVAL_MS, so at most that much is lost when the power is switched off. Messages are dropped when all
+ * blocks are waiting to be written.
+ */
+class MidiCapture
+{
+public:
+    static const uint16_t BLOCK_SIZE{512};
+    static const uint8_t BLOCK_COUNT{4};
+    static const uint16_t FLUSH_INTERVAL_MS{1000};
+
+private:
+    PatchService *patchService{nullptr};
+
+    // blocks are filled and written in order, the blocks before the fill block are being written
+    std::array<std::vector<uint8_t>, BLOCK_COUNT> blocks;
+    uint8_t fillBlock{0};
+    uint8_t writingCount{0};
+
+    bool capturing{false};
+    // false until the first block (containing the header) replaced the capture file
+    bool appendBlocks{false};
+    uint32_t startMicros{0};
+    elapsedMillis flushElapsedMillis;
+
+    // statistics
+    uint32_t recorded{0};
+    uint32_t dropped{0};
+    uint32_t writeErrors{0};
+
+    /**
+     * Queue writing the fill block and continue with the next block.
+     *
+     * @return bool true if the fill block is empty or was queued for writing
+     */
+    bool flush()
+    {
+        flushElapsedMillis = 0;
+
+        std::vector<uint8_t> &block = blocks[fillBlock];
+        if (block.empty())
+        {
+            return true;
+        }
+
+        // the next block is still being written
+        if (writingCount == BLOCK_COUNT - 1)
+        {
+            return false;
+        }
+
+        bool queued = patchService->saveFile(MidiCaptureFile::FILE_NAME, block, appendBlocks, [this]([[maybe_unused]] uint8_t patchNumber, [[maybe_unused]] const Patch &patch, bool success)
+        {
+            writingCount--;
+            writeErrors += success ? 0 : 1;
+        });
+        if (!queued)
+        {
+            return false;
+        }
+
+        appendBlocks = true;
+        writingCount++;
+        fillBlock = (fillBlock + 1) % BLOCK_COUNT;
+        blocks[fillBlock].clear();
+        return true;
+    }
+
+public:
+    /**
+     * Start capturing, replacing the capture file.
+     *
+     * @param patchService patch service, used to write the capture file
+     * @param ingest MIDI ingest stage, all sources must have been added
+     */
+    void start(PatchService &patchService, const MidiIngest &ingest)
+    {
+        this->patchService = &patchService;
+        for (std::vector<uint8_t> &block : blocks)
+        {
+            block.reserve(BLOCK_SIZE);
+        }
+
+        MidiCaptureFile::writeHeader(ingest, blocks[fillBlock]);
+        startMicros = micros();
+        flushElapsedMillis = 0;
+        capturing = true;
+
+        Serial.printf("MIDI capture started, writing %s\n", MidiCaptureFile::FILE_NAME);
+    }
+
+    /**
+     * Record a MIDI message, ignored when not capturing.
+     *
+     * @param event MIDI message
+     */
+    void record(const MidiEvent &event)
+    {
+        if (!capturing)
+        {
+            return;
+        }
+
+        if (blocks[fillBlock].size() + MidiCaptureFile::RECORD_SIZE > BLOCK_SIZE && !flush())
+        {
+            dropped++;
+            return;
+        }
+
+        MidiCaptureFile::writeRecord(event, event.timestamp - startMicros, blocks[fillBlock]);
+        recorded++;
+    }
+
+    /**
+     * Write partially filled blocks every FLUSH_INTERVAL_MS.
+     */
+    void task()
+    {
+        if (capturing && flushElapsedMillis >= FLUSH_INTERVAL_MS)
+        {
+            flush();
+        }
+    }
+
+    /**
+     * Log the statistics since the last call and reset them, nothing is logged when not capturing.
+     */
+    void logStats()
+    {
+        if (!capturing)
+        {
+            return;
+        }
+
+        Serial.printf("MIDI capture: %d recorded, %d dropped, %d write errors, %d blocks writing\n", recorded, dropped, writeErrors, writingCount);
+        recorded = 0;
+        dropped = 0;
+        writeErrors = 0;
+    }
+};
+
+#endif
@@ -0,0 +1,386 @@
+#ifndef MidiIngest_h
+#define MidiIngest_h
+
+#include <Arduino.h>
+#include <stdint.h>
+#include <array>
+
+/**
+ * MIDI message types handled by the synth.
+ */
+enum class MidiEventType : uint8_t { noteOn, noteOff, controlChange, pitchChange, programChange, channelPressure };
+
+/**
+ * Dispatch priority of MIDI messages, from highest to lowest.
+ * Note messages are the notes and the channel messages that have to stay in order with them (e.g. sustain).
+ * Controller messages are the MIDImix buttons, mostly changing the state and the LEDs of the controller.
+ */
+enum class MidiPriority : uint8_t { note, controlChange, controller };
+
+/**
+ * A MIDI message read from one of the MIDI sources.
+ */
+struct MidiEvent
+{
+    // micros() when the message was read from the source
+    uint32_t timestamp;
+    uint8_t source;
+    MidiEventType type;
+    uint8_t channel;
+    // note, control, program or pressure
+    uint8_t data1;
+    // velocity, control value or pitch (-8192 - 8191)
+    int16_t data2;
+    // true if the message came from the controller MIDI
+    bool controller;
+};
+
+/**
+ * Single ingest stage for all MIDI input ports.
+ *
+ * The MIDI handlers registered on the sources push the messages, with the index of their source, into a queue per
+ * priority instead of handling them directly. drain() reads at most SOURCE_BUDGET messages from a source, so a busy source doesn't delay the other
+ * sources. dispatch() passes at most DISPATCH_BUDGET queued messages on, highest priority first, messages of the same
+ * priority in order of arrival.
+ *
+ * drain() stops reading a source while a queue has no room for the messages of the next message read (see hasRoom()),
+ * the unread messages wait in the buffers of the source instead of being dropped. When a queue is full anyway, a new
+ * message is dropped, except for a note off: it replaces the newest queued message that isn't a note off, so a note is
+ * never left hanging.
+ *
+ * Each source has a channel filter, see setChannelMask(). The MIDI handlers check accept() before queueing a message,
+ * so messages on unwanted channels (e.g. the other tracks of a multitrack DAW output) are dropped right away.
+ *
+ * Counters are kept for the throughput, dropped and filtered messages per source, and for the queue depth and the
+ * latency (time between reading and dispatching a message) per priority, see logStats().
+ */
+class MidiIngest
+{
+public:
+    static const uint8_t SOURCE_COUNT_MAX{8};
+    static const uint8_t PRIORITY_COUNT{3};
+    // maximum number of messages read from a source per drain()
+    static const uint8_t SOURCE_BUDGET{16};
+    // maximum number of messages passed on per dispatch()
+    static const uint8_t DISPATCH_BUDGET{32};
+    static const uint8_t QUEUE_SIZE{64};
+    // maximum number of messages pushed for a single message read, e.g. a note layered by the keyboard zones
+    static const uint8_t PUSH_COUNT_MAX{4};
+    // channel mask accepting all channels, bit 0 is channel 1
+    static constexpr uint16_t CHANNEL_MASK_ALL{0xFFFF};
+
+private:
+    static constexpr std::array<const char *, PRIORITY_COUNT> PRIORITY_NAMES{{"note", "control change", "controller"}};
+
+    struct Queue
+    {
+        std::array<MidiEvent, QUEUE_SIZE> events;
+        uint8_t head{0};
+        uint8_t count{0};
+    };
+
+    struct SourceStats
+    {
+        const char *name{nullptr};
+        uint32_t received{0};
+        uint32_t dropped{0};
+        uint32_t filtered{0};
+        // drains stopped because a queue was full
+        uint32_t heldBack{0};
+        uint8_t maxBatch{0};
+    };
+
+    struct PriorityStats
+    {
+        uint32_t dispatched{0};
+        uint32_t latencyTotalMicros{0};
+        uint32_t latencyMaxMicros{0};
+        uint8_t maxDepth{0};
+    };
+
+    std::array<Queue, PRIORITY_COUNT> queues;
+    std::array<SourceStats, SOURCE_COUNT_MAX> sourceStats;
+    std::array<PriorityStats, PRIORITY_COUNT> priorityStats;
+    std::array<uint16_t, SOURCE_COUNT_MAX> channelMasks;
+    uint8_t sourceCount{0};
+
+    elapsedMillis statsElapsedMillis;
+
+    /**
+     * Drop the newest message of a queue that isn't a note off, the newer note offs move up.
+     *
+     * @param queue queue
+     * @return bool true if a message was removed, false if the queue only holds note offs
+     */
+    bool removeNewest(Queue &queue)
+    {
+        for (uint8_t i = queue.count; i > 0; i--)
+        {
+            if (queue.events[(queue.head + i - 1) % QUEUE_SIZE].type == MidiEventType::noteOff)
+            {
+                continue;
+            }
+
+            sourceStats[queue.events[(queue.head + i - 1) % QUEUE_SIZE].source].dropped++;
+            for (uint8_t j = i; j < queue.count; j++)
+            {
+                queue.events[(queue.head + j - 1) % QUEUE_SIZE] = queue.events[(queue.head + j) % QUEUE_SIZE];
+            }
+            queue.count--;
+            return true;
+        }
+        return false;
+    }
+
+public:
+    MidiIngest()
+    {
+        channelMasks.fill(CHANNEL_MASK_ALL);
+    }
+
+    /**
+     * Add a MIDI source.
+     *
+     * @param name name used in the statistics
+     * @return uint8_t source index, to be passed to drain()
+     */
+    uint8_t addSource(const char *name)
+    {
+        if (sourceCount == SOURCE_COUNT_MAX)
+        {
+            Serial.println("Error adding MIDI source, too many sources");
+            return SOURCE_COUNT_MAX - 1;
+        }
+
+        sourceStats[sourceCount].name = name;
+        return sourceCount++;
+    }
+
+    /**
+     * Change the name of a source, e.g. when another device is connected to its port.
+     *
+     * @param source source index
+     * @param name name used in the statistics
+     */
+    void setSourceName(uint8_t source, const char *name)
+    {
+        sourceStats[std::min(source, (uint8_t)(SOURCE_COUNT_MAX - 1))].name = name;
+    }
+
+    /**
+     * Get the number of sources.
+     *
+     * @return uint8_t number of sources
+     */
+    uint8_t getSourceCount() const
+    {
+        return sourceCount;
+    }
+
+    /**
+     * Get the name of a source.
+     *
+     * @param source source index
+     * @return const char* name
+     */
+    const char *getSourceName(uint8_t source) const
+    {
+        return sourceStats[source].name;
+    }
+
+    /**
+     * Read the pending messages of a source, at most SOURCE_BUDGET, while the queues have room (see hasRoom()).
+     * The MIDI handlers of the source are expected to call push() with the source index.
+     *
+     * @param source source index
+     * @param device MIDI device, read() is called until it returns false
+     * @return uint8_t number of messages read
+     */
+    template <typename Device>
+    uint8_t drain(uint8_t source, Device &device)
+    {
+        SourceStats &stats = sourceStats[source];
+        uint8_t batch{0};
+        while (batch < SOURCE_BUDGET)
+        {
+            if (!hasRoom())
+            {
+                stats.heldBack++;
+                break;
+            }
+            if (!device.read())
+            {
+                break;
+            }
+            batch++;
+        }
+
+        stats.maxBatch = std::max(stats.maxBatch, batch);
+        return batch;
+    }
+
+    /**
+     * Check if every queue has room for the messages pushed for a single message read (PUSH_COUNT_MAX), the type of the
+     * next message of a source isn't known before it is read.
+     *
+     * @return bool true if another message can be read
+     */
+    bool hasRoom() const
+    {
+        for (const Queue &queue : queues)
+        {
+            if (queue.count > QUEUE_SIZE - PUSH_COUNT_MAX)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * Set the channels accepted from a source.
+     *
+     * @param source source index
+     * @param channelMask accepted channels, bit 0 is channel 1
+     */
+    void setChannelMask(uint8_t source, uint16_t channelMask)
+    {
+        channelMasks[std::min(source, (uint8_t)(SOURCE_COUNT_MAX - 1))] = channelMask;
+    }
+
+    /**
+     * Check if a message of a source passes the channel filter, a filtered message is counted as received and filtered.
+     *
+     * @param source source index
+     * @param channel channel (1 - 16)
+     * @return bool true if the channel is accepted from the source
+     */
+    bool accept(uint8_t source, uint8_t channel)
+    {
+        source = std::min(source, (uint8_t)(SOURCE_COUNT_MAX - 1));
+        if (channelMasks[source] & (1 << ((channel - 1) & 0x0F)))
+        {
+            return true;
+        }
+
+        filter(source);
+        return false;
+    }
+
+    /**
+     * Count a message of a source dropped before it was queued, e.g. a note outside the keyboard zones.
+     *
+     * @param source source index
+     */
+    void filter(uint8_t source)
+    {
+        SourceStats &stats = sourceStats[std::min(source, (uint8_t)(SOURCE_COUNT_MAX - 1))];
+        stats.received++;
+        stats.filtered++;
+    }
+
+    /**
+     * Queue a message read from a source.
+     *
+     * @param source source index, limited to the last source (messages replayed from a capture file)
+     * @param priority priority
+     * @param type message type
+     * @param channel channel
+     * @param data1 note, control, program or pressure
+     * @param data2 velocity, control value or pitch
+     * @param controller true if the message came from the controller MIDI
+     */
+    void push(uint8_t source, MidiPriority priority, MidiEventType type, uint8_t channel, uint8_t data1, int16_t data2, bool controller)
+    {
+        source = std::min(source, (uint8_t)(SOURCE_COUNT_MAX - 1));
+        SourceStats &stats = sourceStats[source];
+        stats.received++;
+
+        Queue &queue = queues[(uint8_t)priority];
+        if (queue.count == QUEUE_SIZE && (type != MidiEventType::noteOff || !removeNewest(queue)))
+        {
+            stats.dropped++;
+            return;
+        }
+
+        queue.events[(queue.head + queue.count) % QUEUE_SIZE] = MidiEvent{micros(), source, type, channel, data1, data2, controller};
+        queue.count++;
+
+        PriorityStats &queueStats = priorityStats[(uint8_t)priority];
+        queueStats.maxDepth = std::max(queueStats.maxDepth, queue.count);
+    }
+
+    /**
+     * Pass queued messages on, at most DISPATCH_BUDGET, highest priority first.
+     *
+     * @param handler function called with each message (const MidiEvent &)
+     * @return uint8_t number of messages passed on
+     */
+    template <typename Handler>
+    uint8_t dispatch(Handler &&handler)
+    {
+        uint8_t dispatched{0};
+        for (uint8_t priority = 0; priority < PRIORITY_COUNT; priority++)
+        {
+            Queue &queue = queues[priority];
+            PriorityStats &stats = priorityStats[priority];
+            while (queue.count > 0 && dispatched < DISPATCH_BUDGET)
+            {
+                const MidiEvent &event = queue.events[queue.head];
+                uint32_t latency = micros() - event.timestamp;
+                stats.dispatched++;
+                stats.latencyTotalMicros += latency;
+                stats.latencyMaxMicros = std::max(stats.latencyMaxMicros, latency);
+
+                handler(event);
+
+                queue.head = (queue.head + 1) % QUEUE_SIZE;
+                queue.count--;
+                dispatched++;
+            }
+        }
+        return dispatched;
+    }
+
+    /**
+     * Check if messages are queued.
+     *
+     * @return bool true if messages are queued
+     */
+    bool isPending() const
+    {
+        for (const Queue &queue : queues)
+        {
+            if (queue.count > 0)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * Log the statistics since the last call and reset them.
+     */
+    void logStats()
+    {
+        float seconds = statsElapsedMillis / 1000.0f;
+        statsElapsedMillis = 0;
+
+        Serial.println();
+        for (uint8_t source = 0; source < sourceCount; source++)
+        {
+            SourceStats &stats = sourceStats[source];
+            Serial.printf("MIDI ingest source %s: %.1f messages/s, %d dropped, max %d messages per drain, %d filtered, %d held back\n", stats.name, seconds > 0.0f ? stats.received / seconds : 0.0f, stats.dropped, stats.maxBatch, stats.filtered, stats.heldBack);
+            stats = SourceStats{stats.name};
+        }
+        for (uint8_t priority = 0; priority < PRIORITY_COUNT; priority++)
+        {
+            PriorityStats &stats = priorityStats[priority];
+            Serial.printf("MIDI ingest priority %s: %d dispatched, latency %dus average, %dus max, max queue depth %d\n", PRIORITY_NAMES[priority], stats.dispatched, stats.dispatched ? stats.latencyTotalMicros / stats.dispatched : 0, stats.latencyMaxMicros, stats.maxDepth);
+            stats = PriorityStats{};
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,346 @@
+#ifndef MidiOutputQueue_h
+#define MidiOutputQueue_h
+
+#include <Arduino.h>
+#include <MIDI.h>
+#include <stdint.h>
+#include <array>
+
+#include "MidiIngest.h"
+
+/**
+ * MIDI library settings for the hardware serial MIDI.
+ * Running status leaves out the status byte of consecutive messages with the same status, a control change then
+ * takes 2 bytes instead of 3 on the wire.
+ * The SysEx buffer fits a patch dump, see PatchSysEx.h.
+ */
+struct SerialMidiSettings : public midi::DefaultSettings
+{
+    static const bool UseRunningStatus = true;
+    static const unsigned SysExMaxSize = 256;
+};
+
+using SerialMidiInterface = midi::MidiInterface<midi::SerialMIDI<HardwareSerial>, SerialMidiSettings>;
+
+/**
+ * Output queue for MIDI messages sent on a single channel.
+ *
+ * Only the latest value of each control change is kept until it is sent, so moving a knob or sending many params at
+ * once doesn't build up a backlog. Control changes are sent in the order they were first queued. NRPNs (14-bit values,
+ * sent as 4 control changes) are coalesced by number like control changes and sent after the control changes queued
+ * before the next program change. Program changes are kept in order with the control changes and NRPNs: the control
+ * changes and NRPNs queued before a program change are sent before it and are no longer replaced by values queued after
+ * it, which are sent after the program change. Control changes are dropped when CONTROL_CHANGE_QUEUE_SIZE are pending,
+ * NRPNs when NRPN_QUEUE_SIZE are pending, program changes when PROGRAM_CHANGE_QUEUE_SIZE are pending.
+ *
+ * Output can be paced to the rate of the wire: messages are only sent when the time needed to transmit the previous
+ * bytes has passed, with a small burst allowance. The byte count assumes running status (see SerialMidiSettings).
+ * SysEx messages are sent outside the queue, see takeSysExCredit().
+ */
+class MidiOutputQueue
+{
+public:
+    // 31250 baud, 10 bits per byte
+    static const uint16_t SERIAL_MIDI_MICROS_PER_BYTE{320};
+    // room for all controls, plus the values of controls sent again after a queued program change
+    static const uint16_t CONTROL_CHANGE_QUEUE_SIZE{256};
+    static const uint8_t PROGRAM_CHANGE_QUEUE_SIZE{8};
+    // room for all params, plus the values of params sent again after a queued program change (see MIDI_OUT_NRPN)
+    static const uint8_t NRPN_QUEUE_SIZE{128};
+    // bytes that may be sent at once after the output was idle
+    static const uint8_t BURST_BYTES{16};
+
+private:
+    static const uint8_t STATUS_CONTROL_CHANGE{0xB0};
+    static const uint8_t STATUS_PROGRAM_CHANGE{0xC0};
+    static const uint8_t CC_DATA_ENTRY_MSB{6};
+    static const uint8_t CC_DATA_ENTRY_LSB{38};
+    static const uint8_t CC_NRPN_LSB{98};
+    static const uint8_t CC_NRPN_MSB{99};
+
+    struct ControlChange
+    {
+        uint8_t control;
+        uint8_t value;
+    };
+
+    struct ProgramChange
+    {
+        uint8_t program;
+        // number of control changes and NRPNs queued before the program change, see controlChangesQueued and nrpnsQueued
+        uint32_t controlChangesBefore;
+        uint32_t nrpnsBefore;
+    };
+
+    struct Nrpn
+    {
+        uint16_t number;
+        uint16_t value;
+    };
+
+    const uint8_t channel;
+    // 0 to send without pacing
+    const uint16_t microsPerByte;
+
+    // pending control changes in the order they were queued, the control change numbered n (counting all control changes
+    // queued) is stored at n % CONTROL_CHANGE_QUEUE_SIZE
+    std::array<ControlChange, CONTROL_CHANGE_QUEUE_SIZE> controlChanges;
+    uint32_t controlChangesQueued{0};
+    uint32_t controlChangesSent{0};
+    // number of the last control change queued per control
+    std::array<uint32_t, 128> controlChangeNumbers{};
+    // control changes numbered below this were queued before the last program change and are not replaced anymore
+    uint32_t controlChangesFrozen{0};
+
+    std::array<ProgramChange, PROGRAM_CHANGE_QUEUE_SIZE> programChanges;
+    uint8_t programChangeHead{0};
+    uint8_t programChangeCount{0};
+
+    // pending NRPNs in the order they were queued, numbered like the control changes
+    std::array<Nrpn, NRPN_QUEUE_SIZE> nrpns;
+    uint32_t nrpnsQueued{0};
+    uint32_t nrpnsSent{0};
+    // NRPNs numbered below this were queued before the last program change and are not replaced anymore
+    uint32_t nrpnsFrozen{0};
+
+    // status of the last message sent, used to count the bytes saved by running status
+    uint8_t lastStatus{0};
+    // pacing: transmit time available for sending, in microseconds, negative while a SysEx message is transmitted
+    int32_t creditMicros{0};
+    uint32_t lastMicros{0};
+
+    // statistics
+    uint32_t sent{0};
+    uint32_t coalesced{0};
+    uint32_t dropped{0};
+    uint32_t bytes{0};
+
+    /**
+     * Try to use the transmit time of a message.
+     *
+     * @param status status byte of the message
+     * @param dataBytes number of data bytes
+     * @param messages number of messages with the same status sent together
+     * @return bool true if the message can be sent now
+     */
+    bool takeCredit(uint8_t status, uint8_t dataBytes, uint8_t messages = 1)
+    {
+        uint8_t messageBytes = dataBytes * messages + (status != lastStatus ? 1 : 0);
+        int32_t cost = messageBytes * microsPerByte;
+        if (cost > creditMicros)
+        {
+            return false;
+        }
+
+        creditMicros -= cost;
+        lastStatus = status;
+        bytes += messageBytes;
+        sent += messages;
+        return true;
+    }
+
+public:
+    /**
+     * Create an output queue.
+     *
+     * @param channel MIDI channel of the messages
+     * @param microsPerByte transmit time of a byte, 0 to send without pacing
+     */
+    MidiOutputQueue(uint8_t channel, uint16_t microsPerByte) : channel(channel), microsPerByte(microsPerByte)
+    {
+    }
+
+    /**
+     * Check if messages are queued.
+     *
+     * @return bool true if messages are queued
+     */
+    bool isPending() const
+    {
+        return getPendingCount() > 0;
+    }
+
+    /**
+     * Get the number of queued messages.
+     *
+     * @return uint32_t number of queued messages
+     */
+    uint32_t getPendingCount() const
+    {
+        return controlChangesQueued - controlChangesSent + programChangeCount + nrpnsQueued - nrpnsSent;
+    }
+
+    /**
+     * Take the transmit time of a SysEx message, sent directly instead of queued.
+     * A SysEx message can be larger than the burst allowance, it is only sent when no messages are queued and the output
+     * is idle, the messages queued after it wait until it has been transmitted.
+     *
+     * @param size message size in bytes
+     * @return bool true if the message can be sent now
+     */
+    bool takeSysExCredit(uint16_t size)
+    {
+        if (isPending() || creditMicros < (int32_t)(BURST_BYTES * microsPerByte))
+        {
+            return false;
+        }
+
+        creditMicros -= size * microsPerByte;
+        // SysEx cancels running status
+        lastStatus = 0;
+        bytes += size;
+        sent++;
+        return true;
+    }
+
+    /**
+     * Queue a control change, replacing a pending value of the same control queued after the last program change.
+     *
+     * @param control control
+     * @param value value
+     */
+    void controlChange(uint8_t control, uint8_t value)
+    {
+        control &= 0x7F;
+        uint32_t number = controlChangeNumbers[control];
+        if (number >= controlChangesFrozen && number >= controlChangesSent && number < controlChangesQueued && controlChanges[number % CONTROL_CHANGE_QUEUE_SIZE].control == control)
+        {
+            controlChanges[number % CONTROL_CHANGE_QUEUE_SIZE].value = value & 0x7F;
+            coalesced++;
+            return;
+        }
+
+        if (controlChangesQueued - controlChangesSent == CONTROL_CHANGE_QUEUE_SIZE)
+        {
+            dropped++;
+            return;
+        }
+
+        controlChanges[controlChangesQueued % CONTROL_CHANGE_QUEUE_SIZE] = ControlChange{control, (uint8_t)(value & 0x7F)};
+        controlChangeNumbers[control] = controlChangesQueued;
+        controlChangesQueued++;
+    }
+
+    /**
+     * Queue a program change, sent after the control changes and NRPNs queued before it.
+     *
+     * @param program program
+     */
+    void programChange(uint8_t program)
+    {
+        if (programChangeCount == programChanges.size())
+        {
+            dropped++;
+            return;
+        }
+
+        programChanges[(programChangeHead + programChangeCount) % programChanges.size()] = ProgramChange{(uint8_t)(program & 0x7F), controlChangesQueued, nrpnsQueued};
+        programChangeCount++;
+        controlChangesFrozen = controlChangesQueued;
+        nrpnsFrozen = nrpnsQueued;
+    }
+
+    /**
+     * Queue an NRPN, replacing a pending value of the same number queued after the last program change.
+     *
+     * @param number NRPN number (0 - 16383)
+     * @param value 14-bit value
+     */
+    void nrpn(uint16_t number, uint16_t value)
+    {
+        number &= 0x3FFF;
+        for (uint32_t i = std::max(nrpnsFrozen, nrpnsSent); i < nrpnsQueued; i++)
+        {
+            Nrpn &pending = nrpns[i % NRPN_QUEUE_SIZE];
+            if (pending.number == number)
+            {
+                pending.value = value & 0x3FFF;
+                coalesced++;
+                return;
+            }
+        }
+
+        if (nrpnsQueued - nrpnsSent == NRPN_QUEUE_SIZE)
+        {
+            dropped++;
+            return;
+        }
+
+        nrpns[nrpnsQueued % NRPN_QUEUE_SIZE] = Nrpn{number, (uint16_t)(value & 0x3FFF)};
+        nrpnsQueued++;
+    }
+
+    /**
+     * Send the queued messages, as far as the pacing allows.
+     *
+     * @param send function called with the message type (MidiEventType), channel, data 1 and data 2
+     */
+    template <typename Send>
+    void task(Send &&send)
+    {
+        uint32_t now = micros();
+        creditMicros = std::min(creditMicros + (int32_t)(now - lastMicros), (int32_t)(BURST_BYTES * microsPerByte));
+        lastMicros = now;
+
+        // control changes, NRPNs and program changes in the order they were queued: the control changes and NRPNs
+        // queued before the next program change, then the program change
+        while (true)
+        {
+            const ProgramChange *programChange = programChangeCount > 0 ? &programChanges[programChangeHead] : nullptr;
+            if (controlChangesSent != (programChange ? programChange->controlChangesBefore : controlChangesQueued))
+            {
+                if (!takeCredit(STATUS_CONTROL_CHANGE, 2))
+                {
+                    return;
+                }
+                const ControlChange &controlChange = controlChanges[controlChangesSent % CONTROL_CHANGE_QUEUE_SIZE];
+                send(MidiEventType::controlChange, channel, controlChange.control, controlChange.value);
+                controlChangesSent++;
+            }
+            else if (nrpnsSent != (programChange ? programChange->nrpnsBefore : nrpnsQueued))
+            {
+                // the 4 control changes of an NRPN are sent together, so they are not interleaved with other messages
+                if (!takeCredit(STATUS_CONTROL_CHANGE, 2, 4))
+                {
+                    return;
+                }
+                const Nrpn &pending = nrpns[nrpnsSent % NRPN_QUEUE_SIZE];
+                send(MidiEventType::controlChange, channel, CC_NRPN_MSB, pending.number >> 7);
+                send(MidiEventType::controlChange, channel, CC_NRPN_LSB, pending.number & 0x7F);
+                send(MidiEventType::controlChange, channel, CC_DATA_ENTRY_MSB, pending.value >> 7);
+                send(MidiEventType::controlChange, channel, CC_DATA_ENTRY_LSB, pending.value & 0x7F);
+                nrpnsSent++;
+            }
+            else if (programChange)
+            {
+                if (!takeCredit(STATUS_PROGRAM_CHANGE, 1))
+                {
+                    return;
+                }
+                send(MidiEventType::programChange, channel, programChange->program, 0);
+                programChangeHead = (programChangeHead + 1) % programChanges.size();
+                programChangeCount--;
+            }
+            else
+            {
+                break;
+            }
+        }
+    }
+
+    /**
+     * Log the statistics since the last call and reset them.
+     *
+     * @param name output name
+     */
+    void logStats(const char *name)
+    {
+        Serial.printf("MIDI output %s: %d sent (%d bytes), %d coalesced, %d dropped, %d pending\n", name, sent, bytes, coalesced, dropped, getPendingCount());
+        sent = 0;
+        bytes = 0;
+        coalesced = 0;
+        dropped = 0;
+    }
+};
+
+#endif
@@ -0,0 +1,153 @@
+#ifndef MidiReplay_h
+#define MidiReplay_h
+
+#include <Arduino.h>
+#include <stdint.h>
+#include <array>
+#include <vector>
+
+#include "MidiIngest.h"
+#include "MidiCapture.h"
+#include "PatchService.h"
+
+/**
+ * Replays a MIDI capture file (see MidiCaptureFile) with the timing of the capture, to reproduce CPU spikes, stuck
+ * notes, etc. in the same way every time.
+ *
+ * The capture file is loaded into RAM by the storage worker thread (at most FILE_SIZE_MAX bytes), after which task()
+ * passes each message on when its time since the start of the replay equals its time since the start of the capture.
+ * The messages are passed on with their captured source, so they go through the same ingest stage as live MIDI, at most
+ * MidiIngest::SOURCE_BUDGET messages per source per task() and only while the ingest queues have room, like the drained
+ * sources. The messages are passed on in the captured order: a source that used its budget holds back the messages after
+ * it until the next task().
+ */
+class MidiReplay
+{
+public:
+    static const uint32_t FILE_SIZE_MAX{256 * 1024};
+    // messages passed on later than this are counted as late
+    static const uint32_t LATE_MICROS{1000};
+
+private:
+    enum class State : uint8_t { idle, loading, replaying };
+    State state{State::idle};
+
+    std::vector<uint8_t> data;
+    uint32_t position{0};
+    uint32_t startMicros{0};
+
+    // statistics
+    uint32_t replayed{0};
+    uint32_t lateMaxMicros{0};
+    uint32_t lateCount{0};
+
+    /**
+     * Start replaying the loaded capture.
+     *
+     * @param success true if the capture file was read
+     */
+    void start(bool success)
+    {
+        uint16_t headerSize = success ? MidiCaptureFile::readHeader(data.data(), data.size()) : 0;
+        if (headerSize == 0)
+        {
+            Serial.printf("Error loading MIDI capture %s\n", MidiCaptureFile::FILE_NAME);
+            stop();
+            return;
+        }
+
+        Serial.printf("MIDI replay started, %d messages\n", (data.size() - headerSize) / MidiCaptureFile::RECORD_SIZE);
+        position = headerSize;
+        startMicros = micros();
+        replayed = 0;
+        lateMaxMicros = 0;
+        lateCount = 0;
+        state = State::replaying;
+    }
+
+    /**
+     * Stop replaying and release the capture.
+     */
+    void stop()
+    {
+        state = State::idle;
+        data.clear();
+        data.shrink_to_fit();
+    }
+
+public:
+    /**
+     * Load the capture file and start replaying it when loaded.
+     *
+     * @param patchService patch service, used to read the capture file
+     */
+    void load(PatchService &patchService)
+    {
+        state = State::loading;
+        bool queued = patchService.loadFile(MidiCaptureFile::FILE_NAME, data, FILE_SIZE_MAX, [this]([[maybe_unused]] uint8_t patchNumber, [[maybe_unused]] const Patch &patch, bool success)
+        {
+            start(success);
+        });
+        if (!queued)
+        {
+            start(false);
+        }
+    }
+
+    /**
+     * Check if a capture is being loaded or replayed.
+     *
+     * @return bool true if loading or replaying
+     */
+    bool isActive() const
+    {
+        return state != State::idle;
+    }
+
+    /**
+     * Pass on the messages that are due, at most MidiIngest::SOURCE_BUDGET per source, while the ingest queues have room.
+     *
+     * @param ingest MIDI ingest the messages are pushed to, see MidiIngest::hasRoom()
+     * @param push function called with each message (const MidiEvent &), the timestamp is set to the current time
+     */
+    template <typename Push>
+    void task(const MidiIngest &ingest, Push &&push)
+    {
+        if (state != State::replaying)
+        {
+            return;
+        }
+
+        uint32_t now = micros();
+        // messages passed on per captured source
+        std::array<uint8_t, MidiIngest::SOURCE_COUNT_MAX> batches{};
+        while (position + MidiCaptureFile::RECORD_SIZE <= data.size())
+        {
+            if (!ingest.hasRoom())
+            {
+                return;
+            }
+
+            MidiEvent event = MidiCaptureFile::readRecord(data.data() + position);
+            int32_t late = (int32_t)(now - (startMicros + event.timestamp));
+            uint8_t &batch = batches[std::min(event.source, (uint8_t)(MidiIngest::SOURCE_COUNT_MAX - 1))];
+            if (late < 0 || batch == MidiIngest::SOURCE_BUDGET)
+            {
+                return;
+            }
+
+            lateMaxMicros = std::max(lateMaxMicros, (uint32_t)late);
+            lateCount += (uint32_t)late > LATE_MICROS ? 1 : 0;
+            event.timestamp = now;
+            push(event);
+            batch++;
+            replayed++;
+            position += MidiCaptureFile::RECORD_SIZE;
+        }
+
+        Serial.printf("MIDI replay finished, %d messages in %lums, at most %dus late, %d more than %dus late\n", replayed, (now - startMicros) / 1000, lateMaxMicros, lateCount, LATE_MICROS);
+        stop();
+    }
+};
+
+#endif
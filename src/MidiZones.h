@@ -0,0 +1,99 @@
+#ifndef MidiZones_h
+#define MidiZones_h
+
+#include <Arduino.h>
+#include <stdint.h>
+#include <array>
+
+/**
+ * A keyboard zone: the notes of a channel within a note range, transposed.
+ */
+struct MidiZone
+{
+    // channel, 0 = all channels
+    uint8_t channel;
+    uint8_t lowNote;
+    uint8_t highNote;
+    // semitones added to the notes of the zone
+    int8_t transpose;
+};
+
+/**
+ * Keyboard split and layer zones of the external MIDI notes, applied when the notes are ingested, see
+ * SynthController::ingestMidi().
+ *
+ * Without zones all notes are played as they are. With zones a note is played once for every zone containing it
+ * (zones with overlapping note ranges layer, adjacent ranges split the keyboard), notes outside all zones are dropped
+ * before they are queued. Note offs are mapped by the same zones, so the zones shouldn't change while notes are held.
+ */
+class MidiZones
+{
+public:
+    static const uint8_t ZONE_COUNT_MAX{4};
+
+private:
+    std::array<MidiZone, ZONE_COUNT_MAX> zones;
+    uint8_t zoneCount{0};
+
+public:
+    /**
+     * Add a zone.
+     *
+     * @param zone zone
+     * @return bool true if the zone was added, false if ZONE_COUNT_MAX zones were added already
+     */
+    bool add(const MidiZone &zone)
+    {
+        if (zoneCount == ZONE_COUNT_MAX)
+        {
+            Serial.println("Error adding MIDI zone, too many zones");
+            return false;
+        }
+
+        zones[zoneCount++] = zone;
+        Serial.printf("MIDI zone channel %d, notes %d - %d, transpose %d\n", zone.channel, zone.lowNote, zone.highNote, zone.transpose);
+        return true;
+    }
+
+    /**
+     * Remove all zones, all notes are played as they are.
+     */
+    void clear()
+    {
+        zoneCount = 0;
+    }
+
+    /**
+     * Map a note to the zones containing it.
+     *
+     * @param channel channel
+     * @param note note
+     * @param play function called with the (transposed) note (uint8_t) for every zone containing the note, or once with
+     * the note itself when there are no zones
+     * @return uint8_t number of notes played, 0 if the note is dropped
+     */
+    template <typename Play>
+    uint8_t map(uint8_t channel, uint8_t note, Play &&play) const
+    {
+        if (zoneCount == 0)
+        {
+            play(note);
+            return 1;
+        }
+
+        uint8_t played{0};
+        for (uint8_t i = 0; i < zoneCount; i++)
+        {
+            const MidiZone &zone = zones[i];
+            int16_t zoneNote = note + zone.transpose;
+            if ((zone.channel == 0 || zone.channel == channel) && note >= zone.lowNote && note <= zone.highNote && zoneNote >= 0 && zoneNote <= 127)
+            {
+                play((uint8_t)zoneNote);
+                played++;
+            }
+        }
+        return played;
+    }
+};
+
+#endif
@@ -84,6 +84,17 @@ uint8_t convertPatchNumberToDigits(const uint8_t patchNumber)
     return octal + 11;
 }
 
+/**
+ * Convert a morph target param value (0-127) to a patch number (0-63).
+ * 
+ * @param value morph target param value (0-127)
+ * @return uint8_t patch number (0-63)
+ */
+constexpr uint8_t getMorphTargetPatchNumber(const uint8_t value)
+{
+    return value / 2;
+}
+
 /**
  * Check if the USB host MIDI device specified is an Akai MIDImix (idVendor 0x09e8, idProduct 0x0031),
  * 
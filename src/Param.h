@@ -5,14 +5,67 @@
 #include <stdint.h>
 #include <array>
 #include <string>
-#include <functional>
 
 #include "MiscUtil.h"
 #include "Constants.h"
 #include "Synth.h"
 
+class Param;
+
+/**
+ * Param value passed to the synthesizer: the value (0 - max value) and a 7-bit fine part, set using 14-bit control
+ * changes or NRPNs, for a 14-bit resolution of continuous params.
+ */
+struct ParamValue
+{
+    uint8_t coarse;
+    uint8_t fine;
+
+    /**
+     * Create a param value from a 14-bit value (value << 7 | fine).
+     * 
+     * @param value14 14-bit value
+     * @return constexpr ParamValue param value
+     */
+    static constexpr ParamValue fromValue14(uint16_t value14)
+    {
+        return ParamValue{(uint8_t)(value14 >> 7), (uint8_t)(value14 & 0x7F)};
+    }
+
+    /**
+     * Look up the value in a PARAM_SCALE_* table, interpolating between the table entries using the fine part.
+     * 
+     * @param table scale table
+     * @return float scaled value
+     */
+    float scale(const std::array<const float, 128> &table) const
+    {
+        if (fine == 0 || coarse >= table.size() - 1)
+        {
+            return table[coarse];
+        }
+        return table[coarse] + (table[coarse + 1] - table[coarse]) * fine * (1.0f / 128.0f);
+    }
+};
+
+/**
+ * Function called to update the synthesizer whenever the parameter value changes.
+ */
+using ParamUpdateSynthFunc = void (*)(const Param *, Synth &, const ParamValue);
+
+/**
+ * Function converting a parameter value to a text to be displayed on the display.
+ */
+using ParamStringValueFunc = std::string (*)(const Param *, const uint8_t);
+
+/**
+ * Dispatch table indexed by a MIDI control change, note or menu param ID (0-127), nullptr if no param is mapped.
+ */
+using ParamDispatchTable = std::array<const Param *, 128>;
+
 /**
  * A Param represents a parameter of the synthesizer affecting either the sound or the behaviour.
+ * Params are constexpr, the parameter list (PARAMS) is generated at compile time and stays in flash.
  */
 class Param
 {
@@ -38,13 +91,13 @@ private:
      */
     uint8_t menuId{255};
     /**
-     * Name of the parameter group.
+     * Parameter group, the name is stored in PARAM_GROUP_NAMES.
      */
-    std::string groupName;
+    ParamGroup group;
     /**
      * Name of the parameter.
      */
-    std::string name;
+    const char *name;
     /**
      * Control change used for sending and receiving parameter changes from the external MIDI.
      * A value of 255 means "disabled".
@@ -74,97 +127,117 @@ private:
      */
     uint8_t maxValue;
     /**
-     * Function reference to a (lambda) function to be called to update the synthesizer (whenever the parameter value changes).
+     * Discrete params (such as waveforms and modes) switch between values instead of being interpolated when morphing.
+     * Params with a max value below 127 are discrete by default.
      */
-    std::function<void(const Param *, Synth &, const uint8_t)> updateSynthFunc;
+    bool discrete{maxValue < 127};
     /**
-     * Function reference to a (lambda) function to convert a parameter value to a text to be displayed on the display.
+     * Function pointer to a (capture-less lambda) function to be called to update the synthesizer (whenever the parameter value changes).
      */
-    std::function<std::string(const Param *, const uint8_t)> stringValueFunc = &defaultStringValueFunc;
+    ParamUpdateSynthFunc updateSynthFunc;
+    /**
+     * Function pointer to a (capture-less lambda) function to convert a parameter value to a text to be displayed on the display.
+     */
+    ParamStringValueFunc stringValueFunc = &defaultStringValueFunc;
 
 public:
     /**
      * Constructor for menu params.
      */
-    Param(
+    constexpr Param(
         const uint16_t paramId,
         const uint8_t menuId,
-        const std::string &groupName,
-        const std::string &name,
+        const ParamGroup group,
+        const char *name,
         const uint8_t midiCc,
         const uint8_t initialValue,
         const uint8_t maxValue,
-        std::function<void(const Param *, Synth &, const uint8_t)> const &updateSynthFunc) : paramId(paramId), menuId(menuId), groupName(groupName), name(name), midiCc(midiCc), initialValue(initialValue), maxValue(maxValue), updateSynthFunc(updateSynthFunc){};
+        const ParamUpdateSynthFunc updateSynthFunc) : paramId(paramId), menuId(menuId), group(group), name(name), midiCc(midiCc), initialValue(initialValue), maxValue(maxValue), updateSynthFunc(updateSynthFunc){};
 
     /**
      * Constructor for menu params.
      */
-    Param(
+    constexpr Param(
         const uint16_t paramId,
         const uint8_t menuId,
-        const std::string &groupName,
-        const std::string &name,
+        const ParamGroup group,
+        const char *name,
         const uint8_t midiCc,
         const uint8_t initialValue,
         const uint8_t maxValue,
-        std::function<void(const Param *, Synth &, const uint8_t)> const &updateSynthFunc,
-        std::function<std::string(const Param *, const uint8_t)> const &stringValueFunc) : paramId(paramId), menuId(menuId), groupName(groupName), name(name), midiCc(midiCc), initialValue(initialValue), maxValue(maxValue), updateSynthFunc(updateSynthFunc){};
+        const ParamUpdateSynthFunc updateSynthFunc,
+        const ParamStringValueFunc stringValueFunc) : paramId(paramId), menuId(menuId), group(group), name(name), midiCc(midiCc), initialValue(initialValue), maxValue(maxValue), updateSynthFunc(updateSynthFunc), stringValueFunc(stringValueFunc){};
+
+    /**
+     * Constructor for menu params, specifying if the param is discrete.
+     */
+    constexpr Param(
+        const uint16_t paramId,
+        const uint8_t menuId,
+        const ParamGroup group,
+        const char *name,
+        const uint8_t midiCc,
+        const uint8_t initialValue,
+        const uint8_t maxValue,
+        const ParamUpdateSynthFunc updateSynthFunc,
+        const ParamStringValueFunc stringValueFunc,
+        const bool discrete) : paramId(paramId), menuId(menuId), group(group), name(name), midiCc(midiCc), initialValue(initialValue), maxValue(maxValue), discrete(discrete), updateSynthFunc(updateSynthFunc), stringValueFunc(stringValueFunc){};
 
     /**
      * Constructor for control params.
      */
-    Param(
+    constexpr Param(
         const uint16_t paramId,
-        const std::string &groupName,
-        const std::string &name,
+        const ParamGroup group,
+        const char *name,
         const uint8_t midiCc,
         const uint8_t controllerCc,
         const uint8_t initialValue,
         const uint8_t maxValue,
-        std::function<void(const Param *, Synth &, const uint8_t)> const &updateSynthFunc) : paramId(paramId), groupName(groupName), name(name), midiCc(midiCc), controllerCc(controllerCc), initialValue(initialValue), maxValue(maxValue), updateSynthFunc(updateSynthFunc){};
+        const ParamUpdateSynthFunc updateSynthFunc) : paramId(paramId), group(group), name(name), midiCc(midiCc), controllerCc(controllerCc), initialValue(initialValue), maxValue(maxValue), updateSynthFunc(updateSynthFunc){};
 
     /**
      * Constructor for control params.
      */
-    Param(
+    constexpr Param(
         const uint16_t paramId,
-        const std::string &groupName,
-        const std::string &name,
+        const ParamGroup group,
+        const char *name,
         const uint8_t midiCc,
         const uint8_t controllerCc,
         const uint8_t initialValue,
         const uint8_t maxValue,
-        std::function<void(const Param *, Synth &, const uint8_t)> const &updateSynthFunc,
-        std::function<std::string(const Param *, const uint8_t)> const &stringValueFunc) : paramId(paramId), groupName(groupName), name(name), midiCc(midiCc), controllerCc(controllerCc), initialValue(initialValue), maxValue(maxValue), updateSynthFunc(updateSynthFunc), stringValueFunc(stringValueFunc){};
+        const ParamUpdateSynthFunc updateSynthFunc,
+        const ParamStringValueFunc stringValueFunc) : paramId(paramId), group(group), name(name), midiCc(midiCc), controllerCc(controllerCc), initialValue(initialValue), maxValue(maxValue), updateSynthFunc(updateSynthFunc), stringValueFunc(stringValueFunc){};
 
     /**
      * Constructor for control params.
      */
-    Param(
+    constexpr Param(
         const uint16_t paramId,
-        const std::string &groupName,
-        const std::string &name,
+        const ParamGroup group,
+        const char *name,
         const uint8_t midiCc,
         const uint8_t controllerNi,
         const uint8_t controllerNd,
         const uint8_t initialValue,
         const uint8_t maxValue,
-        std::function<void(const Param *, Synth &, const uint8_t)> const &updateSynthFunc) : paramId(paramId), groupName(groupName), name(name), midiCc(midiCc), controllerNi(controllerNi), controllerNd(controllerNd), initialValue(initialValue), maxValue(maxValue), updateSynthFunc(updateSynthFunc){};
+        const ParamUpdateSynthFunc updateSynthFunc) : paramId(paramId), group(group), name(name), midiCc(midiCc), controllerNi(controllerNi), controllerNd(controllerNd), initialValue(initialValue), maxValue(maxValue), updateSynthFunc(updateSynthFunc){};
 
     /**
      * Constructor for control params.
      */
-    Param(
+    constexpr Param(
         const uint16_t paramId,
-        const std::string &groupName,
-        const std::string &name,
+        const ParamGroup group,
+        const char *name,
         const uint8_t midiCc,
         const uint8_t controllerNi,
         const uint8_t controllerNd,
         const uint8_t initialValue,
         const uint8_t maxValue,
-        std::function<void(const Param *, Synth &, const uint8_t)> const &updateSynthFunc,
-        std::function<std::string(const Param *, const uint8_t)> const &stringValueFunc) : paramId(paramId), groupName(groupName), name(name), midiCc(midiCc), controllerNi(controllerNi), controllerNd(controllerNd), initialValue(initialValue), maxValue(maxValue), updateSynthFunc(updateSynthFunc), stringValueFunc(stringValueFunc){};
+        const ParamUpdateSynthFunc updateSynthFunc,
+        const ParamStringValueFunc stringValueFunc) : paramId(paramId), group(group), name(name), midiCc(midiCc), controllerNi(controllerNi), controllerNd(controllerNd), initialValue(initialValue), maxValue(maxValue), updateSynthFunc(updateSynthFunc), stringValueFunc(stringValueFunc){};
 
 
     /**
@@ -173,7 +246,7 @@ public:
      * @param synth synth
      * @param value value
      */
-    void updateSynth(Synth &synth, uint8_t value) const
+    void updateSynth(Synth &synth, ParamValue value) const
     {
         this->updateSynthFunc(this, synth, value);
     }
@@ -194,7 +267,7 @@ public:
      * 
      * @return uint16_t parameter ID
      */
-    uint16_t getParamId() const
+    constexpr uint16_t getParamId() const
     {
         return paramId;
     }
@@ -202,19 +275,19 @@ public:
     /**
      * Get the parameter group name.
      * 
-     * @return std::string parameter group name
+     * @return const char* parameter group name
      */
-    std::string getGroupName() const
+    const char *getGroupName() const
     {
-        return groupName;
+        return PARAM_GROUP_NAMES[static_cast<uint8_t>(group)];
     }
 
     /**
      * Get the parameter name.
      * 
-     * @return std::string parameter name
+     * @return const char* parameter name
      */
-    std::string getName() const
+    const char *getName() const
     {
         return name;
     }
@@ -224,7 +297,7 @@ public:
      * 
      * @return uint8_t control change
      */
-    uint8_t getMidiCc() const
+    constexpr uint8_t getMidiCc() const
     {
         return midiCc;
     }
@@ -234,7 +307,7 @@ public:
      * 
      * @return uint8_t control change
      */
-    uint8_t getControllerCc() const
+    constexpr uint8_t getControllerCc() const
     {
         return controllerCc;
     }
@@ -244,7 +317,7 @@ public:
      * 
      * @return uint8_t note
      */
-    uint8_t getControllerNi() const
+    constexpr uint8_t getControllerNi() const
     {
         return controllerNi;
     }
@@ -254,7 +327,7 @@ public:
      * 
      * @return uint8_t note
      */
-    uint8_t getControllerNd() const
+    constexpr uint8_t getControllerNd() const
     {
         return controllerNd;
     }
@@ -264,7 +337,7 @@ public:
      * 
      * @return uint8_t initial value
      */
-    uint8_t getInitialValue() const
+    constexpr uint8_t getInitialValue() const
     {
         return initialValue;
     }
@@ -274,17 +347,27 @@ public:
      * 
      * @return uint8_t max value
      */
-    uint8_t getMaxValue() const
+    constexpr uint8_t getMaxValue() const
     {
         return maxValue;
     }
 
+    /**
+     * Check if the param is discrete, see discrete.
+     * 
+     * @return bool true if the param is discrete
+     */
+    constexpr bool isDiscrete() const
+    {
+        return discrete;
+    }
+
     /**
      * Get the menu ID.
      * 
      * @return uint8_t menu ID
      */
-    uint8_t getMenuId() const
+    constexpr uint8_t getMenuId() const
     {
         return menuId;
     }
@@ -3,23 +3,36 @@
 
 #include <stdint.h>
 #include <string>
-#include <map>
+#include <array>
 
 #include "Param.h"
 
 /**
- * A Patch consists of a name and a map of parameter ID / parameters value pairs.
+ * A Patch consists of a name and the values of all parameters.
+ * Values are stored in a fixed size array indexed by the param index (see getParamIndex() in ConstantParams.h),
+ * so patches don't use the heap and can be copied cheaply.
  */
 class Patch
 {
 private:
-    std::string DEFAULT_NAME{"Init"};
+    static constexpr const char *DEFAULT_NAME{"Init"};
 
     /**
      * Patch name, fixed length padded with spaces.
      */
     std::string name;
 
+    /**
+     * Parameter values, indexed by param index.
+     */
+    std::array<uint8_t, PARAM_COUNT> paramValues{PARAM_INITIAL_VALUES};
+
+    /**
+     * Fine parameter values (7 bits below the value, see ParamValue), indexed by param index.
+     * Always 0 for discrete params.
+     */
+    std::array<uint8_t, PARAM_COUNT> paramFineValues{};
+
 public:
     /**
      * Patch name length, equal to the number of increment / decrement buttons (MIDImix channels).
@@ -27,7 +40,7 @@ public:
     const static uint8_t NAME_LENGTH{8};
 
     /**
-     * Constructor with name.
+     * Constructor with name, all parameters are set to their initial value.
      * 
      * @param name name
      */
@@ -36,81 +49,129 @@ public:
     }
 
     /**
-     * Constructor with default name.
+     * Constructor with default name, all parameters are set to their initial value.
      */
     explicit Patch() : Patch(DEFAULT_NAME) {}
 
     /**
-     * Map of parameter ID / parameters value pairs.
+     * Get a parameter value.
+     * 
+     * @param param param
+     * @return uint8_t value
      */
-    std::map<uint16_t, uint8_t> paramValueMap;
+    uint8_t getParamValue(const Param &param) const
+    {
+        return paramValues[getParamIndex(param)];
+    }
 
     /**
-     * Delete a parameter value.
+     * Get a parameter value by param index.
      * 
-     * @param paramId parameter ID
+     * @param index param index
+     * @return uint8_t value
      */
-    void deleteParamValue(uint16_t paramId)
+    uint8_t getParamValueByIndex(uint8_t index) const
     {
-        if (!paramValueMap.count(paramId))
-        {
-            return;
-        }
-        paramValueMap.erase(paramId);
+        return paramValues[index];
     }
-    
+
     /**
-     * Get a parameter value.
+     * Get a fine parameter value by param index.
      * 
-     * @param paramId parameter ID
-     * @return uint8_t value
+     * @param index param index
+     * @return uint8_t fine value (0 - 127)
      */
-    uint8_t getParamValue(uint16_t paramId)
+    uint8_t getParamFineValueByIndex(uint8_t index) const
     {
-        if (!paramValueMap.count(paramId))
-        {
-            return 0;
-        }
-        return paramValueMap.at(paramId);
+        return paramFineValues[index];
     }
-    
+
     /**
-     * Set a parameter value.
+     * Get a 14-bit parameter value (value << 7 | fine value) by param index.
      * 
-     * @param paramId parameter ID
-     * @param value value
-     * @param maxValue max value
+     * @param index param index
+     * @return uint16_t 14-bit value
+     */
+    uint16_t getParamValue14ByIndex(uint8_t index) const
+    {
+        return (paramValues[index] << 7) | paramFineValues[index];
+    }
+
+    /**
+     * Set a parameter value, the fine value is reset to 0.
+     * 
+     * @param param param
+     * @param value value, limited to the max value of the param
      * @return uint8_t stored value
      */
-    uint8_t setParamValue(uint16_t paramId, uint8_t value, uint8_t maxValue)
+    uint8_t setParamValue(const Param &param, uint8_t value)
     {
-        auto paramValue = value <= maxValue ? value : maxValue;
-        paramValueMap[paramId] = paramValue;
+        auto paramValue = value <= param.getMaxValue() ? value : param.getMaxValue();
+        paramValues[getParamIndex(param)] = paramValue;
+        paramFineValues[getParamIndex(param)] = 0;
         return paramValue;
     }
 
+    /**
+     * Set a fine parameter value, ignored for discrete params and for the max value.
+     * 
+     * @param param param
+     * @param fineValue fine value (0 - 127)
+     * @return uint8_t stored fine value
+     */
+    uint8_t setParamFineValue(const Param &param, uint8_t fineValue)
+    {
+        uint8_t index = getParamIndex(param);
+        paramFineValues[index] = param.isDiscrete() || paramValues[index] >= param.getMaxValue() ? 0 : fineValue & 0x7F;
+        return paramFineValues[index];
+    }
+
+    /**
+     * Set a parameter value by param index, used when loading patches.
+     * 
+     * @param index param index
+     * @param value value, limited to the max value of the param
+     */
+    void setParamValueByIndex(uint8_t index, uint8_t value)
+    {
+        setParamValue(PARAMS[index], value);
+    }
+
+    /**
+     * Set a 14-bit parameter value (value << 7 | fine value) by param index, used when loading patches.
+     * 
+     * @param index param index
+     * @param value14 14-bit value, the value is limited to the max value of the param
+     */
+    void setParamValue14ByIndex(uint8_t index, uint16_t value14)
+    {
+        setParamValue(PARAMS[index], value14 >> 7);
+        setParamFineValue(PARAMS[index], value14 & 0x7F);
+    }
+
     /**
      * Increment parameter value.
      * 
-     * @param paramId parameter ID
+     * @param param param
      * @param value increment value (use a negative number to decrement the value)
-     * @param maxValue max value
      * @return uint8_t stored value
      */
-    uint8_t incrementParamValue(uint16_t paramId, int8_t value, uint8_t maxValue)
+    uint8_t incrementParamValue(const Param &param, int8_t value)
     {
-        auto incrementedValue = paramValueMap[paramId] + value;
+        uint8_t &paramValue = paramValues[getParamIndex(param)];
+        auto incrementedValue = paramValue + value;
         if (incrementedValue < 0)
         {
             incrementedValue = 0;
         }
-        else if (incrementedValue > maxValue)
+        else if (incrementedValue > param.getMaxValue())
         {
-            incrementedValue = maxValue;
+            incrementedValue = param.getMaxValue();
         }
-        paramValueMap[paramId] = (uint8_t)incrementedValue;
+        paramValue = (uint8_t)incrementedValue;
+        paramFineValues[getParamIndex(param)] = 0;
 
-        return (uint8_t)incrementedValue;
+        return paramValue;
     }
 
     /**
@@ -171,11 +232,11 @@ public:
         Serial.print(name.c_str());
         Serial.println("'");
         
-        for (const auto [paramId, paramValue] : paramValueMap)
+        for (uint8_t index = 0; index < PARAM_COUNT; index++)
         {
-            Serial.print(paramId);
+            Serial.print(PARAMS[index].getParamId());
             Serial.print(" = ");
-            Serial.println(paramValue);
+            Serial.println(paramValues[index]);
         }
     }
 
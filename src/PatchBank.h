@@ -0,0 +1,322 @@
+#ifndef PatchBank_h
+#define PatchBank_h
+
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include <array>
+
+#include "Param.h"
+#include "Patch.h"
+#include "Crc32.h"
+
+/**
+ * Patch bank file format, all patches in a single file.
+ * See src/tmixbank.py for a host side converter and validator.
+ * 
+ * All numbers are little endian:
+ * - header (16 bytes): signature "TMBK", version (uint16), patch count (uint16), param count (uint16),
+ *   record size (uint16), CRC-32 of the header bytes 0-11, the param ID table and the index (uint32)
+ * - param ID table: param count param IDs (uint16), the order of the param values in the records
+ * - index: patch count record offsets (uint32), 0 for an empty patch slot
+ * - records: patch name (8 bytes), param count param values, CRC-32 of the name and values (uint32)
+ *   - version 1: param values (uint8, 255 if not set)
+ *   - version 2: 14-bit param values, value << 7 | fine value (uint16, 65535 if not set)
+ * 
+ * Param IDs are stored in the file, so banks written before params were added or removed can still be read.
+ * Files written by the synth always use the current version and params and contain all patches, with the records in
+ * patch number order. Version 1 files can still be read.
+ */
+class PatchBank
+{
+private:
+    static constexpr uint32_t indexOffset(uint16_t paramCount)
+    {
+        return HEADER_SIZE + paramCount * 2;
+    }
+
+    static constexpr uint32_t recordsOffset(uint16_t paramCount, uint16_t patchCount)
+    {
+        return indexOffset(paramCount) + patchCount * 4;
+    }
+
+    /**
+     * Calculate the header CRC-32: header bytes 0-11, param ID table and index.
+     * 
+     * @param data bank data
+     * @param recordsOffset records offset
+     * @return uint32_t CRC-32
+     */
+    static uint32_t headerCrc(const uint8_t *data, uint32_t recordsOffset)
+    {
+        return crc32(data + HEADER_SIZE, recordsOffset - HEADER_SIZE, crc32(data, HEADER_CRC_OFFSET));
+    }
+
+public:
+    // file param index to current param index, see readParamIds()
+    using ParamIndexTable = std::array<uint8_t, 256>;
+
+    static constexpr const char *SIGNATURE{"TMBK"};
+    static const uint8_t SIGNATURE_SIZE{4};
+    static const uint16_t VERSION{2};
+    static const uint16_t HEADER_SIZE{16};
+    static const uint16_t HEADER_CRC_OFFSET{12};
+    // param value of params not stored in a record, the initial value is used instead
+    static const uint8_t VALUE_NOT_SET_V1{255};
+    static const uint16_t VALUE_NOT_SET{65535};
+
+    // record size and file size using the current version and params
+    static const uint16_t RECORD_SIZE{Patch::NAME_LENGTH + PARAM_COUNT * 2 + 4};
+    static const uint32_t FILE_SIZE{HEADER_SIZE + PARAM_COUNT * 2 + PATCH_COUNT * 4 + PATCH_COUNT * RECORD_SIZE};
+
+    static uint16_t read16(const uint8_t *data)
+    {
+        return data[0] | (data[1] << 8);
+    }
+
+    static uint32_t read32(const uint8_t *data)
+    {
+        return data[0] | (data[1] << 8) | (data[2] << 16) | ((uint32_t)data[3] << 24);
+    }
+
+    static void write16(uint8_t *data, uint16_t value)
+    {
+        data[0] = value & 0xFF;
+        data[1] = value >> 8;
+    }
+
+    static void write32(uint8_t *data, uint32_t value)
+    {
+        data[0] = value & 0xFF;
+        data[1] = (value >> 8) & 0xFF;
+        data[2] = (value >> 16) & 0xFF;
+        data[3] = value >> 24;
+    }
+
+    /**
+     * Get the size of a patch record.
+     * 
+     * @param paramCount number of params in the record
+     * @param version file version
+     * @return constexpr uint16_t record size
+     */
+    static constexpr uint16_t recordSize(uint16_t paramCount, uint16_t version)
+    {
+        return Patch::NAME_LENGTH + paramCount * (version == 1 ? 1 : 2) + 4;
+    }
+
+    /**
+     * Write the param ID table using the current params.
+     * 
+     * @param data buffer of at least PARAM_COUNT * 2 bytes
+     */
+    static void writeParamIds(uint8_t *data)
+    {
+        for (uint8_t paramIndex = 0; paramIndex < PARAM_COUNT; paramIndex++)
+        {
+            write16(data + paramIndex * 2, PARAMS[paramIndex].getParamId());
+        }
+    }
+
+    /**
+     * Read a param ID table, mapping the params in a file to the current params.
+     * 
+     * @param data param ID table
+     * @param paramCount number of params in the table, at most 256
+     * @param paramIndexes set to the current param index of each param in the table, PARAM_INDEX_NONE for missing params
+     * @return bool true if the table is equal to the current params
+     */
+    static bool readParamIds(const uint8_t *data, uint16_t paramCount, ParamIndexTable &paramIndexes)
+    {
+        bool currentParams = paramCount == PARAM_COUNT;
+        for (uint16_t i = 0; i < paramCount; i++)
+        {
+            uint16_t paramId = read16(data + i * 2);
+            paramIndexes[i] = getParamIndexById(paramId);
+            if (paramIndexes[i] == PARAM_INDEX_NONE)
+            {
+                Serial.printf("Warning: patch bank contains missing param with paramId %d, ignoring param values\n", paramId);
+            }
+            currentParams = currentParams && paramIndexes[i] == i;
+        }
+        return currentParams;
+    }
+
+    /**
+     * Read a patch record.
+     * 
+     * @param record record
+     * @param paramCount number of params in the record
+     * @param version file version
+     * @param paramIndexes current param index of each param in the record, see readParamIds()
+     * @param patch patch, params not stored in the record are set to their initial value
+     * @return bool true if the record was read, false if the CRC is invalid (the patch is not changed)
+     */
+    static bool readRecord(const uint8_t *record, uint16_t paramCount, uint16_t version, const ParamIndexTable &paramIndexes, Patch &patch)
+    {
+        uint16_t size = recordSize(paramCount, version);
+        if (read32(record + size - 4) != crc32(record, size - 4))
+        {
+            return false;
+        }
+
+        patch = Patch(std::string(reinterpret_cast<const char *>(record), Patch::NAME_LENGTH));
+        for (uint16_t i = 0; i < paramCount; i++)
+        {
+            if (paramIndexes[i] == PARAM_INDEX_NONE)
+            {
+                continue;
+            }
+
+            if (version == 1)
+            {
+                uint8_t value = record[Patch::NAME_LENGTH + i];
+                if (value != VALUE_NOT_SET_V1)
+                {
+                    patch.setParamValueByIndex(paramIndexes[i], value);
+                }
+            }
+            else
+            {
+                uint16_t value = read16(record + Patch::NAME_LENGTH + i * 2);
+                if (value != VALUE_NOT_SET)
+                {
+                    patch.setParamValue14ByIndex(paramIndexes[i], value);
+                }
+            }
+        }
+        return true;
+    }
+
+    /**
+     * Check if a file version can be read.
+     * 
+     * @param version file version
+     * @return bool true if the version is supported
+     */
+    static constexpr bool isVersionSupported(uint16_t version)
+    {
+        return version == 1 || version == VERSION;
+    }
+
+    /**
+     * Get the file offset of a patch record in a file written by the synth.
+     * 
+     * @param patchNumber patch number
+     * @return uint32_t record offset
+     */
+    static constexpr uint32_t getRecordOffset(uint8_t patchNumber)
+    {
+        return recordsOffset(PARAM_COUNT, PATCH_COUNT) + patchNumber * RECORD_SIZE;
+    }
+
+    /**
+     * Write a patch record.
+     * 
+     * @param patch patch
+     * @param data buffer of at least RECORD_SIZE bytes
+     */
+    static void writeRecord(const Patch &patch, uint8_t *data)
+    {
+        memcpy(data, patch.getName().c_str(), Patch::NAME_LENGTH);
+        for (uint8_t paramIndex = 0; paramIndex < PARAM_COUNT; paramIndex++)
+        {
+            write16(data + Patch::NAME_LENGTH + paramIndex * 2, patch.getParamValue14ByIndex(paramIndex));
+        }
+        write32(data + RECORD_SIZE - 4, crc32(data, RECORD_SIZE - 4));
+    }
+
+    /**
+     * Write a bank containing all patches.
+     * 
+     * @param patches patches, indexed by patch number
+     * @param data buffer of at least FILE_SIZE bytes
+     */
+    static void writeBank(const std::array<Patch, PATCH_COUNT> &patches, uint8_t *data)
+    {
+        const uint32_t firstRecordOffset = recordsOffset(PARAM_COUNT, PATCH_COUNT);
+
+        memcpy(data, SIGNATURE, SIGNATURE_SIZE);
+        write16(data + 4, VERSION);
+        write16(data + 6, PATCH_COUNT);
+        write16(data + 8, PARAM_COUNT);
+        write16(data + 10, RECORD_SIZE);
+
+        writeParamIds(data + HEADER_SIZE);
+
+        for (uint8_t patchNumber = 0; patchNumber < PATCH_COUNT; patchNumber++)
+        {
+            write32(data + indexOffset(PARAM_COUNT) + patchNumber * 4, getRecordOffset(patchNumber));
+            writeRecord(patches[patchNumber], data + getRecordOffset(patchNumber));
+        }
+
+        write32(data + HEADER_CRC_OFFSET, headerCrc(data, firstRecordOffset));
+    }
+
+    /**
+     * Read a bank.
+     * Patches in empty slots or with an invalid CRC are set to the init patch.
+     * 
+     * @param data bank data
+     * @param size bank data size
+     * @param patches patches, indexed by patch number
+     * @param upToDate set to true if the bank contains all patches, written using the current version and params
+     * @return bool true if the bank was read, false if the header is invalid (the patches are not changed)
+     */
+    static bool readBank(const uint8_t *data, size_t size, std::array<Patch, PATCH_COUNT> &patches, bool &upToDate)
+    {
+        upToDate = false;
+
+        if (size < HEADER_SIZE || memcmp(data, SIGNATURE, SIGNATURE_SIZE))
+        {
+            Serial.println("Error loading patch bank, invalid signature");
+            return false;
+        }
+
+        uint16_t version = read16(data + 4);
+        uint16_t patchCount = read16(data + 6);
+        uint16_t paramCount = read16(data + 8);
+        uint16_t fileRecordSize = read16(data + 10);
+        if (!isVersionSupported(version) || fileRecordSize != recordSize(paramCount, version) || size < recordsOffset(paramCount, patchCount))
+        {
+            Serial.printf("Error loading patch bank, unsupported version %d or invalid header\n", version);
+            return false;
+        }
+
+        if (read32(data + HEADER_CRC_OFFSET) != headerCrc(data, recordsOffset(paramCount, patchCount)))
+        {
+            Serial.println("Error loading patch bank, invalid header CRC");
+            return false;
+        }
+
+        // map the params in the file to the current params
+        ParamIndexTable paramIndexes;
+        if (paramCount > paramIndexes.size())
+        {
+            Serial.println("Error loading patch bank, too many params");
+            return false;
+        }
+        upToDate = readParamIds(data + HEADER_SIZE, paramCount, paramIndexes) && patchCount == PATCH_COUNT && version == VERSION;
+        for (uint8_t patchNumber = 0; patchNumber < PATCH_COUNT; patchNumber++)
+        {
+            patches[patchNumber] = Patch();
+
+            uint32_t recordOffset = patchNumber < patchCount ? read32(data + indexOffset(paramCount) + patchNumber * 4) : 0;
+            upToDate = upToDate && recordOffset == getRecordOffset(patchNumber);
+            if (recordOffset == 0)
+            {
+                continue;
+            }
+
+            if (recordOffset + fileRecordSize > size || !readRecord(data + recordOffset, paramCount, version, paramIndexes, patches[patchNumber]))
+            {
+                Serial.printf("Error loading patch %d from patch bank, invalid record\n", patchNumber);
+                upToDate = false;
+            }
+        }
+
+        return true;
+    }
+};
+
+#endif
@@ -0,0 +1,121 @@
+#ifndef PatchJournal_h
+#define PatchJournal_h
+
+#include <stdint.h>
+#include <string.h>
+#include <array>
+
+#include "Patch.h"
+#include "PatchBank.h"
+#include "Crc32.h"
+
+/**
+ * Patch journal file format, saved patches are appended to the journal instead of rewriting the patch bank file.
+ * The patch bank file combined with the journal contains the current patches. When the journal grows too large, the
+ * journal is compacted: the patches are written to a new patch bank file and the journal is emptied.
+ * 
+ * All numbers are little endian:
+ * - header: signature "TMJL", version (uint16), param count (uint16), param ID table (param count param IDs, uint16),
+ *   CRC-32 of the preceding header bytes (uint32)
+ * - entries: patch number (uint8), patch record (see PatchBank.h, using the same version as the journal), commit
+ *   CRC-32 of the patch number and the record (uint32)
+ * 
+ * An entry is only valid when its commit CRC-32 is valid, an entry that was partially written when power was lost is
+ * ignored, as well as anything after it.
+ */
+class PatchJournal
+{
+private:
+    static const uint8_t PARAM_IDS_OFFSET{8};
+
+public:
+    static constexpr const char *SIGNATURE{"TMJL"};
+    static const uint8_t SIGNATURE_SIZE{4};
+    static const uint16_t VERSION{PatchBank::VERSION};
+
+    // header size and entry size using the current params
+    static const uint16_t HEADER_SIZE{PARAM_IDS_OFFSET + PARAM_COUNT * 2 + 4};
+    static const uint16_t ENTRY_SIZE{1 + PatchBank::RECORD_SIZE + 4};
+
+    /**
+     * Write a journal header using the current params.
+     * 
+     * @param data buffer of at least HEADER_SIZE bytes
+     */
+    static void writeHeader(uint8_t *data)
+    {
+        memcpy(data, SIGNATURE, SIGNATURE_SIZE);
+        PatchBank::write16(data + 4, VERSION);
+        PatchBank::write16(data + 6, PARAM_COUNT);
+        PatchBank::writeParamIds(data + PARAM_IDS_OFFSET);
+        PatchBank::write32(data + HEADER_SIZE - 4, crc32(data, HEADER_SIZE - 4));
+    }
+
+    /**
+     * Write a journal entry.
+     * 
+     * @param patchNumber patch number
+     * @param patch patch
+     * @param data buffer of at least ENTRY_SIZE bytes
+     */
+    static void writeEntry(uint8_t patchNumber, const Patch &patch, uint8_t *data)
+    {
+        data[0] = patchNumber;
+        PatchBank::writeRecord(patch, data + 1);
+        PatchBank::write32(data + ENTRY_SIZE - 4, crc32(data, ENTRY_SIZE - 4));
+    }
+
+    /**
+     * Replay a journal, applying the valid entries to the patches.
+     * 
+     * @param data journal data
+     * @param size journal data size
+     * @param patches patches, indexed by patch number
+     * @param entryCount set to the number of valid entries
+     * @param clean set to true if the journal only contains valid entries, written using the current version and params
+     * @return bool true if the journal header is valid
+     */
+    static bool replay(const uint8_t *data, size_t size, std::array<Patch, PATCH_COUNT> &patches, uint16_t &entryCount, bool &clean)
+    {
+        entryCount = 0;
+        clean = false;
+
+        uint16_t version = size < PARAM_IDS_OFFSET ? 0 : PatchBank::read16(data + 4);
+        if (size < PARAM_IDS_OFFSET || memcmp(data, SIGNATURE, SIGNATURE_SIZE) || !PatchBank::isVersionSupported(version))
+        {
+            Serial.println("Error loading patch journal, invalid signature or version");
+            return false;
+        }
+
+        uint16_t paramCount = PatchBank::read16(data + 6);
+        PatchBank::ParamIndexTable paramIndexes;
+        uint32_t headerSize = PARAM_IDS_OFFSET + paramCount * 2 + 4;
+        if (paramCount > paramIndexes.size() || size < headerSize || PatchBank::read32(data + headerSize - 4) != crc32(data, headerSize - 4))
+        {
+            Serial.println("Error loading patch journal, invalid header");
+            return false;
+        }
+
+        bool currentParams = PatchBank::readParamIds(data + PARAM_IDS_OFFSET, paramCount, paramIndexes);
+
+        uint32_t entrySize = 1 + PatchBank::recordSize(paramCount, version) + 4;
+        uint32_t position = headerSize;
+        for (; position + entrySize <= size; position += entrySize)
+        {
+            const uint8_t *entry = data + position;
+            if (PatchBank::read32(entry + entrySize - 4) != crc32(entry, entrySize - 4) || entry[0] >= PATCH_COUNT)
+            {
+                Serial.println("Warning: patch journal contains an incomplete entry, ignoring the remaining entries");
+                break;
+            }
+
+            PatchBank::readRecord(entry + 1, paramCount, version, paramIndexes, patches[entry[0]]);
+            entryCount++;
+        }
+
+        clean = currentParams && version == VERSION && position == size;
+        return true;
+    }
+};
+
+#endif
@@ -3,12 +3,19 @@
 
 #include <stdint.h>
 #include <string>
-#include <map>
+#include <array>
+#include <vector>
+#include <functional>
 
+#include "fnptr.h"
 #include "Param.h"
+#include "Benchmark.h"
+#include "PatchBank.h"
+#include "PatchJournal.h"
 
 #include <SD.h>
 #include <LittleFS.h>
+#include <TeensyThreads.h>
 
 static LittleFS_Program littleFS;
 
@@ -16,21 +23,82 @@ static LittleFS_Program littleFS;
 // This creates a LittleFS drive in Teensy PCB Flash. 
 static const uint32_t PROG_FLASH_SIZE{1024 * 1024 * 1};
 
+/**
+ * Storage request completion callback, called from PatchService::task() on the main thread.
+ * 
+ * @param patchNumber patch number
+ * @param patch patch read (read requests) or written (write requests)
+ * @param success true if the storage access succeeded
+ */
+using StorageCallback = std::function<void(uint8_t patchNumber, const Patch &patch, bool success)>;
+
 /**
  * The PatchService handles loading and saving patches to SD or [LittleFS](https://github.com/PaulStoffregen/LittleFS).
+ * All patches are loaded into a RAM bank at startup, loading a patch is a copy from the bank. Saving a patch updates
+ * the bank and writes the patch through to the storage.
+ * After startup all file access is done by a storage worker thread, so patch I/O doesn't block MIDI handling.
  */
 class PatchService
 {
 private:
+    // patch bank file, see PatchBank.h
+    static constexpr const char *BANK_FILE_NAME{"tmixpatch/bank.tmixbank"};
+    // new patch bank file written during compaction, replaces the patch bank file when complete
+    static constexpr const char *BANK_TEMP_FILE_NAME{"tmixpatch/bank.tmixbank.tmp"};
+    // patch journal file, see PatchJournal.h
+    static constexpr const char *JOURNAL_FILE_NAME{"tmixpatch/bank.tmixjournal"};
+    // number of journal entries that triggers a compaction
+    static const uint8_t JOURNAL_COMPACTION_ENTRIES{32};
+    // file buffer size, leaves room for patch files containing params that have been removed since
+    static const uint16_t FILE_BUFFER_SIZE{512};
+    static_assert(PatchJournal::ENTRY_SIZE <= FILE_BUFFER_SIZE, "FILE_BUFFER_SIZE too small for a patch journal entry");
+    // maximum number of queued storage requests
+    static const uint8_t STORAGE_QUEUE_SIZE{8};
+    // storage worker thread stack size in bytes
+    static const uint16_t STORAGE_THREAD_STACK_SIZE{4096};
+
     /**
-     * Reference to the parameter map, used for determining available parameters and initial values.
+     * Storage request, processed by the storage worker thread.
      */
-    const std::map<uint16_t, const Param *> *paramMap;
+    struct StorageRequest
+    {
+        enum class Type : uint8_t { read, write, readFile, writeFile, appendFile };
+
+        Type type;
+        uint8_t patchNumber;
+        FS *fs;
+        Patch patch;
+        StorageCallback callback;
+        bool success;
+
+        // file requests: file name, data read from or written to the file and the maximum size read
+        const char *fileName;
+        std::vector<uint8_t> *data;
+        uint32_t maxSize;
+    };
 
     DisplayService * displayService;
 
     bool sdInitialized{false};
 
+    // all patches, indexed by patch number
+    std::array<Patch, PATCH_COUNT> patchBank;
+
+    // storage request ring buffer
+    // requests are added by the main thread (requestCount), processed by the storage worker thread (processedCount)
+    // and completed by the main thread (completedCount), the counters only increase
+    std::array<StorageRequest, STORAGE_QUEUE_SIZE> storageRequests;
+    volatile uint32_t requestCount{0};
+    volatile uint32_t processedCount{0};
+    volatile uint32_t completedCount{0};
+    Threads::Mutex storageRequestsMutex;
+
+    // file buffer, used by the storage worker thread only (and by loadPatchBank() before the thread is started)
+    std::array<uint8_t, FILE_BUFFER_SIZE> fileBuffer;
+
+    // number of entries in the patch journal, used by the storage worker thread only (after startup)
+    uint16_t journalEntryCount{0};
+
     /**
      * Convert a patch number (0-63) to a patch file name.
      * 
@@ -48,135 +116,438 @@ private:
     }
 
     /**
-     * Get a parameter value map initialized with default values.
+     * Read a patch from a patch file (one file per patch, as used before the patch bank).
+     * The whole file is read into the file buffer with a single read.
      * 
-     * @return std::map<uint16_t, uint8_t> parameter map
+     * @param patchNumber patch number
+     * @param fs FS
+     * @param patch patch, set to the init patch if reading fails
+     * @return bool true if the patch was read
      */
-    std::map<uint16_t, uint8_t> getPatchInitParamValueMap() const
+    bool readPatch(const uint8_t patchNumber, FS &fs, Patch &patch)
     {
-        std::map<uint16_t, uint8_t> paramValueMap;
-        for (const auto [paramId, param] : *paramMap)
+        patch = initPatch();
+
+        // try opening the file
+        File file = fs.open(patchNumberToFileName(patchNumber).c_str());
+        if (!file)
         {
-            paramValueMap[paramId] = param->getInitialValue();
+            Serial.println("Error opening patch file");
+            return false;
         }
-        return paramValueMap;
+
+        size_t size = file.read(fileBuffer.data(), fileBuffer.size());
+        if (file.available() > 0)
+        {
+            Serial.println("Warning: patch file too large, ignoring remaining param values");
+        }
+        file.close();
+
+        // verify if the signature is correct
+        if (size < FILE_SIGNATURE_SIZE || memcmp(fileBuffer.data(), FILE_SIGNATURE, FILE_SIGNATURE_SIZE))
+        {
+            Serial.println("Error loading patch, invalid signature");
+            return false;
+        }
+
+        // load the patch name
+        if (size < FILE_SIGNATURE_SIZE + Patch::NAME_LENGTH)
+        {
+            Serial.println("Error reading patch name");
+            return false;
+        }
+        patch.setName(std::string(reinterpret_cast<const char *>(&fileBuffer[FILE_SIGNATURE_SIZE]), Patch::NAME_LENGTH));
+
+        // load the parameter values, param IDs are stored little endian
+        for (size_t position = FILE_SIGNATURE_SIZE + Patch::NAME_LENGTH; position + 3 <= size; position += 3)
+        {
+            uint16_t paramId = fileBuffer[position] | (fileBuffer[position + 1] << 8);
+            uint8_t paramValue = fileBuffer[position + 2];
+
+            uint8_t paramIndex = getParamIndexById(paramId);
+            if (paramIndex == PARAM_INDEX_NONE)
+            {
+                Serial.printf("Warning: patch contains missing param with paramId %d, ignoring param value\n", paramId);
+            }
+            else
+            {
+                patch.setParamValueByIndex(paramIndex, paramValue);
+            }
+        }
+
+        return true;
+    }
+
+    /**
+     * Get the file system used to store the patches, SD unless PATCH_STORAGE_LITTLEFS is defined (see main.cpp).
+     * 
+     * @return FS& patch storage
+     */
+    static FS &getPatchStorage()
+    {
+        #ifdef PATCH_STORAGE_LITTLEFS
+        return littleFS;
+        #else
+        return SD;
+        #endif
     }
 
     /**
-     * Load a patch.
+     * Read a whole file with a single read.
+     * 
+     * @param fs FS
+     * @param fileName file name
+     * @param buffer buffer, resized to the file size
+     * @param maxSize maximum number of bytes read, the rest of the file is ignored
+     * @return bool true if the file was read
+     */
+    bool readFile(FS &fs, const char *fileName, std::vector<uint8_t> &buffer, size_t maxSize = SIZE_MAX)
+    {
+        File file = fs.open(fileName);
+        if (!file)
+        {
+            return false;
+        }
+
+        buffer.resize(std::min((size_t)file.size(), maxSize));
+        size_t size = file.read(buffer.data(), buffer.size());
+        buffer.resize(size);
+        file.close();
+
+        return true;
+    }
+
+    /**
+     * Write a whole file with a single write, replacing the file if it exists.
+     * 
+     * @param fs FS
+     * @param fileName file name
+     * @param data data
+     * @param size data size
+     * @return bool true if the file was written
+     */
+    bool writeFile(FS &fs, const char *fileName, const uint8_t *data, size_t size)
+    {
+        fs.remove(fileName);
+
+        File file = fs.open(fileName, FILE_WRITE);
+        if (!file)
+        {
+            Serial.printf("Error opening %s\n", fileName);
+            return false;
+        }
+
+        size_t written = file.write(data, size);
+        file.close();
+
+        if (written != size)
+        {
+            Serial.printf("Error writing %s\n", fileName);
+            return false;
+        }
+
+        return true;
+    }
+
+    /**
+     * Append data to a file with a single write, the file is created if it doesn't exist.
+     * 
+     * @param fs FS
+     * @param fileName file name
+     * @param data data
+     * @param size data size
+     * @return bool true if the data was written
+     */
+    bool appendFile(FS &fs, const char *fileName, const uint8_t *data, size_t size)
+    {
+        File file = fs.open(fileName, FILE_WRITE);
+        if (!file)
+        {
+            Serial.printf("Error opening %s\n", fileName);
+            return false;
+        }
+
+        size_t written = file.write(data, size);
+        file.close();
+
+        if (written != size)
+        {
+            Serial.printf("Error writing %s\n", fileName);
+            return false;
+        }
+
+        return true;
+    }
+
+    /**
+     * Save a patch by appending an entry to the patch journal.
+     * Compacts the journal when it contains JOURNAL_COMPACTION_ENTRIES entries or if appending failed.
      * 
      * @param patchNumber patch number
+     * @param patch patch
      * @param fs FS
-     * @return Patch patch
+     * @return bool true if the patch was written
      */
-    Patch loadPatch(const uint8_t patchNumber, FS &fs)
+    bool writePatch(const uint8_t patchNumber, const Patch &patch, FS &fs)
     {
-        Patch patch = initPatch();
+        Serial.println("Saving patch to patch journal");
 
-        char patchNameBuffer[Patch::NAME_LENGTH]{" "};
-        uint16_t paramId;
-        uint8_t paramValue;
+        PatchJournal::writeEntry(patchNumber, patch, fileBuffer.data());
 
-        // try opening the file
-        File file = fs.open(patchNumberToFileName(patchNumber).c_str());
+        bool success{false};
+        File file = fs.open(JOURNAL_FILE_NAME, FILE_WRITE);
         if (file)
         {
-            Serial.print("File size: ");
-            Serial.println(file.available());
+            success = file.write(fileBuffer.data(), PatchJournal::ENTRY_SIZE) == PatchJournal::ENTRY_SIZE;
+            file.close();
+        }
 
-            // verify if the signature is correct
-            char signatureBuffer[] = "    ";
-            file.read(&signatureBuffer, FILE_SIGNATURE_SIZE);
+        if (!success)
+        {
+            Serial.println("Error writing patch journal file");
+        }
 
-            if (strcmp(signatureBuffer, FILE_SIGNATURE))
+        // a failed append may leave an incomplete entry, compacting removes it
+        if (!success || ++journalEntryCount >= JOURNAL_COMPACTION_ENTRIES)
+        {
+            std::array<Patch, PATCH_COUNT> *patches = new std::array<Patch, PATCH_COUNT>;
+            uint16_t entryCount;
+            bool clean;
+            if (readBankFile(fs, *patches, entryCount, clean))
             {
-                Serial.println("Error loading patch, invalid signature");
-                Serial.println("File signature:");
-                Serial.println(signatureBuffer);
-                Serial.println("Expected signature:");
-                Serial.println(FILE_SIGNATURE);
+                compact(fs, *patches);
             }
-            else
-            {
-                // load the patch name
-                if (file.available() >= Patch::NAME_LENGTH)
-                {
-                    file.read(&patchNameBuffer, Patch::NAME_LENGTH);
-                    patch.setName(std::string(patchNameBuffer));
+            delete patches;
+        }
 
-                    // load the parameter values
-                    while (file.available() >= 3)
-                    {
-                        file.read(&paramId, 2);
-                        file.read(&paramValue, 1);
+        return success;
+    }
 
-                        patch.paramValueMap[paramId] = paramValue;
-                    }
-                }
-                else
-                {
-                    Serial.println("Error reading patch name");
-                }
-            }
+    /**
+     * Read the patch bank file and replay the patch journal, each with a single read.
+     * 
+     * @param fs FS
+     * @param patches patches, indexed by patch number
+     * @param journalEntryCount set to the number of journal entries
+     * @param upToDate set to true if the patch bank file doesn't need to be written again and the journal is clean
+     * @return bool true if the patch bank was read
+     */
+    bool readBankFile(FS &fs, std::array<Patch, PATCH_COUNT> &patches, uint16_t &journalEntryCount, bool &upToDate)
+    {
+        journalEntryCount = 0;
+        upToDate = false;
 
-            file.close();
+        std::vector<uint8_t> buffer;
+        if (!readFile(fs, BANK_FILE_NAME, buffer))
+        {
+            Serial.println("Patch bank file not found");
+            return false;
         }
-        else
+        if (!PatchBank::readBank(buffer.data(), buffer.size(), patches, upToDate))
         {
-            Serial.println("Error opening patch file");
+            return false;
+        }
+
+        bool journalClean{false};
+        if (readFile(fs, JOURNAL_FILE_NAME, buffer))
+        {
+            PatchJournal::replay(buffer.data(), buffer.size(), patches, journalEntryCount, journalClean);
         }
+        upToDate = upToDate && journalClean;
 
-        return patch;
+        return true;
     }
 
     /**
-     * Save a patch.
+     * Write the patches to a new patch bank file and empty the patch journal.
+     * The new patch bank file is written next to the current one and only replaces it when complete: when power is lost,
+     * either the old patch bank file and the journal or the new patch bank file remain.
      * 
-     * @param patchNumber patch number
-     * @param patch patch
      * @param fs FS
+     * @param patches patches, indexed by patch number
+     * @return bool true if compacting succeeded
      */
-    void savePatch(const uint8_t patchNumber, const Patch &patch, FS &fs)
+    bool compact(FS &fs, const std::array<Patch, PATCH_COUNT> &patches)
     {
-        Serial.println("Saving patch to file");
+        Serial.println("Compacting patch journal");
 
-        std::string fileName = patchNumberToFileName(patchNumber);
+        std::vector<uint8_t> buffer(PatchBank::FILE_SIZE);
+        PatchBank::writeBank(patches, buffer.data());
+        if (!writeFile(fs, BANK_TEMP_FILE_NAME, buffer.data(), buffer.size()))
+        {
+            return false;
+        }
+
+        // some file systems can't rename to an existing file, see recoverCompaction() for a power loss in between
+        fs.remove(BANK_FILE_NAME);
+        if (!fs.rename(BANK_TEMP_FILE_NAME, BANK_FILE_NAME))
+        {
+            Serial.println("Error renaming patch bank file");
+            return false;
+        }
 
-        fs.remove(fileName.c_str());
+        journalEntryCount = 0;
+        PatchJournal::writeHeader(buffer.data());
+        return writeFile(fs, JOURNAL_FILE_NAME, buffer.data(), PatchJournal::HEADER_SIZE);
+    }
 
-        File file = fs.open(fileName.c_str(), FILE_WRITE);
-        if (file)
+    /**
+     * Finish a compaction interrupted by a power loss.
+     * Without a patch bank file, the new patch bank file is complete and replaces it. Otherwise the new patch bank file may
+     * be incomplete and is removed.
+     * 
+     * @param fs FS
+     */
+    void recoverCompaction(FS &fs)
+    {
+        if (!fs.exists(BANK_TEMP_FILE_NAME))
         {
-            // write the signature
-            file.write(FILE_SIGNATURE, FILE_SIGNATURE_SIZE);
+            return;
+        }
 
-            // write the patch name
-            file.write(patch.getName().c_str(), Patch::NAME_LENGTH);
+        if (fs.exists(BANK_FILE_NAME))
+        {
+            fs.remove(BANK_TEMP_FILE_NAME);
+        }
+        else
+        {
+            Serial.println("Finishing interrupted patch journal compaction");
+            fs.rename(BANK_TEMP_FILE_NAME, BANK_FILE_NAME);
+        }
+    }
 
-            // write the parameter ID / value pairs
-            for (const auto [paramId, paramValue] : patch.paramValueMap)
+    /**
+     * Add a storage request to the queue.
+     * 
+     * @param type request type
+     * @param patchNumber patch number
+     * @param fs FS
+     * @param patch patch to write (write requests only)
+     * @param callback completion callback, may be empty
+     * @param fileName file name (file requests only)
+     * @param data data read from or written to the file (file requests only), owned by the caller until completion
+     * @param maxSize maximum number of bytes read (read file requests only)
+     * @return bool true if the request was queued, false if the queue is full
+     */
+    bool addStorageRequest(StorageRequest::Type type, const uint8_t patchNumber, FS &fs, const Patch &patch, StorageCallback callback, const char *fileName = nullptr, std::vector<uint8_t> *data = nullptr, uint32_t maxSize = 0)
+    {
+        {
+            Threads::Scope scope(storageRequestsMutex);
+            if (requestCount - completedCount >= STORAGE_QUEUE_SIZE)
             {
-                file.write(&paramId, 2);
-                file.write(&paramValue, 1);
+                Serial.println("Error: storage request queue full");
+                return false;
             }
+        }
 
-            file.close();
+        // the slot is owned by the main thread until the request count is increased
+        StorageRequest &request = storageRequests[requestCount % STORAGE_QUEUE_SIZE];
+        request.type = type;
+        request.patchNumber = patchNumber;
+        request.fs = &fs;
+        request.patch = patch;
+        request.callback = std::move(callback);
+        request.success = false;
+        request.fileName = fileName;
+        request.data = data;
+        request.maxSize = maxSize;
+
+        Threads::Scope scope(storageRequestsMutex);
+        requestCount = requestCount + 1;
+
+        return true;
+    }
+
+    /**
+     * Process a single storage request, if any.
+     * Called by storageTaskRunner() in the storage worker thread.
+     * 
+     * @return bool true if a request was processed
+     */
+    bool storageTask()
+    {
+        {
+            Threads::Scope scope(storageRequestsMutex);
+            if (processedCount == requestCount)
+            {
+                return false;
+            }
         }
-        else
+
+        // the slot is owned by the storage worker thread until the processed count is increased
+        StorageRequest &request = storageRequests[processedCount % STORAGE_QUEUE_SIZE];
+        switch (request.type)
         {
-            Serial.println("Error opening patch file");
+        case StorageRequest::Type::read:
+            request.success = readPatch(request.patchNumber, *request.fs, request.patch);
+            break;
+
+        case StorageRequest::Type::write:
+            request.success = writePatch(request.patchNumber, request.patch, *request.fs);
+            break;
+
+        case StorageRequest::Type::readFile:
+            request.success = readFile(*request.fs, request.fileName, *request.data, request.maxSize);
+            break;
+
+        case StorageRequest::Type::writeFile:
+            request.success = writeFile(*request.fs, request.fileName, request.data->data(), request.data->size());
+            break;
+
+        case StorageRequest::Type::appendFile:
+            request.success = appendFile(*request.fs, request.fileName, request.data->data(), request.data->size());
+            break;
         }
+
+        Threads::Scope scope(storageRequestsMutex);
+        processedCount = processedCount + 1;
+
+        return true;
+    }
+
+    /**
+     * Storage worker thread task runner.
+     */
+    void storageTaskRunner()
+    {
+        while (true) {
+            if (!storageTask())
+            {
+                threads.yield();
+            }
+        }
+    }
+
+    /**
+     * Copy a patch file from LittleFS to the patch bank, followed by the next patches.
+     * 
+     * @param patchNumber patch number
+     */
+    void copyPatchesToSd(const uint8_t patchNumber)
+    {
+        addStorageRequest(StorageRequest::Type::read, patchNumber, littleFS, patchBank[patchNumber],
+            [this](uint8_t patchNumber, const Patch &patch, bool success)
+            {
+                if (success)
+                {
+                    savePatch(patchNumber, patch);
+                }
+                if (patchNumber + 1 < PATCH_COUNT)
+                {
+                    copyPatchesToSd(patchNumber + 1);
+                }
+            }
+        );
     }
 
 public:
     /**
-     * Initialize the patch service.
+     * Initialize the patch service, load the patch bank and start the storage worker thread.
      * 
-     * @param paramMap reference to the parameter map
+     * @param displayService display service
      */
-    void initialize(const std::map<uint16_t, const Param *> *paramMap, DisplayService * displayService)
+    void initialize(DisplayService * displayService)
     {
-        this->paramMap = paramMap;
         this->displayService = displayService;
 
         Serial.println("Initializing LittleFS ...");
@@ -196,40 +567,126 @@ public:
 
         Serial.println("Initializing SD ...");
 
-        // check that the SD card is available
+        // check that the SD card is available, SD is only required when patches are stored on SD
         if (!SD.begin(BUILTIN_SDCARD)) {
             Serial.println("Failed to initialize SD");
-            //TODO: add compile setting to choose between SD and LittleFS?
+            #ifndef PATCH_STORAGE_LITTLEFS
             displayService->displayError("Failed to init SD");
             // delay(5000);
             while (true);
+            #endif
         }
         else
         {
             sdInitialized = true;
             Serial.println("SD initialized.");
+        }
 
-            // check if the tmixpatch folder exists
-            if (!SD.exists("tmixpatch"))
+        // check if the tmixpatch folder exists on the patch storage
+        FS &fs = getPatchStorage();
+        if (!fs.exists("tmixpatch"))
+        {
+            // create the tmixpatch folder
+            if (!fs.mkdir("tmixpatch"))
             {
-                // create the tmixpatch folder
-                if (!SD.mkdir("tmixpatch"))
-                {
-                    Serial.println("Failed to create folder tmixpatch on SD");
-                    sdInitialized = false;
+                Serial.println("Failed to create folder tmixpatch");
 
-                    displayService->displayError("Fail tmixpatch on SD");
-                    // delay(5000);
-                    while (true);
-                }
-                else
+                displayService->displayError("Fail tmixpatch folder");
+                // delay(5000);
+                while (true);
+            }
+            else
+            {
+                Serial.println("Created folder tmixpatch");
+            }
+        }
+        else
+        {
+            Serial.println("Folder tmixpatch already exists");
+        }
+
+        loadPatchBank();
+
+        // start a separate thread for storage access
+        // this keeps SD and LittleFS access off the MIDI handling
+        auto storageThread = threads.addThread(
+            fnptr<void()>(
+                    [this]()
+                    {
+                        this->storageTaskRunner();
+                    }
+            ),
+            0,
+            STORAGE_THREAD_STACK_SIZE
+        );
+
+        // allocate a small time slice for storage access
+        threads.setTimeSlice(storageThread, 1);
+    }
+
+    /**
+     * Load all patches from the patch bank file and the patch journal into the RAM bank.
+     * Without a valid patch bank file, the patch files (one file per patch) are loaded and converted to a patch bank file.
+     * Reads the files directly, to be called before the storage worker thread is started.
+     */
+    void loadPatchBank()
+    {
+        Serial.println("Loading patch bank ...");
+
+        FS &fs = getPatchStorage();
+        uint32_t startMillis = millis();
+
+        recoverCompaction(fs);
+
+        bool upToDate;
+        if (!readBankFile(fs, patchBank, journalEntryCount, upToDate))
+        {
+            Serial.println("Converting patch files to patch bank ...");
+            for (uint8_t patchNumber = 0; patchNumber < PATCH_COUNT; patchNumber++)
+            {
+                readPatch(patchNumber, fs, patchBank[patchNumber]);
+            }
+        }
+        Serial.printf("Patch bank loaded in %lums, %d journal entries\n", millis() - startMillis, journalEntryCount);
+
+        if (!upToDate && !compact(fs, patchBank))
+        {
+            displayService->displayError("Fail patch bank");
+        }
+    }
+
+    /**
+     * Perform delayed tasks.
+     * Calls the completion callbacks of the storage requests processed by the storage worker thread.
+     */
+    void task()
+    {
+        while (true)
+        {
+            {
+                Threads::Scope scope(storageRequestsMutex);
+                if (completedCount == processedCount)
                 {
-                    Serial.println("Created folder tmixpatch on SD");
+                    return;
                 }
             }
-            else
+
+            StorageRequest &request = storageRequests[completedCount % STORAGE_QUEUE_SIZE];
+            StorageCallback callback = std::move(request.callback);
+            request.callback = nullptr;
+            Patch patch = request.patch;
+            uint8_t patchNumber = request.patchNumber;
+            bool success = request.success;
+
+            // release the slot before calling the callback, the callback may add new requests
+            {
+                Threads::Scope scope(storageRequestsMutex);
+                completedCount = completedCount + 1;
+            }
+
+            if (callback)
             {
-                Serial.println("Folder tmixpatch already exists on SD");
+                callback(patchNumber, patch, success);
             }
         }
     }
@@ -241,33 +698,120 @@ public:
      */
     Patch initPatch()
     {
-        Patch patch;
-        patch.paramValueMap = getPatchInitParamValueMap();
-        return patch;
+        return Patch();
     }
 
     /**
-     * Load a patch.
+     * Load a patch from the RAM bank.
      * 
      * @param patchNumber patch number
-     * @return Patch patch
+     * @return const Patch& patch
      */
-    Patch loadPatch(const uint8_t patchNumber)
+    const Patch &loadPatch(const uint8_t patchNumber) const
     {
-        return loadPatch(patchNumber, SD);
+        return patchBank[patchNumber < PATCH_COUNT ? patchNumber : 0];
     }
 
     /**
-     * Save a patch.
+     * Save a patch to the RAM bank and queue writing it through to the patch storage.
      * 
      * @param patchNumber patch number
      * @param patch patch
+     * @param callback called when the patch has been written, may be empty
+     * @return bool true if writing the patch was queued
+     */
+    bool savePatch(const uint8_t patchNumber, const Patch &patch, StorageCallback callback = nullptr)
+    {
+        if (patchNumber >= PATCH_COUNT)
+        {
+            return false;
+        }
+
+        patchBank[patchNumber] = patch;
+        return addStorageRequest(StorageRequest::Type::write, patchNumber, getPatchStorage(), patch, std::move(callback));
+    }
+
+    /**
+     * Queue reading a file on SD, used for files other than patches (e.g. MIDI captures).
+     * 
+     * @param fileName file name
+     * @param data set to the file contents, must not be accessed until the callback is called
+     * @param maxSize maximum number of bytes read, the rest of the file is ignored
+     * @param callback called when the file has been read
+     * @return bool true if reading the file was queued
      */
-    void savePatch(const uint8_t patchNumber, const Patch &patch)
+    bool loadFile(const char *fileName, std::vector<uint8_t> &data, uint32_t maxSize, StorageCallback callback)
     {
-        savePatch(patchNumber, patch, SD);
+        if (!sdInitialized)
+        {
+            return false;
+        }
+
+        return addStorageRequest(StorageRequest::Type::readFile, 0, SD, Patch(), std::move(callback), fileName, &data, maxSize);
     }
 
+    /**
+     * Queue writing a file on SD, used for files other than patches (e.g. MIDI captures).
+     * 
+     * @param fileName file name
+     * @param data data, must not be changed until the callback is called
+     * @param append true to append the data to the file, false to replace the file
+     * @param callback called when the file has been written, may be empty
+     * @return bool true if writing the file was queued
+     */
+    bool saveFile(const char *fileName, std::vector<uint8_t> &data, bool append, StorageCallback callback = nullptr)
+    {
+        if (!sdInitialized)
+        {
+            return false;
+        }
+
+        return addStorageRequest(append ? StorageRequest::Type::appendFile : StorageRequest::Type::writeFile, 0, SD, Patch(), std::move(callback), fileName, &data);
+    }
+
+    #ifdef DEBUG_BENCHMARK
+    /**
+     * Benchmark loading and saving patches.
+     * Compares reading a patch file (as before) to copying the patch from the RAM bank, measures loading the whole patch
+     * bank and compares saving a patch by appending to the journal to rewriting the patch bank file.
+     * Reads and writes the files directly, to be called while no storage requests are queued.
+     */
+    void benchmarkPatchBank()
+    {
+        FS &fs = getPatchStorage();
+        std::array<Patch, PATCH_COUNT> *patches = new std::array<Patch, PATCH_COUNT>;
+
+        Serial.println();
+        Benchmark::run("patch load, patch file", PATCH_COUNT, [this, &fs](uint32_t i)
+        {
+            Patch patch;
+            readPatch(i % PATCH_COUNT, fs, patch);
+            return patch.getParamValueByIndex(0);
+        });
+        Benchmark::run("patch bank load, bank and journal file", 8, [this, &fs, patches](uint32_t i)
+        {
+            uint16_t entryCount;
+            bool upToDate;
+            return readBankFile(fs, *patches, entryCount, upToDate) ? entryCount : 0u;
+        });
+        Benchmark::run("patch load, RAM bank", 10000, [this](uint32_t i)
+        {
+            Patch patch = loadPatch(i % PATCH_COUNT);
+            return patch.getParamValueByIndex(0);
+        });
+        Benchmark::run("patch save, journal entry", 8, [this, &fs](uint32_t i)
+        {
+            return writePatch(i % PATCH_COUNT, patchBank[i % PATCH_COUNT], fs) ? i : 0;
+        });
+        Benchmark::run("patch save, bank file rewrite", 8, [this, &fs](uint32_t i)
+        {
+            return compact(fs, patchBank) ? i : 0;
+        });
+
+        delete patches;
+    }
+    #endif
+
     /**
      * Delete all patches.
      */
@@ -276,26 +820,23 @@ public:
         Serial.println("Deleting all patch files");
 
         Serial.println("TODO: disabled for now");
-        // for (uint8_t patchNumber = 0 ; patchNumber <= 63 ; patchNumber++)
+        // for (uint8_t patchNumber = 0 ; patchNumber < PATCH_COUNT ; patchNumber++)
         // {
         //     littleFS.remove(patchNumberToFileName(patchNumber).c_str());
         // }
     }
 
     /**
-     * Copy all patches from LittleFS to SD.
+     * Copy all patch files from LittleFS to the patch bank.
+     * The patches are copied one by one by the storage worker thread.
      */
     void copyAllPatchesToSd()
     {
-        Serial.println("Copying all patch files to SD");
+        Serial.println("Copying all patch files to the patch bank");
 
-        for (uint8_t patchNumber = 0 ; patchNumber <= 63 ; patchNumber++)
-        {
-            Patch patch = loadPatch(patchNumber, littleFS);
-            savePatch(patchNumber, patch, SD);
-        }
+        copyPatchesToSd(0);
     }
 
 };
 
-#endif
\ No newline at end of file
+#endif
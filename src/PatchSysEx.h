@@ -0,0 +1,255 @@
+#ifndef PatchSysEx_h
+#define PatchSysEx_h
+
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include <array>
+
+#include "Param.h"
+#include "Patch.h"
+#include "MidiOutputQueue.h"
+
+/**
+ * SysEx messages for dumping and loading patches over external MIDI, see src/tmixsysex.py for a host side tool.
+ *
+ * All messages start with F0 7D 54 4D (non-commercial manufacturer ID, "TM"), followed by a command and end with F7:
+ * - patch request (01): patch number, the synth replies with a patch dump
+ * - bank request (02): the synth replies with a patch dump for each patch, in patch number order
+ * - patch dump (10): patch number, name (8 bytes), param count (param ID (2 bytes), 14-bit value (2 bytes)), checksum
+ * - patch ack (11): patch number, status (0 if the patch was saved, 1 if not), sent after a patch dump was loaded
+ *
+ * 14-bit numbers are sent MSB first, 7 bits per byte. The checksum makes the sum of the name, param and checksum bytes a
+ * multiple of 128. Params missing in a patch dump are set to their initial value, params that don't exist anymore are
+ * ignored, like when loading a patch bank. A sender loading patches should wait for the ack of a patch before sending
+ * the next one, so the patch storage keeps up.
+ */
+class PatchSysEx
+{
+private:
+    static constexpr std::array<uint8_t, 4> HEADER{{0xF0, 0x7D, 0x54, 0x4D}};
+    static const uint8_t COMMAND_OFFSET{4};
+    static const uint8_t PATCH_NUMBER_OFFSET{5};
+    static const uint8_t NAME_OFFSET{6};
+    static const uint8_t PARAMS_OFFSET{NAME_OFFSET + Patch::NAME_LENGTH};
+    static const uint8_t SYSEX_END{0xF7};
+
+public:
+    static const uint8_t COMMAND_PATCH_REQUEST{0x01};
+    static const uint8_t COMMAND_BANK_REQUEST{0x02};
+    static const uint8_t COMMAND_PATCH_DUMP{0x10};
+    static const uint8_t COMMAND_PATCH_ACK{0x11};
+
+    // size of a patch dump using the current params
+    static const uint16_t PATCH_DUMP_SIZE{PARAMS_OFFSET + PARAM_COUNT * 4 + 2};
+    static const uint8_t PATCH_ACK_SIZE{8};
+
+    /**
+     * Get the command of a SysEx message.
+     *
+     * @param data message, including F0 and F7
+     * @param size message size
+     * @return int16_t command, -1 if the message is not a TeensyMix message
+     */
+    static int16_t getCommand(const uint8_t *data, uint16_t size)
+    {
+        if (size < COMMAND_OFFSET + 2 || memcmp(data, HEADER.data(), HEADER.size()) || data[size - 1] != SYSEX_END)
+        {
+            return -1;
+        }
+        return data[COMMAND_OFFSET];
+    }
+
+    /**
+     * Get the patch number of a patch request, patch dump or patch ack.
+     *
+     * @param data message
+     * @param size message size
+     * @return uint8_t patch number, PATCH_COUNT if missing or invalid
+     */
+    static uint8_t getPatchNumber(const uint8_t *data, uint16_t size)
+    {
+        return size > PATCH_NUMBER_OFFSET + 1 && data[PATCH_NUMBER_OFFSET] < PATCH_COUNT ? data[PATCH_NUMBER_OFFSET] : PATCH_COUNT;
+    }
+
+    /**
+     * Write a patch dump.
+     *
+     * @param patchNumber patch number
+     * @param patch patch
+     * @param data buffer of at least PATCH_DUMP_SIZE bytes
+     * @return uint16_t message size
+     */
+    static uint16_t writePatchDump(uint8_t patchNumber, const Patch &patch, uint8_t *data)
+    {
+        memcpy(data, HEADER.data(), HEADER.size());
+        data[COMMAND_OFFSET] = COMMAND_PATCH_DUMP;
+        data[PATCH_NUMBER_OFFSET] = patchNumber;
+
+        uint8_t sum{0};
+        std::string name = patch.getName();
+        for (uint8_t i = 0; i < Patch::NAME_LENGTH; i++)
+        {
+            data[NAME_OFFSET + i] = name[i] & 0x7F;
+            sum += data[NAME_OFFSET + i];
+        }
+
+        uint8_t *param = data + PARAMS_OFFSET;
+        for (uint8_t paramIndex = 0; paramIndex < PARAM_COUNT; paramIndex++, param += 4)
+        {
+            uint16_t paramId = PARAMS[paramIndex].getParamId();
+            uint16_t value14 = patch.getParamValue14ByIndex(paramIndex);
+            param[0] = (paramId >> 7) & 0x7F;
+            param[1] = paramId & 0x7F;
+            param[2] = (value14 >> 7) & 0x7F;
+            param[3] = value14 & 0x7F;
+            sum += param[0] + param[1] + param[2] + param[3];
+        }
+
+        param[0] = (128 - (sum & 0x7F)) & 0x7F;
+        param[1] = SYSEX_END;
+        return PATCH_DUMP_SIZE;
+    }
+
+    /**
+     * Read a patch dump.
+     *
+     * @param data message
+     * @param size message size
+     * @param patchNumber set to the patch number
+     * @param patch patch, params not in the dump are set to their initial value
+     * @return bool true if the patch dump is valid, false if not (the patch is not changed)
+     */
+    static bool readPatchDump(const uint8_t *data, uint16_t size, uint8_t &patchNumber, Patch &patch)
+    {
+        // header, command, patch number, name, checksum and F7
+        if (size < PARAMS_OFFSET + 2 || (size - PARAMS_OFFSET - 2) % 4 != 0 || getPatchNumber(data, size) == PATCH_COUNT)
+        {
+            return false;
+        }
+
+        uint8_t sum{0};
+        for (uint16_t i = NAME_OFFSET; i < size - 1; i++)
+        {
+            sum += data[i];
+        }
+        if ((sum & 0x7F) != 0)
+        {
+            return false;
+        }
+
+        patchNumber = data[PATCH_NUMBER_OFFSET];
+        patch = Patch(std::string(reinterpret_cast<const char *>(data + NAME_OFFSET), Patch::NAME_LENGTH));
+        for (const uint8_t *param = data + PARAMS_OFFSET; param + 4 <= data + size - 2; param += 4)
+        {
+            uint8_t paramIndex = getParamIndexById((param[0] << 7) | param[1]);
+            if (paramIndex != PARAM_INDEX_NONE)
+            {
+                patch.setParamValue14ByIndex(paramIndex, (param[2] << 7) | param[3]);
+            }
+        }
+        return true;
+    }
+
+    /**
+     * Write a patch ack.
+     *
+     * @param patchNumber patch number
+     * @param success true if the patch was saved
+     * @param data buffer of at least PATCH_ACK_SIZE bytes
+     * @return uint16_t message size
+     */
+    static uint16_t writePatchAck(uint8_t patchNumber, bool success, uint8_t *data)
+    {
+        memcpy(data, HEADER.data(), HEADER.size());
+        data[COMMAND_OFFSET] = COMMAND_PATCH_ACK;
+        data[PATCH_NUMBER_OFFSET] = patchNumber & 0x7F;
+        data[6] = success ? 0 : 1;
+        data[7] = SYSEX_END;
+        return PATCH_ACK_SIZE;
+    }
+};
+
+/**
+ * Outgoing SysEx of a single external MIDI output: patch acks and patch dumps.
+ * A single message is sent per task(), when the output queue is idle (see MidiOutputQueue::takeSysExCredit()), so a
+ * bank dump is streamed patch by patch and never buffered as a whole.
+ */
+class PatchSysExStream
+{
+public:
+    static const uint8_t ACK_QUEUE_SIZE{8};
+
+private:
+    std::array<uint8_t, PatchSysEx::PATCH_DUMP_SIZE> buffer;
+
+    // patches nextDumpPatchNumber until endDumpPatchNumber (exclusive) are waiting to be dumped
+    uint8_t nextDumpPatchNumber{0};
+    uint8_t endDumpPatchNumber{0};
+
+    // pending acks: patch number | status << 7
+    std::array<uint8_t, ACK_QUEUE_SIZE> acks;
+    uint8_t ackHead{0};
+    uint8_t ackCount{0};
+
+public:
+    /**
+     * Queue dumping patches, replacing a dump in progress.
+     *
+     * @param firstPatchNumber first patch number
+     * @param count number of patches
+     */
+    void dump(uint8_t firstPatchNumber, uint8_t count)
+    {
+        nextDumpPatchNumber = firstPatchNumber;
+        endDumpPatchNumber = std::min(firstPatchNumber + count, (int)PATCH_COUNT);
+    }
+
+    /**
+     * Queue a patch ack, dropped when ACK_QUEUE_SIZE acks are pending.
+     *
+     * @param patchNumber patch number
+     * @param success true if the patch was saved
+     */
+    void ack(uint8_t patchNumber, bool success)
+    {
+        if (ackCount == acks.size())
+        {
+            return;
+        }
+
+        acks[(ackHead + ackCount) % acks.size()] = (patchNumber & 0x7F) | (success ? 0 : 0x80);
+        ackCount++;
+    }
+
+    /**
+     * Send the next pending message, if the output is idle.
+     *
+     * @param output output queue, used for pacing
+     * @param loadPatch function returning the patch (const Patch &) for a patch number
+     * @param send function called with the message data and size
+     */
+    template <typename LoadPatch, typename Send>
+    void task(MidiOutputQueue &output, LoadPatch &&loadPatch, Send &&send)
+    {
+        if (ackCount > 0)
+        {
+            if (output.takeSysExCredit(PatchSysEx::PATCH_ACK_SIZE))
+            {
+                uint8_t ack = acks[ackHead];
+                send(buffer.data(), PatchSysEx::writePatchAck(ack & 0x7F, (ack & 0x80) == 0, buffer.data()));
+                ackHead = (ackHead + 1) % acks.size();
+                ackCount--;
+            }
+            return;
+        }
+
+        if (nextDumpPatchNumber < endDumpPatchNumber && output.takeSysExCredit(PatchSysEx::PATCH_DUMP_SIZE))
+        {
+            send(buffer.data(), PatchSysEx::writePatchDump(nextDumpPatchNumber, loadPatch(nextDumpPatchNumber), buffer.data()));
+            nextDumpPatchNumber++;
+        }
+    }
+};
+
+#endif
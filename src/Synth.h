@@ -7,12 +7,16 @@
 #include "SynthVoice.h"
 
 #include <Audio.h>
+#include "AudioConfig.h"
+#include "AudioMixerSmoothed4.h"
 #include "effect_ensemble.h"
 
 // number of voices, mostly restricted by the amount of CPU power
 // setting this number too high might result in inaccurate MIDI timing or even crashes, especially when using high notes!
 // the maximum is 15 as four 4 channel mixers are used to mix all the voices, the last input is used for other purposes
 static const uint16_t NUM_VOICES{8};
+// number of MIDI channels
+static const uint8_t MIDI_CHANNEL_COUNT{16};
 
 /**
  * The Synth handles the polyphony of the synthesizer. It passes parameter changes to all voices, handles the LFO and mixes the voices to a single output.
@@ -35,6 +39,26 @@ private:
     // add a 1 bit DC offset to prevent a plop/tick sound whenever all voices become silent, probably due to the DAC switching to power-saving mode
     AudioSynthWaveformDc antiPlopOffset;
 
+    // MPE: voice playing the last note of each MIDI channel (VOICE_NONE if none), the voice changed by the expression of
+    // the channel, and the MIDI channel index (0 - 15) of each voice (MIDI_CHANNEL_NONE for notes not played on an MPE
+    // member channel), used to find the voice of a note off, see onMpeNoteOn()
+    static constexpr uint8_t VOICE_NONE{UINT8_MAX};
+    static constexpr uint8_t MIDI_CHANNEL_NONE{UINT8_MAX};
+    std::array<uint8_t, MIDI_CHANNEL_COUNT> mpeVoiceByChannel;
+    std::array<uint8_t, NUM_VOICES> mpeChannelByVoice;
+
+    // MPE expression per MIDI channel, kept between notes as MPE controllers send it before the note on
+    struct MpeExpression
+    {
+        // semitones
+        float pitchChange{0.0f};
+        // 0.0f - 1.0f
+        float pressure{0.0f};
+        // -1.0f - 1.0f
+        float timbre{0.0f};
+    };
+    std::array<MpeExpression, MIDI_CHANNEL_COUNT> mpeExpressions;
+
     // voice sub mixers
     std::array<AudioMixer4, 4> voiceSubMixersL;
     std::array<AudioMixer4, 4> voiceSubMixersR;
@@ -43,9 +67,9 @@ private:
     AudioConnection patchCordAntiPlopOffset0ToVoiceSubMixersL33 = AudioConnection(antiPlopOffset, 0, voiceSubMixersL[3], 3);
     AudioConnection patchCordAntiPlopOffset0ToVoiceSubMixersR33 = AudioConnection(antiPlopOffset, 0, voiceSubMixersL[3], 3);
 
-    // voice mixers
-    AudioMixer4 voiceMixerL;
-    AudioMixer4 voiceMixerR;
+    // voice mixers, smoothed for fading the voices out and in on program changes
+    AudioMixerSmoothed4 voiceMixerL;
+    AudioMixerSmoothed4 voiceMixerR;
 
 	// connect voice sub mixers to voice mixers
     AudioConnection patchCordVoiceSubMixersL0ToVoiceMixerL0 = AudioConnection(voiceSubMixersL[0], 0, voiceMixerL, 0);
@@ -66,8 +90,8 @@ private:
     AudioEffectEnsemble ensemble;
 
     // effect mixer, mixes the clean and ensemble chorus sound
-    AudioMixer4 effectMixerL;
-    AudioMixer4 effectMixerR;
+    AudioMixerSmoothed4 effectMixerL;
+    AudioMixerSmoothed4 effectMixerR;
 
     // connect the voice mixers to the effect mixers (for clean sound)
     AudioConnection patchCordVoiceMixerToEffectMixerL0 = AudioConnection(voiceMixerL, 0, effectMixerL, 0);
@@ -87,21 +111,102 @@ private:
     AudioConnection patchCordEffectMixerLToI2S1L = AudioConnection(effectMixerL, 0, i2s1, 0);
     AudioConnection patchCordEffectMixerRToI2S1R = AudioConnection(effectMixerR, 0, i2s1, 1);
 
-    // waveshaper
-    float currentWaveshapeLevel{0.0f};
-    static const uint16_t WAVESHAPE_ARRAY_SIZE{513};
-    float waveshapeArray[WAVESHAPE_ARRAY_SIZE]{0.0f};
+    // waveshaper, a single Q15 table is shared by all voices
+    // the table is double buffered: a new table is built in the inactive array and then published with a single pointer swap
+    float currentWaveshapeLevel{-1.0f};
+    static const uint16_t WAVESHAPE_ARRAY_SIZE{WaveshapeTable::SIZE};
+    std::array<std::array<int16_t, WAVESHAPE_ARRAY_SIZE>, 2> waveshapeArrays{};
+    uint8_t activeWaveshapeArrayIdx{0};
+    WaveshapeTable waveshapeTable;
 
     /**
-     * Update the waveshape array using a hyperbolic tangent function based on the current waveshape level.
+     * Build a new waveshape array using a hyperbolic tangent function based on the current waveshape level and publish it.
+     * This runs with interrupts enabled, the audio objects keep using the previous array until the new one is published.
      */
     void updateWaveshapeArray()
     {
-        for (uint16_t index = 0; index < WAVESHAPE_ARRAY_SIZE; index++)
+        uint8_t waveshapeArrayIdx = activeWaveshapeArrayIdx ^ 1;
+        auto &waveshapeArray = waveshapeArrays[waveshapeArrayIdx];
+
+        // tanh is symmetric, only calculate one half and mirror it
+        constexpr uint16_t center = WAVESHAPE_ARRAY_SIZE / 2;
+        float drive = 1.0f + currentWaveshapeLevel * 64.0f;
+        waveshapeArray[center] = 0;
+        for (uint16_t offset = 1; offset <= center; offset++)
+        {
+            float x = (float)offset / (float)center;
+            int16_t value = (int16_t)lroundf(32767.0f * 0.25f * tanhf(drive * x));
+            waveshapeArray[center + offset] = value;
+            waveshapeArray[center - offset] = -value;
+        }
+
+        waveshapeTable.publish(waveshapeArray.data());
+        activeWaveshapeArrayIdx = waveshapeArrayIdx;
+    }
+
+    /**
+     * Determine the voice to play a new note: the voice with the oldest note off, or the voice with the oldest note on if
+     * all voices are in note on state.
+     * The voice is no longer the voice of an MPE channel.
+     * 
+     * @return uint8_t voice index
+     */
+    uint8_t allocateVoice()
+    {
+        // determine the oldest voice (currently in note off state) based on the last note off timestamp
+        uint32_t oldestNoteMillis{UINT32_MAX};
+        uint16_t oldestVoice{UINT16_MAX};
+        
+        for (uint16_t voice = 0 ; voice < NUM_VOICES ; voice++)
+        {
+            SynthVoice &synthVoice = synthVoices[voice];
+            if (!synthVoice.getCurrentMidiNoteOn() && synthVoice.getLastNoteOff() < oldestNoteMillis)
+            {
+                oldestNoteMillis = synthVoice.getLastNoteOff();
+                oldestVoice = voice;
+            }
+        }
+
+        if (oldestVoice == UINT16_MAX)
+        {
+            // no voice in note off state found, determine the oldest voice based on the last note on timestamp
+            for (uint16_t voice = 0 ; voice < NUM_VOICES ; voice++)
+            {
+                SynthVoice &synthVoice = synthVoices[voice];
+                if (synthVoice.getLastNoteOn() < oldestNoteMillis)
+                {
+                    oldestNoteMillis = synthVoice.getLastNoteOff();
+                    oldestVoice = voice;
+                }
+            }
+        }
+
+        // fall back to the first voice, like reusing the oldest voice this cuts off its note
+        uint8_t voice = oldestVoice < UINT16_MAX ? oldestVoice : 0;
+
+        // Serial.print("Reusing voice ");
+        // Serial.println(voice);
+
+        uint8_t channel = mpeChannelByVoice[voice];
+        if (channel != MIDI_CHANNEL_NONE && mpeVoiceByChannel[channel] == voice)
         {
-            float x = map((float)index, 0, WAVESHAPE_ARRAY_SIZE - 1, -1.0f, 1.0f);
-            waveshapeArray[index] = 0.25f * tanh((1.0f + currentWaveshapeLevel * 64.0f) * x);
+            mpeVoiceByChannel[channel] = VOICE_NONE;
         }
+        mpeChannelByVoice[voice] = MIDI_CHANNEL_NONE;
+
+        return voice;
+    }
+
+    /**
+     * Get the voice of an MPE channel.
+     * 
+     * @param channel MIDI channel (1 - 16)
+     * @return SynthVoice* voice playing the last note of the channel, nullptr if none
+     */
+    SynthVoice *getMpeVoice(uint8_t channel)
+    {
+        uint8_t voice = mpeVoiceByChannel[(channel - 1) & 0x0F];
+        return voice != VOICE_NONE ? &synthVoices[voice] : nullptr;
     }
 
 public:
@@ -117,6 +222,9 @@ public:
         // start the lfo
         lfo.begin(1.0f, 1.0f, WAVEFORM_TRIANGLE);
 
+        mpeVoiceByChannel.fill(VOICE_NONE);
+        mpeChannelByVoice.fill(MIDI_CHANNEL_NONE);
+
         // initialize the synth voices and adjust the voice sub mixer gain according to the configured amount of voices
         uint8_t voiceIdx{0};
         float voiceGain = 1.0f / static_cast<float>(synthVoices.size());
@@ -127,7 +235,7 @@ public:
 
             uint8_t voiceSubMixerVoiceIdx = voiceIdx % 4;
 
-            synthVoice.initialize(voiceSubMixerL, voiceSubMixerVoiceIdx, voiceSubMixerR, voiceSubMixerVoiceIdx, lfo, 0);
+            synthVoice.initialize(voiceSubMixerL, voiceSubMixerVoiceIdx, voiceSubMixerR, voiceSubMixerVoiceIdx, lfo, 0, waveshapeTable);
 
             voiceSubMixerL.gain(voiceSubMixerVoiceIdx, voiceGain);
             voiceSubMixerR.gain(voiceSubMixerVoiceIdx, voiceGain);
@@ -142,65 +250,98 @@ public:
     // see SynthVoice.h
     void onNoteOn(uint8_t note, uint8_t velocity)
     {
-        // determine the oldest voice (currently in note off state) based on the last note off timestamp
-        uint32_t oldestNoteMillis{UINT32_MAX};
-        uint16_t oldestVoice{UINT16_MAX};
-        
-        for (uint16_t voice = 0 ; voice < NUM_VOICES ; voice++)
-        {
-            SynthVoice &synthVoice = synthVoices[voice];
-            if (!synthVoice.getCurrentMidiNoteOn() && synthVoice.getLastNoteOff() < oldestNoteMillis)
-            {
-                oldestNoteMillis = synthVoice.getLastNoteOff();
-                oldestVoice = voice;
-            }
-        }
-
-        if (oldestVoice < UINT16_MAX)
-        {
-            // found voices in note off state, reuse the oldest voice
-            synthVoices[oldestVoice].onNoteOn(note, velocity);
+        SynthVoice &synthVoice = synthVoices[allocateVoice()];
+        synthVoice.setMpeExpression(0.0f, 0.0f, 0.0f);
+        synthVoice.onNoteOn(note, velocity);
+    }
 
-            // Serial.print("Reusing voice with oldest note off ");
-            // Serial.println(oldestVoice);
+    /**
+     * Note on handler for MPE member channels. The note gets a voice of its own like any other note, the voice is
+     * remembered as the voice of the channel, so the expression messages of the channel only change this voice.
+     * 
+     * @param channel MIDI channel (1 - 16)
+     * @param note note
+     * @param velocity velocity
+     */
+    void onMpeNoteOn(uint8_t channel, uint8_t note, uint8_t velocity)
+    {
+        channel = (channel - 1) & 0x0F;
+        uint8_t voice = allocateVoice();
+        mpeVoiceByChannel[channel] = voice;
+        mpeChannelByVoice[voice] = channel;
 
-            return;
-        }
+        const MpeExpression &expression = mpeExpressions[channel];
+        synthVoices[voice].setMpeExpression(expression.pitchChange, expression.pressure, expression.timbre);
+        synthVoices[voice].onNoteOn(note, velocity);
+    }
 
-        // no voice in note off state found, determine the oldest voice based on the last note on timestamp
-        for (uint16_t voice = 0 ; voice < NUM_VOICES ; voice++)
+    /**
+     * Note off handler for MPE member channels. Turns off the voices of the channel playing the note, not just the voice
+     * of the last note: a controller may start a note on a channel before the previous note of the channel is released.
+     * The voice of the channel remains the voice of the channel during the release.
+     * 
+     * @param channel MIDI channel (1 - 16)
+     * @param note note
+     */
+    void onMpeNoteOff(uint8_t channel, uint8_t note)
+    {
+        channel = (channel - 1) & 0x0F;
+        for (uint8_t voice = 0; voice < NUM_VOICES; voice++)
         {
             SynthVoice &synthVoice = synthVoices[voice];
-            if (synthVoice.getLastNoteOn() < oldestNoteMillis)
+            if (mpeChannelByVoice[voice] == channel && synthVoice.getCurrentMidiNoteOn() && synthVoice.getCurrentMidiNote() == note)
             {
-                oldestNoteMillis = synthVoice.getLastNoteOff();
-                oldestVoice = voice;
+                synthVoice.onNoteOff(note);
             }
         }
+    }
 
-        if (oldestVoice < UINT16_MAX)
+    // see SynthVoice.h
+    void onNoteOff(uint8_t note)
+    {
+        for (uint8_t voice = 0; voice < NUM_VOICES; voice++)
         {
-            // reuse the oldest voice
-            synthVoices[oldestVoice].onNoteOn(note, velocity);
-
-            // Serial.print("Reusing voice with oldest note on ");
-            // Serial.println(oldestVoice);
-
-            return;
+            // find voices in note on state with the same note as the one passed to this method, notes of MPE channels are
+            // turned off by onMpeNoteOff()
+            SynthVoice &synthVoice = synthVoices[voice];
+            if (synthVoice.getCurrentMidiNoteOn() && synthVoice.getCurrentMidiNote() == note && mpeChannelByVoice[voice] == MIDI_CHANNEL_NONE)
+            {
+                synthVoice.onNoteOff(note);
+            }
         }
     }
 
-    // see SynthVoice.h
-    void onNoteOff(uint8_t note)
+    /**
+     * Check if any voice is sounding.
+     * 
+     * @return bool true if a voice is sounding
+     */
+    bool isSounding()
     {
         for (auto &synthVoice : synthVoices)
         {
-            // find voices in note on state with the same note as the one passed to this method
-            if (synthVoice.getCurrentMidiNoteOn() && synthVoice.getCurrentMidiNote() == note)
+            if (synthVoice.isSounding())
             {
-                synthVoice.onNoteOff(note);
+                return true;
             }
         }
+        return false;
+    }
+
+    /**
+     * Fade all voices out or back in. The gain ramps over TRANSITION_SPEED_MS, finished after
+     * ControlSmoother::getSettleMicros().
+     * The voice sub mixer carrying the anti plop offset is not faded (unless it also carries voices).
+     * 
+     * @param level level (0.0f = faded out, 1.0f = faded in)
+     */
+    void setVoiceFade(float level)
+    {
+        for (uint8_t channel = 0; channel <= (NUM_VOICES - 1) / 4; channel++)
+        {
+            voiceMixerL.gain(channel, level);
+            voiceMixerR.gain(channel, level);
+        }
     }
 
     // see SynthVoice.h
@@ -239,9 +380,90 @@ public:
         }
     }
 
+    /**
+     * Set the pitch change of an MPE channel, only changes the voice of the channel.
+     * 
+     * @param channel MIDI channel (1 - 16)
+     * @param value pitch change in semitones, added to the pitch bend
+     */
+    void setMpePitchChange(uint8_t channel, float value)
+    {
+        mpeExpressions[(channel - 1) & 0x0F].pitchChange = value;
+        SynthVoice *synthVoice = getMpeVoice(channel);
+        if (synthVoice != nullptr)
+        {
+            synthVoice->setMpePitchChange(value);
+        }
+    }
+
+    /**
+     * Set the pressure (channel pressure) of an MPE channel, only changes the voice of the channel.
+     * 
+     * @param channel MIDI channel (1 - 16)
+     * @param value pressure (0.0f - 1.0f), filter 1 frequency offset
+     */
+    void setMpePressure(uint8_t channel, float value)
+    {
+        mpeExpressions[(channel - 1) & 0x0F].pressure = value;
+        SynthVoice *synthVoice = getMpeVoice(channel);
+        if (synthVoice != nullptr)
+        {
+            synthVoice->setMpePressure(value);
+        }
+    }
+
+    /**
+     * Set the timbre (CC74) of an MPE channel, only changes the voice of the channel.
+     * 
+     * @param channel MIDI channel (1 - 16)
+     * @param value timbre (-1.0f - 1.0f), filter 1 frequency offset
+     */
+    void setMpeTimbre(uint8_t channel, float value)
+    {
+        mpeExpressions[(channel - 1) & 0x0F].timbre = value;
+        SynthVoice *synthVoice = getMpeVoice(channel);
+        if (synthVoice != nullptr)
+        {
+            synthVoice->setMpeTimbre(value);
+        }
+    }
+
+    /**
+     * Reset the MPE expression of all channels and voices, used when the MPE zone changes.
+     */
+    void resetMpe()
+    {
+        mpeVoiceByChannel.fill(VOICE_NONE);
+        mpeChannelByVoice.fill(MIDI_CHANNEL_NONE);
+        mpeExpressions.fill(MpeExpression{});
+        for (auto &synthVoice : synthVoices)
+        {
+            synthVoice.setMpePitchChange(0.0f);
+            synthVoice.setMpePressure(0.0f);
+            synthVoice.setMpeTimbre(0.0f);
+        }
+    }
+
     // see SynthVoice.h
     void logCpuUsageStats()
     {
+        // the maximum audio CPU usage is reset by the voice, print the latency / throughput line first
+        // one line per build, collect the lines of builds with different block sizes and sample rates to compare them
+        Serial.println();
+        Serial.print("audio engine: block size ");
+        Serial.print(AUDIO_BLOCK_SAMPLES);
+        Serial.print(", sample rate ");
+        Serial.print(AUDIO_SAMPLE_RATE, 0);
+        Serial.print("Hz, block ");
+        Serial.print(AUDIO_BLOCK_MS, 3);
+        Serial.print("ms, output latency ");
+        Serial.print(AUDIO_OUTPUT_LATENCY_MS, 3);
+        Serial.print("ms, CPU usage ");
+        Serial.print(AudioDeadline::getUsageMax());
+        Serial.print("% for ");
+        Serial.print(synthVoices.size());
+        Serial.println(" voices");
+
         synthVoices[0].logCpuUsageStats();
     }
 
@@ -429,7 +651,7 @@ public:
         auto lfoSynthWaveform = SynthVoice::getSynthWaveformByValue(value);
         if (lfoSynthWaveform.audioWaveform == WAVEFORM_ARBITRARY)
         {
-            lfo.arbitraryWaveform(lfoSynthWaveform.waveFormArray, 44100);
+            lfo.arbitraryWaveform(lfoSynthWaveform.waveFormArray, ARBITRARY_WAVEFORM_MAX_FREQ);
         }
         lfo.begin(lfoSynthWaveform.audioWaveform);
     }
@@ -595,6 +817,15 @@ public:
         }
     }
 
+    // see SynthVoice.h
+    void setOscFmOversampling(uint8_t value)
+    {
+        for (auto &synthVoice : synthVoices)
+        {
+            synthVoice.setOscFmOversampling(value);
+        }
+    }
+
     // see SynthVoice.h
     void setOscFmModPhaseEnv2(float value)
     {
@@ -616,14 +847,24 @@ public:
     // see SynthVoice.h
     void setWaveshapeLevel(float value)
     {
-        AudioNoInterrupts();
-        currentWaveshapeLevel = value;
-        updateWaveshapeArray();
+        if (value != currentWaveshapeLevel)
+        {
+            currentWaveshapeLevel = value;
+            updateWaveshapeArray();
+        }
+        for (auto &synthVoice : synthVoices)
+        {
+            synthVoice.setWaveshapeLevel(value);
+        }
+    }
+
+    // see SynthVoice.h
+    void setWaveshapeOversampling(uint8_t value)
+    {
         for (auto &synthVoice : synthVoices)
         {
-            synthVoice.setWaveshapeLevel(value, waveshapeArray, WAVESHAPE_ARRAY_SIZE);
+            synthVoice.setWaveshapeOversampling(value);
         }
-        AudioInterrupts();
     }
 
     // see SynthVoice.h
@@ -8,8 +8,20 @@
 #include "Param.h"
 #include "Patch.h"
 #include "PatchService.h"
+#include "Benchmark.h"
+#include "AudioTransaction.h"
+#include "AudioDeadline.h"
+#include "ControlSmoother.h"
+#include "MidiIngest.h"
+#include "MidiZones.h"
+#include "MidiOutputQueue.h"
+#include "MidiCapture.h"
+#include "MidiReplay.h"
+#include "PatchSysEx.h"
+#include <algorithm>
 #include <vector>
 #include <map>
+#include <type_traits>
 #include <Metro.h>
 
 /**
@@ -24,10 +36,38 @@ private:
     const static uint8_t MIDI_CC_SUSTAIN = 64;
     // MIDI control change for modulation wheel
     const static uint8_t MIDI_CC_MOD_WHL = 1;
+    // MIDI control change for the morph amount between the current patch and the morph target patch
+    const static uint8_t MIDI_CC_MORPH = 3;
+    // MIDI control changes selecting an (N)RPN and entering its 14-bit value, NRPN numbers are parameter IDs
+    const static uint8_t MIDI_CC_DATA_ENTRY_MSB = 6;
+    const static uint8_t MIDI_CC_DATA_ENTRY_LSB = 38;
+    const static uint8_t MIDI_CC_NRPN_LSB = 98;
+    const static uint8_t MIDI_CC_NRPN_MSB = 99;
+    const static uint8_t MIDI_CC_RPN_LSB = 100;
+    const static uint8_t MIDI_CC_RPN_MSB = 101;
+    // MIDI control changes 32 - 63 carry the fine value of the param using control change 0 - 31 (14-bit control change)
+    const static uint8_t MIDI_CC_LSB_FIRST = 32;
+    const static uint8_t MIDI_CC_LSB_LAST = 63;
+    // NRPN number selected when no NRPN or an RPN is selected, also used as null RPN
+    const static uint16_t MIDI_NRPN_NULL = 0x3FFF;
+    // RPNs: pitch bend sensitivity (MPE member channels only) and MPE configuration
+    const static uint16_t MIDI_RPN_PITCH_BEND_SENSITIVITY = 0;
+    const static uint16_t MIDI_RPN_MPE_CONFIGURATION = 6;
+    // MPE: master channels of the lower and upper zone, member channel pitch bend range in semitones (MPE default)
+    const static uint8_t MPE_LOWER_ZONE_MASTER_CHANNEL = 1;
+    const static uint8_t MPE_UPPER_ZONE_MASTER_CHANNEL = 16;
+    const static uint8_t MPE_PITCH_BEND_RANGE_DEFAULT = 48;
+    // MIDI control change for the MPE timbre (on member channels, on other channels it is a regular control change)
+    const static uint8_t MIDI_CC_MPE_TIMBRE = 74;
+    static_assert(isMidiCcRangeFree(MIDI_CC_DATA_ENTRY_MSB, MIDI_CC_DATA_ENTRY_MSB) && isMidiCcRangeFree(MIDI_CC_LSB_FIRST, MIDI_CC_LSB_LAST) && isMidiCcRangeFree(MIDI_CC_NRPN_LSB, MIDI_CC_RPN_MSB), "Param MIDI CC conflicts with NRPN or 14-bit control changes");
     // maximum MIDI note, used to prevent excessive CPU usage, the CPU usage of AudioSynthWaveformModulated increases as the frequency increases
     const static uint8_t MIDI_NOTE_MAX = 96;
     // highest note sent out by the MIDImix, used to separate notes and button presses on incoming controller MIDI messages
     const static uint8_t CONTROL_NOTE_MAX = 27;
+    // MIDI ingest source indexes, the USB host MIDI devices follow the external MIDI sources
+    const static uint8_t MIDI_SOURCE_EXT_USB = 0;
+    const static uint8_t MIDI_SOURCE_EXT_SERIAL = 1;
+    const static uint8_t MIDI_SOURCE_USB_HOST_FIRST = 2;
 
     // state machine, start in play state
     enum class State { play, loadSelect, saveSelect, saveName, menu };
@@ -46,31 +86,66 @@ private:
 
     // USB host MIDI devices, MIDImix and additional devices such as a keyboard (when using a USB hub)
     std::vector<MIDIDeviceBase *> * usbHostMidiDevices;
+    // USB host MIDI devices recognized as MIDImix, updated when a device connects, see updateUsbHostMidiDevices()
+    std::vector<MIDIDeviceBase *> controllerMidiDevices;
+    // USB IDs (vendor << 16 | product) of the USB host MIDI devices when their role was last set, 0 if not connected
+    std::vector<uint32_t> usbHostMidiDeviceIds;
     // external USB MIDI (DAW)
     usb_midi_class * extMidiUsb;
     // external hardware serial MIDI (DAW)
-    midi::MidiInterface<midi::SerialMIDI<HardwareSerial>> * extMidiHardwareSerial;
+    SerialMidiInterface * extMidiHardwareSerial;
+    // external MIDI output queues, the hardware serial MIDI is paced to the wire rate
+    MidiOutputQueue extMidiUsbOutput{MIDI_OUT_CHANNEL, 0};
+    MidiOutputQueue extMidiHardwareSerialOutput{MIDI_OUT_CHANNEL, MidiOutputQueue::SERIAL_MIDI_MICROS_PER_BYTE};
+    // outgoing SysEx (patch dumps and acks) per external MIDI output, see PatchSysEx.h
+    PatchSysExStream extMidiUsbSysEx;
+    PatchSysExStream extMidiHardwareSerialSysEx;
 
     // current patch
     Patch currentPatch{"Init"};
     // current patch number
     uint8_t currentPatchNumber{0};
 
+    // 14-bit param values last sent to the synth, used to only send changed values when applying a patch
+    std::array<uint16_t, PARAM_COUNT> appliedParamValues{};
+    // false until all param values have been sent to the synth at least once
+    bool appliedParamValuesValid{false};
+    // index of the next param checked by applyParamValues(), a pass over all params may take several transactions
+    uint8_t applyParamIndex{0};
+    // time spent applying param values within a single audio transaction, a quarter of an audio block, so the audio
+    // update is never postponed by a whole block (at most one param more is applied after the time is up)
+    static constexpr float APPLY_PARAMS_TRANSACTION_MICROS{AUDIO_BLOCK_MS * 1000.0f / 4.0f};
+
+    // NRPN number selected on the external MIDI, data entry changes the param with this parameter ID
+    uint16_t midiNrpnNumber{MIDI_NRPN_NULL};
+    // RPN number selected on the external MIDI, see handleMidiRpn()
+    uint16_t midiRpnNumber{MIDI_NRPN_NULL};
+
+    // MPE zone on the external MIDI, a single zone using the master channel and the next (lower zone) or previous (upper
+    // zone) member channels, no zone if mpeMemberChannelCount is 0
+    uint8_t mpeMasterChannel{MPE_LOWER_ZONE_MASTER_CHANNEL};
+    uint8_t mpeMemberChannelCount{0};
+    uint8_t mpePitchBendRange{MPE_PITCH_BEND_RANGE_DEFAULT};
+
+    // morph amount between the current patch (0) and the morph target patch (127)
+    uint8_t morphAmount{0};
+    // true if the morph amount or target changed since the morphed param values were last applied
+    bool morphChanged{false};
+    // true while a pass applying the morphed param values is in progress, one applyParamValues() chunk is applied per
+    // audio block, so morphing with many changed params doesn't take the whole main loop (see benchmarkMorph())
+    bool morphApplying{false};
+    // morphed param values are applied at most once per audio block
+    const static uint16_t MORPH_INTERVAL_MICROS{(uint16_t)(AUDIO_BLOCK_MS * 1000)};
+    elapsedMicros morphElapsedMicros;
+
+    // true if applying the current patch is staged until the voices are faded out, see applyCurrentPatch()
+    bool patchChangeStaged{false};
+    elapsedMicros patchChangeElapsedMicros;
+
     // current menu param ID
     uint8_t currentMenuParamId{0};
 
-    // parameter ID to param mappings
-    std::map<uint16_t, const Param *> paramMap;
-    // external MIDI control change to param mappings
-    std::map<uint8_t, const Param *> midiCcParamMap;
-    // controller MIDI control change to param mappings
-    std::map<uint8_t, const Param *> controllerCcParamMap;
-    // controller MIDI increment button note to param mappings
-    std::map<uint8_t, const Param *> controllerNiParamMap;
-    // controller MIDI decrement button note to param mappings
-    std::map<uint8_t, const Param *> controllerNdParamMap;
-    // menu param ID to param mappings
-    std::map<uint8_t, const Param *> menuIdParamMap;
+    // MIDI control change, note and menu param ID to param mappings are constexpr, see PARAMS_BY_* in ConstantParams.h
     
     // increment/decrement button repeat
     // delay in milliseconds
@@ -86,10 +161,19 @@ private:
     bool niNdButtonPressed{false};
     elapsedMillis elapsedMillisSinceLastNiNdButtonPress;
 
+    // instance the static MIDI handlers pass the messages on to, see MidiHandlers
+    static inline SynthController *instance{nullptr};
+
     // instances
     Synth synth;
     DisplayService displayService;
     PatchService patchService;
+    MidiIngest midiIngest;
+    // keyboard split and layer zones of the external MIDI, see MIDI_ZONES in main.cpp
+    MidiZones midiZones;
+    // MIDI capture and replay, see DEBUG_MIDI_CAPTURE and DEBUG_MIDI_REPLAY in main.cpp
+    MidiCapture midiCapture;
+    MidiReplay midiReplay;
 
     #ifdef DEBUG_CPU_USAGE
     // log CPU statistics every x milliseconds
@@ -107,6 +191,23 @@ private:
     // decrement button pressed states
     std::array<bool, 8> controlValueDecrementPressed{false};
 
+    // controller light shadow state by note, only changed lights are sent, see flushControllerLights()
+    static constexpr uint8_t LIGHT_NOT_SET{0xFF};
+    std::array<uint8_t, CONTROL_NOTE_MAX + 1> controllerLights;
+    std::array<uint8_t, CONTROL_NOTE_MAX + 1> controllerLightsSent;
+
+    /**
+     * Look up the param mapped to a control change, note or menu param ID.
+     * 
+     * @param table dispatch table
+     * @param key control change, note or menu param ID
+     * @return const Param* param, nullptr if no param is mapped
+     */
+    static const Param *dispatchParam(const ParamDispatchTable &table, uint8_t key)
+    {
+        return key < table.size() ? table[key] : nullptr;
+    }
+
     /**
      * Send a note on to the controller. Used for controlling button lights.
      * 
@@ -127,27 +228,53 @@ private:
         Serial.println();
         #endif
 
-        for (auto &usbHostMidiDevice : *usbHostMidiDevices)
+        for (auto &controllerMidiDevice : controllerMidiDevices)
+        {
+            controllerMidiDevice->sendNoteOn(note, velocity, channel, cable);
+        }
+    }
+
+    /**
+     * Set a controller button light. The light is sent by the next flushControllerLights().
+     * 
+     * @param note note of the button
+     * @param on on if true
+     */
+    void setControllerLight(uint8_t note, bool on)
+    {
+        if (note < controllerLights.size())
+        {
+            controllerLights[note] = on ? 127 : 0;
+        }
+    }
+
+    /**
+     * Send the controller button lights that changed since the last flush.
+     */
+    void flushControllerLights()
+    {
+        for (uint8_t note = 0; note < controllerLights.size(); note++)
         {
-            if (isAkaiMidiMix(usbHostMidiDevice))
+            if (controllerLights[note] != controllerLightsSent[note])
             {
-                usbHostMidiDevice->sendNoteOn(note, velocity, channel, cable);
+                sendNoteOnToController(note, controllerLights[note], 1);
+                controllerLightsSent[note] = controllerLights[note];
             }
         }
     }
 
     /**
-     * Send a control change to external MIDI (USB and hardware serial).
+     * Send a control change to external MIDI (USB and hardware serial) on MIDI_OUT_CHANNEL.
+     * The control change is queued, see MidiOutputQueue and midiTask().
      * 
      * @param control control
      * @param value value
-     * @param channel channel
      */
-    void sendControlChangeToExtMidi(uint8_t control, uint8_t value, uint8_t channel)
+    void sendControlChangeToExtMidi(uint8_t control, uint8_t value)
     {
         #ifdef DEBUG_MIDI_HANDLERS
         Serial.print("Sending Control Change to ext MIDI, ch=");
-        Serial.print(channel);
+        Serial.print(MIDI_OUT_CHANNEL);
         Serial.print(", control=");
         Serial.print(control);
         Serial.print(", value=");
@@ -155,28 +282,71 @@ private:
         Serial.println();
         #endif
 
-        extMidiUsb->sendControlChange(control, value, channel);
-        extMidiHardwareSerial->sendControlChange(control, value, channel);
+        extMidiUsbOutput.controlChange(control, value);
+        extMidiHardwareSerialOutput.controlChange(control, value);
+    }
+
+    /**
+     * Send the value of a param of the current patch to external MIDI (USB and hardware serial) on MIDI_OUT_CHANNEL.
+     * The value is sent as a control change if the param has a MIDI control change, or as an NRPN (parameter ID, 14-bit
+     * value) for all params when MIDI_OUT_NRPN is defined.
+     * 
+     * @param param param
+     */
+    void sendParamToExtMidi(const Param &param)
+    {
+        #ifdef MIDI_OUT_NRPN
+        uint16_t value14 = currentPatch.getParamValue14ByIndex(getParamIndex(param));
+        extMidiUsbOutput.nrpn(param.getParamId(), value14);
+        extMidiHardwareSerialOutput.nrpn(param.getParamId(), value14);
+        #else
+        if (param.getMidiCc() <= 127)
+        {
+            sendControlChangeToExtMidi(param.getMidiCc(), currentPatch.getParamValue(param));
+        }
+        #endif
     }
 
     /**
-     * Send a program change to external MIDI (USB and hardware serial).
+     * Send a program change to external MIDI (USB and hardware serial) on MIDI_OUT_CHANNEL.
+     * The program change is queued, see MidiOutputQueue and midiTask().
      * 
      * @param program program
-     * @param channel channel
      */
-    void sendProgramChangeToExtMidi(uint8_t program, uint8_t channel)
+    void sendProgramChangeToExtMidi(uint8_t program)
     {
         #ifdef DEBUG_MIDI_HANDLERS
         Serial.print("Sending Program Change to ext MIDI, ch=");
-        Serial.print(channel);
+        Serial.print(MIDI_OUT_CHANNEL);
         Serial.print(", program=");
         Serial.print(program);
         Serial.println();
         #endif
 
-        extMidiUsb->sendProgramChange(program, channel);
-        extMidiHardwareSerial->sendProgramChange(program, channel);
+        extMidiUsbOutput.programChange(program);
+        extMidiHardwareSerialOutput.programChange(program);
+    }
+
+    /**
+     * Send a queued message to external MIDI.
+     * 
+     * @param midi external USB or hardware serial MIDI
+     * @param type message type
+     * @param channel channel
+     * @param data1 control or program
+     * @param data2 control value
+     */
+    template <typename Midi>
+    static void sendToExtMidi(Midi &midi, MidiEventType type, uint8_t channel, uint8_t data1, uint8_t data2)
+    {
+        if (type == MidiEventType::programChange)
+        {
+            midi.sendProgramChange(data1, channel);
+        }
+        else
+        {
+            midi.sendControlChange(data1, data2, channel);
+        }
     }
 
     /**
@@ -209,7 +379,129 @@ private:
     }
 
     /**
-     * Update the display and apply the current patch, sending all parameter values stored in the patch to the synth.
+     * Send a param value to the synth and keep track of the applied value.
+     * 
+     * @param param param
+     * @param value14 14-bit value (value << 7 | fine value)
+     */
+    void updateSynthParam(const Param &param, uint16_t value14)
+    {
+        param.updateSynth(synth, ParamValue::fromValue14(value14));
+        appliedParamValues[getParamIndex(param)] = value14;
+    }
+
+    /**
+     * Get the morph target patch selected in the current patch.
+     * 
+     * @return const Patch& morph target patch
+     */
+    const Patch &getMorphTargetPatch() const
+    {
+        return patchService.loadPatch(getMorphTargetPatchNumber(currentPatch.getParamValueByIndex(getParamIndexById(PARAM_ID_MORPH_TARGET))));
+    }
+
+    /**
+     * Get the value of a param, morphed between the current patch and the morph target patch.
+     * Continuous params are interpolated, discrete params switch to the morph target value halfway.
+     * 
+     * @param index param index
+     * @param targetPatch morph target patch
+     * @return uint16_t morphed 14-bit value (value << 7 | fine value)
+     */
+    uint16_t getMorphedParamValue(uint8_t index, const Patch &targetPatch) const
+    {
+        uint16_t value = currentPatch.getParamValue14ByIndex(index);
+        if (morphAmount == 0)
+        {
+            return value;
+        }
+
+        uint16_t targetValue = targetPatch.getParamValue14ByIndex(index);
+        if (PARAMS[index].isDiscrete())
+        {
+            return morphAmount < 64 ? value : targetValue;
+        }
+
+        return value + ((int32_t)targetValue - value) * morphAmount / 127;
+    }
+
+    /**
+     * Send the (morphed) value of a param of the current patch to the synth.
+     * 
+     * @param param param
+     */
+    void applyParam(const Param &param)
+    {
+        if (param.getParamId() == PARAM_ID_MORPH_TARGET)
+        {
+            morphChanged = true;
+        }
+
+        // all param values are applied once the staged patch change completes
+        if (patchChangeStaged)
+        {
+            return;
+        }
+
+        updateSynthParam(param, getMorphedParamValue(getParamIndex(param), getMorphTargetPatch()));
+    }
+
+    /**
+     * Send the next (morphed) param values of the current patch to the synth, within a single audio transaction.
+     * Only the param values that differ from the values applied before are sent to the synth, all param values are sent
+     * the first time. Continues with the param after the last one applied, until APPLY_PARAMS_TRANSACTION_MICROS have
+     * passed or all params have been checked, so a large patch difference (waveform changes update all voices) doesn't
+     * postpone the audio update by a whole block.
+     * 
+     * @return bool true if the pass over all params is complete, false if params are left for the next call
+     */
+    bool applyParamValues()
+    {
+        const Patch &targetPatch = getMorphTargetPatch();
+        const uint32_t maxCycles = APPLY_PARAMS_TRANSACTION_MICROS * (F_CPU_ACTUAL / 1000000);
+        const uint32_t startCycles = ARM_DWT_CYCCNT;
+
+        AudioTransaction::begin();
+        while (applyParamIndex < PARAM_COUNT && ARM_DWT_CYCCNT - startCycles < maxCycles)
+        {
+            uint16_t value = getMorphedParamValue(applyParamIndex, targetPatch);
+            if (!appliedParamValuesValid || value != appliedParamValues[applyParamIndex])
+            {
+                updateSynthParam(PARAMS[applyParamIndex], value);
+            }
+            applyParamIndex++;
+        }
+        AudioTransaction::end();
+
+        if (applyParamIndex < PARAM_COUNT)
+        {
+            return false;
+        }
+
+        applyParamIndex = 0;
+        appliedParamValuesValid = true;
+        return true;
+    }
+
+    /**
+     * Send all (morphed) param values of the current patch that changed to the synth, starting a new pass over all params.
+     * The changes are applied in several audio transactions if needed, see applyParamValues(), the audio update runs in
+     * between.
+     */
+    void applyAllParamValues()
+    {
+        applyParamIndex = 0;
+        morphApplying = false;
+        while (!applyParamValues())
+        {
+        }
+    }
+
+    /**
+     * Update the display and apply the current patch, morphed towards its morph target patch using the current morph
+     * amount.
+     * When voices are sounding, applying the param values is staged to prevent clicks: the voices are faded out first,
+     * task() applies the param values at an audio block boundary and fades the voices back in.
      */
     void applyCurrentPatch()
     {
@@ -219,53 +511,239 @@ private:
         displayService.displayPatchName(currentPatch);
         displayService.clearParamNameAndValue();
 
-        for (const auto [paramId, paramValue] : currentPatch.paramValueMap)
+        if (patchChangeStaged)
         {
-            if (!paramMap.count(paramId))
-            {
-                Serial.printf("Warning: patch contains missing param with paramId %d\n", paramId);
-                Serial.printf("Warning: deleting param value with paramId %d\n", paramId);
-                currentPatch.deleteParamValue(paramId);
-            }
-            else
-            {
-                paramMap.at(paramId)->updateSynth(synth, paramValue);
-            }
+            // a patch change is already staged, the latest current patch is applied when it completes
+            return;
+        }
+
+        if (appliedParamValuesValid && synth.isSounding())
+        {
+            synth.setVoiceFade(0.0f);
+            patchChangeElapsedMicros = 0;
+            patchChangeStaged = true;
+            return;
+        }
+
+        applyAllParamValues();
+    }
+
+    /**
+     * Complete a staged patch change when the voices are faded out, see applyCurrentPatch().
+     */
+    void patchChangeTask()
+    {
+        // the voice fade is a smoothed mixer gain
+        if (!patchChangeStaged || patchChangeElapsedMicros < ControlSmoother::getSettleMicros())
+        {
+            return;
         }
+
+        // the voices are silent while the param values are applied, the fade in starts when all of them are applied
+        applyAllParamValues();
+        synth.setVoiceFade(1.0f);
+
+        patchChangeStaged = false;
+        morphChanged = false;
     }
 
     /**
      * Handle control changes coming from the external MIDI.
      * 
+     * @param channel channel
      * @param control control change
      * @param value value
      * @return bool true if the control change was processed (valid parameter)
      */
-    bool handleMidiCc(uint8_t control, uint8_t value)
+    bool handleMidiCc(uint8_t channel, uint8_t control, uint8_t value)
     {
-        if (midiCcParamMap.count(control))
+        if (handleMidiNrpnCc(channel, control, value))
         {
-            auto param = midiCcParamMap.at(control);
+            return true;
+        }
 
-            // do not process if the value is equal to the current value
-            if (value != currentPatch.getParamValue(param->getParamId()))
+        // fine value of a 14-bit control change, sent after the value
+        if (control >= MIDI_CC_LSB_FIRST && control <= MIDI_CC_LSB_LAST)
+        {
+            auto param = dispatchParam(PARAMS_BY_MIDI_CC, control - MIDI_CC_LSB_FIRST);
+            if (param != nullptr)
             {
-                // update the current patch
-                value = currentPatch.setParamValue(param->getParamId(), value, param->getMaxValue());
-
-                // update the synth
-                param->updateSynth(synth, value);
-
-                // update the display
-                // displayService.displayParamNameAndValue(*param, value);
+                setMidiParamFineValue(*param, value);
+                return true;
             }
+            return false;
+        }
 
+        auto param = dispatchParam(PARAMS_BY_MIDI_CC, control);
+        if (param != nullptr)
+        {
+            setMidiParamValue(*param, value);
             return true;
         }
 
         return false;
     }
 
+    /**
+     * Handle the (N)RPN control changes coming from the external MIDI: NRPN or RPN select and data entry.
+     * Selecting an NRPN deselects the RPN and the other way around.
+     * 
+     * @param channel channel
+     * @param control control change
+     * @param value value
+     * @return bool true if the control change is an (N)RPN control change
+     */
+    bool handleMidiNrpnCc(uint8_t channel, uint8_t control, uint8_t value)
+    {
+        switch (control)
+        {
+        case MIDI_CC_NRPN_MSB:
+            midiNrpnNumber = (value << 7) | (midiNrpnNumber & 0x7F);
+            midiRpnNumber = MIDI_NRPN_NULL;
+            return true;
+
+        case MIDI_CC_NRPN_LSB:
+            midiNrpnNumber = (midiNrpnNumber & 0x3F80) | value;
+            midiRpnNumber = MIDI_NRPN_NULL;
+            return true;
+
+        case MIDI_CC_RPN_MSB:
+            midiRpnNumber = (value << 7) | (midiRpnNumber & 0x7F);
+            midiNrpnNumber = MIDI_NRPN_NULL;
+            return true;
+
+        case MIDI_CC_RPN_LSB:
+            midiRpnNumber = (midiRpnNumber & 0x3F80) | value;
+            midiNrpnNumber = MIDI_NRPN_NULL;
+            return true;
+
+        case MIDI_CC_DATA_ENTRY_MSB:
+        case MIDI_CC_DATA_ENTRY_LSB:
+            {
+                if (midiRpnNumber != MIDI_NRPN_NULL)
+                {
+                    if (control == MIDI_CC_DATA_ENTRY_MSB)
+                    {
+                        handleMidiRpn(channel, midiRpnNumber, value);
+                    }
+                    return true;
+                }
+
+                uint8_t index = getParamIndexById(midiNrpnNumber);
+                if (index != PARAM_INDEX_NONE)
+                {
+                    if (control == MIDI_CC_DATA_ENTRY_MSB)
+                    {
+                        setMidiParamValue(PARAMS[index], value);
+                    }
+                    else
+                    {
+                        setMidiParamFineValue(PARAMS[index], value);
+                    }
+                }
+                return true;
+            }
+
+        default:
+            return false;
+        }
+    }
+
+    /**
+     * Handle the data entry of an RPN coming from the external MIDI, only the MPE RPNs are supported.
+     * 
+     * @param channel channel
+     * @param rpn RPN number
+     * @param value data entry MSB
+     */
+    void handleMidiRpn(uint8_t channel, uint16_t rpn, uint8_t value)
+    {
+        // MPE configuration message on a master channel, the value is the number of member channels (0 = no zone)
+        if (rpn == MIDI_RPN_MPE_CONFIGURATION && (channel == MPE_LOWER_ZONE_MASTER_CHANNEL || channel == MPE_UPPER_ZONE_MASTER_CHANNEL))
+        {
+            setMpeZone(channel, value);
+        }
+        // pitch bend range of the member channels, the pitch bend range of the master channel is a param
+        else if (rpn == MIDI_RPN_PITCH_BEND_SENSITIVITY && isMpeMemberChannel(channel))
+        {
+            mpePitchBendRange = value;
+        }
+    }
+
+    /**
+     * Set the MPE zone, resets the MPE expression of all voices.
+     * 
+     * @param masterChannel master channel (MPE_LOWER_ZONE_MASTER_CHANNEL or MPE_UPPER_ZONE_MASTER_CHANNEL)
+     * @param memberChannelCount number of member channels (0 = no zone), limited to 15
+     */
+    void setMpeZone(uint8_t masterChannel, uint8_t memberChannelCount)
+    {
+        // disabling the other zone doesn't change the current zone
+        if (memberChannelCount == 0 && masterChannel != mpeMasterChannel)
+        {
+            return;
+        }
+
+        mpeMasterChannel = masterChannel;
+        mpeMemberChannelCount = std::min(memberChannelCount, (uint8_t)(MIDI_CHANNEL_COUNT - 1));
+        mpePitchBendRange = MPE_PITCH_BEND_RANGE_DEFAULT;
+        synth.resetMpe();
+
+        Serial.printf("MPE %s zone, %d member channels\n", masterChannel == MPE_LOWER_ZONE_MASTER_CHANNEL ? "lower" : "upper", mpeMemberChannelCount);
+    }
+
+    /**
+     * Check if a channel of the external MIDI is an MPE member channel.
+     * 
+     * @param channel channel
+     * @return bool true if the channel is a member channel of the MPE zone
+     */
+    bool isMpeMemberChannel(uint8_t channel) const
+    {
+        if (mpeMasterChannel == MPE_LOWER_ZONE_MASTER_CHANNEL)
+        {
+            return channel > mpeMasterChannel && channel <= mpeMasterChannel + mpeMemberChannelCount;
+        }
+        return channel < mpeMasterChannel && channel + mpeMemberChannelCount >= mpeMasterChannel;
+    }
+
+    /**
+     * Set a param value received from the external MIDI, the fine value is reset to 0.
+     * 
+     * @param param param
+     * @param value value
+     */
+    void setMidiParamValue(const Param &param, uint8_t value)
+    {
+        // do not process if the value is equal to the current value
+        if (value != currentPatch.getParamValue(param) || currentPatch.getParamFineValueByIndex(getParamIndex(param)) != 0)
+        {
+            // update the current patch
+            value = currentPatch.setParamValue(param, value);
+
+            // update the synth
+            applyParam(param);
+
+            // update the display
+            // displayService.displayParamNameAndValue(param, value);
+        }
+    }
+
+    /**
+     * Set a fine param value received from the external MIDI (14-bit control change or NRPN data entry).
+     * 
+     * @param param param
+     * @param fineValue fine value
+     */
+    void setMidiParamFineValue(const Param &param, uint8_t fineValue)
+    {
+        if (fineValue != currentPatch.getParamFineValueByIndex(getParamIndex(param)))
+        {
+            currentPatch.setParamFineValue(param, fineValue);
+            applyParam(param);
+        }
+    }
+
     /**
      * Handle control changes coming from the controller MIDI.
      * 
@@ -284,51 +762,45 @@ private:
         // handle master slider for menu params
         if (state == State::menu && control == MIDIMIX_MASTER_SLIDER_CC)
         {
-            if (menuIdParamMap.count(currentMenuParamId))
+            auto param = dispatchParam(PARAMS_BY_MENU_ID, currentMenuParamId);
+            if (param != nullptr)
             {
-                auto param = menuIdParamMap.at(currentMenuParamId);
 
                 // update the current patch
-                value = currentPatch.setParamValue(param->getParamId(), value, param->getMaxValue());
+                value = currentPatch.setParamValue(*param, value);
 
                 // update the synth
-                param->updateSynth(synth, value);
+                applyParam(*param);
 
                 // update the display
                 displayService.displayParamNameAndValue(*param, value);
 
-                // send a control change to the external MIDI, if a MIDI control change is configured
-                if (param->getMidiCc() <= 127)
-                {
-                    sendControlChangeToExtMidi(param->getMidiCc(), value, MIDI_OUT_CHANNEL);
-                }
+                // send the value to the external MIDI
+                sendParamToExtMidi(*param);
             }
 
             return true;
         }
 
         // handle control params
-        if (controllerCcParamMap.count(control))
+        auto param = dispatchParam(PARAMS_BY_CONTROLLER_CC, control);
+        if (param != nullptr)
         {
-            auto param = controllerCcParamMap.at(control);
 
             // do not process if the value is equal to the current value
-            if (value != currentPatch.getParamValue(param->getParamId()))
+            if (value != currentPatch.getParamValue(*param))
             {
                 // update the current patch
-                value = currentPatch.setParamValue(param->getParamId(), value, param->getMaxValue());
+                value = currentPatch.setParamValue(*param, value);
 
                 // update the synth
-                param->updateSynth(synth, value);
+                applyParam(*param);
 
                 // update the display
                 displayService.displayParamNameAndValue(*param, value);
 
-                // send a control change to the external MIDI, if a MIDI control change is configured
-                if (param->getMidiCc() <= 127)
-                {
-                    sendControlChangeToExtMidi(param->getMidiCc(), value, MIDI_OUT_CHANNEL);
-                }
+                // send the value to the external MIDI
+                sendParamToExtMidi(*param);
             }
 
             return true;
@@ -346,9 +818,9 @@ private:
     bool handleControllerNoteOn(uint8_t note)
     {
         // check if all decrement buttons are pressed at the same time, if yes, then delete all patches
-        if (CONTROL_ND_VALUE_MAP.count(note))
+        if (getControlNdValue(note))
         {
-            controlValueDecrementPressed[CONTROL_ND_VALUE_MAP.at(note) - 1] = true;
+            controlValueDecrementPressed[getControlNdValue(note) - 1] = true;
 
             bool allControlValueDecrementPressed = true;
             for (auto pressed : controlValueDecrementPressed)
@@ -374,7 +846,7 @@ private:
         }
 
         // keep track of increment and decrement button presses for button repeat purposes
-        if (CONTROL_NI_VALUE_MAP.count(note) || CONTROL_ND_VALUE_MAP.count(note))
+        if (getControlNiValue(note) || getControlNdValue(note))
         {
             if (!niNdButtonPressed)
             {
@@ -395,20 +867,20 @@ private:
             }
 
             // increment and decrement buttons select the two digits of the menu param
-            if (CONTROL_NI_VALUE_MAP.count(note))
+            if (getControlNiValue(note))
             {
                 // note increment buttons access menu params 0 - 7
-                currentMenuParamId = CONTROL_NI_VALUE_MAP.at(note) - 1;
+                currentMenuParamId = getControlNiValue(note) - 1;
 
                 // select the menu param
                 onMenuParamSelect();
 
                 return true;
             }
-            if (CONTROL_ND_VALUE_MAP.count(note))
+            if (getControlNdValue(note))
             {
                 // note increment buttons access menu params 8 - 15
-                currentMenuParamId = CONTROL_ND_VALUE_MAP.at(note) + 7;
+                currentMenuParamId = getControlNdValue(note) + 7;
 
                 // select the menu param
                 onMenuParamSelect();
@@ -428,9 +900,9 @@ private:
             }
 
             // increment and decrement buttons select the two digits of the patch
-            if (CONTROL_NI_VALUE_MAP.count(note))
+            if (getControlNiValue(note))
             {
-                onPatchSelectDigit1(CONTROL_NI_VALUE_MAP.at(note));
+                onPatchSelectDigit1(getControlNiValue(note));
 
                 if (patchSelectDigit1 > 0 && patchSelectDigit2 > 0)
                 {
@@ -440,9 +912,9 @@ private:
 
                 return true;
             }
-            if (CONTROL_ND_VALUE_MAP.count(note))
+            if (getControlNdValue(note))
             {
-                onPatchSelectDigit2(CONTROL_ND_VALUE_MAP.at(note));
+                onPatchSelectDigit2(getControlNdValue(note));
 
                 if (patchSelectDigit1 > 0 && patchSelectDigit2 > 0)
                 {
@@ -472,15 +944,15 @@ private:
             }
 
             // increment and decrement buttons select the two digits of the patch
-            if (CONTROL_NI_VALUE_MAP.count(note))
+            if (getControlNiValue(note))
             {
-                onPatchSelectDigit1(CONTROL_NI_VALUE_MAP.at(note));
+                onPatchSelectDigit1(getControlNiValue(note));
                 displayService.displayPatchNumber(convertPatchDigitsToNumber(patchSelectDigit1, patchSelectDigit2));
                 return true;
             }
-            if (CONTROL_ND_VALUE_MAP.count(note))
+            if (getControlNdValue(note))
             {
-                onPatchSelectDigit2(CONTROL_ND_VALUE_MAP.at(note));
+                onPatchSelectDigit2(getControlNdValue(note));
                 displayService.displayPatchNumber(convertPatchDigitsToNumber(patchSelectDigit1, patchSelectDigit2));
                 return true;
             }
@@ -500,17 +972,17 @@ private:
             }
 
             // pressing the increment buttons increments the letter at that position
-            if (CONTROL_NI_VALUE_MAP.count(note))
+            if (getControlNiValue(note))
             {
-                currentPatch.incrementNameLetter(CONTROL_NI_VALUE_MAP.at(note) - 1);
+                currentPatch.incrementNameLetter(getControlNiValue(note) - 1);
                 displayService.displayPatchName(currentPatch);
 
                 return true;
             }
             // pressing the decrement buttons decrements the letter at that position
-            if (CONTROL_ND_VALUE_MAP.count(note))
+            if (getControlNdValue(note))
             {
-                currentPatch.decrementNameLetter(CONTROL_ND_VALUE_MAP.at(note) - 1);
+                currentPatch.decrementNameLetter(getControlNdValue(note) - 1);
                 displayService.displayPatchName(currentPatch);
 
                 return true;
@@ -554,35 +1026,28 @@ private:
         }
 
         // check if an increment or decrement button was pressed
-        int8_t incrementValue = 0;
-        if (controllerNiParamMap.count(note))
-        {
-            incrementValue = 1;
-        }
-        else if (controllerNdParamMap.count(note))
+        int8_t incrementValue = 1;
+        auto param = dispatchParam(PARAMS_BY_CONTROLLER_NI, note);
+        if (param == nullptr)
         {
             incrementValue = -1;
+            param = dispatchParam(PARAMS_BY_CONTROLLER_ND, note);
         }
 
-        if (incrementValue != 0)
+        if (param != nullptr)
         {
-            // fetch the param
-            auto param = incrementValue > 0 ? controllerNiParamMap.at(note) : controllerNdParamMap.at(note);
 
             // update the current patch
-            uint8_t value = currentPatch.incrementParamValue(param->getParamId(), incrementValue, param->getMaxValue());
+            uint8_t value = currentPatch.incrementParamValue(*param, incrementValue);
 
             // update the synth
-            param->updateSynth(synth, value);
+            applyParam(*param);
 
             // update the display
             displayService.displayParamNameAndValue(*param, value);
 
-            // send a control change to the external MIDI, if a MIDI control change is configured
-            if (param->getMidiCc() <= 127)
-            {
-                sendControlChangeToExtMidi(param->getMidiCc(), value, MIDI_OUT_CHANNEL);
-            }
+            // send the value to the external MIDI
+            sendParamToExtMidi(*param);
 
             return true;
         }
@@ -599,13 +1064,13 @@ private:
     bool handleControllerNoteOff(uint8_t note)
     {
         // keep track of pressed decrement buttons
-        if (CONTROL_ND_VALUE_MAP.count(note))
+        if (getControlNdValue(note))
         {
-            controlValueDecrementPressed[CONTROL_ND_VALUE_MAP.at(note) - 1] = false;
+            controlValueDecrementPressed[getControlNdValue(note) - 1] = false;
         }
 
         // keep track of increment and decrement button releases for button repeat purposes
-        if (CONTROL_NI_VALUE_MAP.count(note) || CONTROL_ND_VALUE_MAP.count(note))
+        if (getControlNiValue(note) || getControlNdValue(note))
         {
             niNdButtonPressed = false;
         }
@@ -622,7 +1087,7 @@ private:
      */
     void setControlStateLightLoad(bool on)
     {
-        sendNoteOnToController(CONTROL_NT_LOAD, on ? 127 : 0, 1);
+        setControllerLight(CONTROL_NT_LOAD, on);
         controlStateLightLoadWasOn = on;
     }
 
@@ -635,7 +1100,7 @@ private:
      */
     void setControlStateLightSave(bool on)
     {
-        sendNoteOnToController(CONTROL_NT_SAVE, on ? 127 : 0, 1);
+        setControllerLight(CONTROL_NT_SAVE, on);
         controlStateLightSaveWasOn = on;
     }
 
@@ -687,9 +1152,9 @@ private:
      */
     void setControlValueLightDigit1(uint8_t value, bool on)
     {
-        if (CONTROL_VALUE_NI_MAP.count(value))
+        if (value >= 1 && value <= CONTROL_NI_VALUE_NOTES.size())
         {
-            sendNoteOnToController(CONTROL_VALUE_NI_MAP.at(value), on ? 127 : 0, 1);
+            setControllerLight(CONTROL_NI_VALUE_NOTES[value - 1], on);
         }
     }
 
@@ -701,9 +1166,9 @@ private:
      */
     void setControlValueLightDigit2(uint8_t value, bool on)
     {
-        if (CONTROL_VALUE_ND_MAP.count(value))
+        if (value >= 1 && value <= CONTROL_ND_VALUE_NOTES.size())
         {
-            sendNoteOnToController(CONTROL_VALUE_ND_MAP.at(value), on ? 127 : 0, 1);
+            setControllerLight(CONTROL_ND_VALUE_NOTES[value - 1], on);
         }
     }
 
@@ -899,7 +1364,7 @@ private:
         applyCurrentPatch();
 
         // send a program change to external MIDI
-        sendProgramChangeToExtMidi(currentPatchNumber, MIDI_OUT_CHANNEL);
+        sendProgramChangeToExtMidi(currentPatchNumber);
     }
 
     /**
@@ -913,10 +1378,17 @@ private:
         Serial.print(currentPatchNumber);
         Serial.println();
 
-        patchService.savePatch(currentPatchNumber, currentPatch);
+        // the patch is written by the storage worker, report errors when it's done
+        patchService.savePatch(currentPatchNumber, currentPatch, [this](uint8_t patchNumber, const Patch &patch, bool success)
+        {
+            if (!success)
+            {
+                displayService.displayError("Failed to save patch");
+            }
+        });
 
         // send a program change to external MIDI
-        sendProgramChangeToExtMidi(currentPatchNumber, MIDI_OUT_CHANNEL);
+        sendProgramChangeToExtMidi(currentPatchNumber);
 
         displayService.clearPatchNameEditNumbers();
     }
@@ -943,44 +1415,356 @@ private:
         Serial.print(currentMenuParamId);
         Serial.println();
 
-        if (menuIdParamMap.count(currentMenuParamId))
+        auto param = dispatchParam(PARAMS_BY_MENU_ID, currentMenuParamId);
+        if (param != nullptr)
         {
-            auto param = menuIdParamMap.at(currentMenuParamId);
 
             // display the param name and current value
-            displayService.displayParamNameAndValue(*param, currentPatch.getParamValue(param->getParamId()));
+            displayService.displayParamNameAndValue(*param, currentPatch.getParamValue(*param));
         }
     }
 
     /**
-     * MIDI note on handler.
+     * Queue a MIDI message read by one of the registered MIDI handlers, see midiTask().
+     * Messages on channels filtered out for the source and external notes outside the keyboard zones are dropped here,
+     * before they are queued (see MidiIngest::accept() and MidiZones).
      * 
+     * @param source MIDI ingest source index
+     * @param type message type
      * @param channel channel
-     * @param note note
-     * @param velocity velocity
+     * @param data1 note, control, program or pressure
+     * @param data2 velocity, control value or pitch
      * @param controller true if message came from controller MIDI, false if message came from external MIDI
      */
-    void onNoteOn(uint8_t channel, uint8_t note, uint8_t velocity, bool controller)
+    void ingestMidi(uint8_t source, MidiEventType type, uint8_t channel, uint8_t data1, int data2, bool controller)
     {
-        #ifdef DEBUG_MIDI_HANDLERS
-        Serial.print("Note On, ch=");
-        Serial.print(channel);
-        Serial.print(", note=");
-        Serial.print(note);
-        Serial.print(", velocity=");
-        Serial.print(velocity);
-        Serial.print(", controller=");
-        Serial.print(controller);
-        Serial.println();
-        #endif
+        static_assert(MidiZones::ZONE_COUNT_MAX <= MidiIngest::PUSH_COUNT_MAX, "MidiIngest::PUSH_COUNT_MAX too small for the keyboard zones");
 
-        // handle the note on as a musical note if it did not originate from controller MIDI or was not handled by the controller logic
-        if (!controller || !handleControllerNoteOn(note))
+        // the capture holds the messages before filtering, the filters are applied again when replaying
+        if (!midiReplay.isActive())
         {
-            // limit the highest note, CPU usage of OSC1 increases as the note frequency increases
-            if (note <= MIDI_NOTE_MAX)
-            {
-                synth.onNoteOn(note, velocity);
+            midiCapture.record(MidiEvent{micros(), source, type, channel, data1, (int16_t)data2, controller});
+        }
+
+        if (!midiIngest.accept(source, channel))
+        {
+            return;
+        }
+
+        MidiPriority priority{MidiPriority::controlChange};
+        if (type == MidiEventType::noteOn || type == MidiEventType::noteOff)
+        {
+            // controller notes are MIDImix buttons
+            priority = controller ? MidiPriority::controller : MidiPriority::note;
+        }
+        else if (!controller && (type != MidiEventType::controlChange || data1 == MIDI_CC_SUSTAIN || isMpeMemberChannel(channel)))
+        {
+            // program changes, pitch bend, pressure, sustain and MPE expression are sent right before and during the notes
+            // of the channel, keep them in order with the notes (e.g. a note off after a sustain on is held by the pedal)
+            priority = MidiPriority::note;
+        }
+
+        // external notes are played once per keyboard zone containing them, MPE notes are played as they are
+        if (!controller && (type == MidiEventType::noteOn || type == MidiEventType::noteOff) && !isMpeMemberChannel(channel))
+        {
+            uint8_t played = midiZones.map(channel, data1, [this, source, priority, type, channel, data2](uint8_t note)
+            {
+                midiIngest.push(source, priority, type, channel, note, data2, false);
+            });
+            if (played == 0)
+            {
+                midiIngest.filter(source);
+            }
+            return;
+        }
+
+        midiIngest.push(source, priority, type, channel, data1, data2, controller);
+    }
+
+    /**
+     * SysEx handler for the external MIDI: patch and bank dump requests and patch dumps, see PatchSysEx.h.
+     * Handled directly instead of queued, the replies are streamed by midiTask().
+     * 
+     * @param data message, including F0 and F7
+     * @param size message size
+     * @param sysExStream outgoing SysEx of the MIDI output belonging to the input the message came from
+     */
+    void onSysEx(const uint8_t *data, uint16_t size, PatchSysExStream &sysExStream)
+    {
+        switch (PatchSysEx::getCommand(data, size))
+        {
+        case PatchSysEx::COMMAND_PATCH_REQUEST:
+            if (PatchSysEx::getPatchNumber(data, size) < PATCH_COUNT)
+            {
+                sysExStream.dump(PatchSysEx::getPatchNumber(data, size), 1);
+            }
+            break;
+
+        case PatchSysEx::COMMAND_BANK_REQUEST:
+            sysExStream.dump(0, PATCH_COUNT);
+            break;
+
+        case PatchSysEx::COMMAND_PATCH_DUMP:
+            {
+                uint8_t patchNumber;
+                Patch patch;
+                if (!PatchSysEx::readPatchDump(data, size, patchNumber, patch))
+                {
+                    Serial.println("Error loading SysEx patch dump, invalid message");
+                    sysExStream.ack(PatchSysEx::getPatchNumber(data, size), false);
+                    break;
+                }
+
+                // the ack is sent when the patch has been written, the current patch is not changed
+                bool queued = patchService.savePatch(patchNumber, patch, [&sysExStream](uint8_t patchNumber, [[maybe_unused]] const Patch &patch, bool success)
+                {
+                    sysExStream.ack(patchNumber, success);
+                });
+                if (!queued)
+                {
+                    sysExStream.ack(patchNumber, false);
+                }
+            }
+            break;
+
+        default:
+            break;
+        }
+    }
+
+    /**
+     * Static MIDI handlers of a MIDI source, registered as plain function pointers on the MIDI libraries.
+     * Each source gets its own instantiation, so the source index and the controller flag are compile time constants and
+     * a message costs a direct call into the instance, without the captured lambda lookup of fnptr.
+     * 
+     * @tparam Source MIDI ingest source index
+     * @tparam Controller true for the controller MIDI (MIDImix), false for external MIDI
+     */
+    template <uint8_t Source, bool Controller>
+    struct MidiHandlers
+    {
+        static void noteOn(uint8_t channel, uint8_t note, uint8_t velocity)
+        {
+            instance->ingestMidi(Source, MidiEventType::noteOn, channel, note, velocity, Controller);
+        }
+
+        static void noteOff(uint8_t channel, uint8_t note, [[maybe_unused]] uint8_t velocity)
+        {
+            instance->ingestMidi(Source, MidiEventType::noteOff, channel, note, 0, Controller);
+        }
+
+        static void controlChange(uint8_t channel, uint8_t control, uint8_t value)
+        {
+            instance->ingestMidi(Source, MidiEventType::controlChange, channel, control, value, Controller);
+        }
+
+        static void pitchChange(uint8_t channel, int pitch)
+        {
+            instance->ingestMidi(Source, MidiEventType::pitchChange, channel, 0, pitch, Controller);
+        }
+
+        static void programChange(uint8_t channel, uint8_t program)
+        {
+            instance->ingestMidi(Source, MidiEventType::programChange, channel, program, 0, Controller);
+        }
+
+        static void channelPressure(uint8_t channel, uint8_t pressure)
+        {
+            instance->ingestMidi(Source, MidiEventType::channelPressure, channel, pressure, 0, Controller);
+        }
+
+        // external MIDI only, the replies go to the output belonging to the source
+        static void systemExclusive(uint8_t *data, unsigned int size)
+        {
+            static_assert(Source == MIDI_SOURCE_EXT_USB || Source == MIDI_SOURCE_EXT_SERIAL, "SysEx is handled for the external MIDI only");
+            instance->onSysEx(data, size, Source == MIDI_SOURCE_EXT_USB ? instance->extMidiUsbSysEx : instance->extMidiHardwareSerialSysEx);
+        }
+    };
+
+    /**
+     * Register the note, control change, pitch change, program change and channel pressure handlers of a MIDI source.
+     * 
+     * @tparam Source MIDI ingest source index
+     * @tparam Controller true for the controller MIDI (MIDImix), false for external MIDI
+     * @param device MIDI device (USB host MIDI device, USB MIDI or serial MIDI interface)
+     */
+    template <uint8_t Source, bool Controller, typename Device>
+    static void setMidiHandlers(Device &device)
+    {
+        using Handlers = MidiHandlers<Source, Controller>;
+        device.setHandleNoteOn(Handlers::noteOn);
+        device.setHandleNoteOff(Handlers::noteOff);
+        device.setHandleControlChange(Handlers::controlChange);
+        // the MIDI library calls it pitch bend
+        if constexpr (std::is_same_v<Device, SerialMidiInterface>)
+        {
+            device.setHandlePitchBend(Handlers::pitchChange);
+        }
+        else
+        {
+            device.setHandlePitchChange(Handlers::pitchChange);
+        }
+        device.setHandleProgramChange(Handlers::programChange);
+        device.setHandleAfterTouchChannel(Handlers::channelPressure);
+    }
+
+    /**
+     * Register the MIDI handlers of a USB host MIDI device, selecting the handlers instantiated for its source index.
+     * 
+     * @tparam Source first source index to check, sources before MIDI_SOURCE_USB_HOST_FIRST are external MIDI
+     * @param device USB host MIDI device
+     * @param source MIDI ingest source index
+     * @param controller true if the device is a MIDImix
+     */
+    template <uint8_t Source = MIDI_SOURCE_USB_HOST_FIRST>
+    static void setUsbHostMidiHandlers(MIDIDeviceBase &device, uint8_t source, bool controller)
+    {
+        if constexpr (Source < MidiIngest::SOURCE_COUNT_MAX)
+        {
+            if (source != Source)
+            {
+                setUsbHostMidiHandlers<Source + 1>(device, source, controller);
+            }
+            else if (controller)
+            {
+                setMidiHandlers<Source, true>(device);
+            }
+            else
+            {
+                setMidiHandlers<Source, false>(device);
+            }
+        }
+    }
+
+    /**
+     * Set the role of a USB host MIDI device: controller (MIDImix) or external MIDI.
+     * A new controller gets all lights resent by the next flushControllerLights().
+     * 
+     * @param device index of the device in usbHostMidiDevices
+     * @param controller true if the device is a MIDImix
+     */
+    void setUsbHostMidiDeviceRole(uint8_t device, bool controller)
+    {
+        MIDIDeviceBase *usbHostMidiDevice = (*usbHostMidiDevices)[device];
+        uint8_t source = MIDI_SOURCE_USB_HOST_FIRST + device;
+
+        auto controllerMidiDevice = std::find(controllerMidiDevices.begin(), controllerMidiDevices.end(), usbHostMidiDevice);
+        if (controller && controllerMidiDevice == controllerMidiDevices.end())
+        {
+            controllerMidiDevices.push_back(usbHostMidiDevice);
+            controllerLightsSent.fill(LIGHT_NOT_SET);
+        }
+        else if (!controller && controllerMidiDevice != controllerMidiDevices.end())
+        {
+            controllerMidiDevices.erase(controllerMidiDevice);
+        }
+
+        midiIngest.setSourceName(source, controller ? "MIDImix" : "USB host");
+        setUsbHostMidiHandlers(*usbHostMidiDevice, source, controller);
+        #ifdef MIDI_CHANNELS_USB_HOST
+        // the MIDImix always uses all channels
+        midiIngest.setChannelMask(source, controller ? MidiIngest::CHANNEL_MASK_ALL : MIDI_CHANNELS_USB_HOST);
+        #endif
+    }
+
+    /**
+     * Check the USB host MIDI devices for connected and disconnected devices, a MIDImix connected at any time is used as
+     * controller. The USB IDs are only compared here, the role is kept until the device changes.
+     */
+    void updateUsbHostMidiDevices()
+    {
+        for (uint8_t device = 0; device < usbHostMidiDevices->size(); device++)
+        {
+            MIDIDeviceBase *usbHostMidiDevice = (*usbHostMidiDevices)[device];
+            uint32_t ids = (uint32_t)usbHostMidiDevice->idVendor() << 16 | usbHostMidiDevice->idProduct();
+            if (ids == usbHostMidiDeviceIds[device])
+            {
+                continue;
+            }
+
+            usbHostMidiDeviceIds[device] = ids;
+            bool controller = isAkaiMidiMix(usbHostMidiDevice);
+            if (ids != 0)
+            {
+                Serial.printf("USB host MIDI device %d connected, idVendor: %04x, idProduct: %04x, %s\n", device, ids >> 16, ids & 0xFFFF, controller ? "AKAI MIDI Mix" : "other MIDI device");
+            }
+            setUsbHostMidiDeviceRole(device, controller);
+        }
+    }
+
+    /**
+     * Pass a queued MIDI message to its handler.
+     * 
+     * @param event MIDI message
+     */
+    void dispatchMidiEvent(const MidiEvent &event)
+    {
+        switch (event.type)
+        {
+        case MidiEventType::noteOn:
+            onNoteOn(event.channel, event.data1, event.data2, event.controller);
+            break;
+
+        case MidiEventType::noteOff:
+            onNoteOff(event.channel, event.data1, event.controller);
+            break;
+
+        case MidiEventType::controlChange:
+            onControlChange(event.channel, event.data1, event.data2, event.controller);
+            break;
+
+        case MidiEventType::pitchChange:
+            onPitchChange(event.channel, event.data2, event.controller);
+            break;
+
+        case MidiEventType::programChange:
+            onProgramChange(event.channel, event.data1, event.controller);
+            break;
+
+        case MidiEventType::channelPressure:
+            onChannelPressure(event.channel, event.data1, event.controller);
+            break;
+        }
+    }
+
+    /**
+     * MIDI note on handler.
+     * 
+     * @param channel channel
+     * @param note note
+     * @param velocity velocity
+     * @param controller true if message came from controller MIDI, false if message came from external MIDI
+     */
+    void onNoteOn(uint8_t channel, uint8_t note, uint8_t velocity, bool controller)
+    {
+        #ifdef DEBUG_MIDI_HANDLERS
+        Serial.print("Note On, ch=");
+        Serial.print(channel);
+        Serial.print(", note=");
+        Serial.print(note);
+        Serial.print(", velocity=");
+        Serial.print(velocity);
+        Serial.print(", controller=");
+        Serial.print(controller);
+        Serial.println();
+        #endif
+
+        // handle the note on as a musical note if it did not originate from controller MIDI or was not handled by the controller logic
+        if (!controller || !handleControllerNoteOn(note))
+        {
+            // limit the highest note, CPU usage of OSC1 increases as the note frequency increases
+            if (note > MIDI_NOTE_MAX)
+            {
+                return;
+            }
+
+            if (!controller && isMpeMemberChannel(channel))
+            {
+                synth.onMpeNoteOn(channel, note, velocity);
+            }
+            else
+            {
+                synth.onNoteOn(note, velocity);
             }
         }
     }
@@ -1007,7 +1791,14 @@ private:
         // handle the note off as a musical note if it did not originate from controller MIDI or was not handled by the controller logic
         if (!controller || !handleControllerNoteOff(note))
         {
-            synth.onNoteOff(note);
+            if (!controller && isMpeMemberChannel(channel))
+            {
+                synth.onMpeNoteOff(channel, note);
+            }
+            else
+            {
+                synth.onNoteOff(note);
+            }
         }
     }
 
@@ -1033,6 +1824,13 @@ private:
         Serial.println();
         #endif
 
+        // is it the MPE timbre of a member channel? CC74 on other channels is handled as a regular control change
+        if (control == MIDI_CC_MPE_TIMBRE && !controller && isMpeMemberChannel(channel))
+        {
+            synth.setMpeTimbre(channel, (value - 64) / 64.0f);
+            return;
+        }
+
         // is it (pedal) sustain?
         if (control == MIDI_CC_SUSTAIN)
         {
@@ -1047,6 +1845,14 @@ private:
             return;
         }
 
+        // is it morph? the morphed param values are applied by task()
+        if (control == MIDI_CC_MORPH)
+        {
+            morphAmount = value;
+            morphChanged = true;
+            return;
+        }
+
         // otherwise send it to controller MIDI or external MIDI control change handler
         if (controller)
         {
@@ -1054,7 +1860,7 @@ private:
         }
         else
         {
-            handleMidiCc(control, value);
+            handleMidiCc(channel, control, value);
         }
     }
 
@@ -1077,13 +1883,41 @@ private:
         Serial.println();
         #endif
 
-        if (pitch > 0)
+        float value = pitch > 0 ? (float)pitch / 8191.0f : (float)pitch / 8192.0f;
+
+        // the pitch bend of a member channel only bends the note of the channel, using the MPE pitch bend range
+        if (!controller && isMpeMemberChannel(channel))
         {
-            synth.setPitchChange((float)pitch / 8191.0f);
+            synth.setMpePitchChange(channel, value * mpePitchBendRange);
         }
         else
         {
-            synth.setPitchChange((float)pitch / 8192.0f);
+            synth.setPitchChange(value);
+        }
+    }
+
+    /**
+     * Channel pressure handler, only handled on MPE member channels.
+     * 
+     * @param channel channel
+     * @param pressure pressure
+     * @param controller true if message came from controller MIDI, false if message came from external MIDI
+     */
+    void onChannelPressure(uint8_t channel, uint8_t pressure, bool controller)
+    {
+        #ifdef DEBUG_MIDI_HANDLERS
+        Serial.print("Channel Pressure, ch=");
+        Serial.print(channel);
+        Serial.print(", value=");
+        Serial.print(pressure);
+        Serial.print(", controller=");
+        Serial.print(controller);
+        Serial.println();
+        #endif
+
+        if (!controller && isMpeMemberChannel(channel))
+        {
+            synth.setMpePressure(channel, (float)pressure / 127.0f);
         }
     }
 
@@ -1107,7 +1941,7 @@ private:
         #endif
 
         // do not process if the program is greater than 63 or equal to the current patch number
-        if (program <=63 && program != currentPatchNumber)
+        if (program < PATCH_COUNT && program != currentPatchNumber)
         {
             currentPatchNumber = program;
             currentPatch = patchService.loadPatch(currentPatchNumber);
@@ -1118,66 +1952,303 @@ private:
             if (controller)
             {
                 // send a program change to external MIDI if the program change came from the controller MIDI
-                sendProgramChangeToExtMidi(currentPatchNumber, MIDI_OUT_CHANNEL);
+                sendProgramChangeToExtMidi(currentPatchNumber);
+            }
+        }
+    }
+
+    #ifdef DEBUG_BENCHMARK
+    /**
+     * Benchmark the param lookup of the control change, note and menu handlers.
+     * Compares the dispatch tables to the std::map lookup (count() followed by at()) used before.
+     */
+    void benchmarkDispatch()
+    {
+        const uint32_t iterations{128 * 1000};
+
+        std::map<uint8_t, const Param *> controllerCcParamMap;
+        for (uint8_t control = 0; control < PARAMS_BY_CONTROLLER_CC.size(); control++)
+        {
+            if (PARAMS_BY_CONTROLLER_CC[control] != nullptr)
+            {
+                controllerCcParamMap[control] = PARAMS_BY_CONTROLLER_CC[control];
+            }
+        }
+
+        Serial.println();
+        Benchmark::run("controller CC dispatch, std::map", iterations, [&controllerCcParamMap](uint32_t i)
+        {
+            uint8_t control = i & 127;
+            return controllerCcParamMap.count(control) ? controllerCcParamMap.at(control)->getMaxValue() : 0u;
+        });
+        Benchmark::run("controller CC dispatch, table", iterations, [](uint32_t i)
+        {
+            auto param = dispatchParam(PARAMS_BY_CONTROLLER_CC, i & 127);
+            return param != nullptr ? param->getMaxValue() : 0u;
+        });
+        Benchmark::run("controller note dispatch, table", iterations, [](uint32_t i)
+        {
+            auto param = dispatchParam(PARAMS_BY_CONTROLLER_NI, i & 127);
+            if (param == nullptr)
+            {
+                param = dispatchParam(PARAMS_BY_CONTROLLER_ND, i & 127);
+            }
+            return param != nullptr ? param->getMaxValue() : 0u;
+        });
+        Benchmark::run("external MIDI CC dispatch, table", iterations, [](uint32_t i)
+        {
+            auto param = dispatchParam(PARAMS_BY_MIDI_CC, i & 127);
+            return param != nullptr ? param->getMaxValue() : 0u;
+        });
+    }
+
+    /**
+     * Benchmark the per message cost of the MIDI handlers, from the MIDI library calling the handler until the message is
+     * queued. Compares the static handlers to the fnptr wrapped lambda used before, calling ingestMidi() directly is the
+     * baseline, a message on a filtered channel shows the cost of dropping it. The queued messages are discarded, the
+     * first MIDI ingest statistics include them.
+     */
+    void benchmarkMidiHandlers()
+    {
+        const uint32_t iterations{32 * 1000};
+        const uint8_t control{20};
+
+        // called through a volatile function pointer like the MIDI libraries do, so the call isn't inlined
+        void (*volatile fnptrHandler)(uint8_t channel, uint8_t control, uint8_t value) = fnptr<void(uint8_t channel, uint8_t control, uint8_t value)>(
+            [this](uint8_t channel, uint8_t control, uint8_t value)
+            {
+                this->ingestMidi(MIDI_SOURCE_EXT_USB, MidiEventType::controlChange, channel, control, value, false);
+            }
+        );
+        void (*volatile staticHandler)(uint8_t channel, uint8_t control, uint8_t value) = MidiHandlers<MIDI_SOURCE_EXT_USB, false>::controlChange;
+
+        // empty the queue before it fills up, so every message is queued
+        auto discard = [this](uint32_t i)
+        {
+            return (i & 31) == 31 ? midiIngest.dispatch([]([[maybe_unused]] const MidiEvent &event) {}) : 0u;
+        };
+
+        Serial.println();
+        Benchmark::run("MIDI control change, ingestMidi()", iterations, [this, &discard](uint32_t i)
+        {
+            ingestMidi(MIDI_SOURCE_EXT_USB, MidiEventType::controlChange, 1, control, i & 127, false);
+            return discard(i);
+        });
+        Benchmark::run("MIDI control change, fnptr handler", iterations, [&fnptrHandler, &discard](uint32_t i)
+        {
+            fnptrHandler(1, control, i & 127);
+            return discard(i);
+        });
+        Benchmark::run("MIDI control change, static handler", iterations, [&staticHandler, &discard](uint32_t i)
+        {
+            staticHandler(1, control, i & 127);
+            return discard(i);
+        });
+        // messages on channels filtered out are dropped before they are queued
+        midiIngest.setChannelMask(MIDI_SOURCE_EXT_USB, MidiIngest::CHANNEL_MASK_ALL & ~1);
+        Benchmark::run("MIDI control change, filtered channel", iterations, [&staticHandler, &discard](uint32_t i)
+        {
+            staticHandler(1, control, i & 127);
+            return discard(i);
+        });
+        midiIngest.setChannelMask(MIDI_SOURCE_EXT_USB, MidiIngest::CHANNEL_MASK_ALL);
+        discard(31);
+    }
+
+    /**
+     * Benchmark control change handling and patch copies.
+     * Compares the patch value array to a std::map of parameter ID / value pairs as used before.
+     * Changes the synth, the current patch is applied again afterwards.
+     */
+    void benchmarkPatch()
+    {
+        const uint32_t iterations{10000};
+
+        std::map<uint16_t, uint8_t> paramValueMap;
+        for (auto &param : PARAMS)
+        {
+            paramValueMap[param.getParamId()] = currentPatch.getParamValue(param);
+        }
+        const Param &param = PARAMS[PARAM_COUNT / 2];
+
+        Serial.println();
+        Benchmark::run("patch param value update, std::map", iterations, [&paramValueMap, &param](uint32_t i)
+        {
+            uint8_t value = i & 127;
+            if (value != (paramValueMap.count(param.getParamId()) ? paramValueMap.at(param.getParamId()) : 0))
+            {
+                paramValueMap[param.getParamId()] = value <= param.getMaxValue() ? value : param.getMaxValue();
+            }
+            return paramValueMap[param.getParamId()];
+        });
+        Benchmark::run("patch param value update, array", iterations, [this, &param](uint32_t i)
+        {
+            uint8_t value = i & 127;
+            if (value != currentPatch.getParamValue(param))
+            {
+                currentPatch.setParamValue(param, value);
             }
+            return currentPatch.getParamValue(param);
+        });
+        Benchmark::run("external MIDI CC handling", iterations, [this](uint32_t i)
+        {
+            return handleMidiCc(1, PARAM_MC_FILTER_1_RES, i & 127);
+        });
+        Benchmark::run("patch copy, std::map", iterations, [&paramValueMap](uint32_t i)
+        {
+            std::map<uint16_t, uint8_t> copy{paramValueMap};
+            return copy.size() + i;
+        });
+        Benchmark::run("patch copy, array", iterations, [this](uint32_t i)
+        {
+            Patch copy{currentPatch};
+            return copy.getParamValueByIndex(i % PARAM_COUNT);
+        });
+
+        currentPatch = patchService.loadPatch(currentPatchNumber);
+        applyCurrentPatch();
+    }
+
+    /**
+     * Benchmark program changes between the patches shipped in the tmixpatch folder (copy them to the SD card first).
+     * Compares sending all param values to the synth (as before) to sending only the changed param values. The longest
+     * audio transaction is compared to the audio block, the audio update is postponed for that long.
+     * Loading the patch file is not included in the measurement.
+     * Changes the synth, the current patch is applied again afterwards.
+     */
+    void benchmarkProgramChange()
+    {
+        const uint8_t patchCount{9};
+
+        uint32_t fullCyclesTotal{0};
+        uint32_t fullCyclesMax{0};
+        uint32_t diffCyclesTotal{0};
+        uint32_t diffCyclesMax{0};
+        uint32_t changedParamsTotal{0};
+
+        Serial.println();
+        AudioTransaction::resetStats();
+        for (uint8_t i = 0; i < patchCount; i++)
+        {
+            Patch fromPatch = patchService.loadPatch(i);
+            Patch toPatch = patchService.loadPatch((i + 1) % patchCount);
+
+            uint8_t changedParams{0};
+            for (uint8_t index = 0; index < PARAM_COUNT; index++)
+            {
+                changedParams += fromPatch.getParamValueByIndex(index) != toPatch.getParamValueByIndex(index);
+            }
+
+            // all param values
+            currentPatch = fromPatch;
+            applyCurrentPatch();
+            currentPatch = toPatch;
+            appliedParamValuesValid = false;
+            uint32_t start = ARM_DWT_CYCCNT;
+            applyCurrentPatch();
+            uint32_t fullCycles = ARM_DWT_CYCCNT - start;
+
+            // changed param values only
+            currentPatch = fromPatch;
+            applyCurrentPatch();
+            currentPatch = toPatch;
+            start = ARM_DWT_CYCCNT;
+            applyCurrentPatch();
+            uint32_t diffCycles = ARM_DWT_CYCCNT - start;
+
+            Serial.printf("Benchmark program change %d -> %d: %d changed params, all %.1fus, changed only %.1fus\n", i, (i + 1) % patchCount, changedParams, fullCycles * 1000000.0f / F_CPU_ACTUAL, diffCycles * 1000000.0f / F_CPU_ACTUAL);
+
+            fullCyclesTotal += fullCycles;
+            fullCyclesMax = std::max(fullCyclesMax, fullCycles);
+            diffCyclesTotal += diffCycles;
+            diffCyclesMax = std::max(diffCyclesMax, diffCycles);
+            changedParamsTotal += changedParams;
         }
+
+        Serial.printf("Benchmark program change, all params: %.1fus average, %.1fus max\n", fullCyclesTotal * 1000000.0f / F_CPU_ACTUAL / patchCount, fullCyclesMax * 1000000.0f / F_CPU_ACTUAL);
+        Serial.printf("Benchmark program change, changed params only: %.1fus average, %.1fus max, %.1f of %d params changed on average\n", diffCyclesTotal * 1000000.0f / F_CPU_ACTUAL / patchCount, diffCyclesMax * 1000000.0f / F_CPU_ACTUAL, (float)changedParamsTotal / patchCount, PARAM_COUNT);
+        Serial.printf("Benchmark program change, longest audio transaction: %.1fus, %.0f%% of the audio block (%.3fms)\n", AudioTransaction::getMaxMicros(), AudioTransaction::getMaxMicros() / (AUDIO_BLOCK_MS * 10.0f), AUDIO_BLOCK_MS);
+
+        currentPatch = patchService.loadPatch(currentPatchNumber);
+        applyCurrentPatch();
     }
 
+    /**
+     * Benchmark morphing between the patches shipped in the tmixpatch folder (copy them to the SD card first).
+     * Measures applying the morphed param values for a full sweep of the morph amount, the worst case of a morph CC
+     * arriving every audio block. The task applies one applyParamValues() chunk per audio block, a morph update taking
+     * more than one chunk is spread over that many audio blocks.
+     * Changes the synth, the current patch is applied again afterwards.
+     */
+    void benchmarkMorph()
+    {
+        const uint8_t patchCount{9};
+        const uint16_t iterations{patchCount * 128};
+        const uint8_t morphTargetIndex{getParamIndexById(PARAM_ID_MORPH_TARGET)};
+
+        uint32_t cyclesTotal{0};
+        uint32_t cyclesMax{0};
+        uint8_t chunksMax{0};
+
+        AudioTransaction::resetStats();
+        for (uint16_t i = 0; i < iterations; i++)
+        {
+            uint8_t patchNumber = i / 128;
+            if (i % 128 == 0)
+            {
+                currentPatch = patchService.loadPatch(patchNumber);
+                currentPatch.setParamValueByIndex(morphTargetIndex, ((patchNumber + 1) % patchCount) * 2);
+            }
+            morphAmount = i % 128;
+
+            applyParamIndex = 0;
+            uint8_t chunks{1};
+            uint32_t start = ARM_DWT_CYCCNT;
+            while (!applyParamValues())
+            {
+                chunks++;
+            }
+            uint32_t cycles = ARM_DWT_CYCCNT - start;
+
+            cyclesTotal += cycles;
+            cyclesMax = std::max(cyclesMax, cycles);
+            chunksMax = std::max(chunksMax, chunks);
+        }
+
+        Serial.println();
+        Serial.printf("Benchmark morph: %.1fus average, %.1fus max per morph update, %.0f%% of the audio block (%.3fms) max\n", cyclesTotal * 1000000.0f / F_CPU_ACTUAL / iterations, cyclesMax * 1000000.0f / F_CPU_ACTUAL, cyclesMax * 100000.0f / F_CPU_ACTUAL / AUDIO_BLOCK_MS, AUDIO_BLOCK_MS);
+        Serial.printf("Benchmark morph: spread over %d audio blocks max, longest audio transaction %.1fus\n", chunksMax, AudioTransaction::getMaxMicros());
+
+        morphAmount = 0;
+        currentPatch = patchService.loadPatch(currentPatchNumber);
+        applyCurrentPatch();
+    }
+    #endif
+
 public:
     /**
      * Initialize the synth controller.
      * 
-     * @param params reference to the param list
      * @param usbHostMidiDevices USB host MIDI devices
      * @param extMidiUsb external USB MIDI 
      * @param extMidiHardwareSerial external hardware serial MIDI
      */
-    void initialize(const std::vector<Param> &params, std::vector<MIDIDeviceBase *> * usbHostMidiDevices, usb_midi_class * extMidiUsb, midi::MidiInterface<midi::SerialMIDI<HardwareSerial>> * extMidiHardwareSerial)
+    void initialize(std::vector<MIDIDeviceBase *> * usbHostMidiDevices, usb_midi_class * extMidiUsb, SerialMidiInterface * extMidiHardwareSerial)
     {
         this->usbHostMidiDevices = usbHostMidiDevices;
         this->extMidiUsb = extMidiUsb;
         this->extMidiHardwareSerial = extMidiHardwareSerial;
+        instance = this;
 
+        controllerLights.fill(LIGHT_NOT_SET);
+        controllerLightsSent.fill(LIGHT_NOT_SET);
         setAllControlStateLightsLightState(LightState::off);
         setAllControlValueLights(false);
 
-        // create mappings
-        for (auto &param : params)
-        {
-            if (paramMap.count(param.getParamId()))
-            {
-                Serial.printf("Warning: duplicate paramId %d found, ignoring duplicate param\n", param.getParamId());
-            }
-            else
-            {
-                paramMap[param.getParamId()] = &param;
-                if (param.getMidiCc() <= 127)
-                {
-                    midiCcParamMap[param.getMidiCc()] = &param;
-                }
-                if (param.getControllerCc() <= 127)
-                {
-                    controllerCcParamMap[param.getControllerCc()] = &param;
-                }
-                if (param.getControllerNi() <= 127)
-                {
-                    controllerNiParamMap[param.getControllerNi()] = &param;
-                }
-                if (param.getControllerNd() <= 127)
-                {
-                    controllerNdParamMap[param.getControllerNd()] = &param;
-                }
-                if (param.getMenuId() <= 127)
-                {
-                    menuIdParamMap[param.getMenuId()] = &param;
-                }
-            }
-        }
-
         // initialize dependencies
         synth.initialize();
         displayService.initialize();
-        patchService.initialize(&paramMap, &displayService);
+        patchService.initialize(&displayService);
 
         // load patch 0
         currentPatch = patchService.loadPatch(currentPatchNumber);
@@ -1186,196 +2257,62 @@ public:
         // enter play state
         enterStatePlay();
 
-        // register MIDI handlers for USB host MIDI devices
-        // use fnptr to wrap reference to method calls on this SynthController instance to "normal" function pointers
-        for (auto &usbHostMidiDevice : *usbHostMidiDevices)
+        #ifdef DEBUG_BENCHMARK
+        benchmarkDispatch();
+        benchmarkMidiHandlers();
+        benchmarkPatch();
+        benchmarkProgramChange();
+        benchmarkMorph();
+        patchService.benchmarkPatchBank();
+        #endif
+
+        // register MIDI handlers, the handlers queue the messages, see midiTask()
+        // the handlers are static functions per source (see MidiHandlers), passing the messages on to this instance
+        // external USB MIDI and external hardware serial MIDI
+        midiIngest.addSource("USB");
+        setMidiHandlers<MIDI_SOURCE_EXT_USB, false>(*extMidiUsb);
+        extMidiUsb->setHandleSystemExclusive(MidiHandlers<MIDI_SOURCE_EXT_USB, false>::systemExclusive);
+        midiIngest.addSource("serial");
+        setMidiHandlers<MIDI_SOURCE_EXT_SERIAL, false>(*extMidiHardwareSerial);
+        extMidiHardwareSerial->setHandleSystemExclusive(MidiHandlers<MIDI_SOURCE_EXT_SERIAL, false>::systemExclusive);
+        #ifdef MIDI_CHANNELS_USB
+        midiIngest.setChannelMask(MIDI_SOURCE_EXT_USB, MIDI_CHANNELS_USB);
+        #endif
+        #ifdef MIDI_CHANNELS_SERIAL
+        midiIngest.setChannelMask(MIDI_SOURCE_EXT_SERIAL, MIDI_CHANNELS_SERIAL);
+        #endif
+
+        // USB host MIDI devices, external MIDI until a MIDImix connects, see updateUsbHostMidiDevices()
+        for (uint8_t device = 0; device < usbHostMidiDevices->size(); device++)
         {
-            Serial.print("idVendor: ");
-            Serial.println(usbHostMidiDevice->idVendor());
-            Serial.print("idProduct: ");
-            Serial.println(usbHostMidiDevice->idProduct());
+            midiIngest.addSource("USB host");
+            usbHostMidiDeviceIds.push_back(0);
+            setUsbHostMidiDeviceRole(device, false);
+        }
+        updateUsbHostMidiDevices();
 
-            if (isAkaiMidiMix(usbHostMidiDevice))
-            {
-                Serial.println("Found AKAI MIDI Mix connected to USB host");
-
-                usbHostMidiDevice->setHandleNoteOn(
-                    fnptr<void(uint8_t channel, uint8_t note, uint8_t velocity)>(
-                        [this](uint8_t channel, uint8_t note, uint8_t velocity)
-                        {
-                            this->onNoteOn(channel, note, velocity, true);
-                        }
-                    )
-                );
-                usbHostMidiDevice->setHandleNoteOff(
-                    fnptr<void(uint8_t channel, uint8_t note, uint8_t velocity)>(
-                        [this](uint8_t channel, uint8_t note, [[maybe_unused]] uint8_t velocity)
-                        {
-                            this->onNoteOff(channel, note, true);
-                        }
-                    )
-                );
-                usbHostMidiDevice->setHandleControlChange(
-                    fnptr<void(uint8_t channel, uint8_t control, uint8_t value)>(
-                        [this](uint8_t channel, uint8_t control, uint8_t value)
-                        {
-                            this->onControlChange(channel, control, value, true);
-                        }
-                    )
-                );
-                usbHostMidiDevice->setHandlePitchChange(
-                    fnptr<void(uint8_t channel, int pitch)>(
-                        [this](uint8_t channel, int pitch)
-                        {
-                            this->onPitchChange(channel, pitch, true);
-                        }
-                    )
-                );
-                usbHostMidiDevice->setHandleProgramChange(
-                    fnptr<void(uint8_t channel, uint8_t program)>(
-                        [this](uint8_t channel, uint8_t program)
-                        {
-                            this->onProgramChange(channel, program, true);
-                        }
-                    )
-                );
-            }
-            else
-            {
-                Serial.println("Found other MIDI device connected to USB host");
-
-                usbHostMidiDevice->setHandleNoteOn(
-                    fnptr<void(uint8_t channel, uint8_t note, uint8_t velocity)>(
-                        [this](uint8_t channel, uint8_t note, uint8_t velocity)
-                        {
-                            this->onNoteOn(channel, note, velocity, false);
-                        }
-                    )
-                );
-                usbHostMidiDevice->setHandleNoteOff(
-                    fnptr<void(uint8_t channel, uint8_t note, uint8_t velocity)>(
-                        [this](uint8_t channel, uint8_t note, [[maybe_unused]] uint8_t velocity)
-                        {
-                            this->onNoteOff(channel, note, false);
-                        }
-                    )
-                );
-                usbHostMidiDevice->setHandleControlChange(
-                    fnptr<void(uint8_t channel, uint8_t control, uint8_t value)>(
-                        [this](uint8_t channel, uint8_t control, uint8_t value)
-                        {
-                            this->onControlChange(channel, control, value, false);
-                        }
-                    )
-                );
-                usbHostMidiDevice->setHandlePitchChange(
-                    fnptr<void(uint8_t channel, int pitch)>(
-                        [this](uint8_t channel, int pitch)
-                        {
-                            this->onPitchChange(channel, pitch, false);
-                        }
-                    )
-                );
-                usbHostMidiDevice->setHandleProgramChange(
-                    fnptr<void(uint8_t channel, uint8_t program)>(
-                        [this](uint8_t channel, uint8_t program)
-                        {
-                            this->onProgramChange(channel, program, false);
-                        }
-                    )
-                );
-            }
+        #ifdef MIDI_ZONES
+        for (const MidiZone &zone : std::initializer_list<MidiZone>MIDI_ZONES)
+        {
+            midiZones.add(zone);
         }
+        #endif
 
-        // register MIDI handlers for external USB MIDI
-        // use fnptr to wrap reference to method calls on this SynthController instance to "normal" function pointers
-        extMidiUsb->setHandleNoteOn(
-            fnptr<void(uint8_t channel, uint8_t note, uint8_t velocity)>(
-                [this](uint8_t channel, uint8_t note, uint8_t velocity)
-                {
-                    this->onNoteOn(channel, note, velocity, false); 
-                }
-            )
-        );
-        extMidiUsb->setHandleNoteOff(
-            fnptr<void(uint8_t channel, uint8_t note, uint8_t velocity)>(
-                [this](uint8_t channel, uint8_t note, [[maybe_unused]] uint8_t velocity)
-                {
-                    this->onNoteOff(channel, note, false);
-                }
-            )
-        );
-        extMidiUsb->setHandleControlChange(
-            fnptr<void(uint8_t channel, uint8_t control, uint8_t value)>(
-                [this](uint8_t channel, uint8_t control, uint8_t value)
-                {
-                    this->onControlChange(channel, control, value, false);
-                }
-            )
-        );
-        extMidiUsb->setHandlePitchChange(
-            fnptr<void(uint8_t channel, int pitch)>(
-                [this](uint8_t channel, int pitch)
-                {
-                    this->onPitchChange(channel, pitch, false);
-                }
-            )
-        );
-        extMidiUsb->setHandleProgramChange(
-            fnptr<void(uint8_t channel, uint8_t program)>(
-                [this](uint8_t channel, uint8_t program)
-                {
-                    this->onProgramChange(channel, program, false);
-                }
-            )
-        );
+        #ifdef MPE_MEMBER_CHANNELS
+        setMpeZone(MPE_LOWER_ZONE_MASTER_CHANNEL, MPE_MEMBER_CHANNELS);
+        #endif
 
-        // register MIDI handlers for external hardware serial MIDI
-        // use fnptr to wrap reference to method calls on this SynthController instance to "normal" function pointers
-        extMidiHardwareSerial->setHandleNoteOn(
-            fnptr<void(uint8_t channel, uint8_t note, uint8_t velocity)>(
-                [this](uint8_t channel, uint8_t note, uint8_t velocity)
-                {
-                    this->onNoteOn(channel, note, velocity, false); 
-                }
-            )
-        );
-        extMidiHardwareSerial->setHandleNoteOff(
-            fnptr<void(uint8_t channel, uint8_t note, uint8_t velocity)>(
-                [this](uint8_t channel, uint8_t note, [[maybe_unused]] uint8_t velocity)
-                {
-                    this->onNoteOff(channel, note, false);
-                }
-            )
-        );
-        extMidiHardwareSerial->setHandleControlChange(
-            fnptr<void(uint8_t channel, uint8_t control, uint8_t value)>(
-                [this](uint8_t channel, uint8_t control, uint8_t value)
-                {
-                    this->onControlChange(channel, control, value, false);
-                }
-            )
-        );
-        extMidiHardwareSerial->setHandlePitchBend(
-            fnptr<void(uint8_t channel, int pitch)>(
-                [this](uint8_t channel, int pitch)
-                {
-                    this->onPitchChange(channel, pitch, false);
-                }
-            )
-        );
-        extMidiHardwareSerial->setHandleProgramChange(
-            fnptr<void(uint8_t channel, uint8_t program)>(
-                [this](uint8_t channel, uint8_t program)
-                {
-                    this->onProgramChange(channel, program, false);
-                }
-            )
-        );
+        #ifdef DEBUG_MIDI_CAPTURE
+        midiCapture.start(patchService, midiIngest);
+        #endif
+
+        #ifdef DEBUG_MIDI_REPLAY
+        midiReplay.load(patchService);
+        #endif
     }
 
     /**
-     * Light state task, deals with blinking lights.
+     * Light state task, deals with blinking lights and sends the changed lights to the controller.
      */
     void lightStateTask()
     {
@@ -1416,6 +2353,8 @@ public:
         }
 
         lightStateMetroCounter++;
+
+        flushControllerLights();
     }
 
     /**
@@ -1441,15 +2380,78 @@ public:
         buttonRepeatMetroCounter++;
     }
 
+    /**
+     * Read the incoming MIDI of all sources and handle the queued messages, see MidiIngest.
+     * The sources are drained in the order they were added in initialize(), while a MIDI capture is replayed the replayed
+     * messages are queued instead (see MidiReplay).
+     * Then send the queued external MIDI output, see MidiOutputQueue, and the outgoing SysEx, see PatchSysExStream.
+     */
+    void midiTask()
+    {
+        if (midiReplay.isActive())
+        {
+            // live MIDI input is not read while a capture is loaded or replayed
+            midiReplay.task(midiIngest, [this](const MidiEvent &event)
+            {
+                ingestMidi(event.source, event.type, event.channel, event.data1, event.data2, event.controller);
+            });
+        }
+        else
+        {
+            uint8_t source{MIDI_SOURCE_USB_HOST_FIRST};
+            for (auto &usbHostMidiDevice : *usbHostMidiDevices)
+            {
+                midiIngest.drain(source++, *usbHostMidiDevice);
+            }
+            midiIngest.drain(MIDI_SOURCE_EXT_USB, *extMidiUsb);
+            midiIngest.drain(MIDI_SOURCE_EXT_SERIAL, *extMidiHardwareSerial);
+        }
+
+        midiIngest.dispatch([this](const MidiEvent &event)
+        {
+            dispatchMidiEvent(event);
+        });
+
+        extMidiUsbOutput.task([this](MidiEventType type, uint8_t channel, uint8_t data1, uint8_t data2)
+        {
+            sendToExtMidi(*extMidiUsb, type, channel, data1, data2);
+        });
+        extMidiHardwareSerialOutput.task([this](MidiEventType type, uint8_t channel, uint8_t data1, uint8_t data2)
+        {
+            sendToExtMidi(*extMidiHardwareSerial, type, channel, data1, data2);
+        });
+
+        // SysEx patch dumps are streamed one message at a time, when the queued messages have been sent
+        auto loadPatch = [this](uint8_t patchNumber) -> const Patch &
+        {
+            return patchService.loadPatch(patchNumber);
+        };
+        extMidiUsbSysEx.task(extMidiUsbOutput, loadPatch, [this](const uint8_t *data, uint16_t size)
+        {
+            extMidiUsb->sendSysEx(size, data, true);
+        });
+        extMidiHardwareSerialSysEx.task(extMidiHardwareSerialOutput, loadPatch, [this](const uint8_t *data, uint16_t size)
+        {
+            extMidiHardwareSerial->sendSysEx(size, data, true);
+        });
+    }
+
     /**
      * Perform scheduled tasks.
      */
     void task()
     {
         #ifdef DEBUG_CPU_USAGE
+        AudioDeadline::poll();
         if (cpuMetro.check() == 1)
         {
             synth.logCpuUsageStats();
+            AudioDeadline::logStats();
+            AudioTransaction::logStats();
+            midiIngest.logStats();
+            extMidiUsbOutput.logStats("USB");
+            extMidiHardwareSerialOutput.logStats("serial");
+            midiCapture.logStats();
         }
         #endif
 
@@ -1459,6 +2461,29 @@ public:
         //     displayService.task();
         // }
 
+        // storage request completions
+        patchService.task();
+
+        // USB host MIDI devices connected or disconnected by USBHost::Task()
+        updateUsbHostMidiDevices();
+
+        midiCapture.task();
+
+        patchChangeTask();
+
+        // morph at control rate, CCs arriving within one audio block are combined, a pass over the params may take
+        // several audio blocks, morph changes during the pass are applied by the next pass
+        if ((morphChanged || morphApplying) && !patchChangeStaged && morphElapsedMicros >= MORPH_INTERVAL_MICROS)
+        {
+            if (!morphApplying)
+            {
+                morphChanged = false;
+                applyParamIndex = 0;
+            }
+            morphElapsedMicros = 0;
+            morphApplying = !applyParamValues();
+        }
+
         if (lightStateMetro.check() == 1)
         {
             lightStateTask();
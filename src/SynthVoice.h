@@ -8,11 +8,16 @@
 #include "SynthWaveform.h"
 
 #include <Audio.h>
+#include "AudioConfig.h"
+#include "AudioTransaction.h"
+#include "AudioDeadline.h"
+#include "AudioEffectWaveshaperOversampled.h"
+#include "AudioMixerSmoothed4.h"
+#include "AudioSynthFmOperator.h"
 
 // references to external global constants
 extern const std::array<const float, 128> PROGMEM MIDI_NOTE_FREQ;
 extern const std::array<const float, 128> PROGMEM PARAM_SCALE_POWER;
-extern const float TRANSITION_SPEED_MS;
 
 /**
  * A SynthVoice contains the actual oscillators, envelope generators, filters, etc.
@@ -28,59 +33,54 @@ private:
     // You can get a visual representation of the audio nodes and connections by importing the generated part into the Audio System Design Tool.
     // Try to align the coordinates (with shift pressed) to the original coordinates when exporting an updated version.
     // The i2s1 object and two related patch cords need to be commented out, or else there won't be any audio.
+    // The design tool doesn't know the custom audio objects: AudioMixerSmoothed4 (use AudioMixer4),
+    // AudioEffectWaveshaperOversampled (use two AudioEffectWaveshaper objects) and AudioSynthFmOperator (use AudioSynthWaveformModulated
+    // with an AudioEffectMultiply for the modulation index), rename them after exporting.
+    // Static control values are set using the smoothed offset of AudioMixerSmoothed4 instead of AudioSynthWaveformDc objects.
 
     // GUItool: begin automatically generated code
     AudioSynthWaveformDc     dc1Ref;         //xy=130,300
-    AudioSynthWaveformDc     osc1Shape;      //xy=140,680
-    AudioSynthWaveformDc     oscFmPhaseMod;  //xy=159,1120
     AudioEffectEnvelope      envLfo;      //xy=310,180
     AudioEffectEnvelope      env1;           //xy=310,260
     AudioEffectEnvelope      env2;           //xy=310,340
     AudioEffectMultiply      env1Exp;        //xy=635,260
-    AudioMixer4              osc1FreqMixer;  //xy=655,560
-    AudioMixer4              osc1ShapeMixer; //xy=660,700
-    AudioMixer4              oscFmPhaseModMixer; //xy=680,1140
+    AudioMixerSmoothed4      osc1FreqMixer;  //xy=655,560
+    AudioMixerSmoothed4      osc1ShapeMixer; //xy=660,700
+    AudioMixerSmoothed4      oscFmPhaseModMixer; //xy=680,1140
     AudioSynthWaveformModulated osc1;           //xy=870,620
-    AudioSynthWaveformModulated oscFm;          //xy=870,1220
+    AudioSynthFmOperator     oscFm;          //xy=870,1220
     AudioSynthWaveformModulated osc1Unison1;    //xy=889,700
     AudioSynthWaveformModulated osc1Unison2;    //xy=889,740
     AudioSynthWaveformModulated osc1Unison3;    //xy=889,780
     AudioSynthWaveformModulated osc1Unison4;    //xy=889,820
     AudioSynthWaveformModulated osc1Unison5;    //xy=889,860
     AudioSynthWaveformModulated osc1Unison6;    //xy=889,900
-    AudioEffectMultiply      oscFmEnv2Mod;   //xy=899,1100
-    AudioSynthWaveformDc     osc1WaveFold;   //xy=1011,520
-    AudioMixer4              osc1UnisonMixerL; //xy=1246,760
-    AudioMixer4              osc1WaveFoldMixer; //xy=1251,540
-    AudioMixer4              osc1UnisonMixerR; //xy=1251,1000
+    AudioMixerSmoothed4      osc1UnisonMixerL; //xy=1246,760
+    AudioMixerSmoothed4      osc1WaveFoldMixer; //xy=1251,540
+    AudioMixerSmoothed4      osc1UnisonMixerR; //xy=1251,1000
     AudioSynthWaveformDc     kbdTrack;       //xy=1433,180
-    AudioSynthWaveformDc     filter1Freq;    //xy=1436,120
     AudioSynthWaveformDc     kbdVelocity;    //xy=1440,240
     AudioEffectWaveFolder    osc1WaveFolder; //xy=1441,620
-    AudioMixer4              filter1FreqMixer; //xy=1617,360
-    AudioMixer4              filter1FreqSubMixer; //xy=1629,180
-    AudioMixer4              oscMixerL;      //xy=1680,760
-    AudioMixer4              oscMixerR;      //xy=1681,1000
-    AudioSynthWaveformDc     filter2FreqOffset; //xy=1815,120
-    AudioAmplifier           filterPreAmpL;  //xy=1871,760
-    AudioAmplifier           filterPreAmpR;  //xy=1872,1000
-    AudioMixer4              filter2FreqMixer; //xy=2017,180
+    AudioMixerSmoothed4      filter1FreqMixer; //xy=1617,360
+    AudioMixerSmoothed4      filter1FreqSubMixer; //xy=1629,180
+    AudioMixerSmoothed4      oscMixerL;      //xy=1680,760
+    AudioMixerSmoothed4      oscMixerR;      //xy=1681,1000
+    AudioMixerSmoothed4      filterPreAmpL;  //xy=1871,760
+    AudioMixerSmoothed4      filterPreAmpR;  //xy=1872,1000
+    AudioMixerSmoothed4      filter2FreqMixer; //xy=2017,180
     AudioFilterStateVariable filter2L;       //xy=2050,800
     AudioFilterStateVariable filter2R;       //xy=2050,1040
-    AudioMixer4              filterMixer2L;  //xy=2206,780
-    AudioMixer4              filterMixer2R;  //xy=2208,1020
+    AudioMixerSmoothed4      filterMixer2L;  //xy=2206,780
+    AudioMixerSmoothed4      filterMixer2R;  //xy=2208,1020
     AudioFilterStateVariable filter1L;       //xy=2350,800
     AudioFilterStateVariable filter1R;       //xy=2350,1040
-    AudioMixer4              filterMixer1L;  //xy=2506,780
-    AudioMixer4              filterMixer1R;  //xy=2508,1020
+    AudioMixerSmoothed4      filterMixer1L;  //xy=2506,780
+    AudioMixerSmoothed4      filterMixer1R;  //xy=2508,1020
     AudioEffectMultiply      env1AmpL;       //xy=2662,780
     AudioEffectMultiply      env1AmpR;       //xy=2663,1020
     AudioFilterStateVariable lfoFilter;      //xy=2831,420
-    AudioEffectWaveshaper    waveshapeL;     //xy=2848,800
-    AudioEffectWaveshaper    waveshapeR;     //xy=2849,1040
-    AudioMixer4              waveshapeMixerL; //xy=3065,780
-    AudioMixer4              waveshapeMixerR; //xy=3066,1020
-    AudioMixer4              ampLfoMixer;    //xy=3069,520
+    AudioEffectWaveshaperOversampled waveshape; //xy=2848,920
+    AudioMixerSmoothed4      ampLfoMixer;    //xy=3069,520
     AudioEffectMultiply      lfoAmpL;        //xy=3294,780
     AudioEffectMultiply      lfoAmpR;        //xy=3295,1020
     AudioSynthWaveformDc     noteVelocity;   //xy=3323,520
@@ -91,8 +91,6 @@ private:
     AudioConnection          patchCord1 = AudioConnection(dc1Ref, env1);
     AudioConnection          patchCord2 = AudioConnection(dc1Ref, env2);
     AudioConnection          patchCord3 = AudioConnection(dc1Ref, 0, ampLfoMixer, 0);
-    AudioConnection          patchCord4 = AudioConnection(osc1Shape, 0, osc1ShapeMixer, 0);
-    AudioConnection          patchCord5 = AudioConnection(oscFmPhaseMod, 0, oscFmPhaseModMixer, 0);
     AudioConnection          patchCord6 = AudioConnection(envLfo, 0, osc1FreqMixer, 1);
     AudioConnection          patchCord7 = AudioConnection(envLfo, 0, osc1ShapeMixer, 1);
     AudioConnection          patchCord8 = AudioConnection(envLfo, 0, filter1FreqMixer, 1);
@@ -120,7 +118,7 @@ private:
     AudioConnection          patchCord30 = AudioConnection(osc1ShapeMixer, 0, osc1Unison5, 1);
     AudioConnection          patchCord31 = AudioConnection(osc1ShapeMixer, 0, osc1Unison1, 1);
     AudioConnection          patchCord32 = AudioConnection(osc1ShapeMixer, 0, osc1Unison6, 1);
-    AudioConnection          patchCord33 = AudioConnection(oscFmPhaseModMixer, 0, oscFmEnv2Mod, 1);
+    AudioConnection          patchCord33 = AudioConnection(oscFmPhaseModMixer, 0, oscFm, 1);
     AudioConnection          patchCord34 = AudioConnection(osc1, 0, osc1WaveFolder, 1);
     AudioConnection          patchCord35 = AudioConnection(oscFm, 0, oscMixerL, 2);
     AudioConnection          patchCord36 = AudioConnection(oscFm, 0, oscMixerR, 2);
@@ -130,16 +128,13 @@ private:
     AudioConnection          patchCord40 = AudioConnection(osc1Unison4, 0, osc1UnisonMixerL, 1);
     AudioConnection          patchCord41 = AudioConnection(osc1Unison5, 0, osc1UnisonMixerR, 2);
     AudioConnection          patchCord42 = AudioConnection(osc1Unison6, 0, osc1UnisonMixerL, 2);
-    AudioConnection          patchCord43 = AudioConnection(oscFmEnv2Mod, 0, oscFm, 0);
-    AudioConnection          patchCord44 = AudioConnection(osc1WaveFold, 0, osc1WaveFoldMixer, 0);
     AudioConnection          patchCord45 = AudioConnection(osc1UnisonMixerL, 0, oscMixerL, 1);
     AudioConnection          patchCord46 = AudioConnection(osc1WaveFoldMixer, 0, osc1WaveFolder, 0);
     AudioConnection          patchCord47 = AudioConnection(osc1UnisonMixerR, 0, oscMixerR, 1);
     AudioConnection          patchCord48 = AudioConnection(kbdTrack, 0, filter1FreqSubMixer, 1);
-    AudioConnection          patchCord49 = AudioConnection(filter1Freq, 0, filter1FreqSubMixer, 0);
     AudioConnection          patchCord50 = AudioConnection(kbdVelocity, 0, filter1FreqSubMixer, 2);
     AudioConnection          patchCord51 = AudioConnection(osc1WaveFolder, 0, oscMixerL, 0);
-    AudioConnection          patchCord52 = AudioConnection(osc1WaveFolder, 0, oscFmEnv2Mod, 0);
+    AudioConnection          patchCord52 = AudioConnection(osc1WaveFolder, 0, oscFm, 0);
     AudioConnection          patchCord53 = AudioConnection(osc1WaveFolder, 0, oscMixerR, 0);
     AudioConnection          patchCord54 = AudioConnection(filter1FreqMixer, 0, filter1L, 1);
     AudioConnection          patchCord55 = AudioConnection(filter1FreqMixer, 0, filter2FreqMixer, 2);
@@ -147,7 +142,6 @@ private:
     AudioConnection          patchCord57 = AudioConnection(filter1FreqSubMixer, 0, filter1FreqMixer, 0);
     AudioConnection          patchCord58 = AudioConnection(oscMixerL, filterPreAmpL);
     AudioConnection          patchCord59 = AudioConnection(oscMixerR, filterPreAmpR);
-    AudioConnection          patchCord60 = AudioConnection(filter2FreqOffset, 0, filter2FreqMixer, 0);
     AudioConnection          patchCord61 = AudioConnection(filterPreAmpL, 0, filter2L, 0);
     AudioConnection          patchCord62 = AudioConnection(filterPreAmpL, 0, filterMixer2L, 0);
     AudioConnection          patchCord63 = AudioConnection(filterPreAmpR, 0, filter2R, 0);
@@ -168,15 +162,11 @@ private:
     AudioConnection          patchCord78 = AudioConnection(filter1R, 2, filterMixer1R, 3);
     AudioConnection          patchCord79 = AudioConnection(filterMixer1L, 0, env1AmpL, 1);
     AudioConnection          patchCord80 = AudioConnection(filterMixer1R, 0, env1AmpR, 1);
-    AudioConnection          patchCord81 = AudioConnection(env1AmpL, 0, waveshapeMixerL, 0);
-    AudioConnection          patchCord82 = AudioConnection(env1AmpL, waveshapeL);
-    AudioConnection          patchCord83 = AudioConnection(env1AmpR, 0, waveshapeMixerR, 0);
-    AudioConnection          patchCord84 = AudioConnection(env1AmpR, waveshapeR);
+    AudioConnection          patchCord82 = AudioConnection(env1AmpL, 0, waveshape, 0);
+    AudioConnection          patchCord84 = AudioConnection(env1AmpR, 0, waveshape, 1);
     AudioConnection          patchCord85 = AudioConnection(lfoFilter, 0, ampLfoMixer, 1);
-    AudioConnection          patchCord86 = AudioConnection(waveshapeL, 0, waveshapeMixerL, 1);
-    AudioConnection          patchCord87 = AudioConnection(waveshapeR, 0, waveshapeMixerR, 1);
-    AudioConnection          patchCord88 = AudioConnection(waveshapeMixerL, 0, lfoAmpL, 1);
-    AudioConnection          patchCord89 = AudioConnection(waveshapeMixerR, 0, lfoAmpR, 1);
+    AudioConnection          patchCord88 = AudioConnection(waveshape, 0, lfoAmpL, 1);
+    AudioConnection          patchCord89 = AudioConnection(waveshape, 1, lfoAmpR, 1);
     AudioConnection          patchCord90 = AudioConnection(ampLfoMixer, 0, lfoAmpL, 0);
     AudioConnection          patchCord91 = AudioConnection(ampLfoMixer, 0, lfoAmpR, 0);
     AudioConnection          patchCord92 = AudioConnection(lfoAmpL, 0, velocityAmpL, 1);
@@ -198,6 +188,10 @@ private:
     // 450hz with + and - 5 octaves gives a range of 14.0625 to 14400hz, which is just below the maximum of AudioFilterStateVariable (around 14.5khz)
     static constexpr float FILTER_FREQUENCY{450.0f};
     static constexpr float FILTER_OCTAVE_CONTROL{5.0f};
+    // filter 1 frequency range of the MPE timbre (CC74) in octaves, up and down
+    static constexpr float MPE_TIMBRE_FILTER_OCTAVES{2.0f};
+    // filter 1 frequency range of the MPE pressure in octaves, up
+    static constexpr float MPE_PRESSURE_FILTER_OCTAVES{3.0f};
 
     // in a note on?
     bool currentMidiNoteOn{false};
@@ -215,6 +209,10 @@ private:
     uint8_t currentPitchChangeRange{0};
     float currentPitchChangeValue{0.0f};
     float currentModWhlValue{0.0f};
+    // MPE expression of the current note, see setMpeExpression()
+    float currentMpePitchChange{0.0f};
+    float currentMpePressure{0.0f};
+    float currentMpeTimbre{0.0f};
     float currentOsc1Volume{1.0f};
     float currentOscFmVolume{0.0f};
     float currentOsc1UnisonMixCenter{1.0f};
@@ -311,7 +309,7 @@ private:
     /**
      * Restart all oscillator waveforms.
      * 
-     * Use AudioNoInterrupts() before and AudioInterrupts() after calling this method.
+     * Call within an AudioTransaction (see AudioTransaction.h).
      */
     void restartOscWaveForms()
     {
@@ -320,13 +318,13 @@ private:
         if (osc1SynthWaveform.audioWaveform == WAVEFORM_ARBITRARY)
         {
             // sampled waveform selected, load the waveform in the buffer
-            osc1.arbitraryWaveform(osc1SynthWaveform.waveFormArray, 44100);
-            osc1Unison1.arbitraryWaveform(osc1SynthWaveform.waveFormArray, 44100);
-            osc1Unison2.arbitraryWaveform(osc1SynthWaveform.waveFormArray, 44100);
-            osc1Unison3.arbitraryWaveform(osc1SynthWaveform.waveFormArray, 44100);
-            osc1Unison4.arbitraryWaveform(osc1SynthWaveform.waveFormArray, 44100);
-            osc1Unison5.arbitraryWaveform(osc1SynthWaveform.waveFormArray, 44100);
-            osc1Unison6.arbitraryWaveform(osc1SynthWaveform.waveFormArray, 44100);
+            osc1.arbitraryWaveform(osc1SynthWaveform.waveFormArray, ARBITRARY_WAVEFORM_MAX_FREQ);
+            osc1Unison1.arbitraryWaveform(osc1SynthWaveform.waveFormArray, ARBITRARY_WAVEFORM_MAX_FREQ);
+            osc1Unison2.arbitraryWaveform(osc1SynthWaveform.waveFormArray, ARBITRARY_WAVEFORM_MAX_FREQ);
+            osc1Unison3.arbitraryWaveform(osc1SynthWaveform.waveFormArray, ARBITRARY_WAVEFORM_MAX_FREQ);
+            osc1Unison4.arbitraryWaveform(osc1SynthWaveform.waveFormArray, ARBITRARY_WAVEFORM_MAX_FREQ);
+            osc1Unison5.arbitraryWaveform(osc1SynthWaveform.waveFormArray, ARBITRARY_WAVEFORM_MAX_FREQ);
+            osc1Unison6.arbitraryWaveform(osc1SynthWaveform.waveFormArray, ARBITRARY_WAVEFORM_MAX_FREQ);
         }
         osc1.begin(osc1SynthWaveform.audioWaveform);
         osc1Unison1.begin(osc1SynthWaveform.audioWaveform);
@@ -338,19 +336,15 @@ private:
 
         // osc fm
         auto oscFmSynthWaveform = getSynthWaveformByValue(currentOscFmSynthWaveform);
-        if (oscFmSynthWaveform.audioWaveform == WAVEFORM_ARBITRARY)
-        {
-            oscFm.arbitraryWaveform(oscFmSynthWaveform.waveFormArray, 44100);
-        }
-        oscFm.begin(oscFmSynthWaveform.audioWaveform);
+        oscFm.begin(oscFmSynthWaveform.audioWaveform, oscFmSynthWaveform.waveFormArray);
 
         // restart the phase of the oscillators
-        // these calls require a modification to the Teensy Audio library, see Code.md for more information
+        // this call requires a modification to the Teensy Audio library, see Code.md for more information
         // the unison oscillators are not restarted, they are supposed to be out of phase
         #ifndef DISABLE_OSC_RESTART
         osc1.restart();
-        oscFm.restart();
         #endif
+        oscFm.restart();
     }
 
     /**
@@ -358,7 +352,7 @@ private:
      */
     void updateOsc1Frequency()
     {
-        currentOsc1FrequencyMultiplier = pow(2.0f, float(currentOsc1Octave)) * pow(2.0f, currentOsc1Transpose / 12.0f) * pow(2.0f, (currentPitchChangeRange * currentPitchChangeValue) / 12.0f) * pow(2.0f, currentOsc1Detune / 1200.0f);
+        currentOsc1FrequencyMultiplier = pow(2.0f, float(currentOsc1Octave)) * pow(2.0f, currentOsc1Transpose / 12.0f) * pow(2.0f, (currentPitchChangeRange * currentPitchChangeValue + currentMpePitchChange) / 12.0f) * pow(2.0f, currentOsc1Detune / 1200.0f);
         float centerFrequency = MIDI_NOTE_FREQ[currentMidiNote] * currentOsc1FrequencyMultiplier;
         
         // Serial.print("osc 1 freq: ");
@@ -378,7 +372,7 @@ private:
      */
     void updateOscFmFrequency()
     {
-        currentOscFmFrequencyMultiplier = pow(2.0f, float(currentOscFmOctave)) * pow(2.0f, currentOscFmTranspose / 12.0f) * pow(2.0f, (currentPitchChangeRange * currentPitchChangeValue) / 12.0f) * pow(2.0f, currentOscFmDetune / 1200.0f);
+        currentOscFmFrequencyMultiplier = pow(2.0f, float(currentOscFmOctave)) * pow(2.0f, currentOscFmTranspose / 12.0f) * pow(2.0f, (currentPitchChangeRange * currentPitchChangeValue + currentMpePitchChange) / 12.0f) * pow(2.0f, currentOscFmDetune / 1200.0f);
         float centerFrequency = MIDI_NOTE_FREQ[currentMidiNote] * currentOscFmFrequencyMultiplier;
 
         // Serial.print("osc 2 freq: ");
@@ -393,7 +387,8 @@ private:
     void updateFilter1Freq()
     {
         // currentFilter1FreqValue ranges from -2 to +6 oct
-        filter1Freq.amplitude(constrain((currentFilter1FreqValue + 0.5f) * (4.0f / FILTER_OCTAVE_CONTROL)  + currentFilter1FreqModEnv2Offset, -1.0f, 1.0f));
+        float mpeOctaves = currentMpeTimbre * MPE_TIMBRE_FILTER_OCTAVES + currentMpePressure * MPE_PRESSURE_FILTER_OCTAVES;
+        filter1FreqSubMixer.offset(constrain((currentFilter1FreqValue + 0.5f) * (4.0f / FILTER_OCTAVE_CONTROL)  + currentFilter1FreqModEnv2Offset + mpeOctaves / FILTER_OCTAVE_CONTROL, -1.0f, 1.0f));
     }
 
     /**
@@ -439,8 +434,9 @@ public:
      * @param destinationInputR input number of the audio object to connect the right output of this synth voice to
      * @param lfo audio object to connect the LFO input of this synth voice to
      * @param lfoOutput output number of the audio object to connect the LFO input of this synth voice to
+     * @param waveshapeTable waveshape table shared by all synth voices
      */
-    void initialize(AudioStream &destinationL, unsigned char destinationInputL, AudioStream &destinationR, unsigned char destinationInputR, AudioStream &lfo, unsigned char lfoOutput)
+    void initialize(AudioStream &destinationL, unsigned char destinationInputL, AudioStream &destinationR, unsigned char destinationInputR, AudioStream &lfo, unsigned char lfoOutput, const WaveshapeTable &waveshapeTable)
     {
         // connect the audio output of this synth voice to the voice mixer of Synth
         outputL.connect(velocityAmpL, 0, destinationL, destinationInputL);
@@ -450,10 +446,12 @@ public:
         lfoInput.connect(lfo, lfoOutput, envLfo, 0);
 
         // initialize some audio objects with initial or fixed values
-        AudioNoInterrupts();
+        AudioTransaction::begin();
 
         dc1Ref.amplitude(1.0f);
 
+        waveshape.shape(waveshapeTable);
+
         lfoFilter.frequency(250.0f);
 
         osc1.amplitude(1.0f);
@@ -465,8 +463,10 @@ public:
         osc1Unison6.amplitude(1.0f);
 
         oscFm.amplitude(1.0f);
+        // also generates the tables for the standard waveforms of the FM operator
+        oscFm.begin(WAVEFORM_SINE);
 
-        osc1WaveFold.amplitude(0.5f);
+        osc1WaveFoldMixer.offset(0.5f);
 
         osc1.frequencyModulation(4.0f);
         osc1Unison1.frequencyModulation(4.0f);
@@ -478,11 +478,6 @@ public:
 
         osc1FreqMixer.gain(0, 1.0f);
 
-        osc1ShapeMixer.gain(0, 1.0f);
-
-        osc1WaveFoldMixer.gain(0, 1.0f);
-
-        oscFm.frequencyModulation(0.0f);
         oscFm.phaseModulation(720.0f);
 
 
@@ -504,22 +499,22 @@ public:
         env1.releaseNoteOn(1.0f);
         env2.releaseNoteOn(1.0f);
 
-        AudioInterrupts();
+        AudioTransaction::end();
     }
 
     /**
      * Get a synth waveform by number.
      * 
      * @param value waveform number
-     * @return SynthWaveform synth waveform
+     * @return const SynthWaveform& synth waveform
      */
-    static SynthWaveform getSynthWaveformByValue(uint8_t value)
+    static const SynthWaveform &getSynthWaveformByValue(uint8_t value)
     {
         if (value >= SYNTH_WAVEFORMS.size())
         {
             value = (uint8_t)SYNTH_WAVEFORMS.size() - 1;
         }
-        return SYNTH_WAVEFORMS.at(value);
+        return SYNTH_WAVEFORMS[value];
     }
 
     /**
@@ -534,7 +529,7 @@ public:
         currentMidiNoteOn = true;
         lastNoteOn = millis();
 
-        AudioNoInterrupts();
+        AudioTransaction::begin();
 
         // kbdTrack needs to be adjusted at least 1 ms before the note starts to prevent ticks
         kbdTrack.amplitude(midiNoteToKbdTrack(note), 0);
@@ -548,11 +543,11 @@ public:
         env2.noteOff();
         envLfo.noteOff();
 
-        AudioInterrupts();
+        AudioTransaction::end();
 
         delay(1);
 
-        AudioNoInterrupts();
+        AudioTransaction::begin();
 
         updateOsc1Frequency();
         updateOscFmFrequency();
@@ -563,7 +558,7 @@ public:
         env2.noteOn();
         envLfo.noteOn();
 
-        AudioInterrupts();
+        AudioTransaction::end();
     }
 
     /**
@@ -581,11 +576,11 @@ public:
         // trigger envelop note off only if the sustain pedal is not pressed
         if (!currentSustain)
         {
-            AudioNoInterrupts();
+            AudioTransaction::begin();
             env1.noteOff();
             env2.noteOff();
             envLfo.noteOff();
-            AudioInterrupts();
+            AudioTransaction::end();
         }
 
         currentMidiNoteOn = false;
@@ -631,6 +626,16 @@ public:
         return currentMidiNoteOn;
     }
 
+    /**
+     * Check if the voice is sounding, including the release phase of the amp envelope.
+     * 
+     * @return bool true if sounding
+     */
+    bool isSounding()
+    {
+        return env1.isActive();
+    }
+
     /**
      * Get the timestamp of the last note on.
      * 
@@ -685,6 +690,55 @@ public:
         updateEnv2AttackRelease();
     }
 
+    /**
+     * Set the MPE expression of the next note, to be called before onNoteOn().
+     * The expression is applied by onNoteOn().
+     * 
+     * @param pitchChange pitch change in semitones, added to the pitch bend
+     * @param pressure pressure (0.0f - 1.0f), filter 1 frequency offset
+     * @param timbre timbre (-1.0f - 1.0f), filter 1 frequency offset
+     */
+    void setMpeExpression(float pitchChange, float pressure, float timbre)
+    {
+        currentMpePitchChange = pitchChange;
+        currentMpePressure = pressure;
+        currentMpeTimbre = timbre;
+    }
+
+    /**
+     * Set the MPE pitch change of the current note.
+     * 
+     * @param value pitch change in semitones, added to the pitch bend
+     */
+    void setMpePitchChange(float value)
+    {
+        currentMpePitchChange = value;
+        updateOsc1Frequency();
+        updateOscFmFrequency();
+    }
+
+    /**
+     * Set the MPE pressure of the current note, opens filter 1 while the note is held, like the timbre.
+     * 
+     * @param value pressure (0.0f - 1.0f), filter 1 frequency offset
+     */
+    void setMpePressure(float value)
+    {
+        currentMpePressure = value;
+        updateFilter1Freq();
+    }
+
+    /**
+     * Set the MPE timbre (CC74) of the current note.
+     * 
+     * @param value timbre (-1.0f - 1.0f), filter 1 frequency offset
+     */
+    void setMpeTimbre(float value)
+    {
+        currentMpeTimbre = value;
+        updateFilter1Freq();
+    }
+
     /**
      * Log CPU / memory usage for debugging purposes.
      */
@@ -696,8 +750,8 @@ public:
         Serial.print(osc1WaveFolder.processorUsageMax());
         Serial.println("%");
 
-        Serial.print("waveshapeL CPU usage: ");
-        Serial.print(waveshapeL.processorUsageMax());
+        Serial.print("waveshape CPU usage: ");
+        Serial.print(waveshape.processorUsageMax());
         Serial.println("%");
 
         Serial.print("osc1 CPU usage: ");
@@ -717,7 +771,7 @@ public:
         Serial.println("%");
 
         Serial.print("Total audio CPU usage: ");
-        Serial.print(AudioProcessorUsageMax());
+        Serial.print(AudioDeadline::getUsageMax());
         Serial.println("%");
 
         Serial.print("Total audio memory usage: ");
@@ -725,7 +779,7 @@ public:
         Serial.println();
 
         osc1WaveFolder.processorUsageMaxReset();
-        waveshapeL.processorUsageMaxReset();
+        waveshape.processorUsageMaxReset();
         osc1.processorUsageMaxReset();
         oscFm.processorUsageMaxReset();
         filter1L.processorUsageMaxReset();
@@ -836,8 +890,8 @@ public:
     {
         // reduce the the pre-filter gain to prevent clipping cause by the gain around the resonance peak
         auto gain = 0.85f * pow(0.05f, value) + 0.15f;
-        filterPreAmpL.gain(gain);
-        filterPreAmpR.gain(gain);
+        filterPreAmpL.gain(0, gain);
+        filterPreAmpR.gain(0, gain);
 
         // map the resonance to 0.7f - 5.0f required by AudioFilterStateVariable
         auto resonance = map(value, 0.0f, 1.0f, 0.7f, 5.0f);
@@ -872,11 +926,11 @@ public:
      */
     void setFilter1Env2(float value)
     {
-        AudioNoInterrupts();
+        AudioTransaction::begin();
         filter1FreqMixer.gain(3, value);
         currentFilter1FreqModEnv2Offset = value / -2.0f;
         updateFilter1Freq();
-        AudioInterrupts();
+        AudioTransaction::end();
     }
 
     /**
@@ -940,7 +994,7 @@ public:
      */
     void setFilter2FrequencyOffset(float value)
     {
-        filter2FreqOffset.amplitude(value, TRANSITION_SPEED_MS);
+        filter2FreqMixer.offset(value);
     }
 
     /**
@@ -973,9 +1027,9 @@ public:
     void setOsc1SynthWaveform(uint8_t value)
     {
         currentOsc1SynthWaveform = value;
-        AudioNoInterrupts();
+        AudioTransaction::begin();
         restartOscWaveForms();
-        AudioInterrupts();
+        AudioTransaction::end();
     }
 
     /**
@@ -986,9 +1040,9 @@ public:
     void setOscFmSynthWaveform(uint8_t value)
     {
         currentOscFmSynthWaveform = value;
-        AudioNoInterrupts();
+        AudioTransaction::begin();
         restartOscWaveForms();
-        AudioInterrupts();
+        AudioTransaction::end();
     }
 
     /**
@@ -999,7 +1053,7 @@ public:
     void setOsc1WaveFold(float value)
     {
         // 6,25% equals to 100% gain, above 6.25% wavefolding starts to happen
-        osc1WaveFold.amplitude(map(value, 0.0f, 1.0f, 0.0625f, 1.0f), TRANSITION_SPEED_MS);
+        osc1WaveFoldMixer.offset(map(value, 0.0f, 1.0f, 0.0625f, 1.0f));
     }
 
     /**
@@ -1009,7 +1063,7 @@ public:
      */
     void setOsc1Shape(float value)
     {
-        osc1Shape.amplitude(value, TRANSITION_SPEED_MS);
+        osc1ShapeMixer.offset(value);
     }
 
     /**
@@ -1152,6 +1206,16 @@ public:
         osc1UnisonMixerR.gain(2, unisonMixSide);
     }
 
+    /**
+     * Set the osc fm oversampling factor.
+     * 
+     * @param value oversampling factor (1 or 2)
+     */
+    void setOscFmOversampling(uint8_t value)
+    {
+        oscFm.oversampling(value);
+    }
+
     /**
      * Set the level of osc fm phase modulation using env 2.
      * 
@@ -1169,27 +1233,33 @@ public:
      */
     void setOscFmPhaseMod(float value)
     {
-        oscFmPhaseMod.amplitude(value, TRANSITION_SPEED_MS);
+        oscFmPhaseModMixer.offset(value);
     }
 
     /**
      * Set the waveshape level.
      * 
+     * The waveshape table itself is provided by Synth.
+     * 
      * @param value level (0.0f - 1.0f)
      */
-    void setWaveshapeLevel(float value, float waveshapeArray[], const uint16_t waveshapeArraySize)
+    void setWaveshapeLevel(float value)
     {
         // try to compensate for gain increase caused by the waveshaping
         auto cleanGain = 1.0f - pow(value, 0.6f);
         auto waveshapeGain = pow(value, 0.5f) / 2.5f;
 
-        waveshapeMixerL.gain(0, cleanGain);
-        waveshapeMixerR.gain(0, cleanGain);
-        waveshapeMixerL.gain(1, waveshapeGain);
-        waveshapeMixerR.gain(1, waveshapeGain);
+        waveshape.mix(cleanGain, waveshapeGain);
+    }
 
-        waveshapeL.shape(waveshapeArray, waveshapeArraySize);
-        waveshapeR.shape(waveshapeArray, waveshapeArraySize);
+    /**
+     * Set the waveshape oversampling factor.
+     * 
+     * @param value oversampling factor (1, 2 or 4)
+     */
+    void setWaveshapeOversampling(uint8_t value)
+    {
+        waveshape.oversampling(value);
     }
 
     /**
@@ -1,7 +1,6 @@
 #ifndef SynthWaveform_h
 #define SynthWaveform_h
 
-#include <string>
 #include <stdint.h>
 
 /**
@@ -11,7 +10,7 @@
 struct SynthWaveform
 {
 public:
-    const std::string name;
+    const char *const name;
     const short audioWaveform;
     const int16_t *waveFormArray;
 };
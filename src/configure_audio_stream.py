@@ -0,0 +1,32 @@
+#!/usr/bin/env python3
+
+import os
+import re
+import sys
+
+# script for setting AUDIO_BLOCK_SAMPLES and AUDIO_SAMPLE_RATE_EXACT in the Teensy core AudioStream.h, see Code.md
+#
+# usage: configure_audio_stream.py [block samples] [sample rate]
+# defaults: 16 samples, 44117.64706Hz (the Teensy 4 default sample rate)
+# the values can also be set using the AUDIO_BLOCK_SAMPLES and AUDIO_SAMPLE_RATE_EXACT environment variables
+
+block_samples = int(sys.argv[1] if len(sys.argv) > 1 else os.environ.get("AUDIO_BLOCK_SAMPLES", "16"))
+sample_rate = float(sys.argv[2] if len(sys.argv) > 2 else os.environ.get("AUDIO_SAMPLE_RATE_EXACT", "44117.64706"))
+
+if block_samples < 8 or block_samples > 128 or block_samples & (block_samples - 1) != 0:
+    sys.exit("block samples must be a power of 2 between 8 and 128")
+
+filepath = os.path.expanduser("~/.platformio/packages/framework-arduinoteensy/cores/teensy4/AudioStream.h")
+if os.name == "nt":
+    filepath = os.path.expandvars("%userprofile%\\.platformio\\packages\\framework-arduinoteensy\\cores\\teensy4\\AudioStream.h")
+
+with open(filepath, "r") as f:
+    content = f.read()
+
+content = re.sub(r"#define AUDIO_BLOCK_SAMPLES +[0-9]+", "#define AUDIO_BLOCK_SAMPLES  %d" % block_samples, content)
+content = re.sub(r"#define AUDIO_SAMPLE_RATE_EXACT +[0-9.]+f?", "#define AUDIO_SAMPLE_RATE_EXACT %.5ff" % sample_rate, content)
+
+with open(filepath, "w") as f:
+    f.write(content)
+
+print("AUDIO_BLOCK_SAMPLES set to %d, AUDIO_SAMPLE_RATE_EXACT set to %.5f in %s" % (block_samples, sample_rate, filepath))
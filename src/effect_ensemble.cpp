@@ -45,11 +45,11 @@ AudioEffectEnsemble::AudioEffectEnsemble() : AudioStream(1, inputQueueArray){
   inIndex = 0;
   // output indexes
   // default to center of buffer
-  outIndex1 = 512;
-  outIndex2 = 512;
-  outIndex3 = 512;
-  outIndex4 = 512;
-  outIndex5 = 512;
+  outIndex1 = ENSEMBLE_BUFFER_SIZE / 2;
+  outIndex2 = ENSEMBLE_BUFFER_SIZE / 2;
+  outIndex3 = ENSEMBLE_BUFFER_SIZE / 2;
+  outIndex4 = ENSEMBLE_BUFFER_SIZE / 2;
+  outIndex5 = ENSEMBLE_BUFFER_SIZE / 2;
   // lfo index
   // seprated by sixths to approximate 60 degree phase relationship
   lfoIndex1 = 0;
@@ -68,38 +68,13 @@ AudioEffectEnsemble::AudioEffectEnsemble() : AudioStream(1, inputQueueArray){
 }
 
 // TODO: move this to one of the data files, use in output_adat.cpp, output_tdm.cpp, etc
-static const audio_block_t zeroblock = {
-  0, 0, 0, {
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-#if AUDIO_BLOCK_SAMPLES > 16
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-#endif
-#if AUDIO_BLOCK_SAMPLES > 32
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-#endif
-#if AUDIO_BLOCK_SAMPLES > 48
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-#endif
-#if AUDIO_BLOCK_SAMPLES > 64
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-#endif
-#if AUDIO_BLOCK_SAMPLES > 80
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-#endif
-#if AUDIO_BLOCK_SAMPLES > 96
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-#endif
-#if AUDIO_BLOCK_SAMPLES > 112
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-#endif
-  }
-};
+static const audio_block_t zeroblock = {};
 
 //Rate is in Hz
 void AudioEffectEnsemble::lfoRate(float rate)
 {
-  //Assumes COUNTS_PER_LFO is giving 6Hz
-  countsPerLfo = round((COUNTS_PER_LFO * 6) / rate);
+  //Assumes COUNTS_PER_LFO is giving 6Hz at 44.1kHz
+  countsPerLfo = round((COUNTS_PER_LFO * 6) / rate * ENSEMBLE_SAMPLE_RATE_SCALE);
   if (countsPerLfo < 1) {
     countsPerLfo = 1;
   }
@@ -185,17 +160,17 @@ void AudioEffectEnsemble::update(void)
       outIndex5 = 0;
       
 #ifdef LARGE_ENSEMBLE_LFO_TABLE
-    offset1 = lfoTable[lfoIndex1];
-    offset2 = lfoTable[lfoIndex2];
-    offset3 = lfoTable[lfoIndex3];
-    offset4 = lfoTable[lfoIndex4];
-    offset5 = lfoTable[lfoIndex5];
+    offset1 = lfoTable[lfoIndex1] * ENSEMBLE_SAMPLE_RATE_SCALE;
+    offset2 = lfoTable[lfoIndex2] * ENSEMBLE_SAMPLE_RATE_SCALE;
+    offset3 = lfoTable[lfoIndex3] * ENSEMBLE_SAMPLE_RATE_SCALE;
+    offset4 = lfoTable[lfoIndex4] * ENSEMBLE_SAMPLE_RATE_SCALE;
+    offset5 = lfoTable[lfoIndex5] * ENSEMBLE_SAMPLE_RATE_SCALE;
 #else
-    offset1 = lfoLookup(lfoIndex1);
-    offset2 = lfoLookup(lfoIndex2);
-    offset3 = lfoLookup(lfoIndex3);
-    offset4 = lfoLookup(lfoIndex4);
-    offset5 = lfoLookup(lfoIndex5);
+    offset1 = lfoLookup(lfoIndex1) * ENSEMBLE_SAMPLE_RATE_SCALE;
+    offset2 = lfoLookup(lfoIndex2) * ENSEMBLE_SAMPLE_RATE_SCALE;
+    offset3 = lfoLookup(lfoIndex3) * ENSEMBLE_SAMPLE_RATE_SCALE;
+    offset4 = lfoLookup(lfoIndex4) * ENSEMBLE_SAMPLE_RATE_SCALE;
+    offset5 = lfoLookup(lfoIndex5) * ENSEMBLE_SAMPLE_RATE_SCALE;
 #endif
     
 
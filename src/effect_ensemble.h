@@ -35,9 +35,12 @@
 
 #include <Arduino.h>
 #include "AudioStream.h"
-#define ENSEMBLE_BUFFER_SIZE 1024
+// The delays, the modulation depth (the lfoTable values, see LFO_RANGE) and PHASE_90 are counted in samples at 44.1kHz.
+// They are scaled by the sample rate, so the ensemble sounds the same at every sample rate.
+#define ENSEMBLE_SAMPLE_RATE_SCALE (AUDIO_SAMPLE_RATE_EXACT / 44100.0f)
+#define ENSEMBLE_BUFFER_SIZE ((int16_t)(1024 * ENSEMBLE_SAMPLE_RATE_SCALE + 0.5f))
 // to put a channel 90 degrees out of LFO phase for stereo spread
-#define PHASE_90 367
+#define PHASE_90 (367 * ENSEMBLE_SAMPLE_RATE_SCALE)
 
 // LFO wavetable parameters
 #ifdef LARGE_ENSEMBLE_LFO_TABLE
@@ -2,7 +2,7 @@
 #define fnptr_h
 
 // template to allow capturing on regular function pointers
-// see [SynthController.h](SynthController.h) for actual usage of fnptr
+// see [PatchService.h](PatchService.h) for actual usage of fnptr
 // source: https://stackoverflow.com/a/45365798
 
 // please note: this template uses static storage for captured variables, all instances of the same lambda will share the same captured variable values!
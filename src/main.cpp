@@ -6,7 +6,17 @@
 
 // #define DEBUG_MIDI_HANDLERS
 // #define DEBUG_CPU_USAGE
+// #define DEBUG_BENCHMARK
+// #define MIDI_OUT_NRPN
+// #define MPE_MEMBER_CHANNELS 15
+// #define MIDI_CHANNELS_USB 0x0001
+// #define MIDI_CHANNELS_SERIAL 0x0001
+// #define MIDI_CHANNELS_USB_HOST 0xFFFF
+// #define MIDI_ZONES {{1, 0, 59, 12}, {1, 60, 127, 0}, {2, 0, 127, -12}}
+// #define DEBUG_MIDI_CAPTURE
+// #define DEBUG_MIDI_REPLAY
 // #define DISABLE_OSC_RESTART
+// #define PATCH_STORAGE_LITTLEFS
 
 #include "Constants.h"
 #include "MiscUtil.h"
@@ -18,15 +28,18 @@
 #include <vector>
 
 
-#if AUDIO_BLOCK_SAMPLES != 16 && !defined DISABLE_AUDIO_BLOCK_SAMPLES_CHECK
-    #error AUDIO_BLOCK_SAMPLES is not equal to 16, see instructions in Code.md for updating AUDIO_BLOCK_SAMPLES
+// the audio engine supports power of 2 block sizes from 8 to 128 samples, 16 is recommended
+#if (AUDIO_BLOCK_SAMPLES < 8 || AUDIO_BLOCK_SAMPLES > 128 || (AUDIO_BLOCK_SAMPLES & (AUDIO_BLOCK_SAMPLES - 1)) != 0) && !defined DISABLE_AUDIO_BLOCK_SAMPLES_CHECK
+    #error AUDIO_BLOCK_SAMPLES is not a power of 2 between 8 and 128, see instructions in Code.md for updating AUDIO_BLOCK_SAMPLES
 #endif
 
 // main entrypoint for initializing the synthesizer and task handling
 
-// hardware serial MIDI for 5 pin DIN MIDI interface
+// hardware serial MIDI for 5 pin DIN MIDI interface, using running status (see MidiOutputQueue.h)
 static midi::SerialMIDI<HardwareSerial> serialMIDI1(Serial1);
-static midi::MidiInterface<midi::SerialMIDI<HardwareSerial>> hardwareSerialMIDI((midi::SerialMIDI<HardwareSerial>&)serialMIDI1);
+static SerialMidiInterface hardwareSerialMIDI((midi::SerialMIDI<HardwareSerial>&)serialMIDI1);
+// additional transmit buffer, so sending a SysEx patch dump doesn't wait for the serial port (see PatchSysEx.h)
+static uint8_t serialMIDI1WriteBuffer[PatchSysEx::PATCH_DUMP_SIZE];
 
 // USB host MIDI interface for connecting to the Akai MIDImix
 // 3 USB hubs are instantiatied, in case USB hubs are used (some hubs contain multiple sub-hubs internally)
@@ -51,6 +64,7 @@ static SynthController synthController;
 void setup()
 {
     hardwareSerialMIDI.begin();
+    Serial1.addMemoryForWrite(serialMIDI1WriteBuffer, sizeof(serialMIDI1WriteBuffer));
     USBHost::begin();
 
     // add a slight delay to wait for the USB host and MIDImix to come online, otherwise the first commands sent to the MIDImix will be lost
@@ -64,12 +78,12 @@ void setup()
 
     AudioMemory(128);
 
-    synthController.initialize(PARAMS, &usbHostMidiDevices, &usbMIDI, &hardwareSerialMIDI);
+    synthController.initialize(&usbHostMidiDevices, &usbMIDI, &hardwareSerialMIDI);
 }
 
 /**
  * Task loop.
- * Invokes task() / read() calls on the synthesizer USB and MIDI devices.
+ * Invokes task() calls on the synthesizer and the USB host, the MIDI devices are read by the synthesizer MIDI task.
  */
 void loop()
 {
@@ -106,52 +120,17 @@ void loop()
     #endif
 
     #ifdef DEBUG_CPU_USAGE
-    elapsedMillis usbHostMidiDevicesRead;
+    elapsedMillis synthControllerMidiTask;
     #endif
 
-    // read and handle incoming USB host MIDI
-    for (auto &usbHostMidiDevice : usbHostMidiDevices)
-    {
-        usbHostMidiDevice->read();
-    }
-
-    #ifdef DEBUG_CPU_USAGE
-    if (usbHostMidiDevicesRead > 1) {
-        Serial.println();
-        Serial.print("usbHostMidiDevices->read(): ");
-        Serial.print(usbHostMidiDevicesRead);
-        Serial.println("ms");
-    }
-    #endif
-
-    #ifdef DEBUG_CPU_USAGE
-    elapsedMillis usbMidiRead;
-    #endif
-
-    // read and handle incoming USB MIDI
-    usbMIDI.read();
-
-    #ifdef DEBUG_CPU_USAGE
-    if (usbMidiRead > 1) {
-        Serial.println();
-        Serial.print("usbMIDI.read(): ");
-        Serial.print(usbMidiRead);
-        Serial.println("ms");
-    }
-    #endif
-
-    #ifdef DEBUG_CPU_USAGE
-    elapsedMillis hardwareSerialMIDIRead;
-    #endif
-
-    // read and handle incoming hardware serial MIDI
-    hardwareSerialMIDI.read();
+    // read incoming USB host, USB and hardware serial MIDI and handle the queued messages
+    synthController.midiTask();
 
     #ifdef DEBUG_CPU_USAGE
-    if (hardwareSerialMIDIRead > 1) {
+    if (synthControllerMidiTask > 1) {
         Serial.println();
-        Serial.print("hardwareSerialMIDI.read(): ");
-        Serial.print(hardwareSerialMIDIRead);
+        Serial.print("synthController.midiTask(): ");
+        Serial.print(synthControllerMidiTask);
         Serial.println("ms");
     }
     #endif
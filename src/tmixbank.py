@@ -0,0 +1,151 @@
+#!/usr/bin/env python3
+
+import os
+import struct
+import sys
+import zlib
+
+# script for converting patch files (tmixpatch/N.tmixpatch) to a patch bank file and validating patch bank files,
+# see src/PatchBank.h for the patch bank file format
+#
+# usage: tmixbank.py convert [patch folder] [bank file]
+#        tmixbank.py validate [bank file]
+# defaults: ../tmixpatch as patch folder, bank.tmixbank in the patch folder as bank file
+
+PATCH_COUNT = 64
+NAME_LENGTH = 8
+PATCH_SIGNATURE = b"TMP0"
+BANK_SIGNATURE = b"TMBK"
+BANK_VERSION = 2
+HEADER_SIZE = 16
+HEADER_CRC_OFFSET = 12
+# param value size and value not set per bank version, version 2 stores 14-bit values (value << 7 | fine value)
+VALUE_SIZE = {1: 1, 2: 2}
+VALUE_NOT_SET = {1: 255, 2: 65535}
+
+dname = os.path.dirname(os.path.abspath(__file__))
+default_patch_folder = os.path.join(dname, "..", "tmixpatch")
+
+
+def read_patch_file(filepath):
+    with open(filepath, "rb") as f:
+        data = f.read()
+
+    if data[:4] != PATCH_SIGNATURE or len(data) < 4 + NAME_LENGTH:
+        raise ValueError("%s: invalid patch file" % filepath)
+
+    name = data[4:4 + NAME_LENGTH]
+    values = {}
+    for position in range(4 + NAME_LENGTH, len(data) - 2, 3):
+        param_id, value = struct.unpack_from("<HB", data, position)
+        values[param_id] = value
+
+    return name, values
+
+
+def convert(patch_folder, bank_filepath):
+    patches = {}
+    for patch_number in range(PATCH_COUNT):
+        filepath = os.path.join(patch_folder, "%d.tmixpatch" % patch_number)
+        if os.path.exists(filepath):
+            patches[patch_number] = read_patch_file(filepath)
+
+    # all param IDs found in the patch files, values of params missing in a patch file are not set
+    param_ids = sorted(set(param_id for name, values in patches.values() for param_id in values))
+    param_count = len(param_ids)
+    record_size = NAME_LENGTH + param_count * VALUE_SIZE[BANK_VERSION] + 4
+    records_offset = HEADER_SIZE + param_count * 2 + PATCH_COUNT * 4
+
+    index = b""
+    records = b""
+    for patch_number in range(PATCH_COUNT):
+        if patch_number in patches:
+            name, values = patches[patch_number]
+            record = name + b"".join(
+                struct.pack("<H", values[param_id] << 7 if param_id in values else VALUE_NOT_SET[BANK_VERSION])
+                for param_id in param_ids)
+            index += struct.pack("<I", records_offset + len(records))
+            records += record + struct.pack("<I", zlib.crc32(record))
+        else:
+            index += struct.pack("<I", 0)
+
+    header = BANK_SIGNATURE + struct.pack("<HHHH", BANK_VERSION, PATCH_COUNT, param_count, record_size)
+    param_table = b"".join(struct.pack("<H", param_id) for param_id in param_ids)
+    header_crc = zlib.crc32(param_table + index, zlib.crc32(header))
+
+    with open(bank_filepath, "wb") as f:
+        f.write(header + struct.pack("<I", header_crc) + param_table + index + records)
+
+    print("Converted %d patch files with %d params to %s" % (len(patches), param_count, bank_filepath))
+
+
+def validate(bank_filepath):
+    with open(bank_filepath, "rb") as f:
+        data = f.read()
+
+    errors = []
+    if len(data) < HEADER_SIZE or data[:4] != BANK_SIGNATURE:
+        sys.exit("%s: invalid signature" % bank_filepath)
+
+    version, patch_count, param_count, record_size, header_crc = struct.unpack_from("<HHHHI", data, 4)
+    if version not in VALUE_SIZE:
+        sys.exit("%s: unsupported version %d" % (bank_filepath, version))
+    if record_size != NAME_LENGTH + param_count * VALUE_SIZE[version] + 4:
+        errors.append("record size %d doesn't match param count %d" % (record_size, param_count))
+
+    index_offset = HEADER_SIZE + param_count * 2
+    records_offset = index_offset + patch_count * 4
+    if len(data) < records_offset:
+        sys.exit("%s: file too short for the header (%d bytes)" % (bank_filepath, len(data)))
+    if zlib.crc32(data[HEADER_SIZE:records_offset], zlib.crc32(data[:HEADER_CRC_OFFSET])) != header_crc:
+        errors.append("invalid header CRC")
+
+    param_ids = struct.unpack_from("<%dH" % param_count, data, HEADER_SIZE)
+    if len(set(param_ids)) != param_count:
+        errors.append("duplicate param IDs")
+
+    print("%s: version %d, %d patches, %d params, %d bytes" % (bank_filepath, version, patch_count, param_count, len(data)))
+
+    for patch_number in range(patch_count):
+        (offset,) = struct.unpack_from("<I", data, index_offset + patch_number * 4)
+        if offset == 0:
+            print("%2d: empty" % patch_number)
+            continue
+        if offset < records_offset or offset + record_size > len(data):
+            errors.append("patch %d: record offset %d out of range" % (patch_number, offset))
+            continue
+
+        record = data[offset:offset + record_size - 4]
+        (record_crc,) = struct.unpack_from("<I", data, offset + record_size - 4)
+        if zlib.crc32(record) != record_crc:
+            errors.append("patch %d: invalid record CRC" % patch_number)
+            continue
+
+        if version == 1:
+            values = record[NAME_LENGTH:]
+            max_value = 127
+        else:
+            values = struct.unpack_from("<%dH" % param_count, record, NAME_LENGTH)
+            max_value = 0x3FFF
+        not_set = sum(1 for value in values if value == VALUE_NOT_SET[version])
+        invalid = sum(1 for value in values if value > max_value and value != VALUE_NOT_SET[version])
+        if invalid:
+            errors.append("patch %d: %d param values out of range" % (patch_number, invalid))
+        print("%2d: %s%s" % (patch_number, record[:NAME_LENGTH].decode("ascii", "replace"), " (%d params not set)" % not_set if not_set else ""))
+
+    for error in errors:
+        print("Error: %s" % error)
+    if errors:
+        sys.exit(1)
+
+    print("OK")
+
+
+command = sys.argv[1] if len(sys.argv) > 1 else ""
+if command == "convert":
+    patch_folder = sys.argv[2] if len(sys.argv) > 2 else default_patch_folder
+    convert(patch_folder, sys.argv[3] if len(sys.argv) > 3 else os.path.join(patch_folder, "bank.tmixbank"))
+elif command == "validate":
+    validate(sys.argv[2] if len(sys.argv) > 2 else os.path.join(default_patch_folder, "bank.tmixbank"))
+else:
+    sys.exit("usage: tmixbank.py convert [patch folder] [bank file] | validate [bank file]")
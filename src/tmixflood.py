@@ -0,0 +1,275 @@
+#!/usr/bin/env python3
+
+import math
+import random
+import re
+import struct
+import sys
+import time
+
+# script for stress testing the MIDI handling of the synth with floods of notes, control changes, pitch bends and
+# program changes, to find out where the main loop stops keeping up
+#
+# usage: tmixflood.py capture [settings] [capture file]  write the flood as MIDI capture file, copy it to the SD card and
+#                                                        replay it on the synth (DEBUG_MIDI_REPLAY and DEBUG_CPU_USAGE
+#                                                        in src/main.cpp), all ports are driven through the ingest stage
+#        tmixflood.py send [settings] midi_device      send the flood live to a raw MIDI device (e.g. /dev/snd/midiC1D0
+#                                                        for USB MIDI on Linux or a serial port for DIN MIDI)
+#        tmixflood.py report log_file                  summarize the serial monitor log of a flood, exits with an error
+#                                                        if the synth did not keep up or the log has no statistics
+# settings (name=value, rates in messages per second, all ports together):
+#   notes=1000 ccs=1500 pitch=480 programs=2 seconds=10 note_ms=100 ports=USB,serial,USB_host controls=16,17,18,19,74
+#   seed=1
+# defaults: 3000 messages per second for 10 seconds, capture.tmixmidi as capture file
+
+CAPTURE_SIGNATURE = b"TMMC"
+CAPTURE_VERSION = 1
+SOURCE_NAME_SIZE = 12
+# MidiReplay::FILE_SIZE_MAX in src/MidiReplay.h
+REPLAY_FILE_SIZE_MAX = 256 * 1024
+# MidiEventType in src/MidiIngest.h
+NOTE_ON, NOTE_OFF, CONTROL_CHANGE, PITCH_CHANGE, PROGRAM_CHANGE = range(5)
+# MIDI ingest source indexes in src/SynthController.h, the USB host sources follow the external MIDI sources
+SOURCES = {"USB": 0, "serial": 1, "USB_host": 2}
+SOURCE_NAMES = ["USB", "serial", "USB host"]
+# 31250 baud, 10 bits per byte, 3 bytes per message
+SERIAL_MESSAGES_PER_SECOND = 31250 / 10 / 3
+# notes are kept below MIDI_NOTE_MAX in src/SynthController.h
+NOTE_FIRST = 36
+NOTE_LAST = 84
+CHANNEL = 1
+
+DEFAULT_SETTINGS = {
+    "notes": "1000",
+    "ccs": "1500",
+    "pitch": "480",
+    "programs": "2",
+    "seconds": "10",
+    "note_ms": "100",
+    "ports": "USB,serial,USB_host",
+    "controls": "16,17,18,19,74",
+    "seed": "1",
+}
+
+
+def parse_settings(arguments):
+    settings = dict(DEFAULT_SETTINGS)
+    rest = []
+    for argument in arguments:
+        name, separator, value = argument.partition("=")
+        if not separator:
+            rest.append(argument)
+        elif name not in settings:
+            sys.exit("unknown setting %s" % name)
+        else:
+            settings[name] = value
+    return settings, rest
+
+
+def schedule(rate, seconds, rng):
+    """Evenly spread timestamps in microseconds with a little jitter, like a DAW sending automation."""
+    if rate <= 0:
+        return []
+    interval = 1000000.0 / rate
+    return [int(i * interval + rng.uniform(0, interval / 2)) for i in range(int(rate * seconds))]
+
+
+def generate(settings):
+    """Generate the flood, returns a sorted list of (time in microseconds, source, type, data1, data2)."""
+    rng = random.Random(int(settings["seed"]))
+    seconds = float(settings["seconds"])
+    ports = [SOURCES[port] for port in settings["ports"].split(",")]
+    controls = [int(control) for control in settings["controls"].split(",")]
+    note_micros = int(settings["note_ms"]) * 1000
+
+    events = []
+
+    # note messages, half of them note on, each followed by its note off
+    for i, timestamp in enumerate(schedule(float(settings["notes"]) / 2, seconds, rng)):
+        source = ports[i % len(ports)]
+        note = NOTE_FIRST + (i * 7) % (NOTE_LAST - NOTE_FIRST + 1)
+        events.append((timestamp, source, NOTE_ON, note, 100))
+        events.append((timestamp + note_micros, source, NOTE_OFF, note, 0))
+
+    # control changes sweeping up and down, spread over the controls
+    for i, timestamp in enumerate(schedule(float(settings["ccs"]), seconds, rng)):
+        sweep = (i // len(controls)) % 254
+        events.append((timestamp, ports[i % len(ports)], CONTROL_CHANGE, controls[i % len(controls)], min(sweep, 254 - sweep)))
+
+    # pitch bend sine, 1 Hz
+    for i, timestamp in enumerate(schedule(float(settings["pitch"]), seconds, rng)):
+        pitch = int(8191 * math.sin(2 * math.pi * timestamp / 1000000.0))
+        events.append((timestamp, ports[i % len(ports)], PITCH_CHANGE, 0, pitch))
+
+    # program changes cycling through the first patches
+    for i, timestamp in enumerate(schedule(float(settings["programs"]), seconds, rng)):
+        events.append((timestamp, ports[i % len(ports)], PROGRAM_CHANGE, i % 8, 0))
+
+    events.sort(key=lambda event: event[0])
+
+    # the wire rate of DIN MIDI limits what the serial port can carry in real life
+    serial_rate = sum(1 for event in events if event[1] == SOURCES["serial"]) / seconds if seconds > 0 else 0
+    if serial_rate > SERIAL_MESSAGES_PER_SECOND:
+        print("Warning: %.0f messages/s on the serial port, DIN MIDI carries at most %.0f" % (serial_rate, SERIAL_MESSAGES_PER_SECOND))
+    return events
+
+
+def capture(settings, capture_filepath):
+    events = generate(settings)
+
+    header = CAPTURE_SIGNATURE + struct.pack("<HBB", CAPTURE_VERSION, len(SOURCE_NAMES), 0)
+    header += b"".join(name.encode("ascii").ljust(SOURCE_NAME_SIZE, b"\0") for name in SOURCE_NAMES)
+    records = bytearray()
+    for timestamp, source, event_type, data1, data2 in events:
+        if event_type == PITCH_CHANGE:
+            value = data2 + 8192
+        else:
+            value = (data1 & 0x7F) | ((data2 & 0x7F) << 7)
+        records += struct.pack("<IBBH", timestamp & 0xFFFFFFFF, (source << 4) | event_type, CHANNEL, value)
+
+    with open(capture_filepath, "wb") as f:
+        f.write(header + records)
+    if len(header) + len(records) > REPLAY_FILE_SIZE_MAX:
+        print("Warning: the synth replays at most %d bytes, lower the rates or the seconds" % REPLAY_FILE_SIZE_MAX)
+    print("Wrote %d messages (%.0f messages/s) to %s, %d bytes" % (
+        len(events), len(events) / float(settings["seconds"]), capture_filepath, len(header) + len(records)))
+
+
+def encode_message(event_type, data1, data2):
+    status = [0x90, 0x80, 0xB0, 0xE0, 0xC0][event_type] | (CHANNEL - 1)
+    if event_type == PITCH_CHANGE:
+        return bytes([status, (data2 + 8192) & 0x7F, (data2 + 8192) >> 7])
+    if event_type == PROGRAM_CHANGE:
+        return bytes([status, data1])
+    return bytes([status, data1, data2])
+
+
+def send(settings, device_path):
+    events = generate(settings)
+
+    late_max = 0
+    late_count = 0
+    with open(device_path, "wb", buffering=0) as device:
+        start = time.monotonic()
+        for timestamp, source, event_type, data1, data2 in events:
+            delay = timestamp / 1000000.0 - (time.monotonic() - start)
+            if delay > 0:
+                time.sleep(delay)
+            else:
+                late_max = max(late_max, -delay)
+                late_count += 1 if -delay > 0.001 else 0
+            device.write(encode_message(event_type, data1, data2))
+        duration = time.monotonic() - start
+
+    print("Sent %d messages in %.3f s (%.0f messages/s), %d sent more than 1ms late, at most %.1fms late" % (
+        len(events), duration, len(events) / duration if duration > 0 else 0, late_count, late_max * 1000))
+
+
+def report(log_filepath):
+    with open(log_filepath, "r", errors="replace") as f:
+        lines = f.read().splitlines()
+
+    sources = {}
+    priorities = {}
+    cpu_max = 0.0
+    cpu_over = 0
+    update_max = 0.0
+    update_misses = 0
+    update_logs = 0
+    transaction_max = 0.0
+    transaction_logs = 0
+    transaction_overruns = 0
+    slow_tasks = {}
+    replays = []
+
+    for line in lines:
+        match = re.search(r"MIDI ingest source (.+): ([\d.]+) messages/s, (\d+) dropped, max (\d+) messages per drain(?:, (\d+) filtered)?(?:, (\d+) held back)?", line)
+        if match:
+            stats = sources.setdefault(match.group(1), {"rate": 0.0, "dropped": 0, "batch": 0, "filtered": 0, "held_back": 0})
+            stats["rate"] = max(stats["rate"], float(match.group(2)))
+            stats["dropped"] += int(match.group(3))
+            stats["batch"] = max(stats["batch"], int(match.group(4)))
+            stats["filtered"] += int(match.group(5) or 0)
+            stats["held_back"] += int(match.group(6) or 0)
+            continue
+
+        match = re.search(r"MIDI ingest priority (.+): (\d+) dispatched, latency (\d+)us average, (\d+)us max, max queue depth (\d+)", line)
+        if match:
+            stats = priorities.setdefault(match.group(1), {"dispatched": 0, "latency_total": 0, "latency_max": 0, "depth": 0})
+            stats["dispatched"] += int(match.group(2))
+            stats["latency_total"] += int(match.group(2)) * int(match.group(3))
+            stats["latency_max"] = max(stats["latency_max"], int(match.group(4)))
+            stats["depth"] = max(stats["depth"], int(match.group(5)))
+            continue
+
+        match = re.search(r"audio engine: .*CPU usage ([\d.]+)%", line)
+        if match:
+            cpu_max = max(cpu_max, float(match.group(1)))
+            cpu_over += 1 if float(match.group(1)) >= 100 else 0
+            continue
+
+        match = re.search(r"audio updates: ([\d.]+)us max, (\d+) missed the audio block", line)
+        if match:
+            update_max = max(update_max, float(match.group(1)))
+            update_misses += int(match.group(2))
+            update_logs += 1
+            continue
+
+        match = re.search(r"audio transactions: ([\d.]+)us max, (\d+) over the audio block", line)
+        if match:
+            transaction_max = max(transaction_max, float(match.group(1)))
+            transaction_overruns += int(match.group(2))
+            transaction_logs += 1
+            continue
+
+        match = re.search(r"(synthController\.task|synthController\.midiTask|USBHost::task)\(\): (\d+)ms", line)
+        if match:
+            count, longest = slow_tasks.get(match.group(1), (0, 0))
+            slow_tasks[match.group(1)] = (count + 1, max(longest, int(match.group(2))))
+            continue
+
+        match = re.search(r"MIDI replay finished, (\d+) messages in (\d+)ms, at most (\d+)us late, (\d+) more than (\d+)us late", line)
+        if match:
+            replays.append(match.groups())
+
+    # without the statistics nothing can be said about keeping up, e.g. a log of a build without DEBUG_CPU_USAGE
+    missing = [name for name, parsed in (("MIDI ingest", sources and priorities), ("audio update", update_logs), ("audio transaction", transaction_logs)) if not parsed]
+    if missing:
+        sys.exit("No %s statistics in %s, define DEBUG_CPU_USAGE in src/main.cpp and log at least one statistics period" % (
+            ", ".join(missing), log_filepath))
+
+    for stats_name, stats in sorted(sources.items()):
+        print("Source %s: peak %.0f messages/s, %d dropped, max %d messages per drain, %d filtered, %d held back" % (
+            stats_name, stats["rate"], stats["dropped"], stats["batch"], stats["filtered"], stats["held_back"]))
+    for stats_name, stats in priorities.items():
+        average = stats["latency_total"] / stats["dispatched"] if stats["dispatched"] else 0
+        print("Priority %s: %d dispatched, latency %.0fus average, %dus max, max queue depth %d" % (
+            stats_name, stats["dispatched"], average, stats["latency_max"], stats["depth"]))
+    for messages, milliseconds, late_max, late_count, late_micros in replays:
+        print("Replay: %s messages in %s ms, %s more than %sus late, at most %sus late" % (messages, milliseconds, late_count, late_micros, late_max))
+    for task_name, (count, longest) in sorted(slow_tasks.items()):
+        print("Slow %s(): %d times over 1ms, at most %dms" % (task_name, count, longest))
+    print("Audio: updates at most %.1fus, %d audio block deadlines missed, CPU usage at most %.1f%% (%d logs at 100%% or more)" % (
+        update_max, update_misses, cpu_max, cpu_over))
+    print("Audio: transactions at most %.1fus, %d postponing the audio update by an audio block or more" % (
+        transaction_max, transaction_overruns))
+
+    dropped = sum(stats["dropped"] for stats in sources.values())
+    late = sum(int(replay[3]) for replay in replays)
+    if dropped or late or update_misses or transaction_overruns:
+        sys.exit("Result: the synth did not keep up (%d dropped, %d late, %d audio deadlines missed, %d postponed by transactions)" % (
+            dropped, late, update_misses, transaction_overruns))
+    else:
+        print("Result: the synth kept up")
+
+
+command = sys.argv[1] if len(sys.argv) > 1 else ""
+settings, arguments = parse_settings(sys.argv[2:])
+if command == "capture":
+    capture(settings, arguments[0] if arguments else "capture.tmixmidi")
+elif command == "send" and arguments:
+    send(settings, arguments[0])
+elif command == "report" and arguments:
+    report(arguments[0])
+else:
+    sys.exit("usage: tmixflood.py capture [settings] [capture file] | send [settings] midi_device | report log_file")
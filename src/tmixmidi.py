@@ -0,0 +1,120 @@
+#!/usr/bin/env python3
+
+import struct
+import sys
+
+# script for decoding MIDI capture files (capture.tmixmidi on the SD card, see DEBUG_MIDI_CAPTURE in src/main.cpp),
+# see src/MidiCapture.h for the capture file format
+#
+# usage: tmixmidi.py events [capture file]   list all messages
+#        tmixmidi.py summary [capture file]  message counts per source, busiest millisecond and notes left on
+# defaults: capture.tmixmidi as capture file
+
+CAPTURE_SIGNATURE = b"TMMC"
+CAPTURE_VERSION = 1
+HEADER_SIZE = 8
+SOURCE_NAME_SIZE = 12
+RECORD_SIZE = 8
+# MidiEventType in src/MidiIngest.h
+EVENT_TYPES = ["noteOn", "noteOff", "controlChange", "pitchChange", "programChange", "channelPressure"]
+
+
+def read_capture(filepath):
+    with open(filepath, "rb") as f:
+        data = f.read()
+
+    if len(data) < HEADER_SIZE or data[:4] != CAPTURE_SIGNATURE:
+        sys.exit("%s: invalid signature" % filepath)
+    version, source_count = struct.unpack_from("<HB", data, 4)
+    if version != CAPTURE_VERSION:
+        sys.exit("%s: unsupported version %d" % (filepath, version))
+
+    sources = []
+    for source in range(source_count):
+        offset = HEADER_SIZE + source * SOURCE_NAME_SIZE
+        sources.append(data[offset:offset + SOURCE_NAME_SIZE].rstrip(b"\0").decode("ascii", "replace"))
+
+    events = []
+    timestamp_high = 0
+    last_timestamp = 0
+    records_offset = HEADER_SIZE + source_count * SOURCE_NAME_SIZE
+    for position in range(records_offset, len(data) - RECORD_SIZE + 1, RECORD_SIZE):
+        timestamp, source_type, channel, value = struct.unpack_from("<IBBH", data, position)
+        # timestamps wrap after 71 minutes
+        if timestamp < last_timestamp:
+            timestamp_high += 1 << 32
+        last_timestamp = timestamp
+
+        event_type = EVENT_TYPES[source_type & 0x0F] if source_type & 0x0F < len(EVENT_TYPES) else "unknown"
+        if event_type == "pitchChange":
+            data1, data2 = 0, value - 8192
+        else:
+            data1, data2 = value & 0x7F, value >> 7
+        events.append({
+            "time": timestamp_high + timestamp,
+            "source": source_type >> 4,
+            "type": event_type,
+            "channel": channel & 0x7F,
+            "controller": bool(channel & 0x80),
+            "data1": data1,
+            "data2": data2,
+        })
+
+    if (len(data) - records_offset) % RECORD_SIZE:
+        print("Warning: incomplete record at the end of %s" % filepath)
+
+    return sources, events
+
+
+def source_name(sources, source):
+    return sources[source] if source < len(sources) else "source %d" % source
+
+
+def print_events(sources, events):
+    for event in events:
+        print("%12.6f %-10s %-13s ch %2d %3d %5d%s" % (
+            event["time"] / 1000000.0, source_name(sources, event["source"]), event["type"], event["channel"],
+            event["data1"], event["data2"], " (controller)" if event["controller"] else ""))
+
+
+def print_summary(sources, events):
+    duration = events[-1]["time"] / 1000000.0 if events else 0.0
+    print("%d messages in %.3f s" % (len(events), duration))
+
+    for source in sorted(set(event["source"] for event in events)):
+        source_events = [event for event in events if event["source"] == source]
+        counts = ", ".join("%d %s" % (sum(1 for event in source_events if event["type"] == event_type), event_type)
+                           for event_type in EVENT_TYPES if any(event["type"] == event_type for event in source_events))
+        print("%s: %d messages (%s)" % (source_name(sources, source), len(source_events), counts))
+
+    # busiest millisecond, bursts like these cause the CPU spikes
+    per_millisecond = {}
+    for event in events:
+        millisecond = event["time"] // 1000
+        per_millisecond[millisecond] = per_millisecond.get(millisecond, 0) + 1
+    if per_millisecond:
+        millisecond, count = max(per_millisecond.items(), key=lambda item: item[1])
+        print("Busiest millisecond: %d messages at %.3f s" % (count, millisecond / 1000.0))
+
+    # notes without note off at the end of the capture, a note on with velocity 0 is a note off
+    notes_on = {}
+    for event in events:
+        if event["controller"] or event["type"] not in ("noteOn", "noteOff"):
+            continue
+        key = (event["source"], event["channel"], event["data1"])
+        if event["type"] == "noteOn" and event["data2"] > 0:
+            notes_on[key] = event["time"]
+        else:
+            notes_on.pop(key, None)
+    for (source, channel, note), time in sorted(notes_on.items(), key=lambda item: item[1]):
+        print("Note left on: %s ch %d note %d since %.6f s" % (source_name(sources, source), channel, note, time / 1000000.0))
+
+
+command = sys.argv[1] if len(sys.argv) > 1 else ""
+capture_filepath = sys.argv[2] if len(sys.argv) > 2 else "capture.tmixmidi"
+if command == "events":
+    print_events(*read_capture(capture_filepath))
+elif command == "summary":
+    print_summary(*read_capture(capture_filepath))
+else:
+    sys.exit("usage: tmixmidi.py events [capture file] | summary [capture file]")
@@ -0,0 +1,175 @@
+#!/usr/bin/env python3
+
+import struct
+import sys
+import zlib
+
+# script for converting between SysEx patch dumps (.syx files, as saved and sent by any SysEx librarian) and patch bank
+# files, see src/PatchSysEx.h for the SysEx messages and src/PatchBank.h for the patch bank file format
+#
+# usage: tmixsysex.py request [patch number] syx_file  write a patch request, or a bank request without patch number
+#        tmixsysex.py tobank syx_file bank_file         convert received patch dumps to a patch bank file
+#        tmixsysex.py tosyx bank_file syx_file          convert a patch bank file to patch dumps, to be sent with a
+#                                                       delay between the messages (or waiting for each patch ack)
+
+PATCH_COUNT = 64
+NAME_LENGTH = 8
+SYSEX_HEADER = bytes([0xF0, 0x7D, 0x54, 0x4D])
+SYSEX_END = 0xF7
+COMMAND_PATCH_REQUEST = 0x01
+COMMAND_BANK_REQUEST = 0x02
+COMMAND_PATCH_DUMP = 0x10
+BANK_SIGNATURE = b"TMBK"
+BANK_VERSION = 2
+HEADER_SIZE = 16
+HEADER_CRC_OFFSET = 12
+# param value size and value not set per bank version, see src/tmixbank.py
+VALUE_SIZE = {1: 1, 2: 2}
+VALUE_NOT_SET = {1: 255, 2: 65535}
+
+
+def checksum(data):
+    return (128 - (sum(data) & 0x7F)) & 0x7F
+
+
+def read_sysex_messages(filepath):
+    with open(filepath, "rb") as f:
+        data = f.read()
+
+    messages = []
+    start = data.find(0xF0)
+    while start >= 0:
+        end = data.find(SYSEX_END, start)
+        if end < 0:
+            break
+        messages.append(data[start:end + 1])
+        start = data.find(0xF0, end)
+    return messages
+
+
+def decode_patch_dump(message):
+    """Decode a patch dump, returns the patch number, name and a dict of 14-bit values by param ID."""
+    params = message[6 + NAME_LENGTH:-2]
+    if len(params) % 4 or message[5] >= PATCH_COUNT or sum(message[6:-1]) & 0x7F:
+        raise ValueError("invalid patch dump")
+
+    values = {}
+    for position in range(0, len(params), 4):
+        values[(params[position] << 7) | params[position + 1]] = (params[position + 2] << 7) | params[position + 3]
+    return message[5], message[6:6 + NAME_LENGTH], values
+
+
+def encode_patch_dump(patch_number, name, values):
+    body = bytearray(name)
+    for param_id, value in sorted(values.items()):
+        body += bytes([(param_id >> 7) & 0x7F, param_id & 0x7F, (value >> 7) & 0x7F, value & 0x7F])
+    return SYSEX_HEADER + bytes([COMMAND_PATCH_DUMP, patch_number]) + bytes(body) + bytes([checksum(body), SYSEX_END])
+
+
+def read_bank(filepath):
+    """Read a patch bank file, returns a dict of (name, 14-bit values by param ID) by patch number."""
+    with open(filepath, "rb") as f:
+        data = f.read()
+
+    if data[:4] != BANK_SIGNATURE:
+        sys.exit("%s: invalid signature" % filepath)
+    version, patch_count, param_count, record_size = struct.unpack_from("<HHHH", data, 4)
+    if version not in VALUE_SIZE:
+        sys.exit("%s: unsupported version %d" % (filepath, version))
+
+    param_ids = struct.unpack_from("<%dH" % param_count, data, HEADER_SIZE)
+    index_offset = HEADER_SIZE + param_count * 2
+    patches = {}
+    for patch_number in range(min(patch_count, PATCH_COUNT)):
+        (offset,) = struct.unpack_from("<I", data, index_offset + patch_number * 4)
+        if offset == 0:
+            continue
+        record = data[offset:offset + record_size - 4]
+        (record_crc,) = struct.unpack_from("<I", data, offset + record_size - 4)
+        if zlib.crc32(record) != record_crc:
+            print("Warning: patch %d has an invalid record CRC, skipped" % patch_number)
+            continue
+
+        if version == 1:
+            values = [value << 7 if value != VALUE_NOT_SET[1] else None for value in record[NAME_LENGTH:]]
+        else:
+            values = [value if value != VALUE_NOT_SET[2] else None
+                      for value in struct.unpack_from("<%dH" % param_count, record, NAME_LENGTH)]
+        patches[patch_number] = (record[:NAME_LENGTH],
+                                 {param_id: value for param_id, value in zip(param_ids, values) if value is not None})
+    return patches
+
+
+def write_bank(filepath, patches):
+    # all param IDs found in the patch dumps, values of params missing in a patch dump are not set
+    param_ids = sorted(set(param_id for name, values in patches.values() for param_id in values))
+    param_count = len(param_ids)
+    record_size = NAME_LENGTH + param_count * VALUE_SIZE[BANK_VERSION] + 4
+    records_offset = HEADER_SIZE + param_count * 2 + PATCH_COUNT * 4
+
+    index = b""
+    records = b""
+    for patch_number in range(PATCH_COUNT):
+        if patch_number in patches:
+            name, values = patches[patch_number]
+            record = name + b"".join(struct.pack("<H", values.get(param_id, VALUE_NOT_SET[BANK_VERSION]))
+                                     for param_id in param_ids)
+            index += struct.pack("<I", records_offset + len(records))
+            records += record + struct.pack("<I", zlib.crc32(record))
+        else:
+            index += struct.pack("<I", 0)
+
+    header = BANK_SIGNATURE + struct.pack("<HHHH", BANK_VERSION, PATCH_COUNT, param_count, record_size)
+    param_table = b"".join(struct.pack("<H", param_id) for param_id in param_ids)
+    header_crc = zlib.crc32(param_table + index, zlib.crc32(header))
+
+    with open(filepath, "wb") as f:
+        f.write(header + struct.pack("<I", header_crc) + param_table + index + records)
+
+
+def request(patch_number, syx_filepath):
+    if patch_number is None:
+        message = SYSEX_HEADER + bytes([COMMAND_BANK_REQUEST, SYSEX_END])
+    else:
+        message = SYSEX_HEADER + bytes([COMMAND_PATCH_REQUEST, patch_number, SYSEX_END])
+    with open(syx_filepath, "wb") as f:
+        f.write(message)
+    print("Wrote %s request to %s" % ("bank" if patch_number is None else "patch %d" % patch_number, syx_filepath))
+
+
+def to_bank(syx_filepath, bank_filepath):
+    patches = {}
+    for message in read_sysex_messages(syx_filepath):
+        if message[:4] != SYSEX_HEADER or len(message) < 6 or message[4] != COMMAND_PATCH_DUMP:
+            continue
+        try:
+            patch_number, name, values = decode_patch_dump(message)
+        except ValueError as error:
+            print("Warning: %s, skipped" % error)
+            continue
+        patches[patch_number] = (name, values)
+
+    write_bank(bank_filepath, patches)
+    print("Converted %d patch dumps to %s" % (len(patches), bank_filepath))
+
+
+def to_syx(bank_filepath, syx_filepath):
+    patches = read_bank(bank_filepath)
+    with open(syx_filepath, "wb") as f:
+        for patch_number, (name, values) in sorted(patches.items()):
+            f.write(encode_patch_dump(patch_number, name, values))
+    print("Converted %d patches to %s" % (len(patches), syx_filepath))
+
+
+command = sys.argv[1] if len(sys.argv) > 1 else ""
+if command == "request" and len(sys.argv) > 2:
+    if len(sys.argv) > 3:
+        request(int(sys.argv[2]), sys.argv[3])
+    else:
+        request(None, sys.argv[2])
+elif command == "tobank" and len(sys.argv) > 3:
+    to_bank(sys.argv[2], sys.argv[3])
+elif command == "tosyx" and len(sys.argv) > 3:
+    to_syx(sys.argv[2], sys.argv[3])
+else:
+    sys.exit("usage: tmixsysex.py request [patch number] syx_file | tobank syx_file bank_file | tosyx bank_file syx_file")
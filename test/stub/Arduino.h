@@ -0,0 +1,115 @@
+#ifndef Arduino_h
+#define Arduino_h
+
+// Host stand-in for the parts of the Teensy core used by the headers under test, see test/README.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <math.h>
+#include <stdio.h>
+#include <algorithm>
+#include <chrono>
+#include <string>
+
+#define PROGMEM
+
+#define F_CPU_ACTUAL 600000000
+// the cycle counter runs at F_CPU_ACTUAL, derived from the host clock
+#define ARM_DWT_CYCCNT ((uint32_t)(hostNanos() * (F_CPU_ACTUAL / 1000000) / 1000))
+
+// the host clock follows the real time, unless a test sets hostClockManual and advances hostClockNanos itself (e.g. to
+// replay MIDI with the captured timing while stepping through it in a debugger)
+inline bool hostClockManual{false};
+inline uint64_t hostClockNanos{0};
+
+inline uint64_t hostNanos()
+{
+    static const auto start = std::chrono::steady_clock::now();
+    if (hostClockManual)
+    {
+        return hostClockNanos;
+    }
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+inline uint32_t micros()
+{
+    return (uint32_t)(hostNanos() / 1000);
+}
+
+inline uint32_t millis()
+{
+    return (uint32_t)(hostNanos() / 1000000);
+}
+
+inline void __disable_irq() {}
+inline void __enable_irq() {}
+
+// min() and max() can be used unqualified in the Teensy core
+using std::max;
+using std::min;
+
+template <typename T, typename L, typename H>
+inline T constrain(T value, L low, H high)
+{
+    return value < low ? low : (value > high ? high : value);
+}
+
+template <typename T, typename A, typename B, typename C, typename D>
+inline T map(T value, A fromLow, B fromHigh, C toLow, D toHigh)
+{
+    return (value - fromLow) * (toHigh - toLow) / (fromHigh - fromLow) + toLow;
+}
+
+template <uint32_t (*Now)()>
+class elapsedTime
+{
+private:
+    uint32_t start{Now()};
+
+public:
+    elapsedTime() {}
+    elapsedTime(uint32_t value) : start(Now() - value) {}
+    operator uint32_t() const { return Now() - start; }
+    elapsedTime &operator=(uint32_t value) { start = Now() - value; return *this; }
+};
+
+using elapsedMillis = elapsedTime<millis>;
+using elapsedMicros = elapsedTime<micros>;
+
+// serial output is discarded, the tests print their own results, unless a test sets hostSerialCapture to collect the
+// printf() and println() output in hostSerialOutput (e.g. the statistics logged with DEBUG_CPU_USAGE)
+inline bool hostSerialCapture{false};
+inline std::string hostSerialOutput;
+
+struct HostSerial
+{
+    template <typename... Args> void print(Args...) {}
+
+    void println()
+    {
+        if (hostSerialCapture)
+        {
+            hostSerialOutput += '\n';
+        }
+    }
+
+    template <typename... Args> void println(Args...) {}
+
+    template <typename... Args> void printf(const char *format, Args... args)
+    {
+        if (hostSerialCapture)
+        {
+            char buffer[256];
+            snprintf(buffer, sizeof(buffer), format, args...);
+            hostSerialOutput += buffer;
+        }
+    }
+
+    explicit operator bool() const { return true; }
+};
+
+inline HostSerial Serial;
+
+#endif
@@ -0,0 +1,87 @@
+#ifndef Audio_h
+#define Audio_h
+
+// Host stand-in for the Teensy Audio library: an AudioStream whose inputs are set and whose output is read by the
+// test, update() is called directly.
+
+#include <Arduino.h>
+#include <array>
+
+#ifndef AUDIO_BLOCK_SAMPLES
+#define AUDIO_BLOCK_SAMPLES 16
+#endif
+#ifndef AUDIO_SAMPLE_RATE_EXACT
+#define AUDIO_SAMPLE_RATE_EXACT 44117.64706f
+#endif
+
+#define WAVEFORM_SINE 0
+#define WAVEFORM_SAWTOOTH 1
+#define WAVEFORM_SQUARE 2
+#define WAVEFORM_TRIANGLE 3
+#define WAVEFORM_ARBITRARY 4
+#define WAVEFORM_PULSE 5
+#define WAVEFORM_SAWTOOTH_REVERSE 6
+#define WAVEFORM_SAMPLE_HOLD 7
+#define WAVEFORM_TRIANGLE_VARIABLE 8
+#define WAVEFORM_BANDLIMIT_SAWTOOTH 9
+#define WAVEFORM_BANDLIMIT_SAWTOOTH_REVERSE 10
+#define WAVEFORM_BANDLIMIT_SQUARE 11
+#define WAVEFORM_BANDLIMIT_PULSE 12
+
+struct audio_block_t
+{
+    int16_t data[AUDIO_BLOCK_SAMPLES];
+};
+
+class AudioStream
+{
+public:
+    static const uint8_t INPUT_COUNT_MAX{4};
+    static const uint8_t OUTPUT_COUNT_MAX{2};
+
+    // set by the test before update(), consumed by receiveReadOnly() / receiveWritable()
+    std::array<audio_block_t *, INPUT_COUNT_MAX> inputs{};
+    // blocks transmitted by the last update()
+    std::array<audio_block_t *, OUTPUT_COUNT_MAX> outputs{};
+
+    // longest audio update in units of 64 CPU cycles, there is no audio update on the host
+    static inline uint16_t cpu_cycles_total_max{0};
+
+    AudioStream(uint8_t inputCount, audio_block_t **inputQueue) {}
+    virtual ~AudioStream() {}
+    virtual void update() = 0;
+
+protected:
+    audio_block_t *receiveReadOnly(uint8_t index = 0)
+    {
+        audio_block_t *block = inputs[index];
+        inputs[index] = nullptr;
+        return block;
+    }
+
+    audio_block_t *receiveWritable(uint8_t index = 0)
+    {
+        return receiveReadOnly(index);
+    }
+
+    audio_block_t *allocate()
+    {
+        return &pool[poolIndex++ % pool.size()];
+    }
+
+    void transmit(audio_block_t *block, uint8_t index = 0)
+    {
+        outputs[index] = block;
+    }
+
+    void release(audio_block_t *block) {}
+
+private:
+    std::array<audio_block_t, 8> pool;
+    uint8_t poolIndex{0};
+};
+
+inline void AudioNoInterrupts() {}
+inline void AudioInterrupts() {}
+
+#endif
@@ -0,0 +1,136 @@
+#ifndef FS_h
+#define FS_h
+
+// Host stand-in for the Teensy FS API: files are kept in memory. Power loss is emulated by a budget of units, every
+// byte written and every remove, rename and open for writing uses one unit. When the budget is used up the power is
+// lost: writes are truncated and all further changes are ignored, until the budget is reset.
+
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#define FILE_READ 0
+#define FILE_WRITE 1
+#define FILE_WRITE_BEGIN 2
+
+// remaining power budget in units, negative for unlimited power
+inline long hostPowerBudget{-1};
+
+/**
+ * Use power budget.
+ *
+ * @param units units requested
+ * @return long units granted, less than requested when the power is lost
+ */
+inline long hostUsePower(long units)
+{
+    if (hostPowerBudget < 0)
+    {
+        return units;
+    }
+    long granted = std::min(units, hostPowerBudget);
+    hostPowerBudget -= granted;
+    return granted;
+}
+
+class File
+{
+private:
+    std::vector<uint8_t> *data{nullptr};
+    size_t position{0};
+
+public:
+    File() {}
+    File(std::vector<uint8_t> *data, size_t position) : data(data), position(position) {}
+
+    explicit operator bool() const { return data != nullptr; }
+
+    size_t size() const { return data->size(); }
+    int available() const { return data->size() - position; }
+
+    size_t read(void *buffer, size_t size)
+    {
+        size_t count = std::min(size, data->size() - position);
+        memcpy(buffer, data->data() + position, count);
+        position += count;
+        return count;
+    }
+
+    size_t write(const void *buffer, size_t size)
+    {
+        size_t count = hostUsePower(size);
+        if (position + count > data->size())
+        {
+            data->resize(position + count);
+        }
+        memcpy(data->data() + position, buffer, count);
+        position += count;
+        return count;
+    }
+
+    bool seek(size_t position)
+    {
+        this->position = position;
+        return position <= data->size();
+    }
+
+    void close() {}
+};
+
+class FS
+{
+public:
+    // file contents by file name
+    std::map<std::string, std::vector<uint8_t>> files;
+
+    File open(const char *fileName, uint8_t mode = FILE_READ)
+    {
+        if (mode == FILE_READ)
+        {
+            auto file = files.find(fileName);
+            return file == files.end() ? File() : File(&file->second, 0);
+        }
+        if (hostUsePower(1) == 0)
+        {
+            return File();
+        }
+        std::vector<uint8_t> &data = files[fileName];
+        return File(&data, mode == FILE_WRITE ? data.size() : 0);
+    }
+
+    bool exists(const char *fileName)
+    {
+        return files.count(fileName) > 0 || directories.count(fileName) > 0;
+    }
+
+    bool mkdir(const char *directory)
+    {
+        directories.insert(directory);
+        return true;
+    }
+
+    bool remove(const char *fileName)
+    {
+        return hostUsePower(1) == 1 && files.erase(fileName) == 1;
+    }
+
+    bool rename(const char *oldFileName, const char *newFileName)
+    {
+        if (hostUsePower(1) == 0 || files.count(oldFileName) == 0 || files.count(newFileName) > 0)
+        {
+            return false;
+        }
+        files[newFileName] = std::move(files[oldFileName]);
+        files.erase(oldFileName);
+        return true;
+    }
+
+private:
+    std::set<std::string> directories;
+};
+
+#endif
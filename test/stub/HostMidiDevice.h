@@ -0,0 +1,131 @@
+#ifndef HostMidiDevice_h
+#define HostMidiDevice_h
+
+// Host stand-in for the MIDI input and output of the USB host MIDI devices, usbMIDI and the serial MIDI library.
+// A test queues incoming messages with hostReceive(), read() passes the next one to the registered handler like the
+// MIDI libraries do. Sent messages are collected in sent.
+
+#include <stdint.h>
+#include <deque>
+#include <vector>
+
+/**
+ * A MIDI message received or sent by a host MIDI device.
+ */
+struct HostMidiMessage
+{
+    enum class Type : uint8_t { noteOn, noteOff, controlChange, pitchChange, programChange, channelPressure, systemExclusive };
+
+    Type type;
+    uint8_t channel;
+    uint8_t data1;
+    // velocity, control value or pitch (-8192 - 8191)
+    int data2;
+};
+
+class HostMidiDevice
+{
+public:
+    // received messages, read() passes the first on
+    std::deque<HostMidiMessage> received;
+    // sent messages, SysEx messages are stored without their data
+    std::vector<HostMidiMessage> sent;
+
+private:
+    void (*noteOnHandler)(uint8_t, uint8_t, uint8_t){nullptr};
+    void (*noteOffHandler)(uint8_t, uint8_t, uint8_t){nullptr};
+    void (*controlChangeHandler)(uint8_t, uint8_t, uint8_t){nullptr};
+    void (*pitchChangeHandler)(uint8_t, int){nullptr};
+    void (*programChangeHandler)(uint8_t, uint8_t){nullptr};
+    void (*channelPressureHandler)(uint8_t, uint8_t){nullptr};
+    void (*systemExclusiveHandler)(uint8_t *, unsigned int){nullptr};
+
+public:
+    void setHandleNoteOn(void (*handler)(uint8_t, uint8_t, uint8_t)) { noteOnHandler = handler; }
+    void setHandleNoteOff(void (*handler)(uint8_t, uint8_t, uint8_t)) { noteOffHandler = handler; }
+    void setHandleControlChange(void (*handler)(uint8_t, uint8_t, uint8_t)) { controlChangeHandler = handler; }
+    void setHandlePitchChange(void (*handler)(uint8_t, int)) { pitchChangeHandler = handler; }
+    // the serial MIDI library calls it pitch bend
+    void setHandlePitchBend(void (*handler)(uint8_t, int)) { pitchChangeHandler = handler; }
+    void setHandleProgramChange(void (*handler)(uint8_t, uint8_t)) { programChangeHandler = handler; }
+    void setHandleAfterTouchChannel(void (*handler)(uint8_t, uint8_t)) { channelPressureHandler = handler; }
+    void setHandleSystemExclusive(void (*handler)(uint8_t *, unsigned int)) { systemExclusiveHandler = handler; }
+
+    /**
+     * Queue an incoming message, read by the next read().
+     */
+    void hostReceive(HostMidiMessage::Type type, uint8_t channel, uint8_t data1, int data2 = 0)
+    {
+        received.push_back(HostMidiMessage{type, channel, data1, data2});
+    }
+
+    /**
+     * Pass the next received message to its handler.
+     *
+     * @return bool true if a message was read
+     */
+    bool read()
+    {
+        if (received.empty())
+        {
+            return false;
+        }
+
+        HostMidiMessage message = received.front();
+        received.pop_front();
+        switch (message.type)
+        {
+        case HostMidiMessage::Type::noteOn:
+            // like the MIDI libraries, a note on with velocity 0 is a note off
+            if (message.data2 == 0 && noteOffHandler)
+            {
+                noteOffHandler(message.channel, message.data1, 0);
+            }
+            else if (noteOnHandler)
+            {
+                noteOnHandler(message.channel, message.data1, message.data2);
+            }
+            break;
+        case HostMidiMessage::Type::noteOff:
+            if (noteOffHandler) noteOffHandler(message.channel, message.data1, message.data2);
+            break;
+        case HostMidiMessage::Type::controlChange:
+            if (controlChangeHandler) controlChangeHandler(message.channel, message.data1, message.data2);
+            break;
+        case HostMidiMessage::Type::pitchChange:
+            if (pitchChangeHandler) pitchChangeHandler(message.channel, message.data2);
+            break;
+        case HostMidiMessage::Type::programChange:
+            if (programChangeHandler) programChangeHandler(message.channel, message.data1);
+            break;
+        case HostMidiMessage::Type::channelPressure:
+            if (channelPressureHandler) channelPressureHandler(message.channel, message.data1);
+            break;
+        case HostMidiMessage::Type::systemExclusive:
+            break;
+        }
+        return true;
+    }
+
+    void sendNoteOn(uint8_t note, uint8_t velocity, uint8_t channel, uint8_t cable = 0)
+    {
+        sent.push_back(HostMidiMessage{HostMidiMessage::Type::noteOn, channel, note, velocity});
+    }
+
+    void sendControlChange(uint8_t control, uint8_t value, uint8_t channel, uint8_t cable = 0)
+    {
+        sent.push_back(HostMidiMessage{HostMidiMessage::Type::controlChange, channel, control, value});
+    }
+
+    void sendProgramChange(uint8_t program, uint8_t channel, uint8_t cable = 0)
+    {
+        sent.push_back(HostMidiMessage{HostMidiMessage::Type::programChange, channel, program, 0});
+    }
+
+    void sendSysEx(uint32_t size, const uint8_t *data, bool hasTerm = false, uint8_t cable = 0)
+    {
+        sent.push_back(HostMidiMessage{HostMidiMessage::Type::systemExclusive, 0, 0, (int)size});
+    }
+};
+
+#endif
@@ -0,0 +1,19 @@
+#ifndef LiquidCrystal_h
+#define LiquidCrystal_h
+
+// Host stand-in for the LiquidCrystal library, the display output is discarded.
+
+#include <stdint.h>
+
+class LiquidCrystal
+{
+public:
+    LiquidCrystal(uint8_t rs, uint8_t enable, uint8_t d0, uint8_t d1, uint8_t d2, uint8_t d3) {}
+
+    void begin(uint8_t cols, uint8_t rows) {}
+    void clear() {}
+    void setCursor(uint8_t col, uint8_t row) {}
+    template <typename T> size_t print(T) { return 0; }
+};
+
+#endif
@@ -0,0 +1,17 @@
+#ifndef LittleFS_h
+#define LittleFS_h
+
+// Host stand-in for the LittleFS library, see FS.h.
+
+#include "FS.h"
+
+class LittleFS_Program : public FS
+{
+public:
+    bool begin(uint32_t size)
+    {
+        return true;
+    }
+};
+
+#endif
@@ -0,0 +1,45 @@
+#ifndef MIDI_h
+#define MIDI_h
+
+// Host stand-in for the parts of the Arduino MIDI library and the Teensy usbMIDI used by the headers under test, see
+// HostMidiDevice.h.
+
+#include <Arduino.h>
+#include "HostMidiDevice.h"
+
+class HardwareSerial
+{
+};
+
+inline HardwareSerial Serial1;
+
+namespace midi
+{
+    struct DefaultSettings
+    {
+        static const bool UseRunningStatus = false;
+        static const unsigned SysExMaxSize = 128;
+    };
+
+    template <typename SerialPort>
+    class SerialMIDI
+    {
+    public:
+        SerialMIDI(SerialPort &port) {}
+    };
+
+    template <typename Transport, typename Settings = DefaultSettings>
+    class MidiInterface : public HostMidiDevice
+    {
+    public:
+        MidiInterface(Transport &transport) {}
+
+        void begin() {}
+    };
+}
+
+class usb_midi_class : public HostMidiDevice
+{
+};
+
+#endif
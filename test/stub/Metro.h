@@ -0,0 +1,33 @@
+#ifndef Metro_h
+#define Metro_h
+
+// Host stand-in for the Metro library, using the host millis().
+
+#include <Arduino.h>
+
+class Metro
+{
+private:
+    uint32_t interval;
+    uint32_t previous{millis()};
+
+public:
+    Metro(uint32_t interval) : interval(interval) {}
+
+    uint8_t check()
+    {
+        if (millis() - previous >= interval)
+        {
+            previous = millis();
+            return 1;
+        }
+        return 0;
+    }
+
+    void reset()
+    {
+        previous = millis();
+    }
+};
+
+#endif
@@ -0,0 +1,103 @@
+#ifndef SynthStub_h
+#define SynthStub_h
+
+// Host stand-in for the Synth and SynthVoice classes used by the params (src/ConstantParams.h) and the SynthController,
+// for tests of the patch and MIDI handling that don't render audio. Include it before any header from src: Param.h
+// includes Synth.h from src, defining the include guards of Synth.h and SynthVoice.h makes those includes empty.
+// Add a setter here when a param calls a new Synth setter.
+// The notes and the sustain pedal played by the SynthController are logged in hostSynthCalls, e.g. "noteOn 60".
+
+#define Synth_h
+#define SynthVoice_h
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "ConstantSynthWaveforms.h"
+
+static const uint8_t MIDI_CHANNEL_COUNT{16};
+
+inline std::vector<std::string> hostSynthCalls;
+
+class Synth
+{
+public:
+    void initialize() {}
+    void logCpuUsageStats() {}
+    bool isSounding() { return false; }
+    void onNoteOn(uint8_t note, uint8_t velocity) { hostSynthCalls.push_back("noteOn " + std::to_string(note)); }
+    void onNoteOff(uint8_t note) { hostSynthCalls.push_back("noteOff " + std::to_string(note)); }
+    void onMpeNoteOn(uint8_t channel, uint8_t note, uint8_t velocity) { hostSynthCalls.push_back("noteOn " + std::to_string(note)); }
+    void onMpeNoteOff(uint8_t channel, uint8_t note) { hostSynthCalls.push_back("noteOff " + std::to_string(note)); }
+    void onSustainToggle(bool on) { hostSynthCalls.push_back(on ? "sustain on" : "sustain off"); }
+
+    template <typename... Args> void resetMpe(Args...) {}
+    template <typename... Args> void setModWhl(Args...) {}
+    template <typename... Args> void setMpePitchChange(Args...) {}
+    template <typename... Args> void setMpePressure(Args...) {}
+    template <typename... Args> void setMpeTimbre(Args...) {}
+    template <typename... Args> void setPitchChange(Args...) {}
+    template <typename... Args> void setVoiceFade(Args...) {}
+    template <typename... Args> void setAmpKbdVelocity(Args...) {}
+    template <typename... Args> void setAmpModLfo(Args...) {}
+    template <typename... Args> void setEnsembleLfoRate(Args...) {}
+    template <typename... Args> void setEnsembleMix(Args...) {}
+    template <typename... Args> void setEnv1Attack(Args...) {}
+    template <typename... Args> void setEnv1Decay(Args...) {}
+    template <typename... Args> void setEnv1Release(Args...) {}
+    template <typename... Args> void setEnv1Sustain(Args...) {}
+    template <typename... Args> void setEnv2Attack(Args...) {}
+    template <typename... Args> void setEnv2Decay(Args...) {}
+    template <typename... Args> void setEnv2Release(Args...) {}
+    template <typename... Args> void setEnv2Sustain(Args...) {}
+    template <typename... Args> void setEnvLfoAttack(Args...) {}
+    template <typename... Args> void setEnvReverse(Args...) {}
+    template <typename... Args> void setFilter1Env2(Args...) {}
+    template <typename... Args> void setFilter1Frequency(Args...) {}
+    template <typename... Args> void setFilter1KbdTrack(Args...) {}
+    template <typename... Args> void setFilter1KbdVelocity(Args...) {}
+    template <typename... Args> void setFilter1Lfo(Args...) {}
+    template <typename... Args> void setFilter1Resonance(Args...) {}
+    template <typename... Args> void setFilter2FrequencyOffset(Args...) {}
+    template <typename... Args> void setFilterMode(Args...) {}
+    template <typename... Args> void setLfoFreq(Args...) {}
+    template <typename... Args> void setLfoShape(Args...) {}
+    template <typename... Args> void setLfoWaveform(Args...) {}
+    template <typename... Args> void setOsc1Detune(Args...) {}
+    template <typename... Args> void setOsc1ModFreqEnv2(Args...) {}
+    template <typename... Args> void setOsc1ModFreqLfo(Args...) {}
+    template <typename... Args> void setOsc1ModShapeEnv2(Args...) {}
+    template <typename... Args> void setOsc1ModShapeLfo(Args...) {}
+    template <typename... Args> void setOsc1ModWaveFoldEnv2(Args...) {}
+    template <typename... Args> void setOsc1Shape(Args...) {}
+    template <typename... Args> void setOsc1SynthWaveform(Args...) {}
+    template <typename... Args> void setOsc1Transpose(Args...) {}
+    template <typename... Args> void setOsc1UnisonDetune(Args...) {}
+    template <typename... Args> void setOsc1UnisonMix(Args...) {}
+    template <typename... Args> void setOsc1WaveFold(Args...) {}
+    template <typename... Args> void setOscFmModPhaseEnv2(Args...) {}
+    template <typename... Args> void setOscFmOctave(Args...) {}
+    template <typename... Args> void setOscFmOversampling(Args...) {}
+    template <typename... Args> void setOscFmPhaseMod(Args...) {}
+    template <typename... Args> void setOscFmSynthWaveform(Args...) {}
+    template <typename... Args> void setOscFmTranspose(Args...) {}
+    template <typename... Args> void setOscVolumeMix(Args...) {}
+    template <typename... Args> void setPitchChangeRange(Args...) {}
+    template <typename... Args> void setWaveshapeLevel(Args...) {}
+    template <typename... Args> void setWaveshapeOversampling(Args...) {}
+};
+
+class SynthVoice
+{
+public:
+    static const SynthWaveform &getSynthWaveformByValue(uint8_t value)
+    {
+        if (value >= SYNTH_WAVEFORMS.size())
+        {
+            value = (uint8_t)SYNTH_WAVEFORMS.size() - 1;
+        }
+        return SYNTH_WAVEFORMS[value];
+    }
+};
+
+#endif
@@ -0,0 +1,61 @@
+#ifndef TeensyThreads_h
+#define TeensyThreads_h
+
+// Host stand-in for TeensyThreads: threads don't run on their own, a test runs the added thread function until it
+// yields (see hostRunThread()), so the test decides when the work of the thread is done.
+
+// thrown by Threads::yield() to return from a thread function to hostRunThread()
+struct HostThreadYield
+{
+};
+
+class Threads
+{
+public:
+    class Mutex
+    {
+    };
+
+    class Scope
+    {
+    public:
+        Scope(Mutex &mutex) {}
+    };
+
+    // function of the thread added last
+    void (*threadFunction)(){nullptr};
+
+    int addThread(void (*function)(), int arg = 0, int stackSize = -1, void *stack = nullptr)
+    {
+        threadFunction = function;
+        return 1;
+    }
+
+    int setTimeSlice(int id, unsigned int ticks)
+    {
+        return 1;
+    }
+
+    void yield()
+    {
+        throw HostThreadYield();
+    }
+};
+
+inline Threads threads;
+
+/**
+ * Run the thread added last until it yields.
+ */
+inline void hostRunThread()
+{
+    try
+    {
+        threads.threadFunction();
+    }
+    catch (const HostThreadYield &)
+    {
+    }
+}
+
+#endif
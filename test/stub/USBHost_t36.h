@@ -0,0 +1,20 @@
+#ifndef USBHost_t36_h
+#define USBHost_t36_h
+
+// Host stand-in for the parts of the USBHost_t36 library used by the headers under test.
+
+#include <stdint.h>
+#include "HostMidiDevice.h"
+
+class MIDIDeviceBase : public HostMidiDevice
+{
+public:
+    // USB IDs of the connected device, 0 if no device is connected
+    uint16_t hostVendor{0};
+    uint16_t hostProduct{0};
+
+    uint16_t idVendor() { return hostVendor; }
+    uint16_t idProduct() { return hostProduct; }
+};
+
+#endif
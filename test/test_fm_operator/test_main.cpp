@@ -0,0 +1,188 @@
+#include <unity.h>
+#include <stdio.h>
+#include <math.h>
+#include <complex>
+#include <vector>
+
+#include "AudioSynthFmOperator.h"
+
+// Aliasing of AudioSynthFmOperator, the measurement behind the tables in src/AudioSynthFmOperator.h.
+// A sine carrier is modulated by a sine of the same frequency, so all wanted components are harmonics of the carrier.
+// The saw and pulse are measured without modulation. The carrier is placed on an FFT bin, everything outside the
+// harmonic bins is aliasing.
+
+static const uint32_t FFT_SIZE{32768};
+// blocks rendered before measuring, so the half-band filters are settled
+static const uint32_t SETTLE_BLOCKS{64};
+
+struct AliasingCase
+{
+    float index;
+    // carrier frequency in FFT bins
+    uint32_t bin;
+    float aliasing1x;
+    float aliasing2x;
+};
+
+struct WaveformCase
+{
+    short waveform;
+    const char *name;
+    // carrier frequency in FFT bins, odd so no aliases fall on harmonic bins
+    uint32_t bin;
+    // the table in src/AudioSynthFmOperator.h
+    float aliasing1x;
+    float aliasing2x;
+};
+
+// 1khz, 2khz, 3khz and 4khz at the default sample rate
+static const WaveformCase waveformCases[]{
+    {WAVEFORM_SAWTOOTH, "saw", 743, -62.0f, -64.0f},
+    {WAVEFORM_SAWTOOTH, "saw", 1487, -72.0f, -75.0f},
+    {WAVEFORM_SAWTOOTH, "saw", 2229, -79.0f, -83.0f},
+    {WAVEFORM_SAWTOOTH, "saw", 2971, -79.0f, -85.0f},
+    {WAVEFORM_PULSE, "pulse", 743, -64.0f, -66.0f},
+    {WAVEFORM_PULSE, "pulse", 1487, -74.0f, -78.0f},
+    {WAVEFORM_PULSE, "pulse", 2229, -83.0f, -87.0f},
+    {WAVEFORM_PULSE, "pulse", 2971, -83.0f, -92.0f},
+};
+
+// 1khz, 3khz and 6khz at the default sample rate
+static AliasingCase cases[]{
+    {1.0f, 743, 0, 0},
+    {1.0f, 2228, 0, 0},
+    {0.5f, 2228, 0, 0},
+    {0.5f, 4456, 0, 0},
+    {0.25f, 2228, 0, 0},
+    {0.25f, 4456, 0, 0},
+};
+
+static void fft(std::vector<std::complex<double>> &data)
+{
+    const size_t n = data.size();
+    for (size_t i = 1, j = 0; i < n; i++)
+    {
+        size_t bit = n >> 1;
+        for (; j & bit; bit >>= 1)
+        {
+            j ^= bit;
+        }
+        j ^= bit;
+        if (i < j)
+        {
+            std::swap(data[i], data[j]);
+        }
+    }
+    for (size_t length = 2; length <= n; length <<= 1)
+    {
+        const std::complex<double> step = std::polar(1.0, -2.0 * M_PI / length);
+        for (size_t i = 0; i < n; i += length)
+        {
+            std::complex<double> w{1.0};
+            for (size_t j = 0; j < length / 2; j++)
+            {
+                std::complex<double> a = data[i + j];
+                std::complex<double> b = data[i + j + length / 2] * w;
+                data[i + j] = a + b;
+                data[i + j + length / 2] = a - b;
+                w *= step;
+            }
+        }
+    }
+}
+
+/**
+ * Render the operator and measure the aliasing.
+ *
+ * @return float level of the non-harmonic components relative to the total output in dB
+ */
+static float measureAliasing(short waveform, float index, uint32_t bin, uint8_t oversampling)
+{
+    const double carrier = bin * (double)AUDIO_SAMPLE_RATE_EXACT / FFT_SIZE;
+    AudioSynthFmOperator op;
+    op.begin(waveform);
+    op.frequency(carrier);
+    op.oversampling(oversampling);
+
+    std::vector<std::complex<double>> output;
+    uint32_t n{0};
+    for (uint32_t block = 0; output.size() < FFT_SIZE; block++)
+    {
+        audio_block_t modulator;
+        audio_block_t indexBlock;
+        for (uint16_t i = 0; i < AUDIO_BLOCK_SAMPLES; i++, n++)
+        {
+            modulator.data[i] = (int16_t)lround(32767.0 * sin(2.0 * M_PI * carrier * n / AUDIO_SAMPLE_RATE_EXACT));
+            indexBlock.data[i] = (int16_t)std::min(32767.0f, index * 32768.0f);
+        }
+        op.inputs[0] = &modulator;
+        op.inputs[1] = &indexBlock;
+        op.update();
+
+        for (uint16_t i = 0; block >= SETTLE_BLOCKS && i < AUDIO_BLOCK_SAMPLES; i++)
+        {
+            output.push_back(op.outputs[0]->data[i]);
+        }
+    }
+
+    fft(output);
+    double harmonics{0.0};
+    double aliasing{0.0};
+    for (uint32_t k = 1; k <= FFT_SIZE / 2; k++)
+    {
+        (k % bin == 0 ? harmonics : aliasing) += std::norm(output[k]);
+    }
+    return 10.0f * log10f(aliasing / (harmonics + aliasing));
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_aliasing_table()
+{
+    printf("index   carrier   1x        2x\n");
+    for (AliasingCase &aliasingCase : cases)
+    {
+        aliasingCase.aliasing1x = measureAliasing(WAVEFORM_SINE, aliasingCase.index, aliasingCase.bin, 1);
+        aliasingCase.aliasing2x = measureAliasing(WAVEFORM_SINE, aliasingCase.index, aliasingCase.bin, 2);
+        printf("%3.0f%%    %.0fkhz    %5.0fdB   %5.0fdB\n", aliasingCase.index * 100.0f,
+               aliasingCase.bin * AUDIO_SAMPLE_RATE_EXACT / FFT_SIZE / 1000.0f, aliasingCase.aliasing1x, aliasingCase.aliasing2x);
+    }
+
+    // oversampling doesn't make it noticeably worse, and buys at least 10dB where 1x aliases badly
+    for (const AliasingCase &aliasingCase : cases)
+    {
+        TEST_ASSERT_LESS_THAN_FLOAT(aliasingCase.aliasing1x + 3.0f, aliasingCase.aliasing2x);
+        if (aliasingCase.aliasing1x > -20.0f)
+        {
+            TEST_ASSERT_LESS_THAN_FLOAT(aliasingCase.aliasing1x - 10.0f, aliasingCase.aliasing2x);
+        }
+    }
+    // low carriers are clean without oversampling
+    TEST_ASSERT_LESS_THAN_FLOAT(-60.0f, cases[0].aliasing1x);
+}
+
+void test_waveform_aliasing()
+{
+    printf("waveform   carrier   1x        2x\n");
+    for (const WaveformCase &waveformCase : waveformCases)
+    {
+        float aliasing1x = measureAliasing(waveformCase.waveform, 0.0f, waveformCase.bin, 1);
+        float aliasing2x = measureAliasing(waveformCase.waveform, 0.0f, waveformCase.bin, 2);
+        printf("%-8s   %.0fkhz    %5.0fdB   %5.0fdB\n", waveformCase.name,
+               waveformCase.bin * AUDIO_SAMPLE_RATE_EXACT / FFT_SIZE / 1000.0f, aliasing1x, aliasing2x);
+
+        // band-limited at both rates
+        TEST_ASSERT_LESS_THAN_FLOAT(waveformCase.aliasing1x + 1.0f, aliasing1x);
+        TEST_ASSERT_LESS_THAN_FLOAT(waveformCase.aliasing2x + 1.0f, aliasing2x);
+    }
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_aliasing_table);
+    RUN_TEST(test_waveform_aliasing);
+    return UNITY_END();
+}
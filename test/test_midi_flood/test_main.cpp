@@ -0,0 +1,209 @@
+#include <unity.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <Arduino.h>
+#include <USBHost_t36.h>
+#include <MIDI.h>
+
+// the MIDI ingest statistics are logged every cpuMetro period, see task() in src/SynthController.h
+#define DEBUG_CPU_USAGE
+
+// included in the same order as in main.cpp, the Synth is replaced by the stub
+#include "SynthStub.h"
+#include "Constants.h"
+#include "MiscUtil.h"
+#include "SynthController.h"
+
+// Flood of notes, control changes, pitch bends and program changes (like src/tmixflood.py) sent live to the USB, serial
+// and USB host MIDI of the SynthController on the host clock, checking that the main loop keeps up: nothing is dropped,
+// every note reaches the synth and the ingest latency stays within a few main loops.
+// The host has no audio interrupt, so audio deadline misses and audio transactions can't be measured here, replay the
+// flood on the synth for those (see src/tmixflood.py). Set TMIXFLOOD_LOG to write the logged statistics to a file, to be
+// summarized by "tmixflood.py report".
+
+// messages per second of all ports together, the defaults of src/tmixflood.py
+static const uint32_t NOTE_RATE{1000};
+static const uint32_t CC_RATE{1500};
+static const uint32_t PITCH_RATE{480};
+static const uint32_t PROGRAM_RATE{2};
+static const uint32_t NOTE_MICROS{100000};
+// two statistics periods (cpuMetro)
+static const uint32_t FLOOD_MICROS{4000000};
+// host clock step per main loop
+static const uint32_t LOOP_MICROS{100};
+// time the messages may take from the port to the synth, a few main loops
+static const uint32_t LATENCY_MAX_MICROS{1000};
+
+static usb_midi_class usbMidi;
+static midi::SerialMIDI<HardwareSerial> serialMidi1(Serial1);
+static SerialMidiInterface hardwareSerialMidi(serialMidi1);
+static MIDIDeviceBase usbHostMidi1;
+static MIDIDeviceBase usbHostMidi2;
+static std::vector<MIDIDeviceBase *> usbHostMidiDevices{{&usbHostMidi1, &usbHostMidi2}};
+
+static SynthController synthController;
+
+/**
+ * A message of the flood.
+ */
+struct FloodMessage
+{
+    uint32_t timestamp;
+    HostMidiDevice *port;
+    HostMidiMessage message;
+};
+
+/**
+ * Generate the flood, each kind of message evenly spread with random jitter, the ports taking turns.
+ *
+ * @param noteCount set to the number of notes
+ */
+static std::vector<FloodMessage> generateFlood(uint32_t &noteCount)
+{
+    std::vector<HostMidiDevice *> ports{&usbMidi, &hardwareSerialMidi, &usbHostMidi1};
+    std::mt19937 rng(1);
+    std::vector<FloodMessage> flood;
+    auto schedule = [&](uint32_t rate, auto &&add)
+    {
+        for (uint32_t i = 0; i < rate * (FLOOD_MICROS / 1000000); i++)
+        {
+            uint32_t period = 1000000 / rate;
+            add(i * period + rng() % period, ports[i % ports.size()], i);
+        }
+    };
+
+    noteCount = 0;
+    // a note on and a note off per note
+    schedule(NOTE_RATE / 2, [&](uint32_t timestamp, HostMidiDevice *port, uint32_t i)
+    {
+        uint8_t note = 36 + i % 48;
+        flood.push_back(FloodMessage{timestamp, port, {HostMidiMessage::Type::noteOn, 1, note, 100}});
+        flood.push_back(FloodMessage{timestamp + NOTE_MICROS, port, {HostMidiMessage::Type::noteOff, 1, note, 0}});
+        noteCount++;
+    });
+    schedule(CC_RATE, [&](uint32_t timestamp, HostMidiDevice *port, uint32_t i)
+    {
+        static const uint8_t controls[]{16, 17, 18, 19, 74};
+        flood.push_back(FloodMessage{timestamp, port, {HostMidiMessage::Type::controlChange, 1, controls[i % 5], (int)(i % 128)}});
+    });
+    schedule(PITCH_RATE, [&](uint32_t timestamp, HostMidiDevice *port, uint32_t i)
+    {
+        flood.push_back(FloodMessage{timestamp, port, {HostMidiMessage::Type::pitchChange, 1, 0, (int)(i * 97 % 16384) - 8192}});
+    });
+    schedule(PROGRAM_RATE, [&](uint32_t timestamp, HostMidiDevice *port, uint32_t i)
+    {
+        flood.push_back(FloodMessage{timestamp, port, {HostMidiMessage::Type::programChange, 1, (uint8_t)(i % 4), 0}});
+    });
+
+    std::stable_sort(flood.begin(), flood.end(), [](const FloodMessage &a, const FloodMessage &b)
+    {
+        return a.timestamp < b.timestamp;
+    });
+    return flood;
+}
+
+/**
+ * Count the synth calls starting with a prefix.
+ */
+static uint32_t countSynthCalls(const std::string &prefix)
+{
+    return std::count_if(hostSynthCalls.begin(), hostSynthCalls.end(), [&](const std::string &call)
+    {
+        return call.rfind(prefix, 0) == 0;
+    });
+}
+
+void setUp()
+{
+    hostSynthCalls.clear();
+    hostSerialOutput.clear();
+}
+
+void tearDown() {}
+
+void test_flood_keeps_up()
+{
+    uint32_t noteCount;
+    std::vector<FloodMessage> flood = generateFlood(noteCount);
+    synthController.initialize(&usbHostMidiDevices, &usbMidi, &hardwareSerialMidi);
+    // the statistics period starts with the flood
+    hostSerialOutput.clear();
+
+    // main loop on the host clock, the last statistics period ends after the last message
+    uint32_t startMicros = micros();
+    size_t next{0};
+    double midiTaskNanosMax{0};
+    double midiTaskNanosTotal{0};
+    uint32_t loops{0};
+    while (micros() - startMicros < FLOOD_MICROS + NOTE_MICROS + LOOP_MICROS)
+    {
+        hostClockNanos += LOOP_MICROS * 1000;
+        while (next < flood.size() && flood[next].timestamp <= micros() - startMicros)
+        {
+            const HostMidiMessage &message = flood[next].message;
+            flood[next++].port->hostReceive(message.type, message.channel, message.data1, message.data2);
+        }
+
+        synthController.task();
+        auto begin = std::chrono::steady_clock::now();
+        synthController.midiTask();
+        double nanos = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - begin).count();
+        midiTaskNanosMax = std::max(midiTaskNanosMax, nanos);
+        midiTaskNanosTotal += nanos;
+        loops++;
+        // patch loads of the program changes
+        hostRunThread();
+    }
+
+    if (getenv("TMIXFLOOD_LOG"))
+    {
+        std::ofstream(getenv("TMIXFLOOD_LOG")) << hostSerialOutput;
+    }
+
+    // sum the ingest statistics of all periods
+    uint32_t dropped{0};
+    uint32_t latencyMaxMicros{0};
+    uint32_t periods{0};
+    std::istringstream log(hostSerialOutput);
+    for (std::string line; std::getline(log, line);)
+    {
+        char name[32];
+        float rate;
+        uint32_t count, average, latency, depth;
+        if (sscanf(line.c_str(), "MIDI ingest source %31[^:]: %f messages/s, %u dropped", name, &rate, &count) == 3)
+        {
+            dropped += count;
+        }
+        else if (sscanf(line.c_str(), "MIDI ingest priority %31[^:]: %u dispatched, latency %uus average, %uus max, max queue depth %u", name, &count, &average, &latency, &depth) == 5)
+        {
+            printf("%s\n", line.c_str());
+            latencyMaxMicros = std::max(latencyMaxMicros, latency);
+            periods += strcmp(name, "note") == 0 ? 1 : 0;
+        }
+    }
+    printf("%zu messages in %ums, %u dropped, ingest latency at most %uus, midiTask() at most %.1fus, %.1fus average on the host CPU\n",
+        flood.size(), FLOOD_MICROS / 1000, dropped, latencyMaxMicros, midiTaskNanosMax / 1000, midiTaskNanosTotal / loops / 1000);
+
+    TEST_ASSERT_EQUAL_INT_MESSAGE(2, periods, "ingest statistics not logged");
+    TEST_ASSERT_EQUAL_INT(0, dropped);
+    TEST_ASSERT_EQUAL_INT(noteCount, countSynthCalls("noteOn "));
+    TEST_ASSERT_EQUAL_INT(noteCount, countSynthCalls("noteOff "));
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(LATENCY_MAX_MICROS, latencyMaxMicros);
+}
+
+int main()
+{
+    hostClockManual = true;
+    hostSerialCapture = true;
+
+    UNITY_BEGIN();
+    RUN_TEST(test_flood_keeps_up);
+    return UNITY_END();
+}
@@ -0,0 +1,115 @@
+#include <unity.h>
+#include <stdio.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include <Arduino.h>
+#include <USBHost_t36.h>
+#include <MIDI.h>
+
+// included in the same order as in main.cpp, the Synth is replaced by the stub
+#include "SynthStub.h"
+#include "Constants.h"
+#include "MiscUtil.h"
+#include "SynthController.h"
+
+// The MIDI ingest stage of the SynthController, see ingestMidi() and midiTask() in src/SynthController.h.
+// The MIDI sources are the host MIDI devices of test/stub/HostMidiDevice.h, the notes and sustain reaching the synth
+// are logged by test/stub/SynthStub.h.
+
+using Type = HostMidiMessage::Type;
+
+static usb_midi_class usbMidi;
+static midi::SerialMIDI<HardwareSerial> serialMidi1(Serial1);
+static SerialMidiInterface hardwareSerialMidi(serialMidi1);
+static MIDIDeviceBase usbHostMidi1;
+static MIDIDeviceBase usbHostMidi2;
+static std::vector<MIDIDeviceBase *> usbHostMidiDevices{{&usbHostMidi1, &usbHostMidi2}};
+
+static SynthController synthController;
+
+static size_t countSynthCalls(const std::string &call)
+{
+    return std::count_if(hostSynthCalls.begin(), hostSynthCalls.end(), [&call](const std::string &synthCall)
+    {
+        return synthCall.rfind(call, 0) == 0;
+    });
+}
+
+void setUp()
+{
+    hostSynthCalls.clear();
+}
+
+void tearDown() {}
+
+void test_note_off_after_sustain_on_is_held()
+{
+    // note on, pedal down and note off read in the same drain, the note off must reach the synth after the pedal
+    usbMidi.hostReceive(Type::noteOn, 1, 60, 100);
+    usbMidi.hostReceive(Type::controlChange, 1, 64, 127);
+    usbMidi.hostReceive(Type::noteOff, 1, 60);
+    // pedal up and a note on a second port in between, the note off of the first port still follows its pedal
+    usbMidi.hostReceive(Type::controlChange, 1, 64, 0);
+    hardwareSerialMidi.hostReceive(Type::noteOn, 1, 64, 100);
+    synthController.midiTask();
+
+    const std::vector<std::string> expected{"noteOn 60", "sustain on", "noteOff 60", "sustain off", "noteOn 64"};
+    TEST_ASSERT_EQUAL_INT(expected.size(), hostSynthCalls.size());
+    for (size_t i = 0; i < expected.size(); i++)
+    {
+        TEST_ASSERT_EQUAL_STRING(expected[i].c_str(), hostSynthCalls[i].c_str());
+    }
+}
+
+void test_midimix_connected_after_boot()
+{
+    // a keyboard on the second USB host port plays notes
+    usbHostMidi2.hostReceive(Type::noteOn, 1, CONTROL_NT_MENU, 100);
+    usbHostMidi2.hostReceive(Type::noteOff, 1, CONTROL_NT_MENU);
+    synthController.midiTask();
+    TEST_ASSERT_EQUAL_INT(1, countSynthCalls("noteOn"));
+
+    // a MIDImix connected to the port after boot is used as controller, its buttons don't play notes (the menu button
+    // pressed twice enters and leaves the menu)
+    usbHostMidi2.hostVendor = 0x09e8;
+    usbHostMidi2.hostProduct = 0x0031;
+    hostSynthCalls.clear();
+    synthController.task();
+    for (uint8_t i = 0; i < 2; i++)
+    {
+        usbHostMidi2.hostReceive(Type::noteOn, 1, CONTROL_NT_MENU, 127);
+        usbHostMidi2.hostReceive(Type::noteOff, 1, CONTROL_NT_MENU);
+    }
+    synthController.midiTask();
+    TEST_ASSERT_EQUAL_INT(0, countSynthCalls("noteOn"));
+
+    // the lights are sent to the new controller by the next light state tick
+    elapsedMillis waitMillis;
+    while (usbHostMidi2.sent.empty() && waitMillis < 1000)
+    {
+        synthController.task();
+    }
+    TEST_ASSERT_FALSE(usbHostMidi2.sent.empty());
+    TEST_ASSERT_TRUE(usbHostMidi1.sent.empty());
+
+    // disconnected, the port is external MIDI again
+    usbHostMidi2.hostVendor = 0;
+    usbHostMidi2.hostProduct = 0;
+    synthController.task();
+    usbHostMidi2.hostReceive(Type::noteOn, 1, CONTROL_NT_MENU, 100);
+    usbHostMidi2.hostReceive(Type::noteOff, 1, CONTROL_NT_MENU);
+    synthController.midiTask();
+    TEST_ASSERT_EQUAL_INT(1, countSynthCalls("noteOn"));
+}
+
+int main()
+{
+    synthController.initialize(&usbHostMidiDevices, &usbMidi, &hardwareSerialMidi);
+
+    UNITY_BEGIN();
+    RUN_TEST(test_note_off_after_sustain_on_is_held);
+    RUN_TEST(test_midimix_connected_after_boot);
+    return UNITY_END();
+}
@@ -0,0 +1,86 @@
+#include <unity.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+#include <Arduino.h>
+#include "MidiOutputQueue.h"
+
+// Order of the control changes, NRPNs and program changes sent by the MIDI output queue, see src/MidiOutputQueue.h.
+// A value queued before a program change belongs to the old program and has to reach the DAW before the program change.
+
+/**
+ * Send the queued messages, without pacing.
+ *
+ * @return std::vector<std::string> sent messages, e.g. "cc 7 100", "pc 3"
+ */
+static std::vector<std::string> sendAll(MidiOutputQueue &queue)
+{
+    std::vector<std::string> sent;
+    queue.task([&sent](MidiEventType type, uint8_t channel, uint8_t data1, uint8_t data2)
+    {
+        if (type == MidiEventType::programChange)
+        {
+            sent.push_back("pc " + std::to_string(data1));
+        }
+        else
+        {
+            sent.push_back("cc " + std::to_string(data1) + " " + std::to_string(data2));
+        }
+    });
+    return sent;
+}
+
+static void assertSent(const std::vector<std::string> &expected, const std::vector<std::string> &sent)
+{
+    TEST_ASSERT_EQUAL_INT(expected.size(), sent.size());
+    for (size_t i = 0; i < expected.size(); i++)
+    {
+        TEST_ASSERT_EQUAL_STRING(expected[i].c_str(), sent[i].c_str());
+    }
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_control_changes_around_program_change()
+{
+    MidiOutputQueue queue(1, 0);
+    queue.controlChange(7, 100);
+    queue.controlChange(7, 101);
+    queue.programChange(3);
+    queue.controlChange(7, 20);
+    queue.controlChange(8, 30);
+    queue.controlChange(7, 21);
+
+    assertSent({"cc 7 101", "pc 3", "cc 7 21", "cc 8 30"}, sendAll(queue));
+    TEST_ASSERT_FALSE(queue.isPending());
+}
+
+void test_nrpns_around_program_change()
+{
+    MidiOutputQueue queue(1, 0);
+    queue.nrpn(130, 1000);
+    queue.nrpn(130, 1001);
+    queue.programChange(3);
+    queue.nrpn(130, 2000);
+    queue.nrpn(131, 3000);
+    queue.nrpn(130, 2001);
+
+    // NRPN 130 (1 << 7 | 2) = 1001 (7 << 7 | 105) belongs to the old program
+    assertSent({"cc 99 1", "cc 98 2", "cc 6 7", "cc 38 105",
+                "pc 3",
+                "cc 99 1", "cc 98 2", "cc 6 15", "cc 38 81",
+                "cc 99 1", "cc 98 3", "cc 6 23", "cc 38 56"},
+               sendAll(queue));
+    TEST_ASSERT_FALSE(queue.isPending());
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_control_changes_around_program_change);
+    RUN_TEST(test_nrpns_around_program_change);
+    return UNITY_END();
+}
@@ -0,0 +1,191 @@
+#include <unity.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include <Arduino.h>
+#include <USBHost_t36.h>
+#include <MIDI.h>
+
+// the capture is replayed at startup, see initialize() in src/SynthController.h
+#define DEBUG_MIDI_REPLAY
+
+// included in the same order as in main.cpp, the Synth is replaced by the stub
+#include "SynthStub.h"
+#include "Constants.h"
+#include "MiscUtil.h"
+#include "SynthController.h"
+
+// Replay of a MIDI capture (see src/MidiCapture.h and src/MidiReplay.h) through the SynthController on the host, with
+// the captured timing on the host clock, so a capture can be stepped through in a debugger.
+// Without arguments a generated capture is replayed and the time the notes reach the synth is checked. To replay a
+// capture recorded on the synth (DEBUG_MIDI_CAPTURE), set TMIXMIDI_CAPTURE to the path of the .tmixmidi file: the
+// notes and sustain reaching the synth are printed with their time and the notes left on are reported.
+
+// host clock step per main loop
+static const uint32_t LOOP_MICROS{100};
+// time the notes may take from the capture to the synth, at most a few main loops
+static const uint32_t LATENCY_MAX_MICROS{1000};
+
+static usb_midi_class usbMidi;
+static midi::SerialMIDI<HardwareSerial> serialMidi1(Serial1);
+static SerialMidiInterface hardwareSerialMidi(serialMidi1);
+static MIDIDeviceBase usbHostMidi1;
+static MIDIDeviceBase usbHostMidi2;
+static std::vector<MIDIDeviceBase *> usbHostMidiDevices{{&usbHostMidi1, &usbHostMidi2}};
+
+static SynthController synthController;
+
+/**
+ * A message of the generated capture.
+ */
+struct CapturedNote
+{
+    uint32_t timestamp;
+    uint8_t source;
+    MidiEventType type;
+    uint8_t note;
+};
+
+/**
+ * Generate a capture: notes on the USB and serial MIDI, including a burst of more notes than MidiIngest::SOURCE_BUDGET
+ * on both sources at the same time.
+ */
+static std::vector<uint8_t> generateCapture(std::vector<CapturedNote> &notes)
+{
+    for (uint32_t i = 0; i < 16; i++)
+    {
+        uint32_t timestamp = 10000 + i * 5000;
+        notes.push_back(CapturedNote{timestamp, (uint8_t)(i % 2), MidiEventType::noteOn, (uint8_t)(80 + i)});
+        notes.push_back(CapturedNote{timestamp + 2500, (uint8_t)(i % 2), MidiEventType::noteOff, (uint8_t)(80 + i)});
+    }
+    for (uint8_t i = 0; i < 3 * MidiIngest::SOURCE_BUDGET; i++)
+    {
+        notes.push_back(CapturedNote{200000, (uint8_t)(i % 2), MidiEventType::noteOn, (uint8_t)(20 + i)});
+    }
+    std::stable_sort(notes.begin(), notes.end(), [](const CapturedNote &a, const CapturedNote &b)
+    {
+        return a.timestamp < b.timestamp;
+    });
+
+    MidiIngest ingest;
+    ingest.addSource("USB");
+    ingest.addSource("serial");
+    std::vector<uint8_t> data;
+    MidiCaptureFile::writeHeader(ingest, data);
+    for (const CapturedNote &note : notes)
+    {
+        MidiCaptureFile::writeRecord(MidiEvent{0, note.source, note.type, 1, note.note, 100, false}, note.timestamp, data);
+    }
+    return data;
+}
+
+/**
+ * Run the main loop on the host clock until the replay is over.
+ *
+ * @param endMicros time of the last captured message
+ * @param callMicros set to the time of each synth call, see hostSynthCalls
+ */
+static void replay(uint32_t endMicros, std::vector<uint32_t> &callMicros)
+{
+    // loading the capture, the replay starts when it has been read by the storage thread
+    synthController.task();
+    hostRunThread();
+    synthController.task();
+    uint32_t startMicros = micros();
+
+    while (micros() - startMicros <= endMicros + 100000)
+    {
+        hostClockNanos += LOOP_MICROS * 1000;
+        synthController.task();
+        synthController.midiTask();
+        while (callMicros.size() < hostSynthCalls.size())
+        {
+            callMicros.push_back(micros() - startMicros);
+        }
+    }
+}
+
+void setUp()
+{
+    hostSynthCalls.clear();
+}
+
+void tearDown() {}
+
+void test_replay_generated_capture()
+{
+    std::vector<CapturedNote> notes;
+    SD.files[MidiCaptureFile::FILE_NAME] = generateCapture(notes);
+    synthController.initialize(&usbHostMidiDevices, &usbMidi, &hardwareSerialMidi);
+
+    std::vector<uint32_t> callMicros;
+    replay(notes.back().timestamp, callMicros);
+
+    // every note reaches the synth once, in order per source, shortly after its captured time
+    TEST_ASSERT_EQUAL_INT(notes.size(), hostSynthCalls.size());
+    uint32_t latencyMax{0};
+    for (const CapturedNote &note : notes)
+    {
+        std::string call = (note.type == MidiEventType::noteOn ? "noteOn " : "noteOff ") + std::to_string(note.note);
+        auto found = std::find(hostSynthCalls.begin(), hostSynthCalls.end(), call);
+        TEST_ASSERT_TRUE_MESSAGE(found != hostSynthCalls.end(), call.c_str());
+        uint32_t micros = callMicros[found - hostSynthCalls.begin()];
+        TEST_ASSERT_TRUE_MESSAGE(micros >= note.timestamp, "note replayed before its captured time");
+        latencyMax = std::max(latencyMax, micros - note.timestamp);
+    }
+    printf("replayed %zu notes, at most %uus after their captured time\n", notes.size(), latencyMax);
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(LATENCY_MAX_MICROS, latencyMax);
+}
+
+void test_replay_capture_file()
+{
+    std::ifstream file(getenv("TMIXMIDI_CAPTURE"), std::ios::binary);
+    TEST_ASSERT_TRUE_MESSAGE(file.good(), "TMIXMIDI_CAPTURE not found");
+    std::vector<uint8_t> data{std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+    uint16_t headerSize = MidiCaptureFile::readHeader(data.data(), data.size());
+    TEST_ASSERT_TRUE_MESSAGE(headerSize > 0 && data.size() > headerSize, "invalid or empty capture");
+    uint32_t endMicros = MidiCaptureFile::readRecord(data.data() + data.size() - MidiCaptureFile::RECORD_SIZE).timestamp;
+
+    SD.files[MidiCaptureFile::FILE_NAME] = data;
+    synthController.initialize(&usbHostMidiDevices, &usbMidi, &hardwareSerialMidi);
+
+    std::vector<uint32_t> callMicros;
+    replay(endMicros, callMicros);
+
+    std::vector<std::string> notesOn;
+    for (size_t i = 0; i < hostSynthCalls.size(); i++)
+    {
+        printf("%10.3fms %s\n", callMicros[i] / 1000.0f, hostSynthCalls[i].c_str());
+        const std::string &call = hostSynthCalls[i];
+        if (call.rfind("noteOn ", 0) == 0)
+        {
+            notesOn.push_back(call.substr(7));
+        }
+        else if (call.rfind("noteOff ", 0) == 0 && std::find(notesOn.begin(), notesOn.end(), call.substr(8)) != notesOn.end())
+        {
+            notesOn.erase(std::find(notesOn.begin(), notesOn.end(), call.substr(8)));
+        }
+    }
+    printf("%zu messages replayed, %zu synth calls, %zu notes left on\n", (data.size() - headerSize) / MidiCaptureFile::RECORD_SIZE, hostSynthCalls.size(), notesOn.size());
+}
+
+int main()
+{
+    hostClockManual = true;
+
+    UNITY_BEGIN();
+    if (getenv("TMIXMIDI_CAPTURE"))
+    {
+        RUN_TEST(test_replay_capture_file);
+    }
+    else
+    {
+        RUN_TEST(test_replay_generated_capture);
+    }
+    return UNITY_END();
+}
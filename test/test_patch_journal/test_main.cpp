@@ -0,0 +1,160 @@
+#include <unity.h>
+#include <stdio.h>
+#include <algorithm>
+#include <array>
+#include <string>
+#include <vector>
+
+#include <Arduino.h>
+#include <USBHost_t36.h>
+
+// included in the same order as in main.cpp, the Synth is replaced by the stub
+#include "SynthStub.h"
+#include "Constants.h"
+#include "MiscUtil.h"
+
+class DisplayService
+{
+public:
+    void displayError(const std::string &error) const {}
+};
+
+#include "PatchService.h"
+
+// Power loss while saving patches, see the patch journal and compaction in src/PatchService.h.
+// The saves are repeated with the power lost after every possible number of bytes written (and in between the file
+// operations, see test/stub/FS.h), followed by a boot. The boot must recover either the patch bank from before or from
+// after the interrupted save, and booting again must not change it.
+
+using PatchBankPatches = std::array<Patch, PATCH_COUNT>;
+
+// more saves than PatchService::JOURNAL_COMPACTION_ENTRIES, so a compaction is interrupted as well
+static const uint8_t SAVE_COUNT{40};
+
+static DisplayService displayService;
+
+static uint8_t savedPatchNumber(uint8_t save)
+{
+    return save % 5 * 3;
+}
+
+static Patch savedPatch(uint8_t save)
+{
+    Patch patch("Save " + std::to_string(save));
+    patch.setParamValue14ByIndex(save % PARAM_COUNT, (save * 907) % 16384);
+    return patch;
+}
+
+static bool samePatches(const PatchBankPatches &patches, const PatchBankPatches &expectedPatches)
+{
+    for (uint8_t patchNumber = 0; patchNumber < PATCH_COUNT; patchNumber++)
+    {
+        if (patches[patchNumber].getName() != expectedPatches[patchNumber].getName())
+        {
+            return false;
+        }
+        for (uint8_t index = 0; index < PARAM_COUNT; index++)
+        {
+            if (patches[patchNumber].getParamValue14ByIndex(index) != expectedPatches[patchNumber].getParamValue14ByIndex(index))
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static PatchService *boot()
+{
+    hostPowerBudget = -1;
+    PatchService *patchService = new PatchService();
+    patchService->initialize(&displayService);
+    return patchService;
+}
+
+static PatchBankPatches bootPatches()
+{
+    PatchService *patchService = boot();
+    PatchBankPatches patches;
+    for (uint8_t patchNumber = 0; patchNumber < PATCH_COUNT; patchNumber++)
+    {
+        patches[patchNumber] = patchService->loadPatch(patchNumber);
+    }
+    delete patchService;
+    return patches;
+}
+
+static void save(PatchService &patchService, uint8_t save)
+{
+    patchService.savePatch(savedPatchNumber(save), savedPatch(save));
+    hostRunThread();
+    patchService.task();
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_power_loss_at_every_offset()
+{
+    // an empty SD card, the first boot writes the initial patch bank
+    SD.files.clear();
+    std::vector<PatchBankPatches> states{bootPatches()};
+    const auto initialFiles = SD.files;
+
+    // power used by the saves and the patch bank after each save
+    std::vector<long> powerUsed;
+    {
+        PatchService *patchService = boot();
+        const long budget{1L << 40};
+        hostPowerBudget = budget;
+        PatchBankPatches patches = states.back();
+        for (uint8_t i = 0; i < SAVE_COUNT; i++)
+        {
+            save(*patchService, i);
+            powerUsed.push_back(budget - hostPowerBudget);
+            patches[savedPatchNumber(i)] = savedPatch(i);
+            states.push_back(patches);
+        }
+        delete patchService;
+    }
+    TEST_ASSERT_TRUE(samePatches(bootPatches(), states.back()));
+
+    uint32_t failures{0};
+    long firstFailure{-1};
+    for (long budget = 0; budget <= powerUsed.back(); budget++)
+    {
+        SD.files = initialFiles;
+        PatchService *patchService = boot();
+        hostPowerBudget = budget;
+        for (uint8_t i = 0; i < SAVE_COUNT && hostPowerBudget > 0; i++)
+        {
+            save(*patchService, i);
+        }
+        delete patchService;
+
+        // saves completed before the power was lost
+        size_t completed = std::upper_bound(powerUsed.begin(), powerUsed.end(), budget) - powerUsed.begin();
+        PatchBankPatches patches = bootPatches();
+        bool recovered = samePatches(patches, states[completed]) || (completed < SAVE_COUNT && samePatches(patches, states[completed + 1]));
+        bool stable = samePatches(bootPatches(), patches);
+        if (!recovered || !stable)
+        {
+            failures++;
+            if (firstFailure < 0)
+            {
+                firstFailure = budget;
+            }
+        }
+    }
+
+    printf("power lost at %ld offsets of %d saves, %u failures, first failure at %ld\n", powerUsed.back() + 1, SAVE_COUNT, failures, firstFailure);
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0, failures, "patch bank not recovered after a power loss");
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_power_loss_at_every_offset);
+    return UNITY_END();
+}
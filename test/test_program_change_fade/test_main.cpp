@@ -0,0 +1,152 @@
+#include <unity.h>
+#include <stdio.h>
+#include <math.h>
+#include <vector>
+
+#include <Arduino.h>
+#include "ConstantValues.h"
+#include "AudioConfig.h"
+#include "AudioMixerSmoothed4.h"
+#include "ControlSmoother.h"
+
+// Transient of a program change while a voice is sounding, the measurement behind the staged program change in
+// SynthController::applyCurrentPatch() / patchChangeTask().
+// A voice playing the old patch switches to the new patch (different frequency, level and phase) at a block boundary.
+// Applied directly, the switch is a hard jump. Staged, the voice mixer (Synth::setVoiceFade()) fades the voice out, the
+// new patch is applied after ControlSmoother::getSettleMicros() (as in patchChangeTask()) and the voice is faded in.
+// The main loop is stepped in LOOP_MICROS on the audio block clock, patchChangeTask() runs at every step.
+
+// block of the program change
+static const uint32_t CHANGE_BLOCK{40};
+static const uint32_t BLOCK_COUNT{200};
+// main loop period
+static const uint32_t LOOP_MICROS{100};
+// blocks before and after a switch in which the error signal is measured
+static const uint32_t ERROR_WINDOW_BLOCKS{2};
+
+static int16_t voiceSample(bool newPatch, uint32_t n)
+{
+    float t = n / AUDIO_SAMPLE_RATE_EXACT;
+    return (int16_t)(newPatch ? 16384.0f * sinf(2.0f * M_PI * 330.0f * t + 2.0f) : 26214.0f * sinf(2.0f * M_PI * 220.0f * t));
+}
+
+/**
+ * Render the voice through the voice mixer.
+ *
+ * @param staged true to stage the program change behind a fade, false to apply it directly
+ * @param applyBlock set to the block in which the new patch is applied
+ * @return std::vector<float> output samples (-1.0f - 1.0f)
+ */
+static std::vector<float> render(bool staged, uint32_t &applyBlock)
+{
+    // the first audio block after the first main loop seeing the elapsed time reach the settle time
+    const float blockMicros = AUDIO_BLOCK_MS * 1000.0f;
+    uint32_t elapsedMicros{0};
+    while (elapsedMicros < ControlSmoother::getSettleMicros())
+    {
+        elapsedMicros += LOOP_MICROS;
+    }
+    applyBlock = staged ? CHANGE_BLOCK + (uint32_t)ceilf(elapsedMicros / blockMicros) : CHANGE_BLOCK;
+
+    AudioMixerSmoothed4 voiceMixer;
+    audio_block_t voice;
+    std::vector<float> output;
+    for (uint32_t block = 0; block < BLOCK_COUNT; block++)
+    {
+        if (staged && block == CHANGE_BLOCK)
+        {
+            voiceMixer.gain(0, 0.0f);
+        }
+        if (staged && block == applyBlock)
+        {
+            voiceMixer.gain(0, 1.0f);
+        }
+
+        for (uint32_t i = 0; i < AUDIO_BLOCK_SAMPLES; i++)
+        {
+            voice.data[i] = voiceSample(block >= applyBlock, block * AUDIO_BLOCK_SAMPLES + i);
+        }
+        voiceMixer.inputs[0] = &voice;
+        voiceMixer.outputs[0] = nullptr;
+        voiceMixer.update();
+
+        for (uint32_t i = 0; i < AUDIO_BLOCK_SAMPLES; i++)
+        {
+            output.push_back(voiceMixer.outputs[0] == nullptr ? 0.0f : voiceMixer.outputs[0]->data[i] / 32767.0f);
+        }
+    }
+    return output;
+}
+
+/**
+ * Get the largest difference between two successive samples.
+ */
+static float maxStep(const std::vector<float> &samples, uint32_t fromBlock, uint32_t toBlock)
+{
+    float step{0.0f};
+    for (uint32_t n = fromBlock * AUDIO_BLOCK_SAMPLES; n < toBlock * AUDIO_BLOCK_SAMPLES; n++)
+    {
+        step = max(step, fabsf(samples[n] - samples[n - 1]));
+    }
+    return step;
+}
+
+/**
+ * Get the energy of the error signal, the second difference of the output: the sines of the patches hardly contribute,
+ * a jump in level or slope does.
+ *
+ * @return float mean square of the error signal in dBFS
+ */
+static float errorEnergy(const std::vector<float> &samples, uint32_t fromBlock, uint32_t toBlock)
+{
+    double energy{0.0};
+    for (uint32_t n = fromBlock * AUDIO_BLOCK_SAMPLES; n < toBlock * AUDIO_BLOCK_SAMPLES; n++)
+    {
+        double error = samples[n] - 2.0 * samples[n - 1] + samples[n - 2];
+        energy += error * error;
+    }
+    return 10.0f * log10f(energy / ((toBlock - fromBlock) * AUDIO_BLOCK_SAMPLES) + 1e-20);
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_staged_program_change_transient()
+{
+    uint32_t hardApplyBlock;
+    uint32_t stagedApplyBlock;
+    std::vector<float> hard = render(false, hardApplyBlock);
+    std::vector<float> staged = render(true, stagedApplyBlock);
+
+    // the slope of the old patch itself
+    float steadyStep = maxStep(hard, 10, CHANGE_BLOCK);
+    float hardStep = maxStep(hard, CHANGE_BLOCK - 1, CHANGE_BLOCK + 2);
+    float stagedStep = maxStep(staged, CHANGE_BLOCK - 1, stagedApplyBlock + 2 * (stagedApplyBlock - CHANGE_BLOCK));
+    // windows of the same length, around the switch of the hard change and around the fade out and in of the staged one
+    uint32_t windowBlocks = stagedApplyBlock - CHANGE_BLOCK + 2 * ERROR_WINDOW_BLOCKS;
+    float steadyError = errorEnergy(hard, 10, 10 + windowBlocks);
+    float hardError = errorEnergy(hard, CHANGE_BLOCK - ERROR_WINDOW_BLOCKS, CHANGE_BLOCK - ERROR_WINDOW_BLOCKS + windowBlocks);
+    float stagedError = errorEnergy(staged, CHANGE_BLOCK - ERROR_WINDOW_BLOCKS, stagedApplyBlock + ERROR_WINDOW_BLOCKS);
+
+    printf("audio block %.3fms, new patch applied after %d blocks (%.3fms)\n", AUDIO_BLOCK_MS, stagedApplyBlock - CHANGE_BLOCK, (stagedApplyBlock - CHANGE_BLOCK) * AUDIO_BLOCK_MS);
+    printf("max sample step: steady %.3f, hard switch %.3f, staged %.3f\n", steadyStep, hardStep, stagedStep);
+    printf("error signal energy over %d blocks: steady %.1fdB, hard switch %.1fdB, staged %.1fdB\n", windowBlocks, steadyError, hardError, stagedError);
+
+    // the voice is silent when the new patch is applied
+    for (uint32_t n = (stagedApplyBlock - 1) * AUDIO_BLOCK_SAMPLES; n < stagedApplyBlock * AUDIO_BLOCK_SAMPLES; n++)
+    {
+        TEST_ASSERT_TRUE_MESSAGE(staged[n] == 0.0f, "voice not faded out when the new patch is applied");
+    }
+    TEST_ASSERT_GREATER_THAN_FLOAT(4.0f * steadyStep, hardStep);
+    TEST_ASSERT_LESS_THAN_FLOAT(1.5f * steadyStep, stagedStep);
+    TEST_ASSERT_LESS_THAN_FLOAT(hardError - 20.0f, stagedError);
+    TEST_ASSERT_LESS_THAN_FLOAT(steadyError + 6.0f, stagedError);
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_staged_program_change_transient);
+    return UNITY_END();
+}
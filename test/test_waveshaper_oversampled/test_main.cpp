@@ -0,0 +1,216 @@
+#include <unity.h>
+#include <stdio.h>
+#include <math.h>
+#include <array>
+#include <complex>
+#include <vector>
+
+#include <Arduino.h>
+#include "ConstantValues.h"
+#include "AudioEffectWaveshaperOversampled.h"
+
+// Aliasing of AudioEffectWaveshaperOversampled, the measurement behind the figures in
+// src/AudioEffectWaveshaperOversampled.h.
+// A hot sine is shaped by the tanh table of the synth (Synth::updateWaveshapeArray()), so all wanted components are
+// harmonics of the sine. The sine is placed on an FFT bin, everything outside the harmonic bins is aliasing.
+
+static const uint32_t FFT_SIZE{32768};
+// blocks rendered before measuring, so the half-band filters are settled
+static const uint32_t SETTLE_BLOCKS{64};
+// 7khz at the default sample rate
+static const uint32_t SINE_BIN{5199};
+// measured aliasing may be this much worse than the figures
+static const float TOLERANCE_DB{1.0f};
+
+struct AliasingCase
+{
+    // waveshape level of the tanh table (0.0f - 1.0f)
+    float level;
+    // aliasing of a full scale sine at 1x, 2x and 4x oversampling in dB
+    std::array<float, 3> aliasing;
+};
+
+// the table in src/AudioEffectWaveshaperOversampled.h
+static const AliasingCase cases[]{
+    {0.02f, {{-26.0f, -59.0f, -77.0f}}},
+    {0.1f, {{-14.0f, -26.0f, -48.0f}}},
+};
+static const std::array<uint8_t, 3> FACTORS{{1, 2, 4}};
+
+static std::array<int16_t, WaveshapeTable::SIZE> waveshapeArray;
+static WaveshapeTable waveshapeTable;
+
+static void fft(std::vector<std::complex<double>> &data)
+{
+    const size_t n = data.size();
+    for (size_t i = 1, j = 0; i < n; i++)
+    {
+        size_t bit = n >> 1;
+        for (; j & bit; bit >>= 1)
+        {
+            j ^= bit;
+        }
+        j ^= bit;
+        if (i < j)
+        {
+            std::swap(data[i], data[j]);
+        }
+    }
+    for (size_t length = 2; length <= n; length <<= 1)
+    {
+        const std::complex<double> step = std::polar(1.0, -2.0 * M_PI / length);
+        for (size_t i = 0; i < n; i += length)
+        {
+            std::complex<double> w{1.0};
+            for (size_t j = 0; j < length / 2; j++)
+            {
+                std::complex<double> a = data[i + j];
+                std::complex<double> b = data[i + j + length / 2] * w;
+                data[i + j] = a + b;
+                data[i + j + length / 2] = a - b;
+                w *= step;
+            }
+        }
+    }
+}
+
+/**
+ * Build the tanh table like Synth::updateWaveshapeArray().
+ */
+static void buildWaveshapeTable(float level)
+{
+    constexpr uint16_t center = WaveshapeTable::SIZE / 2;
+    float drive = 1.0f + level * 64.0f;
+    waveshapeArray[center] = 0;
+    for (uint16_t offset = 1; offset <= center; offset++)
+    {
+        float x = (float)offset / (float)center;
+        int16_t value = (int16_t)lroundf(32767.0f * 0.25f * tanhf(drive * x));
+        waveshapeArray[center + offset] = value;
+        waveshapeArray[center - offset] = -value;
+    }
+    waveshapeTable.publish(waveshapeArray.data());
+}
+
+/**
+ * Render a sine on each channel through the shaped signal of the waveshaper.
+ *
+ * @param oversampling oversampling factor (1, 2 or 4)
+ * @param amplitudeL amplitude of the left sine (0.0f - 1.0f)
+ * @param amplitudeR amplitude of the right sine (0.0f - 1.0f)
+ * @param outputL left output samples
+ * @param outputR right output samples
+ */
+static void render(uint8_t oversampling, float amplitudeL, float amplitudeR, std::vector<int16_t> &outputL, std::vector<int16_t> &outputR)
+{
+    const double frequency = SINE_BIN * (double)AUDIO_SAMPLE_RATE_EXACT / FFT_SIZE;
+    AudioEffectWaveshaperOversampled waveshaper;
+    waveshaper.shape(waveshapeTable);
+    waveshaper.oversampling(oversampling);
+    waveshaper.mix(0.0f, 1.0f);
+
+    uint32_t n{0};
+    for (uint32_t block = 0; outputL.size() < FFT_SIZE; block++)
+    {
+        audio_block_t blockL;
+        audio_block_t blockR;
+        for (uint16_t i = 0; i < AUDIO_BLOCK_SAMPLES; i++, n++)
+        {
+            double sine = sin(2.0 * M_PI * frequency * n / AUDIO_SAMPLE_RATE_EXACT);
+            blockL.data[i] = (int16_t)lround(32767.0 * amplitudeL * sine);
+            blockR.data[i] = (int16_t)lround(32767.0 * amplitudeR * sine);
+        }
+        waveshaper.inputs[0] = &blockL;
+        waveshaper.inputs[1] = &blockR;
+        waveshaper.update();
+
+        // the mix ramps to the shaped signal in the first blocks
+        for (uint16_t i = 0; block >= SETTLE_BLOCKS && i < AUDIO_BLOCK_SAMPLES; i++)
+        {
+            outputL.push_back(waveshaper.outputs[0]->data[i]);
+            outputR.push_back(waveshaper.outputs[1]->data[i]);
+        }
+    }
+}
+
+/**
+ * Measure the aliasing of a rendered channel.
+ *
+ * @return float level of the non-harmonic components relative to the total output in dB
+ */
+static float measureAliasing(const std::vector<int16_t> &samples)
+{
+    std::vector<std::complex<double>> spectrum(samples.begin(), samples.end());
+    fft(spectrum);
+    double harmonics{0.0};
+    double aliasing{0.0};
+    for (uint32_t k = 1; k <= FFT_SIZE / 2; k++)
+    {
+        (k % SINE_BIN == 0 ? harmonics : aliasing) += std::norm(spectrum[k]);
+    }
+    return 10.0f * log10f(aliasing / (harmonics + aliasing));
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_aliasing_of_a_hot_sine()
+{
+    printf("7khz sine          1x                2x                4x\n");
+    for (const AliasingCase &aliasingCase : cases)
+    {
+        buildWaveshapeTable(aliasingCase.level);
+        // the right channel is half as loud, both channels are measured
+        std::array<float, 3> aliasingL;
+        std::array<float, 3> aliasingR;
+        for (size_t i = 0; i < FACTORS.size(); i++)
+        {
+            std::vector<int16_t> outputL;
+            std::vector<int16_t> outputR;
+            render(FACTORS[i], 1.0f, 0.5f, outputL, outputR);
+            aliasingL[i] = measureAliasing(outputL);
+            aliasingR[i] = measureAliasing(outputR);
+        }
+
+        printf("level %.2f full   %6.1fdB (%5.1f)  %6.1fdB (%5.1f)  %6.1fdB (%5.1f)\n", aliasingCase.level,
+            aliasingL[0], aliasingCase.aliasing[0], aliasingL[1], aliasingCase.aliasing[1], aliasingL[2], aliasingCase.aliasing[2]);
+        printf("level %.2f half   %6.1fdB          %6.1fdB          %6.1fdB\n", aliasingCase.level, aliasingR[0], aliasingR[1], aliasingR[2]);
+
+        for (size_t i = 0; i < FACTORS.size(); i++)
+        {
+            TEST_ASSERT_LESS_THAN_FLOAT(aliasingCase.aliasing[i] + TOLERANCE_DB, aliasingL[i]);
+            // a quieter sine has fewer and weaker harmonics to fold back
+            TEST_ASSERT_LESS_THAN_FLOAT(aliasingL[i] + TOLERANCE_DB, aliasingR[i]);
+        }
+        // oversampling is what reduces the aliasing
+        TEST_ASSERT_GREATER_THAN_FLOAT(aliasingCase.aliasing[0] - TOLERANCE_DB, aliasingL[0]);
+        TEST_ASSERT_LESS_THAN_FLOAT(aliasingL[0] - 10.0f, aliasingL[1]);
+        TEST_ASSERT_LESS_THAN_FLOAT(aliasingL[1] - 10.0f, aliasingL[2]);
+    }
+}
+
+void test_channels_are_independent()
+{
+    // the packed channels don't leak into each other: swapping the inputs swaps the outputs
+    buildWaveshapeTable(cases[0].level);
+    for (uint8_t factor : FACTORS)
+    {
+        std::vector<int16_t> outputL;
+        std::vector<int16_t> outputR;
+        std::vector<int16_t> swappedL;
+        std::vector<int16_t> swappedR;
+        render(factor, 1.0f, 0.3f, outputL, outputR);
+        render(factor, 0.3f, 1.0f, swappedL, swappedR);
+        TEST_ASSERT_TRUE(outputL == swappedR);
+        TEST_ASSERT_TRUE(outputR == swappedL);
+    }
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_aliasing_of_a_hot_sine);
+    RUN_TEST(test_channels_are_independent);
+    return UNITY_END();
+}